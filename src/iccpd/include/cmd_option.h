@@ -41,8 +41,15 @@
         .cmd_file_path = "/var/run/iccpd/iccpd.vty", \
         .config_file_path = "/etc/iccpd/iccpd.conf", \
         .mclagdctl_file_path = "/var/run/iccpd/mclagdctl.sock", \
+        .checkpoint_file_path = "/var/warmboot/iccpd/tables.ckpt", \
+        .capture_file_path = NULL, \
+        .replay_file_path = NULL, \
+        .replay_speed = 1, \
         .console_log = 0, \
         .telnet_port = 2015, \
+        .timer_tick_msec = 10, \
+        .fdb_bulk_redirect = 0, \
+        .netlink_rcvbuf_kb = 0, \
         .init = cmd_option_parser_init, \
         .finalize = cmd_option_parser_finalize, \
         .dump_usage = cmd_option_parser_dump_usage, \
@@ -64,8 +71,15 @@ struct CmdOptionParser
     char* cmd_file_path;
     char* config_file_path;
     char *mclagdctl_file_path;
+    char* checkpoint_file_path;
+    char* capture_file_path;
+    char* replay_file_path;
+    int replay_speed;
     uint8_t console_log;
     uint16_t telnet_port;
+    uint16_t timer_tick_msec;
+    uint8_t fdb_bulk_redirect;
+    uint32_t netlink_rcvbuf_kb;     /* 0 for the default*/
     LIST_HEAD(option_list, CmdOption) option_list;
     int (*parse)(struct CmdOptionParser*, int, char*[]);
     void (*init)(struct CmdOptionParser*);
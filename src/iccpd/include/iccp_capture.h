@@ -0,0 +1,98 @@
+/*
+ *  iccp_capture.h
+ *  Capture of the ICCP, mclagsyncd and kernel inputs, and replay of the
+ *  capture file.
+ *
+ * Copyright(c) 2016-2019 Nephos/Estinet.
+ *
+ * This program is free software; you can redistribute it and/or modify it
+ * under the terms and conditions of the GNU General Public License,
+ * version 2, as published by the Free Software Foundation.
+ *
+ * This program is distributed in the hope it will be useful, but WITHOUT
+ * ANY WARRANTY; without even the implied warranty of MERCHANTABILITY or
+ * FITNESS FOR A PARTICULAR PURPOSE.  See the GNU General Public License for
+ * more details.
+ *
+ * You should have received a copy of the GNU General Public License along with
+ * this program; if not, see <http://www.gnu.org/licenses/>.
+ *
+ * The full GNU General Public License is included in this distribution in
+ * the file called "COPYING".
+ *
+ *  Maintainer: jianjun, grace Li from nephos
+ */
+
+#ifndef _ICCP_CAPTURE_H
+#define _ICCP_CAPTURE_H
+
+#include <stdint.h>
+
+#define ICCP_CAPTURE_MAGIC          0x49435054
+#define ICCP_CAPTURE_VERSION        2
+/* Capture stops when the file reaches the size*/
+#define ICCP_CAPTURE_MAX_BYTES      (512 * 1024 * 1024)
+#define ICCP_CAPTURE_BUF_SIZE       (1024 * 1024)
+#define ICCP_CAPTURE_FLUSH_MSEC     1000
+/* Bigger records are taken as a corrupted file on replay, a checkpoint
+ * image is the biggest record*/
+#define ICCP_CAPTURE_REC_MAX_LEN    (128 * 1024 * 1024)
+
+/* Replay buffer, grown for bigger records*/
+#define ICCP_REPLAY_BUF_SIZE        (64 * 1024)
+/* Records fed in one scheduler loop, the FSMs run between batches*/
+#define ICCP_REPLAY_BATCH           64
+
+enum iccp_capture_type
+{
+    ICCP_CAPTURE_PEER_RX = 1,   /* LDP msg in wire order*/
+    ICCP_CAPTURE_PEER_TX,
+    ICCP_CAPTURE_SYNCD_RX,      /* whole mclagsyncd msg with IccpSyncdHDr*/
+    ICCP_CAPTURE_SYNCD_TX,
+    ICCP_CAPTURE_SESSION_UP,    /* one byte, 1 if accepted by the server*/
+    ICCP_CAPTURE_SESSION_DOWN,
+    ICCP_CAPTURE_START,         /* one byte, 1 on warm reboot*/
+    ICCP_CAPTURE_CONFIG,        /* one line of the config file*/
+    ICCP_CAPTURE_DUMP,          /* link, addr or neighbor msg of a kernel dump*/
+    ICCP_CAPTURE_INGEST,        /* ingest event type, then the NeighEvent or route msg*/
+    ICCP_CAPTURE_TEAM,          /* teamd genl msg, port list reply or event*/
+    ICCP_CAPTURE_CHECKPOINT,    /* checkpoint file restored at start*/
+    ICCP_CAPTURE_SWEEP,         /* int, tables of the checkpoint sweep*/
+    ICCP_CAPTURE_TYPE_MAX
+};
+
+struct System;
+struct CSM;
+struct IngestEvent;
+
+/* Head of the file in host byte order, followed by the records*/
+struct IccpCaptureHdr
+{
+    uint32_t magic;
+    uint32_t version;
+    uint32_t hdr_size;
+    uint32_t rec_hdr_size;
+    uint64_t start_sec;     /* CLOCK_REALTIME*/
+};
+
+/* Followed by len bytes of the msg*/
+struct IccpCaptureRec
+{
+    uint64_t usec;          /* since the capture start*/
+    uint32_t len;
+    uint16_t type;
+    int16_t mlag_id;        /* -1 for mclagsyncd msgs*/
+};
+
+int iccp_capture_start(struct System* sys);
+void iccp_capture_stop();
+void iccp_capture_write(int type, int mlag_id, const void* buf, uint32_t len);
+void iccp_capture_session(struct CSM* csm, int up, int accepted);
+void iccp_capture_ingest(const struct IngestEvent* ev);
+
+int iccp_replay_start(struct System* sys);
+void iccp_replay_feed(struct System* sys);
+int iccp_replay_done(struct System* sys);
+int iccp_replaying();
+
+#endif /* _ICCP_CAPTURE_H */
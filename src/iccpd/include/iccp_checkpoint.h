@@ -0,0 +1,76 @@
+/*
+ *  iccp_checkpoint.h
+ *  Warm restart checkpoint of the MAC/ARP/ND tables.
+ *
+ * Copyright(c) 2016-2019 Nephos/Estinet.
+ *
+ * This program is free software; you can redistribute it and/or modify it
+ * under the terms and conditions of the GNU General Public License,
+ * version 2, as published by the Free Software Foundation.
+ *
+ * This program is distributed in the hope it will be useful, but WITHOUT
+ * ANY WARRANTY; without even the implied warranty of MERCHANTABILITY or
+ * FITNESS FOR A PARTICULAR PURPOSE.  See the GNU General Public License for
+ * more details.
+ *
+ * You should have received a copy of the GNU General Public License along with
+ * this program; if not, see <http://www.gnu.org/licenses/>.
+ *
+ * The full GNU General Public License is included in this distribution in
+ * the file called "COPYING".
+ *
+ *  Maintainer: jianjun, grace Li from nephos
+ */
+
+#ifndef _ICCP_CHECKPOINT_H
+#define _ICCP_CHECKPOINT_H
+
+#include <stddef.h>
+#include <stdint.h>
+
+#define ICCP_CHECKPOINT_FILE            "/var/warmboot/iccpd/tables.ckpt"
+#define ICCP_CHECKPOINT_MAGIC           0x49434350
+#define ICCP_CHECKPOINT_VERSION         1
+#define ICCP_CHECKPOINT_INTERVAL_SEC    60
+/* Restored MACs not confirmed by mclagsyncd or the peer by then are dropped*/
+#define ICCP_CHECKPOINT_SWEEP_SEC       90
+
+/* Tables of iccp_checkpoint_sweep()*/
+#define ICCP_CHECKPOINT_MAC             0x01
+#define ICCP_CHECKPOINT_ARP             0x02
+#define ICCP_CHECKPOINT_NDISC           0x04
+
+struct System;
+
+/* Head of the file, followed by one section per CSM*/
+struct IccpCheckpointHdr
+{
+    uint32_t magic;
+    uint32_t version;
+    uint32_t hdr_size;
+    uint16_t mac_size;      /* entry sizes, the file is dropped if changed*/
+    uint16_t arp_size;
+    uint16_t ndisc_size;
+    uint16_t csm_num;
+    uint64_t save_sec;      /* CLOCK_REALTIME*/
+    uint64_t data_len;
+    uint32_t crc;           /* CRC-32 of the data after the head*/
+    uint32_t pad;
+};
+
+/* Followed by the MACMsg, ARPMsg and NDISCMsg entries of the CSM*/
+struct IccpCheckpointSection
+{
+    int32_t mlag_id;
+    uint32_t mac_num;
+    uint32_t arp_num;
+    uint32_t ndisc_num;
+};
+
+int iccp_checkpoint_save(struct System* sys, int sync);
+int iccp_checkpoint_restore(struct System* sys);
+int iccp_checkpoint_restore_buf(struct System* sys, const char* map, size_t size);
+void iccp_checkpoint_sweep(struct System* sys, int tables);
+void iccp_checkpoint_start(struct System* sys);
+
+#endif /* _ICCP_CHECKPOINT_H */
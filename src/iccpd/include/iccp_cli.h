@@ -49,6 +49,8 @@ typedef struct cli_param_queue
 #define PEER_LINK_STR   "peer_link"
 #define MCLAG_INTF_STR  "mclag_interface"
 #define SYSTEM_MAC_STR  "system_mac"
+#define FAST_HELLO_INTERVAL_STR     "fast_hello_interval"
+#define FAST_HELLO_MULTIPLIER_STR   "fast_hello_multiplier"
 
 int set_mc_lag_id(struct CSM* csm, uint16_t domain);
 int set_peer_link(int mid, const char* ifname);
@@ -58,6 +60,8 @@ int unset_mc_lag_id(struct CSM* csm, uint16_t domain);
 int unset_peer_link(int mid);
 int unset_local_address(int mid);
 int unset_peer_address(int mid);
+int set_fast_hello_interval(int mid, uint32_t msec);
+int set_fast_hello_multiplier(int mid, uint8_t multiplier);
 
 int iccp_cli_attach_mclag_domain_to_port_channel(int domain, const char* ifname);
 int iccp_cli_detach_mclag_domain_to_port_channel(const char* ifname);
@@ -24,6 +24,7 @@
 #ifndef ICCP_CMD_H_
 #define ICCP_CMD_H_
 
+int iccp_config_from_command(char * line);
 int iccp_config_from_file(char *config_default_dir);
 
 #endif /* ICCP_CMD_H_ */
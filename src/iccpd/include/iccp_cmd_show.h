@@ -24,13 +24,36 @@
 #ifndef _ICCP_CMD_SHOW_H
 #define _ICCP_CMD_SHOW_H
 
+#include <stdint.h>
+
 #define ICCP_MAX_PORT_NAME 20
 #define ICCP_MAX_IP_STR_LEN 16
 
+/* Entries and hash buckets per chunk of the MAC/ARP/ND dumps*/
+#define ICCP_DUMP_CHUNK_ENTRIES 512
+#define ICCP_DUMP_CHUNK_BUCKETS 2048
+
+struct mclagdctl_dump_filter;
+
+struct IccpDumpCursor
+{
+    int csm_pos;        /* index in the csm list*/
+    uint32_t bucket;    /* next hash bucket*/
+    uint32_t matched;
+    int id_exist;
+    /* Frame of the current chunk, MCLAGD_REPLY_INFO_HDR room at the head*/
+    char *buf;
+    int buf_size;
+    int num;
+};
+
 extern int iccp_mclag_config_dump(char * *buf, int *num, int mclag_id);
-extern int iccp_arp_dump(char * *buf, int *num, int mclag_id);
-extern int iccp_ndisc_dump(char * *buf, int *num, int mclag_id);
-extern int iccp_mac_dump(char * *buf, int *num, int mclag_id);
+extern int iccp_dump_cursor_init(struct IccpDumpCursor *cursor, int info_type);
+extern void iccp_dump_cursor_finalize(struct IccpDumpCursor *cursor);
+extern int iccp_table_dump_chunk(int info_type, int mclag_id, const struct mclagdctl_dump_filter *filter,
+                                 struct IccpDumpCursor *cursor);
 extern int iccp_local_if_dump(char * *buf, int *num, int mclag_id);
 extern int iccp_peer_if_dump(char * *buf, int *num, int mclag_id);
+extern int iccp_counters_dump(char * *buf, int *num, int mclag_id);
+extern int iccp_latency_dump(char * *buf, int *num);
 #endif
@@ -36,9 +36,18 @@
 #include "../include/app_csm.h"
 #include "../include/msg_format.h"
 #include "../include/port.h"
+#include "../include/iccp_timer.h"
 
 #define CSM_BUFFER_SIZE 65536
 
+/* Peer session socket buffers, a full LDP msg always fits in a rx block*/
+#define CSM_RX_BUF_SIZE         (2 * CSM_BUFFER_SIZE)
+#define CSM_RX_READ_BUDGET      64
+#define CSM_TX_BUF_MIN_SIZE     CSM_BUFFER_SIZE
+#define CSM_TX_QUEUE_MAX        (16 * 1024 * 1024)
+/* Msgs sent ahead of the send queue, a few fast hellos*/
+#define CSM_TX_PRIO_SIZE        512
+
 #ifndef IFNAMSIZ
 #define IFNAMSIZ 16
 #endif /*IFNAMSIZ*/
@@ -71,12 +80,36 @@ struct IccpInfo
     uint32_t rejected_msg_id;
 };
 
+/* Reference counted receive block, received msgs are slices of it*/
+struct CSMRxBlock
+{
+    int refcnt;
+    uint32_t size;
+    uint32_t len;
+    char data[0];
+};
+
 /* Receive message node */
 struct Msg
 {
     char* buf;
     size_t len;
+    /* Not NULL if buf is a slice of a receive block*/
+    struct CSMRxBlock* rx_block;
+    /* Pool of buf, ICCP_POOL_NONE if buf is malloc'd or a slice*/
+    int buf_pool;
+    /* Pipeline origin time in usec for latency tracing, 0 if not traced*/
+    uint64_t trace_usec;
+    /* Table entry restored from the checkpoint, not confirmed yet*/
+    uint8_t stale;
+    /* Sync entry replayed from the journal, it keeps its seq*/
+    uint8_t journaled;
+    /* MAC table entry, generation of the last mclagsyncd snapshot that had it*/
+    uint32_t fdb_gen;
     TAILQ_ENTRY(Msg) tail;
+    /* Hash index links, only used by table entries*/
+    LIST_ENTRY(Msg) hash_next;
+    LIST_ENTRY(Msg) if_next;
 };
 
 /* Connection state */
@@ -99,6 +132,47 @@ typedef enum stp_role_type_e
     STP_ROLE_STANDBY    /* mstp fwd bpdu & set port state*/
 } stp_role_type_et;
 
+/* Peer session I/O statistic */
+struct CSMIoStats
+{
+    uint64_t tx_msgs;
+    uint64_t tx_bytes;
+    uint64_t tx_eagain;
+    uint64_t tx_dropped;
+    uint64_t tx_stalls;         /* times the send queue could not be drained*/
+    uint64_t tx_stall_msec;     /* total time spent with a stalled send queue*/
+    uint32_t tx_stall_max_msec;
+    uint32_t tx_queued_peak;
+    uint64_t rx_msgs;
+    uint64_t rx_bytes;
+    uint64_t rx_copy_bytes;     /* bytes copied in user space after recv*/
+    uint64_t rx_blocks;         /* receive blocks allocated*/
+};
+
+/* Fast hello, sub-second peer liveness on the session*/
+struct CSMFastHello
+{
+    uint32_t tx_interval_msec;      /* 0 if fast hello is off*/
+    uint8_t multiplier;
+    uint32_t tx_seq;
+    uint32_t peer_interval_msec;    /* 0 until a peer hello is received*/
+    uint8_t peer_multiplier;
+    uint32_t peer_seq;
+    struct timespec last_hello;
+    struct timespec last_rx;
+    struct iccp_timer tx_timer;
+    struct iccp_timer detect_timer;
+
+    uint64_t tx_hellos;
+    uint64_t rx_hellos;
+    uint64_t rx_lost;               /* sequence gaps*/
+    uint64_t detects;
+    uint32_t last_detect_msec;      /* last rx to peer down*/
+    uint32_t jitter_max_usec;       /* deviation of hello arrival from peer interval*/
+    uint64_t jitter_sum_usec;
+    uint64_t jitter_samples;
+};
+
 /* Connection state machine instance */
 struct CSM
 {
@@ -117,6 +191,23 @@ struct CSM
     char sender_ip[INET_ADDRSTRLEN];
     void* sock_read_event_ptr;
 
+    /* Non-blocking socket buffers */
+    char* tx_buf;
+    uint32_t tx_size;
+    uint32_t tx_head;
+    uint32_t tx_len;
+    uint32_t tx_msg_left;       /* bytes of the msg at tx_head not written yet*/
+    char tx_prio_buf[CSM_TX_PRIO_SIZE];
+    uint16_t tx_prio_head;
+    uint16_t tx_prio_len;
+    int tx_pollout;
+    int tx_error;
+    struct timespec tx_stall_start;
+    struct CSMRxBlock* rx_block;
+    uint32_t rx_head;           /* first byte not parsed yet*/
+    struct CSMIoStats io_stats;
+    struct CSMFastHello fast_hello;
+
     /* Msg queue */
     TAILQ_HEAD(msg_list, Msg) msg_list;
 
@@ -142,7 +233,16 @@ struct CSM
     LIST_HEAD(csm_if_list, If_info) if_bind_list;
 };
 int iccp_csm_send(struct CSM*, char*, int);
+int iccp_csm_send_prio(struct CSM*, char*, int);
+int iccp_csm_flush(struct CSM*);
+void iccp_csm_io_reset(struct CSM*);
+struct Msg* iccp_csm_alloc_msg(void);
 int iccp_csm_init_msg(struct Msg**, char*, int);
+int iccp_csm_init_pool_msg(struct Msg**, int, char*, int);
+void iccp_csm_free_msg(struct Msg*);
+struct Msg* iccp_csm_slice_msg(struct CSM*, uint32_t, uint32_t);
+int iccp_csm_detach_msg(struct CSM*, struct Msg*);
+char* iccp_csm_rx_space(struct CSM*, uint32_t*);
 int iccp_csm_prepare_nak_msg(struct CSM*, char*, size_t);
 int iccp_csm_prepare_iccp_msg(struct CSM*, char*, size_t);
 int iccp_csm_prepare_capability_msg(struct CSM*, char*, size_t);
@@ -29,11 +29,26 @@
 int iccp_sys_local_if_list_get_init();
 
 int iccp_neigh_get_init();
+int iccp_neigh_dump(int family);
 
 void do_arp_update_from_reply_packet(unsigned int ifindex, unsigned int addr, uint8_t mac_addr[ETHER_ADDR_LEN]);
 void do_ndisc_update_from_reply_packet(unsigned int ifindex, char *ipv6_addr, uint8_t mac_addr[ETHER_ADDR_LEN]);
 
+/* Kernel neighbor change, decoded from RTM_NEWNEIGH/RTM_DELNEIGH*/
+struct NeighEvent
+{
+    uint16_t msgtype;
+    uint16_t state;
+    uint8_t family;
+    uint32_t ifindex;
+    uint8_t dst[16];
+    uint8_t mac[ETHER_ADDR_LEN];
+};
+
+int iccp_neigh_event_decode(struct nlmsghdr *n, struct NeighEvent *ev);
+void do_one_neigh_event(const struct NeighEvent *ev);
 int do_one_neigh_request(struct nlmsghdr *n);
+void iccp_neigh_dump_input(struct nlmsghdr *nlh);
 
 void iccp_from_netlink_port_state_handler( char * ifname, int state);
 
@@ -0,0 +1,100 @@
+/*
+ *  iccp_ingest.h
+ *  Kernel event ingestion thread, feeds the main thread by a SPSC ring.
+ *
+ * Copyright(c) 2016-2019 Nephos/Estinet.
+ *
+ * This program is free software; you can redistribute it and/or modify it
+ * under the terms and conditions of the GNU General Public License,
+ * version 2, as published by the Free Software Foundation.
+ *
+ * This program is distributed in the hope it will be useful, but WITHOUT
+ * ANY WARRANTY; without even the implied warranty of MERCHANTABILITY or
+ * FITNESS FOR A PARTICULAR PURPOSE.  See the GNU General Public License for
+ * more details.
+ *
+ * You should have received a copy of the GNU General Public License along with
+ * this program; if not, see <http://www.gnu.org/licenses/>.
+ *
+ * The full GNU General Public License is included in this distribution in
+ * the file called "COPYING".
+ *
+ *  Maintainer: jianjun, grace Li from nephos
+ */
+
+#ifndef _ICCP_INGEST_H
+#define _ICCP_INGEST_H
+
+#include <stdint.h>
+#include <net/ethernet.h>
+#include <linux/netlink.h>
+
+#include "../include/iccp_ifm.h"
+
+/* Events in the ring, must be power of 2*/
+#define ICCP_INGEST_RING_SIZE       8192
+/* Events handled by the main thread per wakeup*/
+#define ICCP_INGEST_RX_BUDGET       1024
+/* ARP/ND frames read by one recvmmsg, and per wakeup of each packet socket*/
+#define ICCP_INGEST_PKT_BATCH       32
+#define ICCP_INGEST_PKT_BUDGET      256
+/* An ARP/ND reply seen again within the window is not handed over,
+ * slots must be power of 2*/
+#define ICCP_INGEST_DEDUP_SIZE      1024
+#define ICCP_INGEST_DEDUP_USEC      100000
+
+struct System;
+
+enum ICCP_INGEST_EV_TYPE
+{
+    INGEST_EV_NONE = 0,
+    INGEST_EV_NEIGH,        /* RTM_NEWNEIGH/RTM_DELNEIGH*/
+    INGEST_EV_ARP_REPLY,    /* ARP reply from the packet socket*/
+    INGEST_EV_NA,           /* ND advertisement from the packet socket*/
+    INGEST_EV_ROUTE_MSG,    /* link/addr msg, copied as is*/
+    INGEST_EV_ROUTE_ERR,    /* route event socket lost msgs*/
+};
+
+struct IngestEvent
+{
+    uint8_t type;
+    uint64_t rx_usec;       /* read time, for latency tracing*/
+    union
+    {
+        struct NeighEvent neigh;
+        struct nlmsghdr* nlh;   /* malloc'd, freed by the consumer*/
+    } u;
+};
+
+struct IngestStats
+{
+    uint64_t events;
+    uint64_t neigh;
+    uint64_t packets;
+    uint64_t route_msgs;
+    uint64_t recv_errors;
+    uint64_t dropped;
+    uint64_t wakeups;
+    uint64_t resyncs;
+    uint64_t pkt_frames;        /* ARP/ND frames read*/
+    uint64_t pkt_batches;       /* recvmmsg calls returning frames*/
+    uint64_t pkt_dups;          /* replies suppressed by the dedup window*/
+    uint64_t pkt_kernel_drops;  /* frames dropped by the packet sockets*/
+    uint32_t depth;
+    uint32_t depth_peak;
+};
+
+int iccp_ingest_init(struct System* sys);
+int iccp_ingest_start(struct System* sys);
+void iccp_ingest_finalize(struct System* sys);
+void iccp_ingest_get_stats(struct IngestStats* stats);
+
+/* Ingestion thread only*/
+int iccp_ingest_push(struct IngestEvent* ev);
+
+/* Main thread, registered in the event fds*/
+int iccp_ingest_get_fd(struct System* sys);
+int iccp_ingest_handler(struct System* sys);
+void iccp_ingest_dispatch(struct System* sys, struct IngestEvent* ev);
+
+#endif /* _ICCP_INGEST_H */
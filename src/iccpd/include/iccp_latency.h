@@ -0,0 +1,113 @@
+/*
+ *  iccp_latency.h
+ *  Latency tracing of the MAC/ARP/ND sync pipeline.
+ *
+ * Copyright(c) 2016-2019 Nephos/Estinet.
+ *
+ * This program is free software; you can redistribute it and/or modify it
+ * under the terms and conditions of the GNU General Public License,
+ * version 2, as published by the Free Software Foundation.
+ *
+ * This program is distributed in the hope it will be useful, but WITHOUT
+ * ANY WARRANTY; without even the implied warranty of MERCHANTABILITY or
+ * FITNESS FOR A PARTICULAR PURPOSE.  See the GNU General Public License for
+ * more details.
+ *
+ * You should have received a copy of the GNU General Public License along with
+ * this program; if not, see <http://www.gnu.org/licenses/>.
+ *
+ * The full GNU General Public License is included in this distribution in
+ * the file called "COPYING".
+ *
+ *  Maintainer: jianjun, grace Li from nephos
+ */
+
+#ifndef _ICCP_LATENCY_H
+#define _ICCP_LATENCY_H
+
+#include <stdint.h>
+
+/* <10us, <100us, <1ms, <10ms, <100ms, <1s, >=1s*/
+#define ICCP_LAT_BUCKETS        7
+
+/* ICC types 0x0000-0x003F and mLACP types 0x1030-0x106F*/
+#define ICCP_LAT_TLV_SLOTS      128
+
+/* Where the entry being handled came from*/
+enum iccp_latency_ctx
+{
+    ICCP_LAT_CTX_NONE = 0,
+    ICCP_LAT_CTX_SYNCD,     /* FDB msg from mclagsyncd*/
+    ICCP_LAT_CTX_PEER,      /* mLACP TLV from peer*/
+    ICCP_LAT_CTX_KERNEL,    /* neighbor/link event from kernel*/
+    ICCP_LAT_CTX_MAX
+};
+
+/* Pipeline points, the stage is picked by the current context*/
+enum iccp_latency_point
+{
+    ICCP_LAT_POINT_TABLE = 0,   /* MAC/ARP/ND table updated*/
+    ICCP_LAT_POINT_ENQUEUE,     /* queued to sync to peer*/
+    ICCP_LAT_POINT_PROGRAM,     /* sent to mclagsyncd or kernel*/
+    ICCP_LAT_POINT_MAX
+};
+
+enum iccp_latency_stage
+{
+    ICCP_LAT_STAGE_SYNCD_TO_TABLE = 0,
+    ICCP_LAT_STAGE_SYNCD_TO_ENQUEUE,
+    ICCP_LAT_STAGE_PEER_TO_FSM,
+    ICCP_LAT_STAGE_PEER_TO_TABLE,
+    ICCP_LAT_STAGE_PEER_TO_PROGRAM,
+    ICCP_LAT_STAGE_KERNEL_TO_TABLE,
+    ICCP_LAT_STAGE_KERNEL_TO_ENQUEUE,
+    ICCP_LAT_STAGE_LOCAL_TO_SEND,       /* syncd or kernel rx to peer send*/
+    ICCP_LAT_STAGE_PO_DOWN_TO_REDIRECT,
+    ICCP_LAT_STAGE_MAX
+};
+
+enum iccp_latency_dir
+{
+    ICCP_LAT_RX = 0,
+    ICCP_LAT_TX,
+};
+
+struct IccpLatencyStage
+{
+    uint64_t count;
+    uint64_t sum_usec;
+    uint64_t max_usec;
+    uint64_t hist[ICCP_LAT_BUCKETS];
+};
+
+struct IccpLatencyStats
+{
+    struct IccpLatencyStage stages[ICCP_LAT_STAGE_MAX];
+    uint64_t tlv_rx[ICCP_LAT_TLV_SLOTS];
+    uint64_t tlv_tx[ICCP_LAT_TLV_SLOTS];
+    uint64_t tlv_other_rx;
+    uint64_t tlv_other_tx;
+    /* CLOCK_MONOTONIC sec of the last reset*/
+    uint64_t since_sec;
+};
+
+/* Thread safe, the rest is main thread only*/
+uint64_t iccp_latency_now_usec();
+
+void iccp_latency_begin(int ctx, uint64_t origin_usec);
+void iccp_latency_end();
+uint64_t iccp_latency_origin();
+
+void iccp_latency_record(int stage, uint64_t origin_usec);
+/* Return the origin if the point is traced, to stamp queued msgs*/
+uint64_t iccp_latency_mark(int point);
+
+/* buf is a whole LDP msg in wire order*/
+void iccp_latency_count_msg(int dir, const char* buf, int len);
+
+const char* iccp_latency_stage_name(int stage);
+int iccp_latency_tlv_type(int slot);
+const struct IccpLatencyStats* iccp_latency_get_stats();
+void iccp_latency_reset();
+
+#endif /* _ICCP_LATENCY_H */
@@ -31,6 +31,7 @@
 
 #include "../include/system.h"
 #include "../include/port.h"
+#include "../include/iccp_ifm.h"
 #include <netinet/icmp6.h>
 #include <linux/ipv6.h>
 
@@ -38,6 +39,17 @@
 #define ND_OPT_TARGET_LL_ADDR 2
 #define NEXTHDR_ICMP 58
 
+/* Kernel objects dumped again after their events were lost*/
+#define NETLINK_RESYNC_LINK         0x01
+#define NETLINK_RESYNC_ADDR         0x02
+#define NETLINK_RESYNC_NEIGH4       0x04
+#define NETLINK_RESYNC_NEIGH6       0x08
+#define NETLINK_RESYNC_TEAM         0x10
+#define NETLINK_RESYNC_ROUTE        (NETLINK_RESYNC_LINK | NETLINK_RESYNC_ADDR | NETLINK_RESYNC_NEIGH4 | NETLINK_RESYNC_NEIGH6)
+
+/* Receive buffer of the route and team event socks*/
+#define NETLINK_EVENT_RCVBUF_DEFAULT    (4 * 1024 * 1024)
+
 struct nd_msg
 {
     struct icmp6_hdr icmph;
@@ -45,11 +57,14 @@ struct nd_msg
     __u8 opt[0];
 };
 
+/* glibc has it with _GNU_SOURCE*/
+#ifndef _GNU_SOURCE
 struct in6_pktinfo
 {
     struct in6_addr ipi6_addr;  /* src/dst IPv6 address */
     unsigned int ipi6_ifindex;  /* send/recv interface index */
 };
+#endif
 
 int iccp_get_port_member_list(struct LocalInterface* lif);
 void iccp_event_handler_obj_input_newlink(struct nl_object *obj, void *arg);
@@ -57,11 +72,20 @@ void iccp_event_handler_obj_input_dellink(struct nl_object *obj, void *arg);
 int iccp_system_init_netlink_socket();
 void iccp_system_dinit_netlink_socket();
 int iccp_init_netlink_event_fd(struct System *sys);
-int iccp_handle_events(struct System * sys);
+int iccp_handle_events(struct System * sys, int timeout_msec);
 void update_if_ipmac_on_standby(struct LocalInterface* lif_po);
 int iccp_sys_local_if_list_get_addr();
 int iccp_netlink_neighbor_request(int family, uint8_t *addr, int add, uint8_t *mac, char *portname);
+int iccp_netlink_neigh_flush(struct System *sys);
 int iccp_check_if_addr_from_netlink(int family, uint8_t *addr, struct LocalInterface *lif);
+void iccp_netlink_resync_mark(struct System *sys, uint32_t types);
+int iccp_netlink_set_event_rcvbuf(struct System *sys, int bytes);
+void iccp_netlink_route_event_input(struct nlmsghdr *nlh);
+void iccp_netlink_dump_input(struct nlmsghdr *nlh);
+void iccp_netlink_team_input(struct nlmsghdr *nlh);
+int iccp_netlink_read_arp_packets(struct System *sys, struct NeighEvent *evs, int max, int *num);
+int iccp_netlink_read_ndisc_packets(struct System *sys, struct NeighEvent *evs, int max, int *num);
+uint32_t iccp_netlink_packet_drops(struct System *sys);
 
 #endif
 
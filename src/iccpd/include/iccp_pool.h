@@ -0,0 +1,61 @@
+/*
+ *  iccp_pool.h
+ *  Slab pools for the fixed size ICCP objects.
+ *
+ * Copyright(c) 2016-2019 Nephos/Estinet.
+ *
+ * This program is free software; you can redistribute it and/or modify it
+ * under the terms and conditions of the GNU General Public License,
+ * version 2, as published by the Free Software Foundation.
+ *
+ * This program is distributed in the hope it will be useful, but WITHOUT
+ * ANY WARRANTY; without even the implied warranty of MERCHANTABILITY or
+ * FITNESS FOR A PARTICULAR PURPOSE.  See the GNU General Public License for
+ * more details.
+ *
+ * You should have received a copy of the GNU General Public License along with
+ * this program; if not, see <http://www.gnu.org/licenses/>.
+ *
+ * The full GNU General Public License is included in this distribution in
+ * the file called "COPYING".
+ *
+ *  Maintainer: jianjun, grace Li from nephos
+ */
+
+#ifndef _ICCP_POOL_H
+#define _ICCP_POOL_H
+
+#include <stdint.h>
+
+/* Objects carved out of one slab*/
+#define ICCP_POOL_SLAB_OBJS     256
+
+/* buf is not from a pool*/
+#define ICCP_POOL_NONE          -1
+
+enum ICCP_POOL_TYPE
+{
+    ICCP_POOL_MSG = 0,  /* struct Msg*/
+    ICCP_POOL_MAC,      /* struct MACMsg*/
+    ICCP_POOL_ARP,      /* struct ARPMsg*/
+    ICCP_POOL_NDISC,    /* struct NDISCMsg*/
+    ICCP_POOL_MAX
+};
+
+struct IccpPoolStats
+{
+    uint32_t obj_size;
+    uint32_t live;
+    uint32_t peak;
+    uint32_t slabs;
+    uint64_t allocs;
+    uint64_t frees;
+};
+
+void* iccp_pool_alloc(int type);
+void iccp_pool_free(int type, void* obj);
+uint32_t iccp_pool_obj_size(int type);
+const char* iccp_pool_name(int type);
+const struct IccpPoolStats* iccp_pool_get_stats(int type);
+
+#endif /* _ICCP_POOL_H */
@@ -0,0 +1,71 @@
+/*
+ *  iccp_timer.h
+ *  Hierarchical timer wheel driven by one timerfd.
+ *
+ * Copyright(c) 2016-2019 Nephos/Estinet.
+ *
+ * This program is free software; you can redistribute it and/or modify it
+ * under the terms and conditions of the GNU General Public License,
+ * version 2, as published by the Free Software Foundation.
+ *
+ * This program is distributed in the hope it will be useful, but WITHOUT
+ * ANY WARRANTY; without even the implied warranty of MERCHANTABILITY or
+ * FITNESS FOR A PARTICULAR PURPOSE.  See the GNU General Public License for
+ * more details.
+ *
+ * You should have received a copy of the GNU General Public License along with
+ * this program; if not, see <http://www.gnu.org/licenses/>.
+ *
+ * The full GNU General Public License is included in this distribution in
+ * the file called "COPYING".
+ *
+ *  Maintainer: jianjun, grace Li from nephos
+ */
+
+#ifndef _ICCP_TIMER_H
+#define _ICCP_TIMER_H
+
+#include <stdint.h>
+#include <sys/queue.h>
+
+/* Default tick, timers are rounded up to it*/
+#define ICCP_TIMER_TICK_MSEC        10
+#define ICCP_TIMER_TICK_MAX_MSEC    1000
+
+/* 3 levels of 256 slots, 2^24 ticks*/
+#define ICCP_TIMER_WHEEL_BITS       8
+#define ICCP_TIMER_WHEEL_SLOTS      (1 << ICCP_TIMER_WHEEL_BITS)
+#define ICCP_TIMER_WHEEL_LEVELS     3
+
+struct System;
+
+struct iccp_timer
+{
+    LIST_ENTRY(iccp_timer) next;
+    uint64_t expire;        /* in ticks*/
+    void (*handler)(void* arg);
+    void* arg;
+    uint8_t pending;
+};
+
+struct IccpTimerStats
+{
+    uint64_t wakeups;
+    uint64_t expired;
+    uint32_t pending;
+};
+
+int iccp_timer_wheel_init(uint32_t tick_msec);
+void iccp_timer_wheel_finalize();
+int iccp_timer_set_tick(uint32_t tick_msec);
+uint32_t iccp_timer_get_tick();
+const struct IccpTimerStats* iccp_timer_get_stats();
+
+void iccp_timer_init(struct iccp_timer* timer, void (*handler)(void*), void* arg);
+void iccp_timer_start(struct iccp_timer* timer, uint32_t msec);
+void iccp_timer_stop(struct iccp_timer* timer);
+
+int iccp_timer_get_fd(struct System* sys);
+int iccp_timer_handler(struct System* sys);
+
+#endif /* _ICCP_TIMER_H */
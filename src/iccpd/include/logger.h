@@ -43,6 +43,19 @@ typedef enum _iccpd_log_level_t
 #define LOGBUF_SIZE 1024
 #define ICCPD_UTILS_SYSLOG    (syslog)
 
+/* Records are formatted by the caller and handed over to the log writer
+ * thread by the ring, which calls syslog. Must be power of 2*/
+#define LOG_RING_SIZE           4096
+#define LOG_RING_TEXT_SIZE      512
+#define LOG_RING_FILE           "/var/run/iccpd/iccpd_log_ring.bin"
+#define LOG_RING_MAGIC          0x49434c52
+#define LOG_RING_VERSION        1
+
+/* Per call site, records over the burst in one window are suppressed*/
+#define LOG_RATE_WINDOW_MSEC    1000
+#define LOG_RATE_BURST          50
+#define LOG_RATE_SITES          512
+
 #define ICCPD_LOG_CRITICAL(tag, format, args ...) write_log(CRITICAL_LOG_LEVEL, tag, format, ## args)
 #define ICCPD_LOG_ERR(tag, format, args ...) write_log(ERR_LOG_LEVEL, tag, format, ## args)
 #define ICCPD_LOG_WARN(tag, format, args ...) write_log(WARN_LOG_LEVEL, tag, format, ## args)
@@ -57,6 +70,39 @@ struct LoggerConfig
     uint8_t init;
 };
 
+/* Slot of the log ring, kept after written to syslog for post-mortem*/
+struct LogRecord
+{
+    uint64_t seq;       /* pos + 1 queued, pos + LOG_RING_SIZE written*/
+    uint64_t pos;
+    uint64_t usec;      /* CLOCK_REALTIME*/
+    uint8_t level;
+    uint8_t pad;
+    uint16_t len;
+    uint32_t pad2;
+    char text[LOG_RING_TEXT_SIZE];
+};
+
+/* Head of the ring dump file, followed by the LOG_RING_SIZE slots*/
+struct LogRingFileHdr
+{
+    uint32_t magic;
+    uint32_t version;
+    uint32_t record_size;
+    uint32_t records;
+    uint64_t head;
+    uint64_t tail;
+    uint64_t dropped;
+    uint64_t suppressed;
+};
+
+struct LogStats
+{
+    uint64_t written;
+    uint64_t dropped;       /* ring full*/
+    uint64_t suppressed;    /* rate limited*/
+};
+
 struct LoggerConfig* logger_get_configuration();
 void logger_set_configuration(int log_level);
 char* log_level_to_string(int level);
@@ -64,6 +110,11 @@ void log_setup(char* progname, char* path);
 void log_finalize();
 void log_init(struct CmdOptionParser* parser);
 void write_log(const int level, const char* tag, const char *format, ...);
+void log_get_stats(struct LogStats* stats);
+/* Per thread, called from the loop of each thread that logs*/
+int log_rate_flush();
+/* Async signal safe, return the number of records*/
+int log_ring_dump(const char* path);
 
 #endif /* LOGGER_H_ */
 
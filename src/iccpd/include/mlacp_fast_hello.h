@@ -0,0 +1,40 @@
+/*
+ *  mlacp_fast_hello.h
+ *  Sub-second peer liveness detection.
+ *
+ * Copyright(c) 2016-2019 Nephos/Estinet.
+ *
+ * This program is free software; you can redistribute it and/or modify it
+ * under the terms and conditions of the GNU General Public License,
+ * version 2, as published by the Free Software Foundation.
+ *
+ * This program is distributed in the hope it will be useful, but WITHOUT
+ * ANY WARRANTY; without even the implied warranty of MERCHANTABILITY or
+ * FITNESS FOR A PARTICULAR PURPOSE.  See the GNU General Public License for
+ * more details.
+ *
+ * You should have received a copy of the GNU General Public License along with
+ * this program; if not, see <http://www.gnu.org/licenses/>.
+ *
+ * The full GNU General Public License is included in this distribution in
+ * the file called "COPYING".
+ *
+ *  Maintainer: jianjun, grace Li from nephos
+ */
+
+#ifndef _MLACP_FAST_HELLO_H
+#define _MLACP_FAST_HELLO_H
+
+#include <stdint.h>
+
+struct CSM;
+struct Msg;
+
+void mlacp_fast_hello_init(struct CSM* csm);
+void mlacp_fast_hello_finalize(struct CSM* csm);
+int mlacp_fast_hello_config(struct CSM* csm, uint32_t interval_msec, uint8_t multiplier);
+void mlacp_fast_hello_reset(struct CSM* csm);
+void mlacp_fast_hello_recv(struct CSM* csm, struct Msg* msg);
+void mlacp_fast_hello_rx_activity(struct CSM* csm);
+
+#endif /* _MLACP_FAST_HELLO_H */
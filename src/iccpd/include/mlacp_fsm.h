@@ -26,6 +26,8 @@
 #define _MLACP_FSM_H
 
 #include "../include/port.h"
+#include "../include/mlacp_table.h"
+#include "../include/mlacp_journal.h"
 
 #define MLCAP_SYNC_PHY_DEV_SEC     1     /*every 1 sec*/
 
@@ -90,6 +92,35 @@ struct mLACP
     TAILQ_HEAD(ndisc_info_list, Msg) ndisc_list;
     TAILQ_HEAD(mac_msg_list, Msg) mac_msg_list;
     TAILQ_HEAD(mac_info_list, Msg) mac_list;
+    struct mlacp_hash_bucket mac_hash[MLACP_MAC_HASH_SIZE];
+    struct mlacp_hash_bucket mac_if_hash[MLACP_IF_HASH_SIZE];
+    uint32_t mac_num;
+    struct mlacp_hash_bucket arp_hash[MLACP_NEIGH_HASH_SIZE];
+    struct mlacp_hash_bucket arp_if_hash[MLACP_IF_HASH_SIZE];
+    uint32_t arp_num;
+    struct mlacp_hash_bucket ndisc_hash[MLACP_NEIGH_HASH_SIZE];
+    struct mlacp_hash_bucket ndisc_if_hash[MLACP_IF_HASH_SIZE];
+    uint32_t ndisc_num;
+
+    /* Compact sync TLVs, negotiated in the system config exchange*/
+    uint8_t compact_sync;
+    uint16_t sync_pdu_size;
+    struct mlacp_if_id_table tx_if_id;
+    struct mlacp_if_id_table rx_if_id;
+
+    /* Incremental resync, our journal of what was sent to the peer*/
+    uint32_t sync_epoch;
+    struct mlacp_journal journal[MLACP_SYNC_TABLE_MAX];
+    uint32_t mark_seq[MLACP_SYNC_TABLE_MAX];
+    /* what we have from the peer, by table bit*/
+    uint32_t peer_epoch;
+    uint32_t peer_seq[MLACP_SYNC_TABLE_MAX];
+    uint8_t peer_seq_valid;
+    /* tables the peer resumes from resync_seq instead of a full sync*/
+    uint8_t resync_delta;
+    uint32_t resync_seq[MLACP_SYNC_TABLE_MAX];
+    /* peer MACs are kept after disconnect until this time + hold*/
+    time_t resync_hold_time;
 
     LIST_HEAD(lif_list, LocalInterface) lif_list;
     LIST_HEAD(lif_purge_list, LocalInterface) lif_purge_list;
@@ -97,10 +128,12 @@ struct mLACP
 };
 
 void mlacp_init(struct CSM* csm, int all);
+void mlacp_compact_sync_reset(struct CSM* csm);
 void mlacp_finalize(struct CSM* csm);
 void mlacp_fsm_transit(struct CSM* csm);
 void mlacp_enqueue_msg(struct CSM*, struct Msg*);
 struct Msg* mlacp_dequeue_msg(struct CSM*);
+int mlacp_sync_enqueue_or_journal(struct CSM* csm, int table, void* entry, int op);
 
 /* from app_csm*/
 extern int mlacp_bind_local_if(struct CSM* csm, struct LocalInterface* local_if);
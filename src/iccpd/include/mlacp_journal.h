@@ -0,0 +1,66 @@
+/*
+ *  mlacp_journal.h
+ *  Change journal of the mLACP MAC, ARP and ND sync.
+ *
+ * Copyright(c) 2016-2019 Nephos/Estinet.
+ *
+ * This program is free software; you can redistribute it and/or modify it
+ * under the terms and conditions of the GNU General Public License,
+ * version 2, as published by the Free Software Foundation.
+ *
+ * This program is distributed in the hope it will be useful, but WITHOUT
+ * ANY WARRANTY; without even the implied warranty of MERCHANTABILITY or
+ * FITNESS FOR A PARTICULAR PURPOSE.  See the GNU General Public License for
+ * more details.
+ *
+ * You should have received a copy of the GNU General Public License along with
+ * this program; if not, see <http://www.gnu.org/licenses/>.
+ *
+ * The full GNU General Public License is included in this distribution in
+ * the file called "COPYING".
+ *
+ *  Maintainer: jianjun, grace Li from nephos
+ */
+
+#ifndef _MLACP_JOURNAL_H
+#define _MLACP_JOURNAL_H
+
+#include <stdint.h>
+
+/* Records kept per table, must be power of 2*/
+#define MLACP_JOURNAL_SIZE          4096
+
+/* Peer MACs are kept this long after a disconnect while the peer-link
+ * stays up, waiting to resume*/
+#define MLACP_RESYNC_HOLD_SEC       5
+
+enum MLACP_SYNC_TABLE
+{
+    MLACP_SYNC_TABLE_MAC = 0,
+    MLACP_SYNC_TABLE_ARP,
+    MLACP_SYNC_TABLE_NDISC,
+    MLACP_SYNC_TABLE_MAX
+};
+
+#define MLACP_SYNC_TABLE_BIT(table)     (1 << (table))
+#define MLACP_SYNC_TABLE_ALL            ((1 << MLACP_SYNC_TABLE_MAX) - 1)
+
+/* Every MAC/ARP/ND entry sent to the peer gets the next sequence of its
+ * table. Record of seq is at seq & (MLACP_JOURNAL_SIZE - 1)*/
+struct mlacp_journal
+{
+    uint32_t seq;
+    uint32_t entry_size;
+    char* records;
+};
+
+struct CSM;
+
+void mlacp_journal_init(struct CSM* csm);
+void mlacp_journal_finalize(struct CSM* csm);
+uint32_t mlacp_journal_record(struct CSM* csm, int table, const void* entry);
+int mlacp_journal_can_resume(struct CSM* csm, int table, uint32_t epoch, uint32_t seq);
+const void* mlacp_journal_get(struct CSM* csm, int table, uint32_t seq);
+const char* mlacp_journal_table_name(int table);
+
+#endif /* _MLACP_JOURNAL_H */
@@ -33,6 +33,7 @@
 void mlacp_portchannel_state_handler(struct CSM* csm, struct LocalInterface* local_if, int po_state);
 void mlacp_peer_conn_handler(struct CSM* csm);
 void mlacp_peer_disconn_handler(struct CSM* csm);
+void mlacp_peer_disconn_fdb(struct CSM* csm);
 void mlacp_peerlink_up_handler(struct CSM* csm);
 void mlacp_peerlink_down_handler(struct CSM* csm);
 void update_stp_peer_link(struct CSM *csm, struct PeerInterface *peer_if, int po_state, int new_create);
@@ -47,14 +48,20 @@ void del_mac_from_chip(struct MACMsg *mac_msg);
 void add_mac_to_chip(struct MACMsg *mac_msg, uint8_t mac_type);
 uint8_t set_mac_local_age_flag(struct CSM *csm, struct MACMsg *mac_msg, uint8_t set);
 void iccp_get_fdb_change_from_syncd(void);
+void iccp_fdb_subscribe(struct System *sys);
 
 extern int mclagd_ctl_sock_create();
 extern int mclagd_ctl_sock_accept(int fd);
 extern int mclagd_ctl_interactive_process(int client_fd);
+extern int mclagd_ctl_dump_handler(int fd, uint32_t events);
 extern int parseMacString(const char *str_mac, uint8_t *bin_mac);
 char *show_ip_str(uint32_t ipv4_addr);
 char *show_ipv6_str(char *ipv6_addr);
 
 void syncd_info_close();
 int iccp_connect_syncd();
+int iccp_syncd_send(struct System* sys, char* buf, size_t len);
+int iccp_syncd_queue_fdb(struct System* sys, struct mclag_fdb_info* mac_info);
+int iccp_syncd_flush(struct System* sys);
+int iccp_syncd_rx_feed(struct System *sys, const char *buf, uint32_t len);
 #endif
@@ -47,7 +47,14 @@ int mlacp_prepare_for_sys_config(struct CSM* csm, char* buf, size_t max_buf_size
 int mlacp_prepare_for_mac_info_to_peer(struct CSM* csm, char* buf, size_t max_buf_size, struct MACMsg* mac_msg, int count);
 int mlacp_prepare_for_arp_info(struct CSM* csm, char* buf, size_t max_buf_size, struct ARPMsg* arp_msg, int count);
 int mlacp_prepare_for_ndisc_info(struct CSM *csm, char *buf, size_t max_buf_size, struct NDISCMsg *ndisc_msg, int count);
+int mlacp_prepare_for_if_id_map(struct CSM* csm, char* buf, size_t max_buf_size, uint16_t if_id, const char* ifname);
+int mlacp_prepare_for_mac_info_compact(struct CSM* csm, char* buf, size_t max_buf_size, struct MACMsg* mac_msg, uint16_t if_id, int count);
+int mlacp_prepare_for_arp_info_compact(struct CSM* csm, char* buf, size_t max_buf_size, struct ARPMsg* arp_msg, uint16_t if_id, int count);
+int mlacp_prepare_for_ndisc_info_compact(struct CSM* csm, char* buf, size_t max_buf_size, struct NDISCMsg* ndisc_msg, uint16_t if_id, int count);
+int mlacp_prepare_for_sync_seq(struct CSM* csm, char* buf, size_t max_buf_size,
+                               uint8_t op, uint8_t flags, uint32_t epoch, const uint32_t* seq);
 int mlacp_prepare_for_heartbeat(struct CSM* csm, char* buf, size_t max_buf_size);
+int mlacp_prepare_for_fast_hello(struct CSM* csm, char* buf, size_t max_buf_size, uint32_t seq);
 int mlacp_prepare_for_Aggport_state(struct CSM* csm, char* buf, size_t max_buf_size, struct LocalInterface* local_if);
 int mlacp_prepare_for_Aggport_config(struct CSM* csm, char* buf, size_t max_buf_size, struct LocalInterface* lif, int purge_flag);
 int mlacp_prepare_for_port_channel_info(struct CSM* csm, char* buf, size_t max_buf_size, struct LocalInterface* port_channel);
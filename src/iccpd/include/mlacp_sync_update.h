@@ -47,4 +47,8 @@ int mlacp_fsm_update_Agg_conf(struct CSM* csm, mLACPAggConfigTLV* portconf);
 int mlacp_fsm_update_port_channel_info(struct CSM* csm, struct mLACPPortChannelInfoTLV* tlv);
 int mlacp_fsm_update_peerlink_info(struct CSM* csm, struct mLACPPeerLinkInfoTLV* tlv);
 int mlacp_fsm_update_mac_info_from_peer(struct CSM* csm, struct mLACPMACInfoTLV* tlv);
+int mlacp_fsm_update_if_id_map(struct CSM* csm, struct mLACPIfIdMapTLV* tlv);
+int mlacp_fsm_update_mac_info_compact(struct CSM* csm, struct mLACPMACCompactInfoTLV* tlv);
+int mlacp_fsm_update_arp_info_compact(struct CSM* csm, struct mLACPARPCompactInfoTLV* tlv);
+int mlacp_fsm_update_ndisc_info_compact(struct CSM* csm, struct mLACPNDISCCompactInfoTLV* tlv);
 #endif
\ No newline at end of file
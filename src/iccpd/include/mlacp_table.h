@@ -0,0 +1,93 @@
+/*
+ *  mlacp_table.h
+ *  Hash index of mLACP MAC, ARP and ND tables.
+ *
+ * Copyright(c) 2016-2019 Nephos/Estinet.
+ *
+ * This program is free software; you can redistribute it and/or modify it
+ * under the terms and conditions of the GNU General Public License,
+ * version 2, as published by the Free Software Foundation.
+ *
+ * This program is distributed in the hope it will be useful, but WITHOUT
+ * ANY WARRANTY; without even the implied warranty of MERCHANTABILITY or
+ * FITNESS FOR A PARTICULAR PURPOSE.  See the GNU General Public License for
+ * more details.
+ *
+ * You should have received a copy of the GNU General Public License along with
+ * this program; if not, see <http://www.gnu.org/licenses/>.
+ *
+ * The full GNU General Public License is included in this distribution in
+ * the file called "COPYING".
+ *
+ *  Maintainer: jianjun, grace Li from nephos
+ */
+
+#ifndef _MLACP_TABLE_H
+#define _MLACP_TABLE_H
+
+#include <stdint.h>
+#include <sys/queue.h>
+
+#include "../include/port.h"
+
+struct CSM;
+struct Msg;
+
+/* Bucket number must be power of 2*/
+#define MLACP_MAC_HASH_SIZE     16384
+#define MLACP_NEIGH_HASH_SIZE   16384
+#define MLACP_IF_HASH_SIZE      256
+
+LIST_HEAD(mlacp_hash_bucket, Msg);
+
+/* MAC table: key index is MAC+vid, interface index is origin_ifname*/
+uint64_t mlacp_mac_key(const char* mac_str, uint16_t vid);
+unsigned int mlacp_if_hash(const char* ifname);
+struct Msg* mlacp_mac_table_find(struct CSM* csm, const char* mac_str, uint16_t vid);
+void mlacp_mac_table_add(struct CSM* csm, struct Msg* msg);
+void mlacp_mac_table_del(struct CSM* csm, struct Msg* msg);
+void mlacp_mac_table_set_origin(struct CSM* csm, struct Msg* msg, const char* ifname);
+void mlacp_mac_table_flush(struct CSM* csm);
+
+/* ARP/ND table: key index is IP address, interface index is ifname*/
+struct Msg* mlacp_arp_table_find(struct CSM* csm, uint32_t ipv4_addr);
+void mlacp_arp_table_add(struct CSM* csm, struct Msg* msg);
+void mlacp_arp_table_del(struct CSM* csm, struct Msg* msg);
+void mlacp_arp_table_set_ifname(struct CSM* csm, struct Msg* msg, const char* ifname);
+void mlacp_arp_table_flush(struct CSM* csm);
+
+struct Msg* mlacp_ndisc_table_find(struct CSM* csm, const uint32_t* ipv6_addr);
+void mlacp_ndisc_table_add(struct CSM* csm, struct Msg* msg);
+void mlacp_ndisc_table_del(struct CSM* csm, struct Msg* msg);
+void mlacp_ndisc_table_set_ifname(struct CSM* csm, struct Msg* msg, const char* ifname);
+void mlacp_ndisc_table_flush(struct CSM* csm);
+
+/* Interface ids of the compact sync TLVs, valid for one session*/
+#define MLACP_IF_ID_NONE        0xFFFF
+
+struct mlacp_if_id_table
+{
+    uint16_t num;
+    uint16_t size;
+    char (*name)[MAX_L_PORT_NAME];
+    /* Sender side name index, chained by id*/
+    uint16_t* next;
+    uint16_t bucket[MLACP_IF_HASH_SIZE];
+};
+
+void mlacp_if_id_init(struct mlacp_if_id_table* table);
+int mlacp_if_id_get(struct mlacp_if_id_table* table, const char* ifname, int* is_new);
+int mlacp_if_id_set(struct mlacp_if_id_table* table, uint16_t id, const char* ifname);
+const char* mlacp_if_id_name(struct mlacp_if_id_table* table, uint16_t id);
+void mlacp_if_id_flush(struct mlacp_if_id_table* table);
+
+/* All entries whose interface hashes to the same bucket as ifname,
+ * caller must still compare the interface name*/
+#define MLACP_MAC_IF_BUCKET(csm, ifname) \
+    (&MLACP(csm).mac_if_hash[mlacp_if_hash(ifname)])
+#define MLACP_ARP_IF_BUCKET(csm, ifname) \
+    (&MLACP(csm).arp_if_hash[mlacp_if_hash(ifname)])
+#define MLACP_NDISC_IF_BUCKET(csm, ifname) \
+    (&MLACP(csm).ndisc_if_hash[mlacp_if_hash(ifname)])
+
+#endif /* _MLACP_TABLE_H */
@@ -55,6 +55,24 @@ struct mLACPSysConfigTLV
 
 typedef struct mLACPSysConfigTLV mLACPSysConfigTLV;
 
+/* Peer supports the compact MAC/ARP/ND sync TLVs*/
+#define MLACP_SYSCONF_CAP_COMPACT_SYNC      0x00000001
+
+/* Largest sync PDU we accept, below the 64KB LDP message limit*/
+#define MLACP_SYNC_PDU_MAX_SIZE             61440
+/* Smaller PDU size advertised by the peer disables the compact TLVs*/
+#define MLACP_SYNC_PDU_MIN_SIZE             1024
+
+/*
+ * Appended to the System Config TLV, older peers read the fixed
+ * part only and never see it
+ */
+struct mLACPSysConfigCap
+{
+    uint32_t capabilities;
+    uint16_t max_pdu_size;
+} __attribute__ ((packed));
+
 /*
  * RFC 7275
  * 7.2.4.  mLACP Aggregator Config TLV
@@ -366,6 +384,121 @@ struct mLACPMACInfoTLV
     struct mLACPMACData MacEntry[0];
 } __attribute__ ((packed));
 
+/*
+ * Interface ID map TLV, binds the per session interface ids used by the
+ * compact TLVs to interface names. Sent once per id and session
+ */
+struct mLACPIfIdData
+{
+    uint16_t if_id;
+    char ifname[MAX_L_PORT_NAME];
+} __attribute__ ((packed));
+
+struct mLACPIfIdMapTLV
+{
+    ICCParameter icc_parameter;
+    uint16_t num_of_entry;
+    struct mLACPIfIdData IfIdEntry[0];
+} __attribute__ ((packed));
+
+/*
+ * Compact MAC Information TLV
+ */
+struct mLACPMACCompactData
+{
+    uint8_t type;/*add or del*/
+    uint8_t mac_addr[ETHER_ADDR_LEN];
+    uint16_t vid;
+    uint16_t if_id;
+} __attribute__ ((packed));
+
+struct mLACPMACCompactInfoTLV
+{
+    ICCParameter icc_parameter;
+    uint16_t num_of_entry;
+    struct mLACPMACCompactData MacEntry[0];
+} __attribute__ ((packed));
+
+/*
+ * Compact ARP Information TLV
+ */
+struct mLACPARPCompactData
+{
+    uint8_t op_type;
+    uint16_t if_id;
+    uint32_t ipv4_addr;
+    uint8_t mac_addr[ETHER_ADDR_LEN];
+} __attribute__ ((packed));
+
+struct mLACPARPCompactInfoTLV
+{
+    ICCParameter icc_parameter;
+    uint16_t num_of_entry;
+    struct mLACPARPCompactData ArpEntry[0];
+} __attribute__ ((packed));
+
+/*
+ * Compact NDISC Information TLV
+ */
+struct mLACPNDISCCompactData
+{
+    uint8_t op_type;
+    uint16_t if_id;
+    uint32_t ipv6_addr[4];
+    uint8_t mac_addr[ETHER_ADDR_LEN];
+} __attribute__ ((packed));
+
+struct mLACPNDISCCompactInfoTLV
+{
+    ICCParameter icc_parameter;
+    uint16_t num_of_entry;
+    struct mLACPNDISCCompactData NdiscEntry[0];
+} __attribute__ ((packed));
+
+/*
+ * Sync Sequence TLV, for incremental MAC/ARP/ND resync
+ *   MARK:   sender has sent all records up to seq of its epoch
+ *   RESUME: receiver holds the records up to seq of epoch, tables in flags
+ *   REPLY:  sender resumes the tables in flags, full sync for the others
+ */
+enum MLACP_SYNC_SEQ_OP
+{
+    MLACP_SYNC_SEQ_MARK = 1,
+    MLACP_SYNC_SEQ_RESUME,
+    MLACP_SYNC_SEQ_REPLY,
+};
+
+#define MLACP_SYNC_SEQ_TABLES   3
+
+struct mLACPSyncSeqTLV
+{
+    ICCParameter icc_parameter;
+    uint8_t op;
+    uint8_t flags;
+    uint32_t epoch;
+    uint32_t seq[MLACP_SYNC_SEQ_TABLES];
+} __attribute__ ((packed));
+
+/*
+ * NOS: Fast hello, sub-second liveness
+ */
+#define MLACP_FAST_HELLO_VERSION        1
+#define MLACP_FAST_HELLO_MIN_MSEC       50
+#define MLACP_FAST_HELLO_MAX_MSEC       10000
+#define MLACP_FAST_HELLO_MULT_DEFAULT   3
+#define MLACP_FAST_HELLO_MULT_MIN       2
+#define MLACP_FAST_HELLO_MULT_MAX       20
+
+struct mLACPFastHelloTLV
+{
+    ICCParameter icc_parameter;
+    uint8_t version;
+    uint8_t multiplier;
+    uint16_t reserved;
+    uint32_t tx_interval;   /* msec*/
+    uint32_t seq;
+} __attribute__ ((packed));
+
 struct ARPMsg
 {
     uint8_t     op_type;
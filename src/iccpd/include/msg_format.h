@@ -99,6 +99,12 @@
 #define TLV_T_MLACP_MAC_INFO            0x1038
 #define TLV_T_MLACP_WARMBOOT_FLAG       0x1039
 #define TLV_T_MLACP_NDISC_INFO          0x103A
+#define TLV_T_MLACP_IF_ID_MAP           0x103B
+#define TLV_T_MLACP_MAC_INFO_COMPACT    0x103C
+#define TLV_T_MLACP_ARP_INFO_COMPACT    0x103D
+#define TLV_T_MLACP_NDISC_INFO_COMPACT  0x103E
+#define TLV_T_MLACP_SYNC_SEQ            0x103F
+#define TLV_T_MLACP_FAST_HELLO          0x1040
 #define TLV_T_MLACP_LIST_END            0x104a  // list end
 
 /* Debug */
@@ -178,6 +184,24 @@ static char* get_tlv_type_string(int type)
 
         case TLV_T_MLACP_STP_INFO:
             return "TLV_T_MLACP_STP_INFO";
+
+        case TLV_T_MLACP_IF_ID_MAP:
+            return "TLV_T_MLACP_IF_ID_MAP";
+
+        case TLV_T_MLACP_MAC_INFO_COMPACT:
+            return "TLV_T_MLACP_MAC_INFO_COMPACT";
+
+        case TLV_T_MLACP_ARP_INFO_COMPACT:
+            return "TLV_T_MLACP_ARP_INFO_COMPACT";
+
+        case TLV_T_MLACP_NDISC_INFO_COMPACT:
+            return "TLV_T_MLACP_NDISC_INFO_COMPACT";
+
+        case TLV_T_MLACP_SYNC_SEQ:
+            return "TLV_T_MLACP_SYNC_SEQ";
+
+        case TLV_T_MLACP_FAST_HELLO:
+            return "TLV_T_MLACP_FAST_HELLO";
     }
 
     return "UNKNOWN";
@@ -427,7 +451,8 @@ struct AppDisconnectCauseTLV
 typedef enum mclag_syncd_msg_type_e_
 {
     MCLAG_SYNCD_MSG_TYPE_NONE           = 0,
-    MCLAG_SYNCD_MSG_TYPE_FDB_OPERATION  = 1
+    MCLAG_SYNCD_MSG_TYPE_FDB_OPERATION  = 1,
+    MCLAG_SYNCD_MSG_TYPE_FDB_DELTA      = 2
 }mclag_syncd_msg_type_e;
 
 typedef enum mclag_msg_type_e_
@@ -438,7 +463,9 @@ typedef enum mclag_msg_type_e_
     MCLAG_MSG_TYPE_FLUSH_FDB            = 3,
     MCLAG_MSG_TYPE_SET_MAC              = 4,
     MCLAG_MSG_TYPE_SET_FDB              = 5,
-    MCLAG_MSG_TYPE_GET_FDB_CHANGES      = 20
+    MCLAG_MSG_TYPE_REDIRECT_FDB         = 6,
+    MCLAG_MSG_TYPE_GET_FDB_CHANGES      = 20,
+    MCLAG_MSG_TYPE_SUBSCRIBE_FDB        = 21
 }mclag_msg_type_e;
 
 
@@ -482,6 +509,46 @@ struct mclag_fdb_info
     short op_type;  /*add or del*/
 };
 
+typedef enum mclag_fdb_redirect_type_e_
+{
+    MCLAG_FDB_REDIRECT_MOVE = 1,    /* move the entries to dst_port*/
+    MCLAG_FDB_REDIRECT_DEL  = 2     /* delete the entries, dst_port is unused*/
+} mclag_fdb_redirect_type_e;
+
+/* Redirect all non-static FDB entries of src_port by one msg.
+ * vid_num 0 is all VLANs, the entries of vid[] only otherwise*/
+struct mclag_fdb_redirect_info
+{
+    char src_port[MAX_L_PORT_NAME];
+    char dst_port[MAX_L_PORT_NAME];
+    short op_type;
+    unsigned short vid_num;
+    unsigned short vid[0];
+};
+
+/* Send the whole FDB table before the changes*/
+#define MCLAG_FDB_SUBSCRIBE_SNAPSHOT    0x01
+
+/* Ask mclagsyncd to push the FDB changes as they occur.
+ * Changes of one MAC within window_msec are coalesced to the last one*/
+struct mclag_fdb_subscribe_info
+{
+    uint32_t window_msec;
+    uint32_t flags;
+};
+
+#define MCLAG_FDB_DELTA_SNAPSHOT        0x01    /* entries of the whole table*/
+#define MCLAG_FDB_DELTA_SNAPSHOT_END    0x02    /* last msg of the snapshot*/
+
+/* Head of MCLAG_SYNCD_MSG_TYPE_FDB_DELTA, followed by count mclag_fdb_info.
+ * seq goes up by one per msg, snapshot msgs included, a gap means lost msgs*/
+struct mclag_fdb_delta_hdr
+{
+    uint32_t seq;
+    uint16_t flags;
+    uint16_t count;
+};
+
 /* For storing message log: For Notification TLV */
 struct MsgTypeSet
 {
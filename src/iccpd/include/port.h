@@ -50,6 +50,18 @@
 #define IF_T_VLAN         2
 #define IF_T_VXLAN       3
 #define IF_T_BRIDGE      4
+
+/* 802.1Q VLAN ID space, membership is also kept as a bitmap*/
+#define VLAN_ID_MAX         4096
+#define VLAN_BITMAP_WORDS   (VLAN_ID_MAX / 64)
+
+struct VlanBitmap
+{
+    uint64_t bits[VLAN_BITMAP_WORDS];
+};
+
+/* Local interface hash index, bucket number must be power of 2*/
+#define LOCAL_IF_HASH_SIZE 1024
 typedef struct
 {
     char *ifname;
@@ -89,6 +101,8 @@ struct PeerInterface
 
     LIST_ENTRY(PeerInterface) mlacp_next;
     LIST_HEAD(peer_vlan_list, VLAN_ID) vlan_list;
+    /* Same VLANs as vlan_list, for O(1) membership tests*/
+    struct VlanBitmap vlan_bitmap;
 };
 
 struct LocalInterface
@@ -121,17 +135,28 @@ struct LocalInterface
     uint8_t port_config_sync;
 
     LIST_HEAD(local_vlan_list, VLAN_ID) vlan_list;
+    /* Same VLANs as vlan_list, for O(1) membership tests*/
+    struct VlanBitmap vlan_bitmap;
 
     LIST_ENTRY(LocalInterface) system_next;
     LIST_ENTRY(LocalInterface) system_purge_next;
     LIST_ENTRY(LocalInterface) mlacp_next;
     LIST_ENTRY(LocalInterface) mlacp_purge_next;
+
+    /* sys->lif_list hash index*/
+    LIST_ENTRY(LocalInterface) name_hash_next;
+    LIST_ENTRY(LocalInterface) ifindex_hash_next;
+    LIST_ENTRY(LocalInterface) po_id_hash_next;
 };
 
+LIST_HEAD(lif_hash_bucket, LocalInterface);
+
 struct LocalInterface* local_if_create(int ifindex, char* ifname, int type);
 struct LocalInterface* local_if_find_by_name(const char* ifname);
 struct LocalInterface* local_if_find_by_ifindex(int ifindex);
 struct LocalInterface* local_if_find_by_po_id(int po_id);
+void local_if_rename(struct LocalInterface* local_if, const char* ifname);
+void local_if_unlink(struct LocalInterface* local_if);
 
 void local_if_destroy(char *ifname);
 void local_if_change_flag_clear(void);
@@ -152,6 +177,19 @@ int peer_if_clean_unused_vlan(struct PeerInterface* peer_if);
 int local_if_add_vlan(struct LocalInterface* local_if, uint16_t vid);
 void local_if_del_vlan(struct LocalInterface* local_if, uint16_t vid);
 void local_if_del_all_vlan(struct LocalInterface* lif);
+int local_if_set_vlans(struct LocalInterface* local_if, const struct VlanBitmap* vlans);
+int local_if_has_vlan(const struct LocalInterface* local_if, int vid);
+int local_if_vlan_id(const struct LocalInterface* lif_vlan);
+int peer_if_has_vlan(const struct PeerInterface* peer_if, int vid);
+
+/* VLAN bitmap*/
+void vlan_bitmap_clear_all(struct VlanBitmap* bm);
+void vlan_bitmap_set(struct VlanBitmap* bm, int vid);
+void vlan_bitmap_clear(struct VlanBitmap* bm, int vid);
+int vlan_bitmap_test(const struct VlanBitmap* bm, int vid);
+int vlan_bitmap_count(const struct VlanBitmap* bm);
+/* Lowest VLAN of a & ~b, -1 if a is a subset of b*/
+int vlan_bitmap_first_diff(const struct VlanBitmap* a, const struct VlanBitmap* b);
 
 /* ARP manipulation */
 int set_sys_arp_accept_flag(char* ifname, int flag);
@@ -41,7 +41,9 @@ struct System;
 #define CONNECT_TIMEOUT_MSEC         100
 #define HEARTBEAT_TIMEOUT_SEC       15
 #define TRANSIT_INTERVAL_SEC       1
-#define EPOLL_TIMEOUT_MSEC          100
+#define FDB_PULL_INTERVAL_SEC       60
+/* Coalescing window asked of mclagsyncd for the pushed FDB changes*/
+#define FDB_SUBSCRIBE_WINDOW_MSEC   10
 
 int scheduler_prepare_session(struct CSM*);
 int scheduler_check_csm_config(struct CSM*);
@@ -53,8 +55,10 @@ void scheduler_loop();
 void scheduler_start();
 void scheduler_server_sock_init();
 int scheduler_csm_read_callback(struct CSM* csm);
+int scheduler_csm_write_callback(struct CSM* csm);
 int iccp_get_server_sock_fd();
 int scheduler_server_accept();
 int iccp_receive_signal_handler(struct System* sys);
+void scheduler_fsm_kick();
 
 #endif /* SCHEDULER_H_ */
@@ -31,6 +31,7 @@
 
 #include <sys/time.h>
 #include <sys/types.h>
+#include <time.h>
 #include <unistd.h>
 
 #include <sys/socket.h>
@@ -47,11 +48,117 @@
 #define MCLAG_ERROR -1
 
 struct CSM;
+struct Msg;
 
 #ifndef MAX_BUFSIZE
     #define MAX_BUFSIZE 4096
 #endif
 
+/* mclagsyncd outbound queue*/
+#define SYNCD_TX_FDB_BATCH_SIZE     64
+#define SYNCD_TX_HIGH_WATER         (4 * 1024 * 1024)
+#define SYNCD_TX_IOV_MAX            64
+#define SYNCD_TX_DEFER_HASH_SIZE    1024
+
+/* mclagsyncd receive reassembly buffer*/
+#define SYNCD_RX_BUF_MIN_SIZE       16384
+#define SYNCD_RX_READ_BUDGET        64
+
+/* Kernel neighbor programming, ARP/ND requests are queued in batches,
+ * sent on EPOLLOUT and acked asynchronously*/
+#define NEIGH_BATCH_BUF_SIZE        65536
+#define NEIGH_BATCH_MAX_MSGS        256
+#define NEIGH_PENDING_MAX           4096    /* must be power of 2*/
+#define NEIGH_BATCH_RING_SIZE       64      /* must be power of 2*/
+#define NEIGH_ACK_WAIT_MSEC         100     /* ack of a sent request is lost after this*/
+#define NEIGH_LATENCY_BUCKETS       6       /* <100us <1ms <10ms <100ms <1s >=1s*/
+
+struct NeighPending
+{
+    uint32_t seq;
+    uint32_t batch;
+    uint8_t in_use;
+    uint8_t sent;
+    uint8_t add;
+    uint8_t family;
+    uint8_t mac[ETHER_ADDR_LEN];
+    uint8_t addr[16];
+    char ifname[MAX_L_PORT_NAME];
+    struct timespec sent_time;
+    int error;      /* of the ack, kept until the slot is reused*/
+};
+
+struct NeighBatch
+{
+    uint32_t last_seq;
+    uint32_t msgs;
+    struct timespec sent;
+};
+
+struct NeighBatchStats
+{
+    uint64_t requests;
+    uint64_t batches;
+    uint64_t bytes;
+    uint64_t acks;
+    uint64_t failures;
+    uint64_t eagain;
+    uint64_t lost_acks;
+    uint64_t dropped;
+    uint64_t resyncs;
+    uint32_t pending_peak;
+    uint32_t latency_max_usec;
+    uint64_t latency_hist[NEIGH_LATENCY_BUCKETS];
+};
+
+struct SyncdTxStats
+{
+    uint64_t tx_frames;
+    uint64_t tx_fdb_entries;
+    uint64_t tx_bytes;
+    uint64_t writev_calls;
+    uint64_t eagain;
+    uint64_t hwm_hits;
+    uint64_t dropped_frames;
+    uint64_t dropped_fdb_entries;
+    uint64_t fdb_redirects;
+    uint64_t stalls;
+    uint64_t deferred_frames;
+    uint64_t deferred_fdb_entries;
+    uint64_t deferred_coalesced;
+    uint32_t queued_bytes_peak;
+};
+
+LIST_HEAD(syncd_defer_bucket, Msg);
+
+struct FdbSubscribeStats
+{
+    uint64_t subscribes;
+    uint64_t deltas;            /* delta msgs, snapshot ones included*/
+    uint64_t delta_entries;
+    uint64_t snapshots;
+    uint64_t snapshot_entries;
+    uint64_t gaps;              /* seq jumps, each asks a snapshot*/
+    uint64_t reconciled;        /* local MACs not in a snapshot, deleted*/
+    uint64_t polls;             /* GET_FDB_CHANGES sent*/
+};
+
+struct NetlinkResyncStats
+{
+    uint64_t route_losses;      /* route event socket overruns*/
+    uint64_t team_losses;       /* team event socket overruns*/
+    uint64_t ring_losses;       /* ingest ring full*/
+    uint64_t deferred;          /* losses while a resync was waiting*/
+    uint64_t link_dumps;
+    uint64_t addr_dumps;
+    uint64_t neigh4_dumps;
+    uint64_t neigh6_dumps;
+    uint64_t team_dumps;        /* port-channels whose members were dumped*/
+    uint64_t steps;
+    uint64_t total_usec;
+    uint32_t max_step_usec;
+};
+
 struct System
 {
     int server_fd;/* Peer-Link Socket*/
@@ -69,6 +176,19 @@ struct System
     struct nl_sock * genric_event_sock;
     struct nl_sock * route_event_sock;
 
+    /* ARP/ND programming, batch being built and requests waiting for ack*/
+    struct nl_sock * neigh_sock;
+    TAILQ_HEAD(neigh_tx_list, Msg) neigh_tx_list;  /* batches not sent yet, the tail is open*/
+    uint32_t neigh_tx_msgs;         /* requests in the open batch*/
+    int neigh_tx_pollout;
+    uint32_t neigh_seq;
+    uint32_t neigh_batch_id;
+    uint32_t neigh_pending_num;
+    struct NeighPending* neigh_pending;
+    struct NeighBatch neigh_batch[NEIGH_BATCH_RING_SIZE];
+    struct NeighBatchStats neigh_stats;
+    struct nl_sock * neigh_dump_sock;   /* resync dumps, read over several steps*/
+
     int sig_pipe_r;
     int sig_pipe_w;
     int warmboot_start;
@@ -78,19 +198,57 @@ struct System
     LIST_HEAD(csm_list, CSM) csm_list;
     LIST_HEAD(lif_all_list, LocalInterface) lif_list;
     LIST_HEAD(lif_purge_all_list, LocalInterface) lif_purge_list;
+    struct lif_hash_bucket lif_name_hash[LOCAL_IF_HASH_SIZE];
+    struct lif_hash_bucket lif_ifindex_hash[LOCAL_IF_HASH_SIZE];
+    struct lif_hash_bucket lif_po_id_hash[LOCAL_IF_HASH_SIZE];
+
+    /* mclagsyncd outbound queue, flushed by writev*/
+    TAILQ_HEAD(syncd_tx_list, Msg) syncd_tx_list;
+    struct Msg* syncd_tx_fdb_frame; /* tail SET_FDB frame still open for entries*/
+    size_t syncd_tx_offset;         /* bytes of the head frame already written*/
+    uint32_t syncd_tx_bytes;        /* bytes queued and not yet written*/
+    int syncd_tx_pollout;
+    int syncd_tx_stalled;           /* hit the high-water, hold msgs back until drained*/
+    /* Msgs held back while stalled, in order. FDB entries are keyed by MAC and vid,
+       a later op replaces the held back one*/
+    TAILQ_HEAD(syncd_defer_list, Msg) syncd_defer_list;
+    struct syncd_defer_bucket syncd_defer_hash[SYNCD_TX_DEFER_HASH_SIZE];
+    uint32_t syncd_defer_num;
+    struct SyncdTxStats syncd_tx_stats;
+
+    /* FDB changes pushed by mclagsyncd, polled until the first snapshot ends*/
+    int fdb_subscribed;
+    int fdb_snapshot;           /* snapshot msgs being received*/
+    int fdb_resubscribing;      /* snapshot asked after a gap*/
+    uint32_t fdb_seq;           /* seq of the last delta msg*/
+    uint32_t fdb_gen;           /* generation of the last snapshot*/
+    struct FdbSubscribeStats fdb_sub_stats;
+
+    /* mclagsyncd receive buffer, holds a partial msg across reads*/
+    char* syncd_rx_buf;
+    uint32_t syncd_rx_size;
+    uint32_t syncd_rx_len;
 
     /* Settings */
     char* log_file_path;
     char* cmd_file_path;
     char* config_file_path;
     char* mclagdctl_file_path;
+    char* checkpoint_file_path;
+    char* capture_file_path;    /* NULL if not capturing*/
+    char* replay_file_path;     /* NULL if not replaying*/
+    int replay_speed;           /* 0 for as fast as possible*/
     int pid_file_fd;
     int telnet_port;
+    /* mclagsyncd supports MCLAG_MSG_TYPE_REDIRECT_FDB*/
+    int fdb_bulk_redirect;
     fd_set readfd; /*record socket need to listen*/
     int readfd_count;
     time_t csm_trans_time;
-    int need_sync_team_again;
-    int need_sync_netlink_again;
+    int fsm_kick;
+    /* NETLINK_RESYNC_* kernel objects to dump again*/
+    uint32_t netlink_resync_dirty;
+    struct NetlinkResyncStats netlink_resync_stats;
 };
 
 struct CSM* system_create_csm();
@@ -99,5 +257,6 @@ struct CSM* system_get_csm_by_mlacp_id(int id);
 struct System* system_get_instance();
 void system_finalize();
 void system_init(struct System*);
+int system_init_sockets(struct System*);
 
 #endif /* SYSTEM_H_ */
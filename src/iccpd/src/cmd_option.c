@@ -132,6 +132,14 @@ void cmd_option_parser_init(struct CmdOptionParser* parser)
     LIST_INIT(&parser->option_list);
     cmd_option_register(parser, "-l <LOG_FILE_PATH>", "Set log file path.\n(Default: /var/log/iccpd.log)");
     cmd_option_register(parser, "-p <TCP_PORT>", "Set the port used for telnet listening port.\n(Default: 2015)");
+    cmd_option_register(parser, "-f <CONFIG_FILE>", "Set the configuration file path.\n(Default: /etc/iccpd/iccpd.conf)");
+    cmd_option_register(parser, "-w <CHECKPOINT_FILE>", "Set the warm restart checkpoint file path.\n(Default: /var/warmboot/iccpd/tables.ckpt)");
+    cmd_option_register(parser, "-d <CAPTURE_FILE>", "Capture the ICCP PDUs, mclagsyncd msgs and kernel inputs to the file. (Default: No)");
+    cmd_option_register(parser, "-r <CAPTURE_FILE>", "Replay a capture file without opening sockets or programming the kernel, then exit.");
+    cmd_option_register(parser, "-s <SPEED>", "Replay at SPEED times the captured pace, 0 for no wait.\n(Default: 1)");
+    cmd_option_register(parser, "-t <TICK_MSEC>", "Set the timer tick in milliseconds, 1 to 1000.\n(Default: 10)");
+    cmd_option_register(parser, "-n <RCVBUF_KB>", "Set the receive buffer of the kernel event sockets in KB, 64 to 1048576.\n(Default: 4096)");
+    cmd_option_register(parser, "-b", "Redirect the FDB entries of a down port-channel by one mclagsyncd msg. (Default: No)");
     cmd_option_register(parser, "-c", "Dump log message to console. (Default: No)");
     cmd_option_register(parser, "-h", "Show the usage.");
 }
@@ -254,6 +262,34 @@ int cmd_option_parser_parse(struct CmdOptionParser* parser, int argc, char* argv
             if (num > 0 && num < 65535)
                 parser->telnet_port = num;
         }
+        else if (strncmp(opt_name, "-t", 2) == 0)
+        {
+            num = atoi(val);
+            if (num > 0 && num <= 1000)
+                parser->timer_tick_msec = num;
+        }
+        else if (strncmp(opt_name, "-f", 2) == 0)
+            parser->config_file_path = val;
+        else if (strncmp(opt_name, "-w", 2) == 0)
+            parser->checkpoint_file_path = val;
+        else if (strncmp(opt_name, "-d", 2) == 0)
+            parser->capture_file_path = val;
+        else if (strncmp(opt_name, "-r", 2) == 0)
+            parser->replay_file_path = val;
+        else if (strncmp(opt_name, "-s", 2) == 0)
+        {
+            num = atoi(val);
+            if (num >= 0)
+                parser->replay_speed = num;
+        }
+        else if (strncmp(opt_name, "-n", 2) == 0)
+        {
+            num = atoi(val);
+            if (num >= 64 && num <= 1048576)
+                parser->netlink_rcvbuf_kb = num;
+        }
+        else if (strncmp(opt_name, "-b", 2) == 0)
+            parser->fdb_bulk_redirect = 1;
         else if (strncmp(opt_name, "-c", 2) == 0)
             parser->console_log = 1;
         else
@@ -0,0 +1,712 @@
+/*
+ *  iccp_capture.c
+ *  Capture of the ICCP, mclagsyncd and kernel inputs, and replay of the
+ *  capture file.
+ *
+ * Copyright(c) 2016-2019 Nephos/Estinet.
+ *
+ * This program is free software; you can redistribute it and/or modify it
+ * under the terms and conditions of the GNU General Public License,
+ * version 2, as published by the Free Software Foundation.
+ *
+ * This program is distributed in the hope it will be useful, but WITHOUT
+ * ANY WARRANTY; without even the implied warranty of MERCHANTABILITY or
+ * FITNESS FOR A PARTICULAR PURPOSE.  See the GNU General Public License for
+ * more details.
+ *
+ * You should have received a copy of the GNU General Public License along with
+ * this program; if not, see <http://www.gnu.org/licenses/>.
+ *
+ * The full GNU General Public License is included in this distribution in
+ * the file called "COPYING".
+ *
+ *  Maintainer: jianjun, grace Li from nephos
+ */
+
+#include <errno.h>
+#include <fcntl.h>
+#include <stdio.h>
+#include <stdlib.h>
+#include <string.h>
+#include <time.h>
+#include <unistd.h>
+#include <sys/queue.h>
+#include <sys/resource.h>
+
+#include "../include/system.h"
+#include "../include/logger.h"
+#include "../include/scheduler.h"
+#include "../include/iccp_csm.h"
+#include "../include/iccp_timer.h"
+#include "../include/iccp_latency.h"
+#include "../include/mlacp_link_handler.h"
+#include "../include/mlacp_fast_hello.h"
+#include "../include/iccp_cmd.h"
+#include "../include/iccp_netlink.h"
+#include "../include/iccp_ingest.h"
+#include "../include/iccp_checkpoint.h"
+#include "../include/iccp_capture.h"
+
+/* The capture is written through a stdio buffer flushed by a timer, a
+ * crash loses at most ICCP_CAPTURE_FLUSH_MSEC of records. Besides the peer
+ * and mclagsyncd msgs it takes everything else the tables are built from:
+ * the boot type, the config lines, the kernel dumps, the ingest events,
+ * the teamd msgs and the restored checkpoint.
+ *
+ * On replay no socket is opened and nothing is programmed in the kernel.
+ * The peer and mclagsyncd fds are opened on /dev/null, so what the FSMs
+ * send is written and dropped, and the recorded inputs go through the same
+ * parse and dispatch code as the live ones, in the captured order. The tx
+ * records are only counted, to compare with the msgs sent by the replay.
+ * Timers run on the replay clock, the timer driven work, e.g. MAC aging,
+ * only lines up with the capture when it is replayed at speed 1.*/
+
+struct IccpCapture
+{
+    FILE* fp;
+    char* buf;
+    uint64_t start_usec;
+    uint64_t bytes;
+    uint64_t records;
+    struct iccp_timer flush_timer;
+};
+
+struct IccpReplay
+{
+    FILE* fp;
+    char* buf;
+    uint32_t buf_size;
+    int speed;              /* 0 for no wait between records*/
+    int eof;
+    int done;
+    int rec_loaded;
+    struct IccpCaptureRec rec;
+    uint64_t start_usec;
+    uint64_t last_rec_usec;
+    struct timespec cpu_start;
+    uint64_t records[ICCP_CAPTURE_TYPE_MAX];
+    uint64_t bytes;
+    uint64_t skipped;       /* no CSM or session for the record*/
+    struct iccp_timer wait_timer;
+};
+
+static struct IccpCapture iccp_capture;
+static struct IccpReplay iccp_replay;
+
+static const char* iccp_capture_type_str[ICCP_CAPTURE_TYPE_MAX] =
+{
+    [ICCP_CAPTURE_PEER_RX]      = "peer rx",
+    [ICCP_CAPTURE_PEER_TX]      = "peer tx",
+    [ICCP_CAPTURE_SYNCD_RX]     = "syncd rx",
+    [ICCP_CAPTURE_SYNCD_TX]     = "syncd tx",
+    [ICCP_CAPTURE_SESSION_UP]   = "session up",
+    [ICCP_CAPTURE_SESSION_DOWN] = "session down",
+    [ICCP_CAPTURE_START]        = "start",
+    [ICCP_CAPTURE_CONFIG]       = "config",
+    [ICCP_CAPTURE_DUMP]         = "kernel dump",
+    [ICCP_CAPTURE_INGEST]       = "kernel event",
+    [ICCP_CAPTURE_TEAM]         = "team",
+    [ICCP_CAPTURE_CHECKPOINT]   = "checkpoint",
+    [ICCP_CAPTURE_SWEEP]        = "sweep",
+};
+
+/****************************************
+* Capture
+****************************************/
+
+static void iccp_capture_flush_handler(void* arg)
+{
+    if (iccp_capture.fp == NULL)
+        return;
+
+    fflush(iccp_capture.fp);
+    iccp_timer_start(&iccp_capture.flush_timer, ICCP_CAPTURE_FLUSH_MSEC);
+
+    return;
+}
+
+int iccp_capture_start(struct System* sys)
+{
+    struct IccpCaptureHdr hdr;
+    struct timespec now;
+
+    if (sys == NULL || sys->capture_file_path == NULL)
+        return 0;
+
+    iccp_capture.fp = fopen(sys->capture_file_path, "w");
+    if (iccp_capture.fp == NULL)
+    {
+        ICCPD_LOG_ERR(__FUNCTION__, "Failed to open capture file %s: %s",
+                      sys->capture_file_path, strerror(errno));
+        return MCLAG_ERROR;
+    }
+
+    iccp_capture.buf = (char*)malloc(ICCP_CAPTURE_BUF_SIZE);
+    if (iccp_capture.buf)
+        setvbuf(iccp_capture.fp, iccp_capture.buf, _IOFBF, ICCP_CAPTURE_BUF_SIZE);
+
+    clock_gettime(CLOCK_REALTIME, &now);
+    memset(&hdr, 0, sizeof(hdr));
+    hdr.magic = ICCP_CAPTURE_MAGIC;
+    hdr.version = ICCP_CAPTURE_VERSION;
+    hdr.hdr_size = sizeof(struct IccpCaptureHdr);
+    hdr.rec_hdr_size = sizeof(struct IccpCaptureRec);
+    hdr.start_sec = now.tv_sec;
+
+    if (fwrite(&hdr, sizeof(hdr), 1, iccp_capture.fp) != 1)
+    {
+        iccp_capture_stop();
+        return MCLAG_ERROR;
+    }
+
+    iccp_capture.start_usec = iccp_latency_now_usec();
+    iccp_capture.bytes = sizeof(hdr);
+    iccp_capture.records = 0;
+
+    iccp_timer_init(&iccp_capture.flush_timer, iccp_capture_flush_handler, NULL);
+    iccp_timer_start(&iccp_capture.flush_timer, ICCP_CAPTURE_FLUSH_MSEC);
+
+    ICCPD_LOG_NOTICE(__FUNCTION__, "Capture ICCP and mclagsyncd msgs to %s", sys->capture_file_path);
+
+    return 0;
+}
+
+void iccp_capture_stop()
+{
+    if (iccp_capture.fp == NULL)
+        return;
+
+    iccp_timer_stop(&iccp_capture.flush_timer);
+    fclose(iccp_capture.fp);
+    iccp_capture.fp = NULL;
+
+    if (iccp_capture.buf)
+        free(iccp_capture.buf);
+    iccp_capture.buf = NULL;
+
+    ICCPD_LOG_NOTICE(__FUNCTION__, "Capture stopped, %llu records %llu bytes",
+                     (unsigned long long)iccp_capture.records, (unsigned long long)iccp_capture.bytes);
+
+    return;
+}
+
+/* The record is head followed by buf*/
+static void iccp_capture_put(int type, int mlag_id, const void* head, uint32_t head_len,
+                             const void* buf, uint32_t len)
+{
+    struct IccpCaptureRec rec;
+
+    if (iccp_capture.fp == NULL)
+        return;
+
+    if (head_len + len > ICCP_CAPTURE_REC_MAX_LEN)
+    {
+        ICCPD_LOG_WARN(__FUNCTION__, "Capture record type %d of %u bytes is dropped", type, head_len + len);
+        return;
+    }
+
+    len += head_len;
+    if (iccp_capture.bytes + sizeof(rec) + len > ICCP_CAPTURE_MAX_BYTES)
+    {
+        ICCPD_LOG_WARN(__FUNCTION__, "Capture file reaches %u bytes", ICCP_CAPTURE_MAX_BYTES);
+        iccp_capture_stop();
+        return;
+    }
+
+    rec.usec = iccp_latency_now_usec() - iccp_capture.start_usec;
+    rec.len = len;
+    rec.type = type;
+    rec.mlag_id = mlag_id;
+
+    if (fwrite(&rec, sizeof(rec), 1, iccp_capture.fp) != 1
+        || (head_len > 0 && fwrite(head, head_len, 1, iccp_capture.fp) != 1)
+        || (len > head_len && fwrite(buf, len - head_len, 1, iccp_capture.fp) != 1))
+    {
+        ICCPD_LOG_WARN(__FUNCTION__, "Failed to write capture file: %s", strerror(errno));
+        iccp_capture_stop();
+        return;
+    }
+
+    iccp_capture.bytes += sizeof(rec) + len;
+    iccp_capture.records++;
+
+    return;
+}
+
+void iccp_capture_write(int type, int mlag_id, const void* buf, uint32_t len)
+{
+    iccp_capture_put(type, mlag_id, NULL, 0, buf, len);
+
+    return;
+}
+
+void iccp_capture_session(struct CSM* csm, int up, int accepted)
+{
+    uint8_t role = accepted ? 1 : 0;
+
+    if (csm == NULL)
+        return;
+
+    if (up)
+        iccp_capture_write(ICCP_CAPTURE_SESSION_UP, csm->mlag_id, &role, sizeof(role));
+    else
+        iccp_capture_write(ICCP_CAPTURE_SESSION_DOWN, csm->mlag_id, NULL, 0);
+
+    return;
+}
+
+void iccp_capture_ingest(const struct IngestEvent* ev)
+{
+    uint8_t type = ev->type;
+    const void* buf = NULL;
+    uint32_t len = 0;
+
+    if (iccp_capture.fp == NULL)
+        return;
+
+    switch (ev->type)
+    {
+        case INGEST_EV_NEIGH:
+        case INGEST_EV_ARP_REPLY:
+        case INGEST_EV_NA:
+            buf = &ev->u.neigh;
+            len = sizeof(struct NeighEvent);
+            break;
+
+        case INGEST_EV_ROUTE_MSG:
+            buf = ev->u.nlh;
+            len = ev->u.nlh->nlmsg_len;
+            break;
+
+        default:
+            break;
+    }
+
+    iccp_capture_put(ICCP_CAPTURE_INGEST, -1, &type, sizeof(type), buf, len);
+
+    return;
+}
+
+/****************************************
+* Replay
+****************************************/
+
+static void iccp_replay_wait_handler(void* arg)
+{
+    scheduler_fsm_kick();
+
+    return;
+}
+
+int iccp_replay_start(struct System* sys)
+{
+    struct IccpCaptureHdr hdr;
+
+    if (sys == NULL || sys->replay_file_path == NULL)
+        return 0;
+
+    memset(&iccp_replay, 0, sizeof(iccp_replay));
+    iccp_replay.speed = sys->replay_speed;
+
+    iccp_replay.fp = fopen(sys->replay_file_path, "r");
+    if (iccp_replay.fp == NULL)
+    {
+        ICCPD_LOG_ERR(__FUNCTION__, "Failed to open replay file %s: %s",
+                      sys->replay_file_path, strerror(errno));
+        goto err;
+    }
+
+    if (fread(&hdr, sizeof(hdr), 1, iccp_replay.fp) != 1
+        || hdr.magic != ICCP_CAPTURE_MAGIC || hdr.version != ICCP_CAPTURE_VERSION
+        || hdr.hdr_size != sizeof(struct IccpCaptureHdr) || hdr.rec_hdr_size != sizeof(struct IccpCaptureRec))
+    {
+        ICCPD_LOG_ERR(__FUNCTION__, "%s is not a version %d capture file",
+                      sys->replay_file_path, ICCP_CAPTURE_VERSION);
+        goto err;
+    }
+
+    iccp_replay.buf_size = ICCP_REPLAY_BUF_SIZE;
+    iccp_replay.buf = (char*)malloc(iccp_replay.buf_size);
+    if (iccp_replay.buf == NULL)
+        goto err;
+
+    /* Sinks for what the FSMs send to mclagsyncd*/
+    if (sys->sync_fd <= 0)
+        sys->sync_fd = open("/dev/null", O_WRONLY | O_CLOEXEC);
+
+    iccp_timer_init(&iccp_replay.wait_timer, iccp_replay_wait_handler, NULL);
+    iccp_replay.start_usec = iccp_latency_now_usec();
+    clock_gettime(CLOCK_PROCESS_CPUTIME_ID, &iccp_replay.cpu_start);
+
+    ICCPD_LOG_NOTICE(__FUNCTION__, "Replay %s captured at %llu, speed %d",
+                     sys->replay_file_path, (unsigned long long)hdr.start_sec, iccp_replay.speed);
+
+    scheduler_fsm_kick();
+
+    return 0;
+
+ err:
+    if (iccp_replay.fp)
+        fclose(iccp_replay.fp);
+    iccp_replay.fp = NULL;
+    iccp_replay.eof = 1;
+
+    return MCLAG_ERROR;
+}
+
+static struct CSM* iccp_replay_find_csm(struct System* sys, int mlag_id)
+{
+    struct CSM* csm = NULL;
+
+    LIST_FOREACH(csm, &(sys->csm_list), next)
+    {
+        if (csm->mlag_id == mlag_id)
+            return csm;
+    }
+
+    return NULL;
+}
+
+/* Same as a msg parsed from the peer socket, but copied out of the file*/
+static int iccp_replay_peer_rx(struct CSM* csm, char* buf, uint32_t len)
+{
+    struct Msg* msg = NULL;
+
+    if (csm->sock_fd <= 0 || len < sizeof(LDPHdr))
+        return MCLAG_ERROR;
+
+    iccp_latency_count_msg(ICCP_LAT_RX, buf, len);
+
+    if (iccp_csm_init_msg(&msg, buf, len) == 0 && msg)
+    {
+        msg->trace_usec = iccp_latency_now_usec();
+        iccp_csm_enqueue_msg(csm, msg);
+        ++csm->icc_msg_in_count;
+    }
+    else
+        ++csm->i_msg_in_count;
+
+    ++csm->io_stats.rx_msgs;
+    csm->io_stats.rx_bytes += len;
+    mlacp_fast_hello_rx_activity(csm);
+
+    return 0;
+}
+
+static int iccp_replay_session_up(struct CSM* csm, char* buf, uint32_t len)
+{
+    if (csm->sock_fd > 0)
+        return MCLAG_ERROR;
+
+    csm->sock_fd = open("/dev/null", O_WRONLY | O_CLOEXEC);
+    if (csm->sock_fd < 0)
+        return MCLAG_ERROR;
+
+    if (len > 0 && buf[0] == 1)
+        csm->current_state = ICCP_NONEXISTENT;
+    time(&csm->connTimePrev);
+
+    return 0;
+}
+
+/* Copied out of the record, the route msg is freed by the dispatch*/
+static int iccp_replay_ingest(struct System* sys, char* buf, uint32_t len)
+{
+    struct IngestEvent ev;
+
+    if (len < 1)
+        return MCLAG_ERROR;
+
+    memset(&ev, 0, sizeof(ev));
+    ev.type = (uint8_t)buf[0];
+    ev.rx_usec = iccp_latency_now_usec();
+    buf++;
+    len--;
+
+    switch (ev.type)
+    {
+        case INGEST_EV_NEIGH:
+        case INGEST_EV_ARP_REPLY:
+        case INGEST_EV_NA:
+            if (len != sizeof(struct NeighEvent))
+                return MCLAG_ERROR;
+            memcpy(&ev.u.neigh, buf, len);
+            break;
+
+        case INGEST_EV_ROUTE_MSG:
+            if (len < sizeof(struct nlmsghdr) || (ev.u.nlh = (struct nlmsghdr*)malloc(len)) == NULL)
+                return MCLAG_ERROR;
+            memcpy(ev.u.nlh, buf, len);
+            if (ev.u.nlh->nlmsg_len > len)
+            {
+                free(ev.u.nlh);
+                return MCLAG_ERROR;
+            }
+            break;
+
+        case INGEST_EV_ROUTE_ERR:
+            break;
+
+        default:
+            return MCLAG_ERROR;
+    }
+
+    iccp_ingest_dispatch(sys, &ev);
+
+    return 0;
+}
+
+static int iccp_replay_nlmsg_valid(char* buf, uint32_t len)
+{
+    return len >= sizeof(struct nlmsghdr) && ((struct nlmsghdr*)buf)->nlmsg_len <= len;
+}
+
+static int iccp_replay_handle_rec(struct System* sys, struct IccpCaptureRec* rec, char* buf)
+{
+    struct CSM* csm = NULL;
+    int tables;
+
+    switch (rec->type)
+    {
+        case ICCP_CAPTURE_SYNCD_RX:
+            return iccp_syncd_rx_feed(sys, buf, rec->len);
+
+        case ICCP_CAPTURE_START:
+            if (rec->len != 1)
+                return MCLAG_ERROR;
+            sys->warmboot_start = buf[0] ? WARM_REBOOT : 0;
+            return 0;
+
+        case ICCP_CAPTURE_CONFIG:
+            /* The buffer has room for the terminator*/
+            buf[rec->len] = '\0';
+            iccp_config_from_command(buf);
+            return 0;
+
+        case ICCP_CAPTURE_DUMP:
+            if (!iccp_replay_nlmsg_valid(buf, rec->len))
+                return MCLAG_ERROR;
+            iccp_netlink_dump_input((struct nlmsghdr*)buf);
+            return 0;
+
+        case ICCP_CAPTURE_INGEST:
+            return iccp_replay_ingest(sys, buf, rec->len);
+
+        case ICCP_CAPTURE_TEAM:
+            if (!iccp_replay_nlmsg_valid(buf, rec->len))
+                return MCLAG_ERROR;
+            iccp_netlink_team_input((struct nlmsghdr*)buf);
+            return 0;
+
+        case ICCP_CAPTURE_CHECKPOINT:
+            return iccp_checkpoint_restore_buf(sys, buf, rec->len) < 0 ? MCLAG_ERROR : 0;
+
+        case ICCP_CAPTURE_SWEEP:
+            if (rec->len != sizeof(tables))
+                return MCLAG_ERROR;
+            memcpy(&tables, buf, sizeof(tables));
+            iccp_checkpoint_sweep(sys, tables);
+            return 0;
+
+        case ICCP_CAPTURE_PEER_TX:
+        case ICCP_CAPTURE_SYNCD_TX:
+            return 0;
+
+        default:
+            break;
+    }
+
+    if ((csm = iccp_replay_find_csm(sys, rec->mlag_id)) == NULL)
+        return MCLAG_ERROR;
+
+    switch (rec->type)
+    {
+        case ICCP_CAPTURE_PEER_RX:
+            return iccp_replay_peer_rx(csm, buf, rec->len);
+
+        case ICCP_CAPTURE_SESSION_UP:
+            return iccp_replay_session_up(csm, buf, rec->len);
+
+        case ICCP_CAPTURE_SESSION_DOWN:
+            if (csm->sock_fd <= 0)
+                return MCLAG_ERROR;
+            scheduler_session_disconnect_handler(csm);
+            return 0;
+
+        default:
+            break;
+    }
+
+    return MCLAG_ERROR;
+}
+
+static int iccp_replay_load_rec()
+{
+    struct IccpCaptureRec* rec = &iccp_replay.rec;
+    char* buf = NULL;
+
+    if (fread(rec, sizeof(*rec), 1, iccp_replay.fp) != 1)
+        return MCLAG_ERROR;
+
+    if (rec->type <= 0 || rec->type >= ICCP_CAPTURE_TYPE_MAX || rec->len > ICCP_CAPTURE_REC_MAX_LEN)
+    {
+        ICCPD_LOG_ERR(__FUNCTION__, "Bad record type %u len %u at %llu us",
+                      rec->type, rec->len, (unsigned long long)rec->usec);
+        return MCLAG_ERROR;
+    }
+
+    if (rec->len >= iccp_replay.buf_size)
+    {
+        buf = (char*)realloc(iccp_replay.buf, rec->len + 1);
+        if (buf == NULL)
+        {
+            ICCPD_LOG_ERR(__FUNCTION__, "No memory for a record of %u bytes", rec->len);
+            return MCLAG_ERROR;
+        }
+        iccp_replay.buf = buf;
+        iccp_replay.buf_size = rec->len + 1;
+    }
+
+    if (rec->len > 0 && fread(iccp_replay.buf, rec->len, 1, iccp_replay.fp) != 1)
+    {
+        ICCPD_LOG_ERR(__FUNCTION__, "Truncated record at %llu us", (unsigned long long)rec->usec);
+        return MCLAG_ERROR;
+    }
+
+    iccp_replay.rec_loaded = 1;
+
+    return 0;
+}
+
+/* Feed the records that are due, called once per scheduler loop*/
+void iccp_replay_feed(struct System* sys)
+{
+    uint64_t due, now;
+    int batch;
+
+    if (iccp_replay.fp == NULL || iccp_replay.eof)
+        return;
+
+    /* The FSMs settle on what was fed before, as they did between the
+       socket reads of the captured run*/
+    if (sys->fsm_kick)
+        return;
+
+    for (batch = 0; batch < ICCP_REPLAY_BATCH; batch++)
+    {
+        if (!iccp_replay.rec_loaded && iccp_replay_load_rec() < 0)
+        {
+            iccp_replay.eof = 1;
+            scheduler_fsm_kick();
+            return;
+        }
+
+        if (iccp_replay.speed > 0)
+        {
+            due = iccp_replay.start_usec + iccp_replay.rec.usec / iccp_replay.speed;
+            now = iccp_latency_now_usec();
+            if (due > now)
+            {
+                iccp_timer_start(&iccp_replay.wait_timer, (due - now + 999) / 1000);
+                return;
+            }
+        }
+
+        iccp_replay.rec_loaded = 0;
+        iccp_replay.records[iccp_replay.rec.type]++;
+        iccp_replay.bytes += iccp_replay.rec.len;
+        iccp_replay.last_rec_usec = iccp_replay.rec.usec;
+
+        if (iccp_replay_handle_rec(sys, &iccp_replay.rec, iccp_replay.buf) < 0)
+            iccp_replay.skipped++;
+
+        /* A new session is set up before the peer msgs are fed*/
+        if (iccp_replay.rec.type == ICCP_CAPTURE_SESSION_UP || iccp_replay.rec.type == ICCP_CAPTURE_SESSION_DOWN)
+            break;
+    }
+
+    /* More records may be due, don't block for events*/
+    scheduler_fsm_kick();
+
+    return;
+}
+
+static void iccp_replay_report(struct System* sys)
+{
+    struct CSM* csm = NULL;
+    struct timespec cpu_end;
+    uint64_t elapsed_usec, cpu_usec;
+    uint64_t peer_tx = 0;
+    uint64_t total = 0;
+    int i;
+
+    elapsed_usec = iccp_latency_now_usec() - iccp_replay.start_usec;
+    clock_gettime(CLOCK_PROCESS_CPUTIME_ID, &cpu_end);
+    cpu_usec = (uint64_t)(cpu_end.tv_sec - iccp_replay.cpu_start.tv_sec) * 1000000
+               + (cpu_end.tv_nsec - iccp_replay.cpu_start.tv_nsec) / 1000;
+
+    LIST_FOREACH(csm, &(sys->csm_list), next)
+    {
+        peer_tx += csm->io_stats.tx_msgs;
+    }
+
+    for (i = 1; i < ICCP_CAPTURE_TYPE_MAX; i++)
+    {
+        total += iccp_replay.records[i];
+        fprintf(stdout, "%-14s %llu\n", iccp_capture_type_str[i], (unsigned long long)iccp_replay.records[i]);
+    }
+
+    fprintf(stdout, "records        %llu (%llu bytes, %llu skipped)\n",
+            (unsigned long long)total, (unsigned long long)iccp_replay.bytes,
+            (unsigned long long)iccp_replay.skipped);
+    fprintf(stdout, "captured time  %.3f s\n", iccp_replay.last_rec_usec / 1000000.0);
+    fprintf(stdout, "replay time    %.3f s, cpu %.3f s\n", elapsed_usec / 1000000.0, cpu_usec / 1000000.0);
+    fprintf(stdout, "rx msgs/s      %.0f\n",
+            elapsed_usec ? (iccp_replay.records[ICCP_CAPTURE_PEER_RX] + iccp_replay.records[ICCP_CAPTURE_SYNCD_RX]
+                            + iccp_replay.records[ICCP_CAPTURE_INGEST])
+            * 1000000.0 / elapsed_usec : 0.0);
+    fprintf(stdout, "peer tx        %llu captured, %llu replayed\n",
+            (unsigned long long)iccp_replay.records[ICCP_CAPTURE_PEER_TX], (unsigned long long)peer_tx);
+    fprintf(stdout, "syncd tx       %llu captured, %llu replayed\n",
+            (unsigned long long)iccp_replay.records[ICCP_CAPTURE_SYNCD_TX],
+            (unsigned long long)sys->syncd_tx_stats.tx_frames);
+    fflush(stdout);
+
+    ICCPD_LOG_NOTICE(__FUNCTION__, "Replay done, %llu records in %llu us, cpu %llu us",
+                     (unsigned long long)total, (unsigned long long)elapsed_usec, (unsigned long long)cpu_usec);
+
+    return;
+}
+
+/* The replay is done when the file is consumed and the FSMs are idle*/
+int iccp_replay_done(struct System* sys)
+{
+    if (sys == NULL || sys->replay_file_path == NULL || !iccp_replay.eof || sys->fsm_kick)
+        return 0;
+
+    if (iccp_replay.done)
+        return 1;
+
+    iccp_replay.done = 1;
+    iccp_timer_stop(&iccp_replay.wait_timer);
+    if (iccp_replay.fp)
+    {
+        iccp_replay_report(sys);
+        fclose(iccp_replay.fp);
+        iccp_replay.fp = NULL;
+    }
+
+    if (iccp_replay.buf)
+        free(iccp_replay.buf);
+    iccp_replay.buf = NULL;
+
+    return 1;
+}
+
+/* Nothing is sent to the kernel, mclagsyncd or the peer*/
+int iccp_replaying()
+{
+    struct System* sys = system_get_instance();
+
+    return sys != NULL && sys->replay_file_path != NULL;
+}
@@ -0,0 +1,583 @@
+/*
+ *  iccp_checkpoint.c
+ *  Warm restart checkpoint of the MAC/ARP/ND tables.
+ *
+ * Copyright(c) 2016-2019 Nephos/Estinet.
+ *
+ * This program is free software; you can redistribute it and/or modify it
+ * under the terms and conditions of the GNU General Public License,
+ * version 2, as published by the Free Software Foundation.
+ *
+ * This program is distributed in the hope it will be useful, but WITHOUT
+ * ANY WARRANTY; without even the implied warranty of MERCHANTABILITY or
+ * FITNESS FOR A PARTICULAR PURPOSE.  See the GNU General Public License for
+ * more details.
+ *
+ * You should have received a copy of the GNU General Public License along with
+ * this program; if not, see <http://www.gnu.org/licenses/>.
+ *
+ * The full GNU General Public License is included in this distribution in
+ * the file called "COPYING".
+ *
+ *  Maintainer: jianjun, grace Li from nephos
+ */
+
+
+#include <errno.h>
+#include <fcntl.h>
+#include <limits.h>
+#include <signal.h>
+#include <stdio.h>
+#include <stdlib.h>
+#include <string.h>
+#include <time.h>
+#include <unistd.h>
+#include <sys/mman.h>
+#include <sys/stat.h>
+#include <sys/queue.h>
+#include <sys/socket.h>
+#include <sys/types.h>
+#include <sys/wait.h>
+
+#include "../include/system.h"
+#include "../include/logger.h"
+#include "../include/port.h"
+#include "../include/iccp_csm.h"
+#include "../include/iccp_pool.h"
+#include "../include/iccp_timer.h"
+#include "../include/mlacp_tlv.h"
+#include "../include/mlacp_table.h"
+#include "../include/mlacp_link_handler.h"
+#include "../include/iccp_netlink.h"
+#include "../include/iccp_checkpoint.h"
+#include "../include/iccp_capture.h"
+
+/* The tables are written to a file mapped by mmap at intervals by a forked
+ * child, and on warm reboot exit. On start they are loaded back with every entry marked stale,
+ * an update from a live source (kernel, mclagsyncd, peer) clears the mark.
+ * Entries the peer sent are confirmed by the peer only. Stale entries are
+ * not sent to the peer. Entries still stale after the reconcile are dropped,
+ * and deleted from the chip or the kernel when iccpd programmed them there.
+ * The peer sync journal is not saved, a new epoch starts on restart and the
+ * peer gets a full sync after it.*/
+
+static struct iccp_timer iccp_checkpoint_save_timer;
+static struct iccp_timer iccp_checkpoint_sweep_timer;
+/* Child writing the periodic snapshot, 0 if none*/
+static pid_t iccp_checkpoint_pid = 0;
+
+static uint32_t iccp_checkpoint_crc32(const uint8_t* buf, size_t len)
+{
+    static uint32_t table[256];
+    static int table_init = 0;
+    uint32_t crc, c;
+    int i, j;
+
+    if (!table_init)
+    {
+        for (i = 0; i < 256; i++)
+        {
+            c = i;
+            for (j = 0; j < 8; j++)
+                c = (c & 1) ? (0xEDB88320 ^ (c >> 1)) : (c >> 1);
+            table[i] = c;
+        }
+        table_init = 1;
+    }
+
+    crc = 0xFFFFFFFF;
+    while (len--)
+        crc = table[(crc ^ *buf++) & 0xFF] ^ (crc >> 8);
+
+    return crc ^ 0xFFFFFFFF;
+}
+
+static int iccp_checkpoint_mkdir(const char* path)
+{
+    char dir[PATH_MAX];
+    char* p = NULL;
+
+    snprintf(dir, sizeof(dir), "%s", path);
+    p = strrchr(dir, '/');
+    if (!p || p == dir)
+        return 0;
+    *p = '\0';
+
+    for (p = dir + 1; *p; p++)
+    {
+        if (*p != '/')
+            continue;
+
+        *p = '\0';
+        if (mkdir(dir, 0755) < 0 && errno != EEXIST)
+            return MCLAG_ERROR;
+        *p = '/';
+    }
+
+    if (mkdir(dir, 0755) < 0 && errno != EEXIST)
+        return MCLAG_ERROR;
+
+    return 0;
+}
+
+/* Write the tables out, 0 or errno. It runs in the save child too, which
+ * must not take the logger lock, the caller logs*/
+static int iccp_checkpoint_write(struct System* sys, int sync)
+{
+    struct IccpCheckpointHdr* hdr = NULL;
+    struct IccpCheckpointSection* sec = NULL;
+    struct CSM* csm = NULL;
+    struct Msg* msg = NULL;
+    char tmp_path[PATH_MAX];
+    char* map = NULL;
+    size_t size, offset;
+    int csm_num = 0;
+    int fd, err;
+
+    size = sizeof(struct IccpCheckpointHdr);
+    LIST_FOREACH(csm, &(sys->csm_list), next)
+    {
+        size += sizeof(struct IccpCheckpointSection)
+                + MLACP(csm).mac_num * sizeof(struct MACMsg)
+                + MLACP(csm).arp_num * sizeof(struct ARPMsg)
+                + MLACP(csm).ndisc_num * sizeof(struct NDISCMsg);
+        csm_num++;
+    }
+
+    if (iccp_checkpoint_mkdir(sys->checkpoint_file_path) < 0)
+        return errno;
+
+    /* Written aside and renamed, the file is never seen half written*/
+    snprintf(tmp_path, sizeof(tmp_path), "%s.tmp", sys->checkpoint_file_path);
+    fd = open(tmp_path, O_RDWR | O_CREAT | O_TRUNC | O_CLOEXEC, 0644);
+    if (fd < 0)
+        return errno;
+
+    if (ftruncate(fd, size) < 0)
+        goto close_fd;
+
+    map = (char*)mmap(NULL, size, PROT_READ | PROT_WRITE, MAP_SHARED, fd, 0);
+    if (map == MAP_FAILED)
+        goto close_fd;
+
+    offset = sizeof(struct IccpCheckpointHdr);
+    LIST_FOREACH(csm, &(sys->csm_list), next)
+    {
+        sec = (struct IccpCheckpointSection*)(map + offset);
+        memset(sec, 0, sizeof(struct IccpCheckpointSection));
+        sec->mlag_id = csm->mlag_id;
+        offset += sizeof(struct IccpCheckpointSection);
+
+        TAILQ_FOREACH(msg, &(MLACP(csm).mac_list), tail)
+        {
+            if (sec->mac_num >= MLACP(csm).mac_num)
+                break;
+            memcpy(map + offset, msg->buf, sizeof(struct MACMsg));
+            offset += sizeof(struct MACMsg);
+            sec->mac_num++;
+        }
+
+        TAILQ_FOREACH(msg, &(MLACP(csm).arp_list), tail)
+        {
+            if (sec->arp_num >= MLACP(csm).arp_num)
+                break;
+            memcpy(map + offset, msg->buf, sizeof(struct ARPMsg));
+            offset += sizeof(struct ARPMsg);
+            sec->arp_num++;
+        }
+
+        TAILQ_FOREACH(msg, &(MLACP(csm).ndisc_list), tail)
+        {
+            if (sec->ndisc_num >= MLACP(csm).ndisc_num)
+                break;
+            memcpy(map + offset, msg->buf, sizeof(struct NDISCMsg));
+            offset += sizeof(struct NDISCMsg);
+            sec->ndisc_num++;
+        }
+    }
+
+    hdr = (struct IccpCheckpointHdr*)map;
+    memset(hdr, 0, sizeof(struct IccpCheckpointHdr));
+    hdr->magic = ICCP_CHECKPOINT_MAGIC;
+    hdr->version = ICCP_CHECKPOINT_VERSION;
+    hdr->hdr_size = sizeof(struct IccpCheckpointHdr);
+    hdr->mac_size = sizeof(struct MACMsg);
+    hdr->arp_size = sizeof(struct ARPMsg);
+    hdr->ndisc_size = sizeof(struct NDISCMsg);
+    hdr->csm_num = csm_num;
+    hdr->save_sec = time(NULL);
+    hdr->data_len = offset - sizeof(struct IccpCheckpointHdr);
+    hdr->crc = iccp_checkpoint_crc32((uint8_t*)map + sizeof(struct IccpCheckpointHdr), hdr->data_len);
+
+    msync(map, size, sync ? MS_SYNC : MS_ASYNC);
+    munmap(map, size);
+
+    /* A table may have less entries than its counter*/
+    if (offset < size && ftruncate(fd, offset) < 0)
+        goto close_fd;
+
+    close(fd);
+
+    if (rename(tmp_path, sys->checkpoint_file_path) < 0)
+    {
+        err = errno;
+        unlink(tmp_path);
+        return err;
+    }
+
+    return 0;
+
+ close_fd:
+    err = errno;
+    close(fd);
+    unlink(tmp_path);
+    return err;
+}
+
+/* Collect the save child, wait for it if block is set.
+ * MCLAG_ERROR if it is still running*/
+static int iccp_checkpoint_reap(struct System* sys, int block)
+{
+    int status = 0;
+    pid_t pid;
+
+    if (iccp_checkpoint_pid <= 0)
+        return 0;
+
+    do
+    {
+        pid = waitpid(iccp_checkpoint_pid, &status, block ? 0 : WNOHANG);
+    } while (pid < 0 && errno == EINTR);
+
+    if (pid == 0)
+        return MCLAG_ERROR;
+
+    iccp_checkpoint_pid = 0;
+
+    if (pid < 0)
+        ICCPD_LOG_WARN(__FUNCTION__, "Failed to wait for the checkpoint writer: %s", strerror(errno));
+    else if (WIFEXITED(status) && WEXITSTATUS(status) == 0)
+        ICCPD_LOG_DEBUG(__FUNCTION__, "Checkpoint saved to %s", sys->checkpoint_file_path);
+    else if (WIFEXITED(status))
+        ICCPD_LOG_WARN(__FUNCTION__, "Failed to write %s: %s",
+                       sys->checkpoint_file_path, strerror(WEXITSTATUS(status)));
+    else
+        ICCPD_LOG_WARN(__FUNCTION__, "Checkpoint writer for %s is killed", sys->checkpoint_file_path);
+
+    return 0;
+}
+
+/* sync is set on exit, the file must be on disk before the reboot and it
+ * is written here. Otherwise a forked child writes its copy-on-write view
+ * of the tables, the scheduler loop goes on and reaps it later*/
+int iccp_checkpoint_save(struct System* sys, int sync)
+{
+    int err;
+
+    if (!sys || !sys->checkpoint_file_path)
+        return MCLAG_ERROR;
+
+    /* The checkpoint belongs to the live daemon*/
+    if (sys->replay_file_path != NULL)
+        return 0;
+
+    if (sync)
+    {
+        /* An older snapshot must not be renamed over this one*/
+        if (iccp_checkpoint_pid > 0)
+            kill(iccp_checkpoint_pid, SIGKILL);
+        iccp_checkpoint_reap(sys, 1);
+
+        err = iccp_checkpoint_write(sys, 1);
+        if (err != 0)
+        {
+            ICCPD_LOG_WARN(__FUNCTION__, "Failed to write %s: %s", sys->checkpoint_file_path, strerror(err));
+            return MCLAG_ERROR;
+        }
+
+        ICCPD_LOG_DEBUG(__FUNCTION__, "Checkpoint saved to %s", sys->checkpoint_file_path);
+        return 0;
+    }
+
+    /* The last one is still being written, skip this round*/
+    if (iccp_checkpoint_reap(sys, 0) < 0)
+        return 0;
+
+    iccp_checkpoint_pid = fork();
+    if (iccp_checkpoint_pid < 0)
+    {
+        iccp_checkpoint_pid = 0;
+        ICCPD_LOG_WARN(__FUNCTION__, "Failed to fork the checkpoint writer: %s", strerror(errno));
+        return MCLAG_ERROR;
+    }
+
+    if (iccp_checkpoint_pid == 0)
+        _exit(iccp_checkpoint_write(sys, 0));
+
+    return 0;
+}
+
+static struct CSM* iccp_checkpoint_find_csm(struct System* sys, int mlag_id)
+{
+    struct CSM* csm = NULL;
+
+    LIST_FOREACH(csm, &(sys->csm_list), next)
+    {
+        if (csm->mlag_id == mlag_id)
+            return csm;
+    }
+
+    return NULL;
+}
+
+/* The entry is dropped if its interface is not there any more*/
+static int iccp_checkpoint_restore_entry(struct CSM* csm, int pool, const char* entry, int len)
+{
+    const struct MACMsg* mac_msg = NULL;
+    const struct ARPMsg* arp_msg = NULL;
+    const struct NDISCMsg* ndisc_msg = NULL;
+    struct Msg* msg = NULL;
+
+    if (pool == ICCP_POOL_MAC)
+    {
+        mac_msg = (const struct MACMsg*)entry;
+        if (!local_if_find_by_name(mac_msg->ifname) || !local_if_find_by_name(mac_msg->origin_ifname)
+            || mlacp_mac_table_find(csm, mac_msg->mac_str, mac_msg->vid))
+            return 0;
+    }
+    else if (pool == ICCP_POOL_ARP)
+    {
+        arp_msg = (const struct ARPMsg*)entry;
+        if (!local_if_find_by_name(arp_msg->ifname) || mlacp_arp_table_find(csm, arp_msg->ipv4_addr))
+            return 0;
+    }
+    else
+    {
+        ndisc_msg = (const struct NDISCMsg*)entry;
+        if (!local_if_find_by_name(ndisc_msg->ifname) || mlacp_ndisc_table_find(csm, ndisc_msg->ipv6_addr))
+            return 0;
+    }
+
+    if (iccp_csm_init_pool_msg(&msg, pool, (char*)entry, len) != 0)
+        return 0;
+
+    msg->stale = 1;
+    if (pool == ICCP_POOL_MAC)
+        mlacp_mac_table_add(csm, msg);
+    else if (pool == ICCP_POOL_ARP)
+        mlacp_arp_table_add(csm, msg);
+    else
+        mlacp_ndisc_table_add(csm, msg);
+
+    return 1;
+}
+
+/* MACs are restored on warm reboot only, the FDB is flushed otherwise.
+ * ARP/ND are reconciled by the kernel dump that follows*/
+/* Restore from a checkpoint image, the mapped file or a captured copy*/
+int iccp_checkpoint_restore_buf(struct System* sys, const char* map, size_t size)
+{
+    const struct IccpCheckpointHdr* hdr = NULL;
+    const struct IccpCheckpointSection* sec = NULL;
+    struct CSM* csm = NULL;
+    uint64_t save_sec;
+    size_t offset, sec_len;
+    int restore_mac;
+    int mac_num = 0, arp_num = 0, ndisc_num = 0;
+    uint32_t i;
+    int n;
+
+    if (size < sizeof(struct IccpCheckpointHdr))
+        return MCLAG_ERROR;
+
+    hdr = (const struct IccpCheckpointHdr*)map;
+    if (hdr->magic != ICCP_CHECKPOINT_MAGIC || hdr->version != ICCP_CHECKPOINT_VERSION
+        || hdr->hdr_size != sizeof(struct IccpCheckpointHdr)
+        || hdr->mac_size != sizeof(struct MACMsg) || hdr->arp_size != sizeof(struct ARPMsg)
+        || hdr->ndisc_size != sizeof(struct NDISCMsg)
+        || hdr->data_len != size - sizeof(struct IccpCheckpointHdr)
+        || hdr->crc != iccp_checkpoint_crc32((uint8_t*)map + sizeof(struct IccpCheckpointHdr), hdr->data_len))
+        return MCLAG_ERROR;
+
+    restore_mac = (sys->warmboot_start == WARM_REBOOT);
+    save_sec = hdr->save_sec;
+
+    offset = sizeof(struct IccpCheckpointHdr);
+    for (n = 0; n < hdr->csm_num; n++)
+    {
+        if (offset + sizeof(struct IccpCheckpointSection) > size)
+            return MCLAG_ERROR;
+
+        sec = (const struct IccpCheckpointSection*)(map + offset);
+        offset += sizeof(struct IccpCheckpointSection);
+
+        sec_len = (size_t)sec->mac_num * sizeof(struct MACMsg) + (size_t)sec->arp_num * sizeof(struct ARPMsg)
+                  + (size_t)sec->ndisc_num * sizeof(struct NDISCMsg);
+        if (offset + sec_len > size)
+            return MCLAG_ERROR;
+
+        /* The MLAG is not configured any more*/
+        csm = iccp_checkpoint_find_csm(sys, sec->mlag_id);
+        if (!csm)
+        {
+            offset += sec_len;
+            continue;
+        }
+
+        for (i = 0; i < sec->mac_num; i++, offset += sizeof(struct MACMsg))
+        {
+            if (restore_mac)
+                mac_num += iccp_checkpoint_restore_entry(csm, ICCP_POOL_MAC, map + offset, sizeof(struct MACMsg));
+        }
+
+        for (i = 0; i < sec->arp_num; i++, offset += sizeof(struct ARPMsg))
+            arp_num += iccp_checkpoint_restore_entry(csm, ICCP_POOL_ARP, map + offset, sizeof(struct ARPMsg));
+
+        for (i = 0; i < sec->ndisc_num; i++, offset += sizeof(struct NDISCMsg))
+            ndisc_num += iccp_checkpoint_restore_entry(csm, ICCP_POOL_NDISC, map + offset, sizeof(struct NDISCMsg));
+    }
+
+    ICCPD_LOG_NOTICE(__FUNCTION__, "Restore %d MAC, %d ARP, %d ND from checkpoint saved %llu seconds ago",
+                     mac_num, arp_num, ndisc_num, (unsigned long long)(time(NULL) - save_sec));
+
+    return mac_num + arp_num + ndisc_num;
+}
+
+int iccp_checkpoint_restore(struct System* sys)
+{
+    struct stat st;
+    char* map = NULL;
+    int fd;
+    int ret = MCLAG_ERROR;
+
+    if (!sys || !sys->checkpoint_file_path)
+        return MCLAG_ERROR;
+
+    fd = open(sys->checkpoint_file_path, O_RDONLY | O_CLOEXEC);
+    if (fd < 0)
+    {
+        ICCPD_LOG_INFO(__FUNCTION__, "No checkpoint %s to restore", sys->checkpoint_file_path);
+        return 0;
+    }
+
+    if (fstat(fd, &st) == 0 && st.st_size > 0)
+    {
+        map = (char*)mmap(NULL, st.st_size, PROT_READ, MAP_PRIVATE, fd, 0);
+        if (map == MAP_FAILED)
+            map = NULL;
+    }
+
+    if (map)
+    {
+        iccp_capture_write(ICCP_CAPTURE_CHECKPOINT, -1, map, st.st_size);
+        ret = iccp_checkpoint_restore_buf(sys, map, st.st_size);
+        munmap(map, st.st_size);
+    }
+    close(fd);
+
+    if (ret < 0)
+        ICCPD_LOG_WARN(__FUNCTION__, "Checkpoint %s is invalid, skip it", sys->checkpoint_file_path);
+
+    return ret;
+}
+
+/* Drop the restored entries no live source has confirmed. MACs learned
+ * from the peer or redirected to the peer-link and neighbors the peer sent
+ * were programmed by iccpd, nobody else removes them*/
+void iccp_checkpoint_sweep(struct System* sys, int tables)
+{
+    struct CSM* csm = NULL;
+    struct Msg* msg = NULL;
+    struct Msg* msg_next = NULL;
+    struct MACMsg* mac_msg = NULL;
+    struct ARPMsg* arp_msg = NULL;
+    struct NDISCMsg* ndisc_msg = NULL;
+    int mac_num = 0, arp_num = 0, ndisc_num = 0;
+
+    if (!sys)
+        return;
+
+    iccp_capture_write(ICCP_CAPTURE_SWEEP, -1, &tables, sizeof(tables));
+
+    LIST_FOREACH(csm, &(sys->csm_list), next)
+    {
+        if (tables & ICCP_CHECKPOINT_MAC)
+        {
+            for (msg = TAILQ_FIRST(&(MLACP(csm).mac_list)); msg; msg = msg_next)
+            {
+                msg_next = TAILQ_NEXT(msg, tail);
+                if (!msg->stale)
+                    continue;
+                mac_msg = (struct MACMsg*)msg->buf;
+                if ((mac_msg->age_flag & MAC_AGE_LOCAL) || strcmp(mac_msg->ifname, csm->peer_itf_name) == 0)
+                    del_mac_from_chip(mac_msg);
+                mlacp_mac_table_del(csm, msg);
+                mac_num++;
+            }
+        }
+
+        if (tables & ICCP_CHECKPOINT_ARP)
+        {
+            for (msg = TAILQ_FIRST(&(MLACP(csm).arp_list)); msg; msg = msg_next)
+            {
+                msg_next = TAILQ_NEXT(msg, tail);
+                if (!msg->stale)
+                    continue;
+                arp_msg = (struct ARPMsg*)msg->buf;
+                if (arp_msg->op_type == NEIGH_SYNC_ADD)
+                    iccp_netlink_neighbor_request(AF_INET, (uint8_t*)&arp_msg->ipv4_addr, 0,
+                                                  arp_msg->mac_addr, arp_msg->ifname);
+                mlacp_arp_table_del(csm, msg);
+                arp_num++;
+            }
+        }
+
+        if (tables & ICCP_CHECKPOINT_NDISC)
+        {
+            for (msg = TAILQ_FIRST(&(MLACP(csm).ndisc_list)); msg; msg = msg_next)
+            {
+                msg_next = TAILQ_NEXT(msg, tail);
+                if (!msg->stale)
+                    continue;
+                ndisc_msg = (struct NDISCMsg*)msg->buf;
+                if (ndisc_msg->op_type == NEIGH_SYNC_ADD)
+                    iccp_netlink_neighbor_request(AF_INET6, (uint8_t*)ndisc_msg->ipv6_addr, 0,
+                                                  ndisc_msg->mac_addr, ndisc_msg->ifname);
+                mlacp_ndisc_table_del(csm, msg);
+                ndisc_num++;
+            }
+        }
+    }
+
+    if (mac_num || arp_num || ndisc_num)
+        ICCPD_LOG_NOTICE(__FUNCTION__, "Sweep %d MAC, %d ARP, %d ND restored but not confirmed",
+                         mac_num, arp_num, ndisc_num);
+
+    return;
+}
+
+static void iccp_checkpoint_save_timer_handler(void* arg)
+{
+    iccp_checkpoint_save((struct System*)arg, 0);
+    iccp_timer_start(&iccp_checkpoint_save_timer, ICCP_CHECKPOINT_INTERVAL_SEC * 1000);
+
+    return;
+}
+
+static void iccp_checkpoint_sweep_timer_handler(void* arg)
+{
+    iccp_checkpoint_sweep((struct System*)arg,
+                          ICCP_CHECKPOINT_MAC | ICCP_CHECKPOINT_ARP | ICCP_CHECKPOINT_NDISC);
+
+    return;
+}
+
+void iccp_checkpoint_start(struct System* sys)
+{
+    iccp_timer_init(&iccp_checkpoint_save_timer, iccp_checkpoint_save_timer_handler, sys);
+    iccp_timer_init(&iccp_checkpoint_sweep_timer, iccp_checkpoint_sweep_timer_handler, sys);
+    iccp_timer_start(&iccp_checkpoint_save_timer, ICCP_CHECKPOINT_INTERVAL_SEC * 1000);
+    iccp_timer_start(&iccp_checkpoint_sweep_timer, ICCP_CHECKPOINT_SWEEP_SEC * 1000);
+
+    return;
+}
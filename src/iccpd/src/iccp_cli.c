@@ -29,6 +29,8 @@
 #include "../include/iccp_csm.h"
 #include "../include/mlacp_link_handler.h"
 #include "../include/iccp_netlink.h"
+#include "../include/mlacp_tlv.h"
+#include "../include/mlacp_fast_hello.h"
 /*
  * 'id <1-65535>' command
  */
@@ -282,6 +284,42 @@ int unset_peer_address(int mid)
     return 0;
 }
 
+int set_fast_hello_interval(int mid, uint32_t msec)
+{
+    struct CSM* csm = NULL;
+
+    csm = system_get_csm_by_mlacp_id(mid);
+    if (csm == NULL)
+        return MCLAG_ERROR;
+
+    if (mlacp_fast_hello_config(csm, msec, csm->fast_hello.multiplier) < 0)
+    {
+        ICCPD_LOG_ERR(__FUNCTION__, "Fast hello interval %u ms out of range [%d, %d]",
+                      msec, MLACP_FAST_HELLO_MIN_MSEC, MLACP_FAST_HELLO_MAX_MSEC);
+        return MCLAG_ERROR;
+    }
+
+    return 0;
+}
+
+int set_fast_hello_multiplier(int mid, uint8_t multiplier)
+{
+    struct CSM* csm = NULL;
+
+    csm = system_get_csm_by_mlacp_id(mid);
+    if (csm == NULL)
+        return MCLAG_ERROR;
+
+    if (mlacp_fast_hello_config(csm, csm->fast_hello.tx_interval_msec, multiplier) < 0)
+    {
+        ICCPD_LOG_ERR(__FUNCTION__, "Fast hello multiplier %u out of range [%d, %d]",
+                      multiplier, MLACP_FAST_HELLO_MULT_MIN, MLACP_FAST_HELLO_MULT_MAX);
+        return MCLAG_ERROR;
+    }
+
+    return 0;
+}
+
 int iccp_cli_attach_mclag_domain_to_port_channel( int domain, const char* ifname)
 {
     struct CSM* csm = NULL;
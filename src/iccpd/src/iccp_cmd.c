@@ -24,6 +24,7 @@
 #include <net/if.h>
 #include <sys/queue.h>
 #include <ctype.h>
+#include <string.h>
 
 #include "../include/iccp_csm.h"
 #include "../include/msg_format.h"
@@ -32,6 +33,7 @@
 #include "../include/iccp_cmd_show.h"
 #include "../include/iccp_cli.h"
 #include "../include/logger.h"
+#include "../include/iccp_capture.h"
 
 int set_mc_lag_by_id(uint16_t mid)
 {
@@ -137,6 +139,16 @@ int iccp_config_from_command(char * line)
         cp += strlen(SYSTEM_MAC_STR) + 1;
         set_local_system_id(cp);
     }
+    else if (strncmp(cp, FAST_HELLO_INTERVAL_STR, strlen(FAST_HELLO_INTERVAL_STR)) == 0)/*fast hello interval*/
+    {
+        cp += strlen(FAST_HELLO_INTERVAL_STR) + 1;
+        set_fast_hello_interval(mid, atoi(cp));
+    }
+    else if (strncmp(cp, FAST_HELLO_MULTIPLIER_STR, strlen(FAST_HELLO_MULTIPLIER_STR)) == 0)/*fast hello multiplier*/
+    {
+        cp += strlen(FAST_HELLO_MULTIPLIER_STR) + 1;
+        set_fast_hello_multiplier(mid, atoi(cp));
+    }
     else
     {
         /*error*/
@@ -158,6 +170,7 @@ iccp_config_from_file(char *config_default_dir)
 
     while (fgets(command_buf, CONFIG_LINE_LEN, confp))
     {
+        iccp_capture_write(ICCP_CAPTURE_CONFIG, -1, command_buf, strlen(command_buf));
         iccp_config_from_command(command_buf);
     }
 
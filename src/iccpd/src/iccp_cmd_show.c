@@ -22,6 +22,7 @@
  */
 #include <arpa/inet.h>
 #include <ctype.h>
+#include <strings.h>
 #include <net/if.h>
 #include <sys/queue.h>
 
@@ -32,6 +33,9 @@
 #include "mclagdctl/mclagdctl.h"
 #include "../include/iccp_cmd_show.h"
 #include "../include/mlacp_link_handler.h"
+#include "../include/iccp_pool.h"
+#include "../include/iccp_ingest.h"
+#include "../include/iccp_latency.h"
 
 int iccp_mclag_config_dump(char * *buf,  int *num, int mclag_id)
 {
@@ -140,203 +144,286 @@ int iccp_mclag_config_dump(char * *buf,  int *num, int mclag_id)
     return EXEC_TYPE_SUCCESS;
 }
 
-int iccp_arp_dump(char * *buf, int *num, int mclag_id)
+static int iccp_dump_match_ifname(const struct mclagdctl_dump_filter *filter, const char *ifname)
 {
-    struct System *sys = NULL;
-    struct CSM *csm = NULL;
-    struct Msg *msg = NULL;
-    struct ARPMsg *iccpd_arp = NULL;
-    struct mclagd_arp_msg mclagd_arp;
-    int arp_num = 0;
-    int id_exist = 0;
-    char * arp_buf = NULL;
-    int arp_buf_size = MCLAGDCTL_CMD_SIZE;
+    return strncmp(filter->ifname, ifname, MCLAGDCTL_MAX_L_PORT_NANE) == 0;
+}
 
-    if (!(sys = system_get_instance()))
-    {
-        return EXEC_TYPE_NO_EXIST_SYS;
-    }
+static int iccp_dump_match_mac(const struct mclagdctl_dump_filter *filter, const char *mac_str)
+{
+    return strncasecmp(mac_str, filter->mac_prefix, strlen(filter->mac_prefix)) == 0;
+}
 
-    arp_buf = (char*)malloc(arp_buf_size);
-    if (!arp_buf)
-        return EXEC_TYPE_FAILED;
+/* ARP/ND entries are on the VLAN interface*/
+static int iccp_dump_match_vlan_if(const struct mclagdctl_dump_filter *filter, const char *ifname)
+{
+    char vlan_name[MCLAGDCTL_MAX_L_PORT_NANE];
 
-    LIST_FOREACH(csm, &(sys->csm_list), next)
+    snprintf(vlan_name, sizeof(vlan_name), "%s%u", VLAN_PREFIX, filter->vid);
+
+    return strcmp(vlan_name, ifname) == 0;
+}
+
+static int iccp_dump_match(int info_type, const struct mclagdctl_dump_filter *filter, const char *buf)
+{
+    const struct MACMsg *mac_msg = NULL;
+    const struct ARPMsg *arp_msg = NULL;
+    const struct NDISCMsg *ndisc_msg = NULL;
+    const char *ifname = NULL;
+    const uint8_t *mac_addr = NULL;
+    char mac_str[ETHER_ADDR_STR_LEN];
+
+    if (info_type == INFO_TYPE_DUMP_MAC)
     {
-        if (mclag_id > 0)
+        mac_msg = (const struct MACMsg *)buf;
+
+        if ((filter->flags & MCLAGDCTL_FILTER_VLAN) && mac_msg->vid != filter->vid)
+            return 0;
+
+        if ((filter->flags & MCLAGDCTL_FILTER_IFNAME) && !iccp_dump_match_ifname(filter, mac_msg->ifname)
+            && !iccp_dump_match_ifname(filter, mac_msg->origin_ifname))
+            return 0;
+
+        if ((filter->flags & MCLAGDCTL_FILTER_MAC) && !iccp_dump_match_mac(filter, mac_msg->mac_str))
+            return 0;
+
+        if (filter->flags & MCLAGDCTL_FILTER_AGE)
         {
-            if (csm->mlag_id == mclag_id)
-                id_exist = 1;
-            else
-                continue;
+            if (filter->age_flag == 0 && mac_msg->age_flag != 0)
+                return 0;
+
+            if ((mac_msg->age_flag & filter->age_flag) != filter->age_flag)
+                return 0;
         }
 
-        TAILQ_FOREACH(msg, &MLACP(csm).arp_list, tail)
-        {
-            memset(&mclagd_arp, 0, sizeof(struct mclagd_arp_msg));
-            iccpd_arp = (struct ARPMsg*)msg->buf;
+        return 1;
+    }
 
-            mclagd_arp.op_type = iccpd_arp->op_type;
-            memcpy(mclagd_arp.ifname, iccpd_arp->ifname, strlen(iccpd_arp->ifname));
-            memcpy(mclagd_arp.ipv4_addr, show_ip_str(iccpd_arp->ipv4_addr), 16);
-            memcpy(mclagd_arp.mac_addr, iccpd_arp->mac_addr, 6);
+    if (info_type == INFO_TYPE_DUMP_ARP)
+    {
+        arp_msg = (const struct ARPMsg *)buf;
+        ifname = arp_msg->ifname;
+        mac_addr = arp_msg->mac_addr;
+    }
+    else
+    {
+        ndisc_msg = (const struct NDISCMsg *)buf;
+        ifname = ndisc_msg->ifname;
+        mac_addr = ndisc_msg->mac_addr;
+    }
 
-            memcpy(arp_buf + MCLAGD_REPLY_INFO_HDR + arp_num * sizeof(struct mclagd_arp_msg),
-                   &mclagd_arp, sizeof(struct mclagd_arp_msg));
+    if ((filter->flags & MCLAGDCTL_FILTER_VLAN) && !iccp_dump_match_vlan_if(filter, ifname))
+        return 0;
 
-            arp_num++;
+    if ((filter->flags & MCLAGDCTL_FILTER_IFNAME) && !iccp_dump_match_ifname(filter, ifname))
+        return 0;
 
-            if ((arp_num + 1) * sizeof(struct mclagd_arp_msg) > (arp_buf_size - MCLAGD_REPLY_INFO_HDR))
-            {
-                arp_buf_size += MCLAGDCTL_CMD_SIZE;
-                arp_buf = (char*)realloc(arp_buf, arp_buf_size);
-                if (!arp_buf)
-                    return EXEC_TYPE_FAILED;
-            }
-        }
+    if (filter->flags & MCLAGDCTL_FILTER_MAC)
+    {
+        snprintf(mac_str, sizeof(mac_str), "%02x:%02x:%02x:%02x:%02x:%02x",
+                 mac_addr[0], mac_addr[1], mac_addr[2], mac_addr[3], mac_addr[4], mac_addr[5]);
+        if (!iccp_dump_match_mac(filter, mac_str))
+            return 0;
     }
 
-    *buf = arp_buf;
-    *num = arp_num;
+    /* Neighbors have no age flag*/
+    return 1;
+}
 
-    if (mclag_id > 0 && !id_exist)
-        return EXEC_TYPE_NO_EXIST_MCLAGID;
+static int iccp_dump_entry_size(int info_type)
+{
+    if (info_type == INFO_TYPE_DUMP_MAC)
+        return sizeof(struct mclagd_mac_msg);
+    else if (info_type == INFO_TYPE_DUMP_ARP)
+        return sizeof(struct mclagd_arp_msg);
 
-    return EXEC_TYPE_SUCCESS;
+    return sizeof(struct mclagd_ndisc_msg);
 }
 
-int iccp_ndisc_dump(char * *buf, int *num, int mclag_id)
+static void iccp_dump_fill_entry(int info_type, const char *buf, char *entry)
 {
-    struct System *sys = NULL;
-    struct CSM *csm = NULL;
-    struct Msg *msg = NULL;
+    struct MACMsg *iccpd_mac = NULL;
+    struct ARPMsg *iccpd_arp = NULL;
     struct NDISCMsg *iccpd_ndisc = NULL;
-    struct mclagd_ndisc_msg mclagd_ndisc;
-    int ndisc_num = 0;
-    int id_exist = 0;
-    char *ndisc_buf = NULL;
-    int ndisc_buf_size = MCLAGDCTL_CMD_SIZE;
+    struct mclagd_mac_msg *mclagd_mac = NULL;
+    struct mclagd_arp_msg *mclagd_arp = NULL;
+    struct mclagd_ndisc_msg *mclagd_ndisc = NULL;
 
-    if (!(sys = system_get_instance()))
+    memset(entry, 0, iccp_dump_entry_size(info_type));
+
+    if (info_type == INFO_TYPE_DUMP_MAC)
     {
-        ICCPD_LOG_INFO(__FUNCTION__, "cannot find sys!\n");
-        return EXEC_TYPE_NO_EXIST_SYS;
+        iccpd_mac = (struct MACMsg*)buf;
+        mclagd_mac = (struct mclagd_mac_msg *)entry;
+
+        mclagd_mac->op_type = iccpd_mac->op_type;
+        mclagd_mac->fdb_type = iccpd_mac->fdb_type;
+        memcpy(mclagd_mac->mac_str, iccpd_mac->mac_str, ETHER_ADDR_STR_LEN);
+        mclagd_mac->vid = iccpd_mac->vid;
+        memcpy(mclagd_mac->ifname, iccpd_mac->ifname, strlen(iccpd_mac->ifname));
+        memcpy(mclagd_mac->origin_ifname, iccpd_mac->origin_ifname, strlen(iccpd_mac->origin_ifname));
+        mclagd_mac->age_flag = iccpd_mac->age_flag;
+    }
+    else if (info_type == INFO_TYPE_DUMP_ARP)
+    {
+        iccpd_arp = (struct ARPMsg*)buf;
+        mclagd_arp = (struct mclagd_arp_msg *)entry;
+
+        mclagd_arp->op_type = iccpd_arp->op_type;
+        memcpy(mclagd_arp->ifname, iccpd_arp->ifname, strlen(iccpd_arp->ifname));
+        memcpy(mclagd_arp->ipv4_addr, show_ip_str(iccpd_arp->ipv4_addr), 16);
+        memcpy(mclagd_arp->mac_addr, iccpd_arp->mac_addr, 6);
     }
+    else
+    {
+        iccpd_ndisc = (struct NDISCMsg *)buf;
+        mclagd_ndisc = (struct mclagd_ndisc_msg *)entry;
 
-    ndisc_buf = (char *)malloc(ndisc_buf_size);
-    if (!ndisc_buf)
-        return EXEC_TYPE_FAILED;
+        mclagd_ndisc->op_type = iccpd_ndisc->op_type;
+        memcpy(mclagd_ndisc->ifname, iccpd_ndisc->ifname, strlen(iccpd_ndisc->ifname));
+        memcpy(mclagd_ndisc->ipv6_addr, show_ipv6_str((char *)iccpd_ndisc->ipv6_addr), 46);
+        memcpy(mclagd_ndisc->mac_addr, iccpd_ndisc->mac_addr, 6);
+    }
 
-    LIST_FOREACH(csm, &(sys->csm_list), next)
+    return;
+}
+
+static struct mlacp_hash_bucket *iccp_dump_bucket(struct CSM *csm, int info_type, uint32_t bucket)
+{
+    if (info_type == INFO_TYPE_DUMP_MAC)
+        return &MLACP(csm).mac_hash[bucket];
+    else if (info_type == INFO_TYPE_DUMP_ARP)
+        return &MLACP(csm).arp_hash[bucket];
+
+    return &MLACP(csm).ndisc_hash[bucket];
+}
+
+/* Walk one hash bucket into the cursor frame, 0 if it does not fit*/
+static int iccp_dump_bucket_fill(struct IccpDumpCursor *cursor, int info_type,
+                                 const struct mclagdctl_dump_filter *filter,
+                                 struct mlacp_hash_bucket *bucket)
+{
+    struct Msg *msg = NULL;
+    int entry_size = iccp_dump_entry_size(info_type);
+    int count_only = filter->flags & MCLAGDCTL_FILTER_COUNT_ONLY;
+    int matched = 0;
+    int size = 0;
+    char *buf = NULL;
+
+    LIST_FOREACH(msg, bucket, hash_next)
     {
-        if (mclag_id > 0)
-        {
-            if (csm->mlag_id == mclag_id)
-                id_exist = 1;
-            else
-                continue;
-        }
+        if (iccp_dump_match(info_type, filter, msg->buf))
+            matched++;
+    }
 
-        TAILQ_FOREACH(msg, &MLACP(csm).ndisc_list, tail)
-        {
-            memset(&mclagd_ndisc, 0, sizeof(struct mclagd_ndisc_msg));
-            iccpd_ndisc = (struct NDISCMsg *)msg->buf;
+    if (count_only || matched == 0)
+    {
+        cursor->matched += matched;
+        return 1;
+    }
 
-            mclagd_ndisc.op_type = iccpd_ndisc->op_type;
-            memcpy(mclagd_ndisc.ifname, iccpd_ndisc->ifname, strlen(iccpd_ndisc->ifname));
-            memcpy(mclagd_ndisc.ipv6_addr, show_ipv6_str((char *)iccpd_ndisc->ipv6_addr), 46);
-            memcpy(mclagd_ndisc.mac_addr, iccpd_ndisc->mac_addr, 6);
+    size = MCLAGD_REPLY_INFO_HDR + (cursor->num + matched) * entry_size;
+    if (size > cursor->buf_size)
+    {
+        /* Finish the chunk first, a big bucket gets a frame of its own*/
+        if (cursor->num > 0)
+            return 0;
 
-            memcpy(ndisc_buf + MCLAGD_REPLY_INFO_HDR + ndisc_num * sizeof(struct mclagd_ndisc_msg),
-                   &mclagd_ndisc, sizeof(struct mclagd_ndisc_msg));
+        buf = (char *)realloc(cursor->buf, size);
+        if (!buf)
+            return MCLAG_ERROR;
 
-            ndisc_num++;
+        cursor->buf = buf;
+        cursor->buf_size = size;
+    }
 
-            if ((ndisc_num + 1) * sizeof(struct mclagd_ndisc_msg) > (ndisc_buf_size - MCLAGD_REPLY_INFO_HDR))
-            {
-                ndisc_buf_size += MCLAGDCTL_CMD_SIZE;
-                ndisc_buf = (char *)realloc(ndisc_buf, ndisc_buf_size);
-                if (!ndisc_buf)
-                    return EXEC_TYPE_FAILED;
-            }
-        }
+    LIST_FOREACH(msg, bucket, hash_next)
+    {
+        if (!iccp_dump_match(info_type, filter, msg->buf))
+            continue;
+
+        iccp_dump_fill_entry(info_type, msg->buf,
+                             cursor->buf + MCLAGD_REPLY_INFO_HDR + cursor->num * entry_size);
+        cursor->num++;
     }
+    cursor->matched += matched;
 
-    *buf = ndisc_buf;
-    *num = ndisc_num;
+    return 1;
+}
 
-    if (mclag_id > 0 && !id_exist)
-        return EXEC_TYPE_NO_EXIST_MCLAGID;
+int iccp_dump_cursor_init(struct IccpDumpCursor *cursor, int info_type)
+{
+    memset(cursor, 0, sizeof(struct IccpDumpCursor));
 
-    return EXEC_TYPE_SUCCESS;
+    cursor->buf_size = MCLAGD_REPLY_INFO_HDR + ICCP_DUMP_CHUNK_ENTRIES * iccp_dump_entry_size(info_type);
+    cursor->buf = (char *)malloc(cursor->buf_size);
+    if (!cursor->buf)
+        return MCLAG_ERROR;
+
+    return 0;
+}
+
+void iccp_dump_cursor_finalize(struct IccpDumpCursor *cursor)
+{
+    if (cursor->buf)
+        free(cursor->buf);
+
+    cursor->buf = NULL;
+    cursor->buf_size = 0;
 }
 
-int iccp_mac_dump(char * *buf, int *num, int mclag_id)
+/* Fill the next chunk of a MAC/ARP/ND dump to cursor->buf. The tables are
+ * walked by hash bucket, so the cursor stays valid when entries come and
+ * go between chunks. Return 1 when the walk is done, 0 if more chunks follow*/
+int iccp_table_dump_chunk(int info_type, int mclag_id, const struct mclagdctl_dump_filter *filter,
+                          struct IccpDumpCursor *cursor)
 {
     struct System *sys = NULL;
     struct CSM *csm = NULL;
-    struct Msg *msg = NULL;
-    struct MACMsg *iccpd_mac = NULL;
-    struct mclagd_mac_msg mclagd_mac;
-    int mac_num = 0;
-    int id_exist = 0;
-    char * mac_buf = NULL;
-    int mac_buf_size = MCLAGDCTL_CMD_SIZE;
+    uint32_t hash_size;
+    int budget = ICCP_DUMP_CHUNK_BUCKETS;
+    int pos = 0;
+    int ret = 0;
 
     if (!(sys = system_get_instance()))
-    {
         return EXEC_TYPE_NO_EXIST_SYS;
-    }
 
-    mac_buf = (char*)malloc(mac_buf_size);
-    if (!mac_buf)
-        return EXEC_TYPE_FAILED;
+    hash_size = (info_type == INFO_TYPE_DUMP_MAC) ? MLACP_MAC_HASH_SIZE : MLACP_NEIGH_HASH_SIZE;
+    cursor->num = 0;
 
     LIST_FOREACH(csm, &(sys->csm_list), next)
     {
-        if (mclag_id > 0)
-        {
-            if (csm->mlag_id == mclag_id)
-                id_exist = 1;
-            else
-                continue;
-        }
+        if (pos++ < cursor->csm_pos)
+            continue;
 
-        TAILQ_FOREACH(msg, &MLACP(csm).mac_list, tail)
+        if (mclag_id <= 0 || csm->mlag_id == mclag_id)
         {
-            memset(&mclagd_mac, 0, sizeof(struct mclagd_mac_msg));
-            iccpd_mac = (struct MACMsg*)msg->buf;
-
-            mclagd_mac.op_type = iccpd_mac->op_type;
-            mclagd_mac.fdb_type = iccpd_mac->fdb_type;
-            memcpy(mclagd_mac.mac_str, iccpd_mac->mac_str, ETHER_ADDR_STR_LEN);
-            mclagd_mac.vid = iccpd_mac->vid;
-            memcpy(mclagd_mac.ifname, iccpd_mac->ifname, strlen(iccpd_mac->ifname));
-            memcpy(mclagd_mac.origin_ifname, iccpd_mac->origin_ifname, strlen(iccpd_mac->origin_ifname));
-            mclagd_mac.age_flag = iccpd_mac->age_flag;
+            cursor->id_exist = 1;
 
-            memcpy(mac_buf + MCLAGD_REPLY_INFO_HDR + mac_num * sizeof(struct mclagd_mac_msg),
-                   &mclagd_mac, sizeof(struct mclagd_mac_msg));
-
-            mac_num++;
-
-            if ((mac_num + 1) * sizeof(struct mclagd_mac_msg) > (mac_buf_size - MCLAGD_REPLY_INFO_HDR))
+            while (cursor->bucket < hash_size)
             {
-                mac_buf_size += MCLAGDCTL_CMD_SIZE;
-                mac_buf = (char*)realloc(mac_buf, mac_buf_size);
-                if (!mac_buf)
+                if (budget-- <= 0 || cursor->num >= ICCP_DUMP_CHUNK_ENTRIES)
+                    return 0;
+
+                ret = iccp_dump_bucket_fill(cursor, info_type, filter,
+                                            iccp_dump_bucket(csm, info_type, cursor->bucket));
+                if (ret < 0)
                     return EXEC_TYPE_FAILED;
+                if (ret == 0)
+                    return 0;
+
+                cursor->bucket++;
             }
         }
-    }
 
-    *buf = mac_buf;
-    *num = mac_num;
+        cursor->csm_pos++;
+        cursor->bucket = 0;
+    }
 
-    if (mclag_id > 0 && !id_exist)
+    if (mclag_id > 0 && !cursor->id_exist)
         return EXEC_TYPE_NO_EXIST_MCLAGID;
 
-    return EXEC_TYPE_SUCCESS;
+    return 1;
 }
 
 int iccp_local_if_dump(char * *buf,  int *num, int mclag_id)
@@ -542,3 +629,236 @@ int iccp_peer_if_dump(char * *buf, int *num, int mclag_id)
     return EXEC_TYPE_SUCCESS;
 }
 
+int iccp_counters_dump(char * *buf, int *num, int mclag_id)
+{
+    struct System *sys = NULL;
+    struct CSM *csm = NULL;
+    struct mclagd_counters *counters = NULL;
+    struct mclagd_session_counters session;
+    struct IngestStats ingest_stats;
+    const struct IccpPoolStats *pool_stats = NULL;
+    char *counters_buf = NULL;
+    int i = 0;
+    int session_num = 0;
+    int id_exist = 0;
+    int csm_num = 0;
+
+    if (!(sys = system_get_instance()))
+    {
+        return EXEC_TYPE_NO_EXIST_SYS;
+    }
+
+    LIST_FOREACH(csm, &(sys->csm_list), next)
+        csm_num++;
+
+    counters_buf = (char*)malloc(MCLAGD_REPLY_INFO_HDR + sizeof(struct mclagd_counters)
+                                 + csm_num * sizeof(struct mclagd_session_counters));
+    if (!counters_buf)
+        return EXEC_TYPE_FAILED;
+
+    counters = (struct mclagd_counters *)(counters_buf + MCLAGD_REPLY_INFO_HDR);
+    memset(counters, 0, sizeof(struct mclagd_counters));
+
+    counters->syncd_tx_frames = sys->syncd_tx_stats.tx_frames;
+    counters->syncd_tx_fdb_entries = sys->syncd_tx_stats.tx_fdb_entries;
+    counters->syncd_tx_bytes = sys->syncd_tx_stats.tx_bytes;
+    counters->syncd_writev_calls = sys->syncd_tx_stats.writev_calls;
+    counters->syncd_eagain = sys->syncd_tx_stats.eagain;
+    counters->syncd_hwm_hits = sys->syncd_tx_stats.hwm_hits;
+    counters->syncd_dropped_frames = sys->syncd_tx_stats.dropped_frames;
+    counters->syncd_dropped_fdb_entries = sys->syncd_tx_stats.dropped_fdb_entries;
+    counters->syncd_fdb_redirects = sys->syncd_tx_stats.fdb_redirects;
+    counters->syncd_stalls = sys->syncd_tx_stats.stalls;
+    counters->syncd_deferred_frames = sys->syncd_tx_stats.deferred_frames;
+    counters->syncd_deferred_fdb_entries = sys->syncd_tx_stats.deferred_fdb_entries;
+    counters->syncd_deferred_coalesced = sys->syncd_tx_stats.deferred_coalesced;
+    counters->syncd_deferred = sys->syncd_defer_num;
+    counters->syncd_queued_bytes = sys->syncd_tx_bytes;
+    counters->syncd_queued_bytes_peak = sys->syncd_tx_stats.queued_bytes_peak;
+
+    counters->fdb_sub_subscribes = sys->fdb_sub_stats.subscribes;
+    counters->fdb_sub_deltas = sys->fdb_sub_stats.deltas;
+    counters->fdb_sub_delta_entries = sys->fdb_sub_stats.delta_entries;
+    counters->fdb_sub_snapshots = sys->fdb_sub_stats.snapshots;
+    counters->fdb_sub_snapshot_entries = sys->fdb_sub_stats.snapshot_entries;
+    counters->fdb_sub_gaps = sys->fdb_sub_stats.gaps;
+    counters->fdb_sub_reconciled = sys->fdb_sub_stats.reconciled;
+    counters->fdb_sub_polls = sys->fdb_sub_stats.polls;
+    counters->fdb_sub_state = sys->fdb_subscribed;
+    counters->fdb_sub_seq = sys->fdb_seq;
+
+    for (i = 0; i < ICCP_POOL_MAX && i < MCLAGDCTL_POOL_MAX; i++)
+    {
+        pool_stats = iccp_pool_get_stats(i);
+        snprintf(counters->pools[i].name, MCLAGDCTL_POOL_NAME_LEN, "%s", iccp_pool_name(i));
+        counters->pools[i].obj_size = pool_stats->obj_size;
+        counters->pools[i].live = pool_stats->live;
+        counters->pools[i].peak = pool_stats->peak;
+        counters->pools[i].slab_bytes = (unsigned long long)pool_stats->slabs * pool_stats->obj_size * ICCP_POOL_SLAB_OBJS;
+        counters->pools[i].allocs = pool_stats->allocs;
+        counters->pools[i].frees = pool_stats->frees;
+    }
+
+    counters->neigh_requests = sys->neigh_stats.requests;
+    counters->neigh_batches = sys->neigh_stats.batches;
+    counters->neigh_bytes = sys->neigh_stats.bytes;
+    counters->neigh_acks = sys->neigh_stats.acks;
+    counters->neigh_failures = sys->neigh_stats.failures;
+    counters->neigh_eagain = sys->neigh_stats.eagain;
+    counters->neigh_lost_acks = sys->neigh_stats.lost_acks;
+    counters->neigh_dropped = sys->neigh_stats.dropped;
+    counters->neigh_resyncs = sys->neigh_stats.resyncs;
+    counters->neigh_pending = sys->neigh_pending_num;
+    counters->neigh_pending_peak = sys->neigh_stats.pending_peak;
+    counters->neigh_latency_max_usec = sys->neigh_stats.latency_max_usec;
+    for (i = 0; i < NEIGH_LATENCY_BUCKETS && i < MCLAGDCTL_NEIGH_LATENCY_BUCKETS; i++)
+        counters->neigh_latency_hist[i] = sys->neigh_stats.latency_hist[i];
+
+    iccp_ingest_get_stats(&ingest_stats);
+    counters->ingest_events = ingest_stats.events;
+    counters->ingest_neigh = ingest_stats.neigh;
+    counters->ingest_route_msgs = ingest_stats.route_msgs;
+    counters->ingest_packets = ingest_stats.packets;
+    counters->ingest_recv_errors = ingest_stats.recv_errors;
+    counters->ingest_dropped = ingest_stats.dropped;
+    counters->ingest_wakeups = ingest_stats.wakeups;
+    counters->ingest_resyncs = ingest_stats.resyncs;
+    counters->ingest_pkt_frames = ingest_stats.pkt_frames;
+    counters->ingest_pkt_batches = ingest_stats.pkt_batches;
+    counters->ingest_pkt_dups = ingest_stats.pkt_dups;
+    counters->ingest_pkt_kernel_drops = ingest_stats.pkt_kernel_drops;
+    counters->ingest_depth = ingest_stats.depth;
+    counters->ingest_depth_peak = ingest_stats.depth_peak;
+
+    counters->resync_route_losses = sys->netlink_resync_stats.route_losses;
+    counters->resync_team_losses = sys->netlink_resync_stats.team_losses;
+    counters->resync_ring_losses = sys->netlink_resync_stats.ring_losses;
+    counters->resync_deferred = sys->netlink_resync_stats.deferred;
+    counters->resync_link_dumps = sys->netlink_resync_stats.link_dumps;
+    counters->resync_addr_dumps = sys->netlink_resync_stats.addr_dumps;
+    counters->resync_neigh4_dumps = sys->netlink_resync_stats.neigh4_dumps;
+    counters->resync_neigh6_dumps = sys->netlink_resync_stats.neigh6_dumps;
+    counters->resync_team_dumps = sys->netlink_resync_stats.team_dumps;
+    counters->resync_steps = sys->netlink_resync_stats.steps;
+    counters->resync_total_usec = sys->netlink_resync_stats.total_usec;
+    counters->resync_max_step_usec = sys->netlink_resync_stats.max_step_usec;
+    counters->resync_pending = sys->netlink_resync_dirty;
+
+    LIST_FOREACH(csm, &(sys->csm_list), next)
+    {
+        if (mclag_id > 0)
+        {
+            if (csm->mlag_id == mclag_id)
+                id_exist = 1;
+            else
+                continue;
+        }
+
+        memset(&session, 0, sizeof(struct mclagd_session_counters));
+        session.mclag_id = csm->mlag_id;
+        memcpy(session.peer_ip, csm->peer_ip, ICCP_MAX_IP_STR_LEN);
+        session.tx_msgs = csm->io_stats.tx_msgs;
+        session.tx_bytes = csm->io_stats.tx_bytes;
+        session.tx_eagain = csm->io_stats.tx_eagain;
+        session.tx_dropped = csm->io_stats.tx_dropped;
+        session.tx_stalls = csm->io_stats.tx_stalls;
+        session.tx_stall_msec = csm->io_stats.tx_stall_msec;
+        session.rx_msgs = csm->io_stats.rx_msgs;
+        session.rx_bytes = csm->io_stats.rx_bytes;
+        session.rx_copy_bytes = csm->io_stats.rx_copy_bytes;
+        session.rx_blocks = csm->io_stats.rx_blocks;
+        session.tx_queued_bytes = csm->tx_len;
+        session.tx_queued_bytes_peak = csm->io_stats.tx_queued_peak;
+        session.tx_stall_max_msec = csm->io_stats.tx_stall_max_msec;
+        session.fast_hello_interval_msec = csm->fast_hello.tx_interval_msec;
+        session.fast_hello_multiplier = csm->fast_hello.multiplier;
+        session.fast_hello_peer_interval_msec = csm->fast_hello.peer_interval_msec;
+        session.fast_hello_peer_multiplier = csm->fast_hello.peer_multiplier;
+        session.fast_hello_last_detect_msec = csm->fast_hello.last_detect_msec;
+        session.fast_hello_jitter_max_usec = csm->fast_hello.jitter_max_usec;
+        if (csm->fast_hello.jitter_samples)
+            session.fast_hello_jitter_avg_usec = csm->fast_hello.jitter_sum_usec / csm->fast_hello.jitter_samples;
+        session.fast_hello_tx = csm->fast_hello.tx_hellos;
+        session.fast_hello_rx = csm->fast_hello.rx_hellos;
+        session.fast_hello_rx_lost = csm->fast_hello.rx_lost;
+        session.fast_hello_detects = csm->fast_hello.detects;
+
+        memcpy(counters_buf + MCLAGD_REPLY_INFO_HDR + sizeof(struct mclagd_counters)
+               + session_num * sizeof(struct mclagd_session_counters),
+               &session, sizeof(struct mclagd_session_counters));
+        session_num++;
+    }
+
+    *buf = counters_buf;
+    *num = session_num;
+
+    if (mclag_id > 0 && !id_exist)
+        return EXEC_TYPE_NO_EXIST_MCLAGID;
+
+    return EXEC_TYPE_SUCCESS;
+}
+
+int iccp_latency_dump(char * *buf, int *num)
+{
+    const struct IccpLatencyStats *stats = iccp_latency_get_stats();
+    const struct IccpLatencyStage *st = NULL;
+    struct mclagd_latency *latency = NULL;
+    struct mclagd_tlv_counters tlv;
+    char *latency_buf = NULL;
+    int tlv_num = 0;
+    int i = 0;
+    int type = 0;
+
+    for (i = 0; i < ICCP_LAT_TLV_SLOTS; i++)
+    {
+        if (stats->tlv_rx[i] || stats->tlv_tx[i])
+            tlv_num++;
+    }
+
+    latency_buf = (char*)malloc(MCLAGD_REPLY_INFO_HDR + sizeof(struct mclagd_latency)
+                                + tlv_num * sizeof(struct mclagd_tlv_counters));
+    if (!latency_buf)
+        return EXEC_TYPE_FAILED;
+
+    latency = (struct mclagd_latency *)(latency_buf + MCLAGD_REPLY_INFO_HDR);
+    memset(latency, 0, sizeof(struct mclagd_latency));
+
+    latency->elapsed_sec = iccp_latency_now_usec() / 1000000 - stats->since_sec;
+    latency->tlv_other_rx = stats->tlv_other_rx;
+    latency->tlv_other_tx = stats->tlv_other_tx;
+
+    for (i = 0; i < ICCP_LAT_STAGE_MAX && i < MCLAGDCTL_LATENCY_STAGE_MAX; i++)
+    {
+        st = &stats->stages[i];
+        snprintf(latency->stages[i].name, MCLAGDCTL_LATENCY_NAME_LEN, "%s", iccp_latency_stage_name(i));
+        latency->stages[i].count = st->count;
+        latency->stages[i].sum_usec = st->sum_usec;
+        latency->stages[i].max_usec = st->max_usec;
+        memcpy(latency->stages[i].hist, st->hist, sizeof(latency->stages[i].hist));
+        latency->stage_num++;
+    }
+
+    tlv_num = 0;
+    for (i = 0; i < ICCP_LAT_TLV_SLOTS; i++)
+    {
+        if (!stats->tlv_rx[i] && !stats->tlv_tx[i])
+            continue;
+
+        type = iccp_latency_tlv_type(i);
+        memset(&tlv, 0, sizeof(struct mclagd_tlv_counters));
+        tlv.type = type;
+        snprintf(tlv.name, MCLAGDCTL_LATENCY_NAME_LEN, "%s", get_tlv_type_string(type));
+        tlv.rx = stats->tlv_rx[i];
+        tlv.tx = stats->tlv_tx[i];
+
+        memcpy(latency_buf + MCLAGD_REPLY_INFO_HDR + sizeof(struct mclagd_latency)
+               + tlv_num * sizeof(struct mclagd_tlv_counters),
+               &tlv, sizeof(struct mclagd_tlv_counters));
+        tlv_num++;
+    }
+
+    *buf = latency_buf;
+    *num = tlv_num;
+
+    return EXEC_TYPE_SUCCESS;
+}
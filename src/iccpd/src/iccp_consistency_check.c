@@ -96,8 +96,6 @@ static int iccp_check_interface_vlan(char* ifname)
 {
     struct CSM* csm = NULL;
     struct PeerInterface* peer_if = NULL;
-    struct VLAN_ID* local_vlan = NULL;
-    struct VLAN_ID* peer_vlan = NULL;
     struct LocalInterface* local_if = NULL;
 
     local_if = local_if_find_by_name(ifname);
@@ -112,34 +110,11 @@ static int iccp_check_interface_vlan(char* ifname)
     if (peer_if == NULL)
         return -4;
 
-    LIST_FOREACH(local_vlan, &(local_if->vlan_list), port_next)
-    {
-        LIST_FOREACH(peer_vlan, &(peer_if->vlan_list), port_next)
-        {
-            if (peer_vlan->vid == local_vlan->vid)
-                break;
-        }
-
-        if (peer_vlan == NULL)
-        {
-            return -5;
-        }
-    }
-
-    LIST_FOREACH(peer_vlan, &(peer_if->vlan_list), port_next)
-    {
-
-        LIST_FOREACH(local_vlan, &(local_if->vlan_list), port_next)
-        {
-            if (peer_vlan->vid == local_vlan->vid)
-                break;
-        }
+    if (vlan_bitmap_first_diff(&local_if->vlan_bitmap, &peer_if->vlan_bitmap) >= 0)
+        return -5;
 
-        if (local_vlan == NULL)
-        {
-            return -6;
-        }
-    }
+    if (vlan_bitmap_first_diff(&peer_if->vlan_bitmap, &local_if->vlan_bitmap) >= 0)
+        return -6;
 
     return 1;
 }
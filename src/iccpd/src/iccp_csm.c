@@ -23,13 +23,18 @@
 
 #include <netinet/in.h>
 #include <arpa/inet.h>
+#include <sys/epoll.h>
 
 #include "../include/logger.h"
 #include "../include/system.h"
 #include "../include/scheduler.h"
 #include "../include/msg_format.h"
 #include "../include/iccp_csm.h"
+#include "../include/iccp_pool.h"
 #include "../include/mlacp_link_handler.h"
+#include "../include/mlacp_fast_hello.h"
+#include "../include/iccp_latency.h"
+#include "../include/iccp_capture.h"
 /*****************************************
 * Define
 *
@@ -40,8 +45,7 @@
         while (!TAILQ_EMPTY(&(list))) { \
             msg = TAILQ_FIRST(&(list)); \
             TAILQ_REMOVE(&(list), msg, tail); \
-            free(msg->buf); \
-            free(msg); \
+            iccp_csm_free_msg(msg); \
         } \
         TAILQ_INIT(&(list)); \
     }
@@ -121,6 +125,7 @@ void iccp_csm_init(struct CSM* csm)
     memset(csm->peer_ip, 0, INET_ADDRSTRLEN);
     memset(csm->iccp_info.sender_name, 0, MAX_L_ICC_SENDER_NAME);
     csm->iccp_info.icc_rg_id = 0x0;
+    mlacp_fast_hello_init(csm);
 }
 
 /* Connection State Machine instance status reset */
@@ -191,6 +196,8 @@ void iccp_csm_finalize(struct CSM* csm)
         LIST_REMOVE(cif, csm_next);
     }
 
+    mlacp_fast_hello_finalize(csm);
+
     /* Release iccp_csm */
     pthread_mutex_destroy(&(csm->conn_mutex));
     iccp_csm_msg_list_finalize(csm);
@@ -210,18 +217,203 @@ void iccp_csm_msg_list_finalize(struct CSM* csm)
     {
         msg = TAILQ_FIRST(&(csm->msg_list));
         TAILQ_REMOVE(&(csm->msg_list), msg, tail);
-        free(msg);
+        iccp_csm_free_msg(msg);
     }
 }
 
 /* Send message to peer */
-int iccp_csm_send(struct CSM* csm, char* buf, int msg_len)
+static uint32_t iccp_csm_elapsed_msec(struct timespec *start)
 {
-    LDPHdr* ldp_hdr = (LDPHdr*)buf;
-    ICCParameter* param = NULL;
+    struct timespec now;
 
-    if (csm == NULL || buf == NULL || csm->sock_fd <= 0 || msg_len <= 0)
+    clock_gettime(CLOCK_MONOTONIC, &now);
+
+    return (now.tv_sec - start->tv_sec) * 1000 + (now.tv_nsec - start->tv_nsec) / 1000000;
+}
+
+static void iccp_csm_tx_stall_end(struct CSM* csm)
+{
+    uint32_t msec = iccp_csm_elapsed_msec(&csm->tx_stall_start);
+
+    csm->io_stats.tx_stall_msec += msec;
+    if (msec > csm->io_stats.tx_stall_max_msec)
+        csm->io_stats.tx_stall_max_msec = msec;
+
+    return;
+}
+
+static void iccp_csm_tx_set_pollout(struct CSM* csm, int enable)
+{
+    struct System* sys = NULL;
+    struct epoll_event event;
+
+    if (csm->tx_pollout == enable)
+        return;
+
+    if ((sys = system_get_instance()) == NULL)
+        return;
+
+    event.data.fd = csm->sock_fd;
+    event.events = enable ? (EPOLLIN | EPOLLOUT) : EPOLLIN;
+    epoll_ctl(sys->epoll_fd, EPOLL_CTL_MOD, csm->sock_fd, &event);
+
+    if (enable)
+    {
+        ++csm->io_stats.tx_stalls;
+        clock_gettime(CLOCK_MONOTONIC, &csm->tx_stall_start);
+    }
+    else
+    {
+        iccp_csm_tx_stall_end(csm);
+    }
+
+    csm->tx_pollout = enable;
+
+    return;
+}
+
+/* Append a msg to the send queue*/
+static int iccp_csm_tx_enqueue(struct CSM* csm, char* buf, int msg_len)
+{
+    uint32_t size;
+    char* tx_buf = NULL;
+
+    if (csm->tx_len + msg_len > CSM_TX_QUEUE_MAX)
+    {
+        /*Peer is not reading, the session can not be kept in sync any more*/
+        ++csm->io_stats.tx_dropped;
+        csm->tx_error = 1;
+        ICCPD_LOG_WARN(__FUNCTION__, "Peer %s send queue is full, %u bytes pending",
+                       csm->peer_ip, csm->tx_len);
         return MCLAG_ERROR;
+    }
+
+    if (csm->tx_head + csm->tx_len + msg_len > csm->tx_size)
+    {
+        if (csm->tx_head > 0)
+        {
+            memmove(csm->tx_buf, csm->tx_buf + csm->tx_head, csm->tx_len);
+            csm->tx_head = 0;
+        }
+
+        if (csm->tx_len + msg_len > csm->tx_size)
+        {
+            size = csm->tx_size ? csm->tx_size : CSM_TX_BUF_MIN_SIZE;
+            while (size < csm->tx_len + msg_len)
+                size *= 2;
+
+            tx_buf = (char*)realloc(csm->tx_buf, size);
+            if (tx_buf == NULL)
+            {
+                ++csm->io_stats.tx_dropped;
+                return MCLAG_ERROR;
+            }
+
+            csm->tx_buf = tx_buf;
+            csm->tx_size = size;
+        }
+    }
+
+    memcpy(csm->tx_buf + csm->tx_head + csm->tx_len, buf, msg_len);
+    csm->tx_len += msg_len;
+    if (csm->tx_len > csm->io_stats.tx_queued_peak)
+        csm->io_stats.tx_queued_peak = csm->tx_len;
+
+    return 0;
+}
+
+/* Write buf as far as the socket takes it, 0 when it is full*/
+static ssize_t iccp_csm_tx_write_buf(struct CSM* csm, char* buf, uint32_t len)
+{
+    ssize_t n;
+
+    while (1)
+    {
+        n = write(csm->sock_fd, buf, len);
+        if (n >= 0)
+            break;
+
+        if (errno == EINTR)
+            continue;
+
+        if (errno == EAGAIN || errno == EWOULDBLOCK)
+        {
+            ++csm->io_stats.tx_eagain;
+            iccp_csm_tx_set_pollout(csm, 1);
+            return 0;
+        }
+
+        ICCPD_LOG_WARN(__FUNCTION__, "Failed to send to peer %s: %s", csm->peer_ip, strerror(errno));
+        csm->tx_error = 1;
+        return MCLAG_ERROR;
+    }
+
+    csm->io_stats.tx_bytes += n;
+
+    return n;
+}
+
+/* Consume n written bytes of the send queue, keeping track of where the
+ * msg being written ends*/
+static void iccp_csm_tx_advance(struct CSM* csm, uint32_t n)
+{
+    LDPHdr* ldp_hdr = NULL;
+    uint32_t step;
+
+    while (n > 0)
+    {
+        if (csm->tx_msg_left == 0)
+        {
+            ldp_hdr = (LDPHdr*)(csm->tx_buf + csm->tx_head);
+            csm->tx_msg_left = ntohs(ldp_hdr->msg_len) + MSG_L_INCLUD_U_BIT_MSG_T_L_FIELDS;
+        }
+
+        step = n < csm->tx_msg_left ? n : csm->tx_msg_left;
+        csm->tx_head += step;
+        csm->tx_len -= step;
+        csm->tx_msg_left -= step;
+        n -= step;
+    }
+}
+
+/* Write the send queue as far as the socket takes it. The msgs sent ahead
+ * go out as soon as the msg being written is complete*/
+static int iccp_csm_tx_write(struct CSM* csm)
+{
+    ssize_t n;
+
+    while (csm->tx_len > 0 || csm->tx_prio_len > 0)
+    {
+        if (csm->tx_prio_len > 0 && csm->tx_msg_left == 0)
+        {
+            n = iccp_csm_tx_write_buf(csm, csm->tx_prio_buf + csm->tx_prio_head, csm->tx_prio_len);
+            if (n <= 0)
+                return n;
+
+            csm->tx_prio_head += n;
+            csm->tx_prio_len -= n;
+            if (csm->tx_prio_len == 0)
+                csm->tx_prio_head = 0;
+            continue;
+        }
+
+        n = iccp_csm_tx_write_buf(csm, csm->tx_buf + csm->tx_head, csm->tx_len);
+        if (n <= 0)
+            return n;
+
+        iccp_csm_tx_advance(csm, n);
+    }
+
+    csm->tx_head = 0;
+    iccp_csm_tx_set_pollout(csm, 0);
+
+    return 0;
+}
+
+static void iccp_csm_tx_log(struct CSM* csm, char* buf, int msg_len)
+{
+    LDPHdr* ldp_hdr = (LDPHdr*)buf;
+    ICCParameter* param = NULL;
 
     if (ntohs(ldp_hdr->msg_type) == MSG_T_CAPABILITY)
         param = (struct ICCParameter*)&buf[sizeof(LDPHdr)];
@@ -236,7 +428,230 @@ int iccp_csm_send(struct CSM* csm, char* buf, int msg_len)
     if (csm->msg_log.end_index >= 128)
         csm->msg_log.end_index = 0;
 
-    return write(csm->sock_fd, buf, msg_len);
+    ++csm->io_stats.tx_msgs;
+    iccp_latency_count_msg(ICCP_LAT_TX, buf, msg_len);
+    iccp_capture_write(ICCP_CAPTURE_PEER_TX, csm->mlag_id, buf, msg_len);
+}
+
+int iccp_csm_send(struct CSM* csm, char* buf, int msg_len)
+{
+    if (csm == NULL || buf == NULL || csm->sock_fd <= 0 || msg_len <= 0)
+        return MCLAG_ERROR;
+
+    if (iccp_csm_tx_enqueue(csm, buf, msg_len) < 0)
+        return MCLAG_ERROR;
+
+    iccp_csm_tx_log(csm, buf, msg_len);
+
+    /*Send queue is behind, wait for EPOLLOUT to keep the msg order*/
+    if (csm->tx_pollout)
+        return msg_len;
+
+    if (iccp_csm_tx_write(csm) < 0)
+        return MCLAG_ERROR;
+
+    return msg_len;
+}
+
+/* Send ahead of the queued msgs, e.g. a fast hello must not wait behind a
+ * bulk sync. The peer does not depend on the msg order for these*/
+int iccp_csm_send_prio(struct CSM* csm, char* buf, int msg_len)
+{
+    if (csm == NULL || buf == NULL || csm->sock_fd <= 0 || msg_len <= 0)
+        return MCLAG_ERROR;
+
+    if (csm->tx_prio_head + csm->tx_prio_len + msg_len > CSM_TX_PRIO_SIZE)
+    {
+        ++csm->io_stats.tx_dropped;
+        return MCLAG_ERROR;
+    }
+
+    memcpy(csm->tx_prio_buf + csm->tx_prio_head + csm->tx_prio_len, buf, msg_len);
+    csm->tx_prio_len += msg_len;
+    iccp_csm_tx_log(csm, buf, msg_len);
+
+    if (csm->tx_pollout)
+        return msg_len;
+
+    if (iccp_csm_tx_write(csm) < 0)
+        return MCLAG_ERROR;
+
+    return msg_len;
+}
+
+/* Write out the send queue, disconnect the session if it is broken.
+ * Must not be called while walking the mlacp tables*/
+int iccp_csm_flush(struct CSM* csm)
+{
+    if (csm == NULL || csm->sock_fd <= 0)
+        return MCLAG_ERROR;
+
+    if ((csm->tx_len > 0 || csm->tx_prio_len > 0) && !csm->tx_error)
+        iccp_csm_tx_write(csm);
+
+    if (csm->tx_error)
+    {
+        ICCPD_LOG_WARN(__FUNCTION__, "Peer %s send queue is broken, %u bytes pending",
+                       csm->peer_ip, csm->tx_len);
+        scheduler_session_disconnect_handler(csm);
+        return MCLAG_ERROR;
+    }
+
+    return 0;
+}
+
+/* Drop one reference of a receive block*/
+static void iccp_csm_rx_block_put(struct CSMRxBlock* block)
+{
+    if (--block->refcnt <= 0)
+        free(block);
+
+    return;
+}
+
+/* Make room for the next recv, return the write position in the rx block.
+ * A partial msg is moved in place if no slice refers to the block,
+ * otherwise it is copied into a new block*/
+char* iccp_csm_rx_space(struct CSM* csm, uint32_t* space)
+{
+    struct CSMRxBlock* block = csm->rx_block;
+    struct CSMRxBlock* new_block = NULL;
+    LDPHdr* ldp_hdr = NULL;
+    uint32_t pending = 0;
+    uint32_t need = sizeof(LDPHdr);
+
+    if (block)
+    {
+        pending = block->len - csm->rx_head;
+        if (pending >= sizeof(LDPHdr))
+        {
+            ldp_hdr = (LDPHdr*)&block->data[csm->rx_head];
+            need = ntohs(ldp_hdr->msg_len) + MSG_L_INCLUD_U_BIT_MSG_T_L_FIELDS;
+        }
+
+        /*Nobody else holds the block, reuse it*/
+        if (block->refcnt == 1 && csm->rx_head > 0
+            && (pending == 0 || csm->rx_head + need > block->size))
+        {
+            if (pending > 0)
+            {
+                memmove(block->data, &block->data[csm->rx_head], pending);
+                csm->io_stats.rx_copy_bytes += pending;
+            }
+            block->len = pending;
+            csm->rx_head = 0;
+        }
+
+        if (csm->rx_head + need <= block->size && block->len < block->size)
+        {
+            *space = block->size - block->len;
+            return &block->data[block->len];
+        }
+    }
+
+    new_block = (struct CSMRxBlock*)malloc(sizeof(struct CSMRxBlock) + CSM_RX_BUF_SIZE);
+    if (new_block == NULL)
+        return NULL;
+
+    new_block->refcnt = 1;
+    new_block->size = CSM_RX_BUF_SIZE;
+    new_block->len = 0;
+    ++csm->io_stats.rx_blocks;
+
+    if (block)
+    {
+        memcpy(new_block->data, &block->data[csm->rx_head], pending);
+        new_block->len = pending;
+        csm->io_stats.rx_copy_bytes += pending;
+        iccp_csm_rx_block_put(block);
+    }
+
+    csm->rx_block = new_block;
+    csm->rx_head = 0;
+    *space = new_block->size - new_block->len;
+
+    return &new_block->data[new_block->len];
+}
+
+/* Build a msg on len bytes of the rx block at offset, without copying*/
+struct Msg* iccp_csm_slice_msg(struct CSM* csm, uint32_t offset, uint32_t len)
+{
+    struct Msg* msg = NULL;
+
+    msg = iccp_csm_alloc_msg();
+    if (msg == NULL)
+        return NULL;
+
+    msg->buf = &csm->rx_block->data[offset];
+    msg->len = len;
+    msg->rx_block = csm->rx_block;
+    ++csm->rx_block->refcnt;
+
+    return msg;
+}
+
+/* Give a msg its own buffer, for msgs kept longer than one loop*/
+int iccp_csm_detach_msg(struct CSM* csm, struct Msg* msg)
+{
+    char* buf = NULL;
+
+    if (msg->rx_block == NULL)
+        return 0;
+
+    buf = (char*)malloc(msg->len);
+    if (buf == NULL)
+        return MCLAG_ERROR;
+
+    memcpy(buf, msg->buf, msg->len);
+    csm->io_stats.rx_copy_bytes += msg->len;
+    iccp_csm_rx_block_put(msg->rx_block);
+    msg->buf = buf;
+    msg->rx_block = NULL;
+
+    return 0;
+}
+
+void iccp_csm_free_msg(struct Msg* msg)
+{
+    if (msg->rx_block)
+        iccp_csm_rx_block_put(msg->rx_block);
+    else if (msg->buf_pool != ICCP_POOL_NONE)
+        iccp_pool_free(msg->buf_pool, msg->buf);
+    else
+        free(msg->buf);
+
+    iccp_pool_free(ICCP_POOL_MSG, msg);
+
+    return;
+}
+
+/* Release the socket buffers, called when the session is closed*/
+void iccp_csm_io_reset(struct CSM* csm)
+{
+    if (csm == NULL)
+        return;
+
+    if (csm->tx_pollout)
+        iccp_csm_tx_stall_end(csm);
+
+    if (csm->tx_buf)
+        free(csm->tx_buf);
+    if (csm->rx_block)
+        iccp_csm_rx_block_put(csm->rx_block);
+
+    csm->tx_buf = NULL;
+    csm->tx_size = 0;
+    csm->tx_head = 0;
+    csm->tx_len = 0;
+    csm->tx_msg_left = 0;
+    csm->tx_prio_head = 0;
+    csm->tx_prio_len = 0;
+    csm->tx_pollout = 0;
+    csm->tx_error = 0;
+    csm->rx_block = NULL;
+    csm->rx_head = 0;
+
+    return;
 }
 
 /* Connection State Machine Transition */
@@ -266,6 +681,8 @@ void iccp_csm_transit(struct CSM* csm)
     switch (csm->current_state)
     {
         case ICCP_NONEXISTENT:
+            if (msg)
+                iccp_csm_free_msg(msg);
             scheduler_prepare_session(csm);
             if (csm->sock_fd > 0 && scheduler_check_csm_config(csm) > 0)
                 csm->current_state = ICCP_INITIALIZED;
@@ -618,8 +1035,7 @@ void iccp_csm_correspond_from_msg(struct CSM* csm, struct Msg* msg)
         ++csm->u_msg_in_count;
     }
 
-    free(msg->buf);
-    free(msg);
+    iccp_csm_free_msg(msg);
 }
 
 /* Receive capability message correspond function */
@@ -686,7 +1102,7 @@ void iccp_csm_enqueue_msg(struct CSM* csm, struct Msg* msg)
     if (csm == NULL)
     {
         if (msg != NULL)
-            free(msg);
+            iccp_csm_free_msg(msg);
         return;
     }
 
@@ -740,6 +1156,21 @@ struct Msg* iccp_csm_dequeue_msg(struct CSM* csm)
     return msg;
 }
 
+/* Msg nodes come from the msg pool, buf is set by the caller*/
+struct Msg* iccp_csm_alloc_msg(void)
+{
+    struct Msg* msg = NULL;
+
+    msg = (struct Msg*)iccp_pool_alloc(ICCP_POOL_MSG);
+    if (msg == NULL)
+        return NULL;
+
+    memset(msg, 0, sizeof(struct Msg));
+    msg->buf_pool = ICCP_POOL_NONE;
+
+    return msg;
+}
+
 /* Message initialization */
 int iccp_csm_init_msg(struct Msg** msg, char* data, int len)
 {
@@ -751,29 +1182,53 @@ int iccp_csm_init_msg(struct Msg** msg, char* data, int len)
     if (data == NULL || len <= 0)
         return MCLAG_ERROR;
 
-    iccp_msg = (struct Msg*)malloc(sizeof(struct Msg));
+    iccp_msg = iccp_csm_alloc_msg();
     if (iccp_msg == NULL)
-        goto err_ret;
+        return MCLAG_ERROR;
 
     iccp_msg->buf = (char*)malloc(len);
     if (iccp_msg->buf == NULL)
-        goto err_ret;
+    {
+        iccp_pool_free(ICCP_POOL_MSG, iccp_msg);
+        return MCLAG_ERROR;
+    }
 
     memcpy(iccp_msg->buf, data, len);
     iccp_msg->len = len;
     *msg = iccp_msg;
 
     return 0;
+}
+
+/* Message initialization for MAC/ARP/ND entries, buf is taken from
+ * the pool of the entry type*/
+int iccp_csm_init_pool_msg(struct Msg** msg, int pool, char* data, int len)
+{
+    struct Msg* iccp_msg = NULL;
+
+    if (msg == NULL)
+        return -2;
+
+    if (data == NULL || len <= 0 || len > iccp_pool_obj_size(pool))
+        return MCLAG_ERROR;
+
+    iccp_msg = iccp_csm_alloc_msg();
+    if (iccp_msg == NULL)
+        return MCLAG_ERROR;
 
- err_ret:
-    if (iccp_msg)
+    iccp_msg->buf = (char*)iccp_pool_alloc(pool);
+    if (iccp_msg->buf == NULL)
     {
-        if (iccp_msg->buf)
-            free(iccp_msg->buf);
-        free(iccp_msg);
+        iccp_pool_free(ICCP_POOL_MSG, iccp_msg);
+        return MCLAG_ERROR;
     }
 
-    return MCLAG_ERROR;
+    memcpy(iccp_msg->buf, data, len);
+    iccp_msg->len = len;
+    iccp_msg->buf_pool = pool;
+    *msg = iccp_msg;
+
+    return 0;
 }
 
 void iccp_csm_stp_role_count(struct CSM *csm)
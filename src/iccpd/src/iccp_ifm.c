@@ -35,7 +35,10 @@
 #include "../include/mlacp_sync_update.h"
 #include "../include/mlacp_link_handler.h"
 #include "../include/port.h"
+#include "../include/iccp_pool.h"
 #include "../include/iccp_netlink.h"
+#include "../include/iccp_latency.h"
+#include "../include/iccp_capture.h"
 
 #define fwd_neigh_state_valid(state) (state & (NUD_REACHABLE | NUD_STALE | NUD_DELAY | NUD_PROBE | NUD_PERMANENT))
 
@@ -52,6 +55,7 @@ static int iccp_valid_handler(struct nl_msg *msg, void *arg)
     if (nlh->nlmsg_type != RTM_NEWLINK)
         return 0;
 
+    iccp_capture_write(ICCP_CAPTURE_DUMP, -1, nlh, nlh->nlmsg_len);
     if (nl_msg_parse(msg, &iccp_event_handler_obj_input_newlink, &event) < 0)
         ICCPD_LOG_ERR(__FUNCTION__, "Unknown message type.");
 
@@ -109,14 +113,13 @@ int iccp_sys_local_if_list_get_init()
     return ret;
 }
 
-static void do_arp_learn_from_kernel(struct ndmsg *ndm, struct rtattr *tb[], int msgtype)
+static void do_arp_learn_from_kernel(const struct NeighEvent *ev)
 {
     struct System *sys = NULL;
     struct CSM *csm = NULL;
     struct Msg *msg = NULL;
     struct ARPMsg *arp_msg = NULL, *arp_info = NULL;
-    struct VLAN_ID *vlan_id_list = NULL;
-    struct Msg *msg_send = NULL;
+    int arp_vid = -1;
 
     char buf[MAX_BUFSIZE];
     size_t msg_len = 0;
@@ -130,8 +133,9 @@ static void do_arp_learn_from_kernel(struct ndmsg *ndm, struct rtattr *tb[], int
         return;
 
     /* Find local itf*/
-    if (!(arp_lif = local_if_find_by_ifindex(ndm->ndm_ifindex)))
+    if (!(arp_lif = local_if_find_by_ifindex(ev->ifindex)))
         return;
+    arp_vid = local_if_vlan_id(arp_lif);
 
     /* create ARP msg*/
     memset(buf, 0, MAX_BUFSIZE);
@@ -139,16 +143,14 @@ static void do_arp_learn_from_kernel(struct ndmsg *ndm, struct rtattr *tb[], int
     arp_msg = (struct ARPMsg*)&buf;
     arp_msg->op_type = NEIGH_SYNC_LIF;
     sprintf(arp_msg->ifname, "%s", arp_lif->name);
-    if (tb[NDA_DST])
-        memcpy(&arp_msg->ipv4_addr, RTA_DATA(tb[NDA_DST]), RTA_PAYLOAD(tb[NDA_DST]));
-    if (tb[NDA_LLADDR])
-        memcpy(arp_msg->mac_addr, RTA_DATA(tb[NDA_LLADDR]), RTA_PAYLOAD(tb[NDA_LLADDR]));
+    memcpy(&arp_msg->ipv4_addr, ev->dst, 4);
+    memcpy(arp_msg->mac_addr, ev->mac, ETHER_ADDR_LEN);
 
     arp_msg->ipv4_addr = arp_msg->ipv4_addr;
 
     ICCPD_LOG_NOTICE(__FUNCTION__, "ARP type %s, state (%04X)(%d) ifindex [%d] (%s) ip %s, mac [%02X:%02X:%02X:%02X:%02X:%02X]",
-                    msgtype == RTM_NEWNEIGH ? "New":"Del", ndm->ndm_state, fwd_neigh_state_valid(ndm->ndm_state),
-                    ndm->ndm_ifindex, arp_lif->name,
+                    ev->msgtype == RTM_NEWNEIGH ? "New":"Del", ev->state, fwd_neigh_state_valid(ev->state),
+                    ev->ifindex, arp_lif->name,
                     show_ip_str(arp_msg->ipv4_addr),
                     arp_msg->mac_addr[0], arp_msg->mac_addr[1], arp_msg->mac_addr[2], arp_msg->mac_addr[3], arp_msg->mac_addr[4],
                     arp_msg->mac_addr[5]);
@@ -164,24 +166,16 @@ static void do_arp_learn_from_kernel(struct ndmsg *ndm, struct rtattr *tb[], int
             if (!local_if_is_l3_mode(lif_po))
             {
                 /* Is the L2 MLAG itf belong to a vlan?*/
-                LIST_FOREACH(vlan_id_list, &(lif_po->vlan_list), port_next)
-                {
-                    if ( !(vlan_id_list->vlan_itf
-                           && vlan_id_list->vlan_itf->ifindex == ndm->ndm_ifindex))
-                        continue;
-                    break;
-                }
-
-                if (!vlan_id_list)
+                if (!local_if_has_vlan(lif_po, arp_vid))
                     continue;
 
                 ICCPD_LOG_DEBUG(__FUNCTION__, "ARP is from mclag enabled member port of vlan %s",
-                                vlan_id_list->vlan_itf->name);
+                                arp_lif->name);
             }
             else
             {
                 /* Is the ARP belong to a L3 mode MLAG itf?*/
-                if (ndm->ndm_ifindex != lif_po->ifindex)
+                if (ev->ifindex != lif_po->ifindex)
                     continue;
 
                 ICCPD_LOG_DEBUG(__FUNCTION__, "ARP is from mclag enabled intf %s", lif_po->name);
@@ -202,23 +196,31 @@ static void do_arp_learn_from_kernel(struct ndmsg *ndm, struct rtattr *tb[], int
         return;
 
     /* update lif ARP*/
-    TAILQ_FOREACH(msg, &MLACP(csm).arp_list, tail)
+    msg = mlacp_arp_table_find(csm, arp_msg->ipv4_addr);
+    if (msg)
     {
         arp_info = (struct ARPMsg*)msg->buf;
-        if (arp_info->ipv4_addr != arp_msg->ipv4_addr)
-            continue;
 
-        if (msgtype == RTM_DELNEIGH)
+        if (ev->msgtype == RTM_DELNEIGH)
         {
             /* delete ARP*/
-            TAILQ_REMOVE(&MLACP(csm).arp_list, msg, tail);
-            free(msg->buf);
-            free(msg);
+            mlacp_arp_table_del(csm, msg);
             msg = NULL;
             ICCPD_LOG_DEBUG(__FUNCTION__, "Delete ARP %s", show_ip_str(arp_msg->ipv4_addr));
         }
         else
         {
+            /* Kernel has it, a restored entry is confirmed and sent to the peer.
+             * One the peer sent was programmed by us, only the peer confirms it*/
+            if (msg->stale)
+            {
+                if (arp_info->op_type == NEIGH_SYNC_ADD)
+                    return;
+
+                msg->stale = 0;
+                arp_update = 1;
+            }
+
             /* update ARP*/
             if (arp_info->op_type != arp_msg->op_type
                 || strcmp(arp_info->ifname, arp_msg->ifname) != 0
@@ -227,24 +229,23 @@ static void do_arp_learn_from_kernel(struct ndmsg *ndm, struct rtattr *tb[], int
             {
                 arp_update = 1;
                 arp_info->op_type = arp_msg->op_type;
-                sprintf(arp_info->ifname, "%s", arp_msg->ifname);
+                mlacp_arp_table_set_ifname(csm, msg, arp_msg->ifname);
                 memcpy(arp_info->mac_addr, arp_msg->mac_addr, ETHER_ADDR_LEN);
                 ICCPD_LOG_DEBUG(__FUNCTION__, "Update ARP for %s", show_ip_str(arp_msg->ipv4_addr));
             }
         }
-        break;
     }
 
     if (msg && !arp_update)
         return;
 
-    if (msgtype != RTM_DELNEIGH)
+    if (ev->msgtype != RTM_DELNEIGH)
     {
         /* enquene lif_msg (add)*/
         if (!msg)
         {
             arp_msg->op_type = NEIGH_SYNC_LIF;
-            if (iccp_csm_init_msg(&msg, (char*)arp_msg, msg_len) == 0)
+            if (iccp_csm_init_pool_msg(&msg, ICCP_POOL_ARP, (char*)arp_msg, msg_len) == 0)
             {
                 mlacp_enqueue_arp(csm, msg);
                 /*ICCPD_LOG_DEBUG(__FUNCTION__, "ARP-list enqueue: %s, add %s",
@@ -256,51 +257,28 @@ static void do_arp_learn_from_kernel(struct ndmsg *ndm, struct rtattr *tb[], int
         }
 
         /* enqueue iccp_msg (add)*/
-        if (MLACP(csm).current_state == MLACP_STATE_EXCHANGE)
-        {
-            arp_msg->op_type = NEIGH_SYNC_ADD;
-            if (iccp_csm_init_msg(&msg_send, (char*)arp_msg, msg_len) == 0)
-            {
-                TAILQ_INSERT_TAIL(&(MLACP(csm).arp_msg_list), msg_send, tail);
-                /*ICCPD_LOG_DEBUG(__FUNCTION__, "Enqueue ARP[ADD] message for %s",
-                                show_ip_str(arp_msg->ipv4_addr));*/
-            }
-            else
-                ICCPD_LOG_WARN(__FUNCTION__, "Failed to enqueue ARP[ADD] message for %s",
-                                show_ip_str(arp_msg->ipv4_addr));
-
-        }
+        if (mlacp_sync_enqueue_or_journal(csm, MLACP_SYNC_TABLE_ARP, arp_msg, NEIGH_SYNC_ADD) < 0)
+            ICCPD_LOG_WARN(__FUNCTION__, "Failed to enqueue ARP[ADD] message for %s",
+                            show_ip_str(arp_msg->ipv4_addr));
     }
     else
     {
         /* enqueue iccp_msg (delete)*/
-        if (MLACP(csm).current_state == MLACP_STATE_EXCHANGE)
-        {
-            arp_msg->op_type = NEIGH_SYNC_DEL;
-            if (iccp_csm_init_msg(&msg_send, (char*)arp_msg, msg_len) == 0)
-            {
-                TAILQ_INSERT_TAIL(&(MLACP(csm).arp_msg_list), msg_send, tail);
-                /*ICCPD_LOG_DEBUG(__FUNCTION__, "Enqueue ARP[DEL] message for %s",
-                                show_ip_str(arp_msg->ipv4_addr));*/
-            }
-            else
-                ICCPD_LOG_WARN(__FUNCTION__, "Failed to enqueue ARP[DEL] message for %s",
-                                show_ip_str(arp_msg->ipv4_addr));
-
-        }
+        if (mlacp_sync_enqueue_or_journal(csm, MLACP_SYNC_TABLE_ARP, arp_msg, NEIGH_SYNC_DEL) < 0)
+            ICCPD_LOG_WARN(__FUNCTION__, "Failed to enqueue ARP[DEL] message for %s",
+                            show_ip_str(arp_msg->ipv4_addr));
     }
 
     return;
 }
 
-static void do_ndisc_learn_from_kernel(struct ndmsg *ndm, struct rtattr *tb[], int msgtype)
+static void do_ndisc_learn_from_kernel(const struct NeighEvent *ev)
 {
     struct System *sys = NULL;
     struct CSM *csm = NULL;
     struct Msg *msg = NULL;
     struct NDISCMsg *ndisc_msg = NULL, *ndisc_info = NULL;
-    struct VLAN_ID *vlan_id_list = NULL;
-    struct Msg *msg_send = NULL;
+    int ndisc_vid = -1;
 
     char buf[MAX_BUFSIZE];
     size_t msg_len = 0;
@@ -314,8 +292,9 @@ static void do_ndisc_learn_from_kernel(struct ndmsg *ndm, struct rtattr *tb[], i
         return;
 
     /* Find local itf */
-    if (!(ndisc_lif = local_if_find_by_ifindex(ndm->ndm_ifindex)))
+    if (!(ndisc_lif = local_if_find_by_ifindex(ev->ifindex)))
         return;
+    ndisc_vid = local_if_vlan_id(ndisc_lif);
 
     /* create NDISC msg */
     memset(buf, 0, MAX_BUFSIZE);
@@ -323,14 +302,12 @@ static void do_ndisc_learn_from_kernel(struct ndmsg *ndm, struct rtattr *tb[], i
     ndisc_msg = (struct NDISCMsg *)&buf;
     ndisc_msg->op_type = NEIGH_SYNC_LIF;
     sprintf(ndisc_msg->ifname, "%s", ndisc_lif->name);
-    if (tb[NDA_DST])
-        memcpy(&ndisc_msg->ipv6_addr, RTA_DATA(tb[NDA_DST]), RTA_PAYLOAD(tb[NDA_DST]));
-    if (tb[NDA_LLADDR])
-        memcpy(ndisc_msg->mac_addr, RTA_DATA(tb[NDA_LLADDR]), RTA_PAYLOAD(tb[NDA_LLADDR]));
+    memcpy(&ndisc_msg->ipv6_addr, ev->dst, 16);
+    memcpy(ndisc_msg->mac_addr, ev->mac, ETHER_ADDR_LEN);
 
     ICCPD_LOG_NOTICE(__FUNCTION__, "ndisc type %s, state (%04X)(%d), ifindex [%d] (%s), ip %s, mac [%02X:%02X:%02X:%02X:%02X:%02X]",
-                    msgtype == RTM_NEWNEIGH ? "New" : "Del", ndm->ndm_state, fwd_neigh_state_valid(ndm->ndm_state),
-                    ndm->ndm_ifindex, ndisc_lif->name,
+                    ev->msgtype == RTM_NEWNEIGH ? "New" : "Del", ev->state, fwd_neigh_state_valid(ev->state),
+                    ev->ifindex, ndisc_lif->name,
                     show_ipv6_str((char *)ndisc_msg->ipv6_addr),
                     ndisc_msg->mac_addr[0], ndisc_msg->mac_addr[1], ndisc_msg->mac_addr[2], ndisc_msg->mac_addr[3], ndisc_msg->mac_addr[4],
                     ndisc_msg->mac_addr[5]);
@@ -346,22 +323,15 @@ static void do_ndisc_learn_from_kernel(struct ndmsg *ndm, struct rtattr *tb[], i
             if (!local_if_is_l3_mode(lif_po))
             {
                 /* Is the L2 MLAG itf belong to a vlan? */
-                LIST_FOREACH(vlan_id_list, &(lif_po->vlan_list), port_next)
-                {
-                    if (!(vlan_id_list->vlan_itf && vlan_id_list->vlan_itf->ifindex == ndm->ndm_ifindex))
-                        continue;
-                    break;
-                }
-
-                if (!vlan_id_list)
+                if (!local_if_has_vlan(lif_po, ndisc_vid))
                     continue;
 
-                ICCPD_LOG_DEBUG(__FUNCTION__, "ND is from mclag enabled member port of vlan %s", vlan_id_list->vlan_itf->name);
+                ICCPD_LOG_DEBUG(__FUNCTION__, "ND is from mclag enabled member port of vlan %s", ndisc_lif->name);
             }
             else
             {
                 /* Is the ND belong to a L3 mode MLAG itf? */
-                if (ndm->ndm_ifindex != lif_po->ifindex)
+                if (ev->ifindex != lif_po->ifindex)
                     continue;
 
                 ICCPD_LOG_DEBUG(__FUNCTION__, "ND is from mclag enabled intf %s", lif_po->name);
@@ -382,49 +352,55 @@ static void do_ndisc_learn_from_kernel(struct ndmsg *ndm, struct rtattr *tb[], i
         return;
 
     /* update lif ND */
-    TAILQ_FOREACH(msg, &MLACP(csm).ndisc_list, tail)
+    msg = mlacp_ndisc_table_find(csm, ndisc_msg->ipv6_addr);
+    if (msg)
     {
         ndisc_info = (struct NDISCMsg *)msg->buf;
 
-        if (memcmp(&ndisc_info->ipv6_addr, &ndisc_msg->ipv6_addr, 16) != 0)
-            continue;
-
-        if (msgtype == RTM_DELNEIGH)
+        if (ev->msgtype == RTM_DELNEIGH)
         {
             /* delete ND */
-            TAILQ_REMOVE(&MLACP(csm).ndisc_list, msg, tail);
-            free(msg->buf);
-            free(msg);
+            mlacp_ndisc_table_del(csm, msg);
             msg = NULL;
             ICCPD_LOG_DEBUG(__FUNCTION__, "Delete neighbor %s", show_ipv6_str((char *)ndisc_msg->ipv6_addr));
         }
         else
         {
+            /* Kernel has it, a restored entry is confirmed and sent to the peer.
+             * One the peer sent was programmed by us, only the peer confirms it*/
+            if (msg->stale)
+            {
+                if (ndisc_info->op_type == NEIGH_SYNC_ADD)
+                    return;
+
+                msg->stale = 0;
+                neigh_update = 1;
+            }
+
             /* update ND */
-            if (ndisc_info->op_type != ndisc_info->op_type
-                || strcmp(ndisc_info->ifname, ndisc_info->ifname) != 0
-                || memcmp(ndisc_info->mac_addr, ndisc_info->mac_addr, ETHER_ADDR_LEN) != 0)
+            if (ndisc_info->op_type != ndisc_msg->op_type
+                || strcmp(ndisc_info->ifname, ndisc_msg->ifname) != 0
+                || memcmp(ndisc_info->mac_addr, ndisc_msg->mac_addr, ETHER_ADDR_LEN) != 0)
             {
                 neigh_update = 1;
                 ndisc_info->op_type = ndisc_msg->op_type;
-                sprintf(ndisc_info->ifname, "%s", ndisc_msg->ifname);
+                mlacp_ndisc_table_set_ifname(csm, msg, ndisc_msg->ifname);
                 memcpy(ndisc_info->mac_addr, ndisc_msg->mac_addr, ETHER_ADDR_LEN);
                 ICCPD_LOG_DEBUG(__FUNCTION__, "Update neighbor for %s", show_ipv6_str((char *)ndisc_msg->ipv6_addr));
             }
         }
-        break;
     }
 
     if (msg && !neigh_update)
         return;
 
-    if (msgtype != RTM_DELNEIGH)
+    if (ev->msgtype != RTM_DELNEIGH)
     {
         /* enquene lif_msg (add) */
         if (!msg)
         {
             ndisc_msg->op_type = NEIGH_SYNC_LIF;
-            if (iccp_csm_init_msg(&msg, (char *)ndisc_msg, msg_len) == 0)
+            if (iccp_csm_init_pool_msg(&msg, ICCP_POOL_NDISC, (char *)ndisc_msg, msg_len) == 0)
             {
                 mlacp_enqueue_ndisc(csm, msg);
                 /* ICCPD_LOG_DEBUG(__FUNCTION__, "Ndisc-list enqueue: %s, add %s", ndisc_msg->ifname, show_ipv6_str((char *)ndisc_msg->ipv6_addr)); */
@@ -435,34 +411,14 @@ static void do_ndisc_learn_from_kernel(struct ndmsg *ndm, struct rtattr *tb[], i
         }
 
         /* enqueue iccp_msg (add) */
-        if (MLACP(csm).current_state == MLACP_STATE_EXCHANGE)
-        {
-            ndisc_msg->op_type = NEIGH_SYNC_ADD;
-            if (iccp_csm_init_msg(&msg_send, (char *)ndisc_msg, msg_len) == 0)
-            {
-                TAILQ_INSERT_TAIL(&(MLACP(csm).ndisc_msg_list), msg_send, tail);
-                /* ICCPD_LOG_DEBUG(__FUNCTION__, "Enqueue Ndisc[ADD] for %s", show_ipv6_str((char *)ndisc_msg->ipv6_addr)); */
-            }
-            else
-                ICCPD_LOG_DEBUG(__FUNCTION__, "Failed to enqueue Ndisc[ADD] message for %s", show_ipv6_str((char *)ndisc_msg->ipv6_addr));
-
-        }
+        if (mlacp_sync_enqueue_or_journal(csm, MLACP_SYNC_TABLE_NDISC, ndisc_msg, NEIGH_SYNC_ADD) < 0)
+            ICCPD_LOG_DEBUG(__FUNCTION__, "Failed to enqueue Ndisc[ADD] message for %s", show_ipv6_str((char *)ndisc_msg->ipv6_addr));
     }
     else
     {
         /* enqueue iccp_msg (delete) */
-        if (MLACP(csm).current_state == MLACP_STATE_EXCHANGE)
-        {
-            ndisc_msg->op_type = NEIGH_SYNC_DEL;
-            if (iccp_csm_init_msg(&msg_send, (char *)ndisc_msg, msg_len) == 0)
-            {
-                TAILQ_INSERT_TAIL(&(MLACP(csm).ndisc_msg_list), msg_send, tail);
-                /* ICCPD_LOG_DEBUG(__FUNCTION__, "Enqueue Ndisc[DEL] for %s", show_ipv6_str((char *)ndisc_msg->ipv6_addr)); */
-            }
-            else
-                ICCPD_LOG_DEBUG(__FUNCTION__, "Failed to enqueue Ndisc[DEL] message for [%x:%x:%x:%x]", show_ipv6_str((char *)ndisc_msg->ipv6_addr));
-
-        }
+        if (mlacp_sync_enqueue_or_journal(csm, MLACP_SYNC_TABLE_NDISC, ndisc_msg, NEIGH_SYNC_DEL) < 0)
+            ICCPD_LOG_DEBUG(__FUNCTION__, "Failed to enqueue Ndisc[DEL] message for [%x:%x:%x:%x]", show_ipv6_str((char *)ndisc_msg->ipv6_addr));
     }
 
     return;
@@ -498,24 +454,21 @@ void ifm_parse_rtattr(struct rtattr **tb, int max, struct rtattr *rta, int len)
     }
 }
 
-int do_one_neigh_request(struct nlmsghdr *n)
+/* Decode a RTM_NEWNEIGH/RTM_DELNEIGH to a NeighEvent, return 0 if not of interest.
+ * Only parses the msg, can be called out of the main thread*/
+int iccp_neigh_event_decode(struct nlmsghdr *n, struct NeighEvent *ev)
 {
     struct ndmsg *ndm = NLMSG_DATA(n);
     int len = n->nlmsg_len;
     struct rtattr *tb[NDA_MAX + 1] = {0};
 
-    if (n->nlmsg_type == NLMSG_DONE)
-    {
-        return 0;
-    }
-
     /* process msg_type RTM_NEWNEIGH, RTM_GETNEIGH, RTM_DELNEIGH */
     if (n->nlmsg_type != RTM_NEWNEIGH && n->nlmsg_type  != RTM_DELNEIGH )
         return(0);
 
     len -= NLMSG_LENGTH(sizeof(*ndm));
     if (len < 0)
-        return MCLAG_ERROR;
+        return(0);
 
     ifm_parse_rtattr(tb, NDA_MAX, NDA_RTA(ndm), len);
 
@@ -534,34 +487,68 @@ int do_one_neigh_request(struct nlmsghdr *n)
         return(0);
     }
 
-    if (ndm->ndm_family == AF_INET)
-    {
-        do_arp_learn_from_kernel(ndm, tb, n->nlmsg_type);
-    }
+    if (ndm->ndm_family != AF_INET && ndm->ndm_family != AF_INET6)
+        return(0);
 
-    if (ndm->ndm_family == AF_INET6)
+    memset(ev, 0, sizeof(struct NeighEvent));
+    ev->msgtype = n->nlmsg_type;
+    ev->family = ndm->ndm_family;
+    ev->state = ndm->ndm_state;
+    ev->ifindex = ndm->ndm_ifindex;
+    memcpy(ev->dst, RTA_DATA(tb[NDA_DST]),
+           RTA_PAYLOAD(tb[NDA_DST]) < sizeof(ev->dst) ? RTA_PAYLOAD(tb[NDA_DST]) : sizeof(ev->dst));
+    if (tb[NDA_LLADDR])
+        memcpy(ev->mac, RTA_DATA(tb[NDA_LLADDR]),
+               RTA_PAYLOAD(tb[NDA_LLADDR]) < ETHER_ADDR_LEN ? RTA_PAYLOAD(tb[NDA_LLADDR]) : ETHER_ADDR_LEN);
+
+    return 1;
+}
+
+void do_one_neigh_event(const struct NeighEvent *ev)
+{
+    if (ev->family == AF_INET)
+        do_arp_learn_from_kernel(ev);
+    else if (ev->family == AF_INET6)
+        do_ndisc_learn_from_kernel(ev);
+}
+
+int do_one_neigh_request(struct nlmsghdr *n)
+{
+    struct NeighEvent ev;
+
+    if (n->nlmsg_type == NLMSG_DONE)
     {
-        do_ndisc_learn_from_kernel(ndm, tb, n->nlmsg_type);
+        return 0;
     }
+
+    if (iccp_neigh_event_decode(n, &ev))
+        do_one_neigh_event(&ev);
+
     return(0);
 }
 
-static int iccp_neigh_valid_handler(struct nl_msg *msg, void *arg)
+/* A neighbor of a dump, captured so that a replay gets the same table*/
+void iccp_neigh_dump_input(struct nlmsghdr *nlh)
 {
-    struct nlmsghdr *nlh = nlmsg_hdr(msg);
-
+    iccp_capture_write(ICCP_CAPTURE_DUMP, -1, nlh, nlh->nlmsg_len);
     do_one_neigh_request(nlh);
+}
+
+static int iccp_neigh_valid_handler(struct nl_msg *msg, void *arg)
+{
+    iccp_neigh_dump_input(nlmsg_hdr(msg));
 
     return 0;
 }
 
-int iccp_neigh_get_init()
+/* Dump the kernel neighbors of one family, AF_UNSPEC for all*/
+int iccp_neigh_dump(int family)
 {
     struct System *sys = NULL;
     struct nl_cb *cb;
     struct nl_cb *orig_cb;
     struct rtgenmsg rt_hdr = {
-        .rtgen_family   = AF_UNSPEC,
+        .rtgen_family   = family,
     };
     int ret;
     int retry = 1;
@@ -606,6 +593,11 @@ int iccp_neigh_get_init()
     return ret;
 }
 
+int iccp_neigh_get_init()
+{
+    return iccp_neigh_dump(AF_UNSPEC);
+}
+
 /*When received ARP packets from kernel, update arp information*/
 void do_arp_update_from_reply_packet(unsigned int ifindex, unsigned int addr, uint8_t mac_addr[ETHER_ADDR_LEN])
 {
@@ -613,8 +605,7 @@ void do_arp_update_from_reply_packet(unsigned int ifindex, unsigned int addr, ui
     struct CSM *csm = NULL;
     struct Msg *msg = NULL;
     struct ARPMsg *arp_msg = NULL, *arp_info = NULL;
-    struct VLAN_ID *vlan_id_list = NULL;
-    struct Msg *msg_send = NULL;
+    int arp_vid = -1;
 
     char buf[MAX_BUFSIZE];
     size_t msg_len = 0;
@@ -629,6 +620,7 @@ void do_arp_update_from_reply_packet(unsigned int ifindex, unsigned int addr, ui
     /* Find local itf*/
     if (!(arp_lif = local_if_find_by_ifindex(ifindex)))
         return;
+    arp_vid = local_if_vlan_id(arp_lif);
 
     /* create ARP msg*/
     memset(buf, 0, MAX_BUFSIZE);
@@ -656,18 +648,10 @@ void do_arp_update_from_reply_packet(unsigned int ifindex, unsigned int addr, ui
             if (!local_if_is_l3_mode(lif_po))
             {
                 /* Is the L2 MLAG itf belong to a vlan?*/
-                LIST_FOREACH(vlan_id_list, &(lif_po->vlan_list), port_next)
-                {
-                    if ( !(vlan_id_list->vlan_itf
-                           && vlan_id_list->vlan_itf->ifindex == ifindex))
-                        continue;
-                    break;
-                }
-
-                if (!vlan_id_list)
+                if (!local_if_has_vlan(lif_po, arp_vid))
                     continue;
                 ICCPD_LOG_DEBUG(__FUNCTION__, "ARP is from mclag enabled port %s of vlan %s",
-                                              lif_po->name, vlan_id_list->vlan_itf->name);
+                                              lif_po->name, arp_lif->name);
             }
             else
             {
@@ -699,11 +683,12 @@ void do_arp_update_from_reply_packet(unsigned int ifindex, unsigned int addr, ui
     }
 
     /* update lif ARP*/
-    TAILQ_FOREACH(msg, &MLACP(csm).arp_list, tail)
+    msg = mlacp_arp_table_find(csm, arp_msg->ipv4_addr);
+    if (msg)
     {
         arp_info = (struct ARPMsg*)msg->buf;
-        if (arp_info->ipv4_addr != arp_msg->ipv4_addr)
-            continue;
+        /* The host answered, a restored entry is confirmed*/
+        msg->stale = 0;
 
         /* update ARP*/
         if (arp_info->op_type != arp_msg->op_type
@@ -712,20 +697,19 @@ void do_arp_update_from_reply_packet(unsigned int ifindex, unsigned int addr, ui
                       ETHER_ADDR_LEN) != 0)
         {
             arp_info->op_type = arp_msg->op_type;
-            sprintf(arp_info->ifname, "%s", arp_msg->ifname);
+            mlacp_arp_table_set_ifname(csm, msg, arp_msg->ifname);
             memcpy(arp_info->mac_addr, arp_msg->mac_addr, ETHER_ADDR_LEN);
             ICCPD_LOG_NOTICE(__FUNCTION__, "Update ARP for %s by ARP reply, intf %s mac [%02X:%02X:%02X:%02X:%02X:%02X]",
                             show_ip_str(arp_msg->ipv4_addr), arp_msg->ifname,
                             arp_msg->mac_addr[0], arp_msg->mac_addr[1], arp_msg->mac_addr[2], arp_msg->mac_addr[3], arp_msg->mac_addr[4], arp_msg->mac_addr[5]);
         }
-        break;
     }
 
     /* enquene lif_msg (add)*/
     if (!msg)
     {
         arp_msg->op_type = NEIGH_SYNC_LIF;
-        if (iccp_csm_init_msg(&msg, (char*)arp_msg, msg_len) == 0)
+        if (iccp_csm_init_pool_msg(&msg, ICCP_POOL_ARP, (char*)arp_msg, msg_len) == 0)
         {
             mlacp_enqueue_arp(csm, msg);
             /*ICCPD_LOG_DEBUG(__FUNCTION__, "ARP-list enqueue: %s, add %s",
@@ -737,19 +721,9 @@ void do_arp_update_from_reply_packet(unsigned int ifindex, unsigned int addr, ui
     }
 
     /* enqueue iccp_msg (add)*/
-    if (MLACP(csm).current_state == MLACP_STATE_EXCHANGE)
-    {
-        arp_msg->op_type = NEIGH_SYNC_ADD;
-        if (iccp_csm_init_msg(&msg_send, (char*)arp_msg, msg_len) == 0)
-        {
-            TAILQ_INSERT_TAIL(&(MLACP(csm).arp_msg_list), msg_send, tail);
-            /*ICCPD_LOG_DEBUG(__FUNCTION__, "Enqueue ARP[ADD] for %s",
-                            show_ip_str(arp_msg->ipv4_addr));*/
-        }
-        else
-            ICCPD_LOG_WARN(__FUNCTION__, "Failed to enqueue ARP[ADD] message for %s",
-                            show_ip_str(arp_msg->ipv4_addr));
-    }
+    if (mlacp_sync_enqueue_or_journal(csm, MLACP_SYNC_TABLE_ARP, arp_msg, NEIGH_SYNC_ADD) < 0)
+        ICCPD_LOG_WARN(__FUNCTION__, "Failed to enqueue ARP[ADD] message for %s",
+                        show_ip_str(arp_msg->ipv4_addr));
 
     return;
 }
@@ -760,8 +734,7 @@ void do_ndisc_update_from_reply_packet(unsigned int ifindex, char *ipv6_addr, ui
     struct CSM *csm = NULL;
     struct Msg *msg = NULL;
     struct NDISCMsg *ndisc_msg = NULL, *ndisc_info = NULL;
-    struct VLAN_ID *vlan_id_list = NULL;
-    struct Msg *msg_send = NULL;
+    int ndisc_vid = -1;
     char mac_str[18] = "";
     uint8_t null_mac[] = { 0x00, 0x00, 0x00, 0x00, 0x00, 0x00 };
 
@@ -778,6 +751,7 @@ void do_ndisc_update_from_reply_packet(unsigned int ifindex, char *ipv6_addr, ui
     /* Find local itf */
     if (!(ndisc_lif = local_if_find_by_ifindex(ifindex)))
         return;
+    ndisc_vid = local_if_vlan_id(ndisc_lif);
 
     sprintf(mac_str, "%02x:%02x:%02x:%02x:%02x:%02x", mac_addr[0], mac_addr[1], mac_addr[2], mac_addr[3], mac_addr[4], mac_addr[5]);
 
@@ -804,16 +778,9 @@ void do_ndisc_update_from_reply_packet(unsigned int ifindex, char *ipv6_addr, ui
             if (!local_if_is_l3_mode(lif_po))
             {
                 /* Is the L2 MLAG itf belong to a vlan? */
-                LIST_FOREACH(vlan_id_list, &(lif_po->vlan_list), port_next)
-                {
-                    if (!(vlan_id_list->vlan_itf && vlan_id_list->vlan_itf->ifindex == ifindex))
-                        continue;
-                    break;
-                }
-
-                if (!vlan_id_list)
+                if (!local_if_has_vlan(lif_po, ndisc_vid))
                     continue;
-                ICCPD_LOG_DEBUG(__FUNCTION__, "ND is from mclag enabled port %s of vlan %s", lif_po->name, vlan_id_list->vlan_itf->name);
+                ICCPD_LOG_DEBUG(__FUNCTION__, "ND is from mclag enabled port %s of vlan %s", lif_po->name, ndisc_lif->name);
             }
             else
             {
@@ -845,13 +812,11 @@ void do_ndisc_update_from_reply_packet(unsigned int ifindex, char *ipv6_addr, ui
     }
 
     /* update lif ND */
-    TAILQ_FOREACH(msg, &MLACP(csm).ndisc_list, tail)
+    msg = mlacp_ndisc_table_find(csm, ndisc_msg->ipv6_addr);
+    if (msg)
     {
         ndisc_info = (struct NDISCMsg *)msg->buf;
 
-        if (memcmp((char *)ndisc_info->ipv6_addr, (char *)ndisc_msg->ipv6_addr, 16) != 0)
-            continue;
-
         /* If MAC addr is NULL, use the old one */
         if (memcmp(mac_addr, null_mac, ETHER_ADDR_LEN) == 0)
         {
@@ -860,17 +825,19 @@ void do_ndisc_update_from_reply_packet(unsigned int ifindex, char *ipv6_addr, ui
                     ndisc_info->mac_addr[2], ndisc_info->mac_addr[3], ndisc_info->mac_addr[4], ndisc_info->mac_addr[5]);
         }
 
+        /* The host answered, a restored entry is confirmed*/
+        msg->stale = 0;
+
         /* update ND */
         if (ndisc_info->op_type != ndisc_msg->op_type
             || strcmp(ndisc_info->ifname, ndisc_msg->ifname) != 0
             || memcmp(ndisc_info->mac_addr, ndisc_msg->mac_addr, ETHER_ADDR_LEN) != 0)
         {
             ndisc_info->op_type = ndisc_msg->op_type;
-            sprintf(ndisc_info->ifname, "%s", ndisc_msg->ifname);
+            mlacp_ndisc_table_set_ifname(csm, msg, ndisc_msg->ifname);
             memcpy(ndisc_info->mac_addr, ndisc_msg->mac_addr, ETHER_ADDR_LEN);
             ICCPD_LOG_DEBUG(__FUNCTION__, "Update ND for %s", show_ipv6_str((char *)ndisc_msg->ipv6_addr));
         }
-        break;
     }
 
     /* enquene lif_msg (add) */
@@ -883,7 +850,7 @@ void do_ndisc_update_from_reply_packet(unsigned int ifindex, char *ipv6_addr, ui
         }
 
         ndisc_msg->op_type = NEIGH_SYNC_LIF;
-        if (iccp_csm_init_msg(&msg, (char *)ndisc_msg, msg_len) == 0)
+        if (iccp_csm_init_pool_msg(&msg, ICCP_POOL_NDISC, (char *)ndisc_msg, msg_len) == 0)
         {
             mlacp_enqueue_ndisc(csm, msg);
             /* ICCPD_LOG_DEBUG(__FUNCTION__, "NDISC-list enqueue: %s, add %s", ndisc_msg->ifname, show_ipv6_str((char *)ndisc_msg->ipv6_addr)); */
@@ -900,17 +867,8 @@ void do_ndisc_update_from_reply_packet(unsigned int ifindex, char *ipv6_addr, ui
     }
 
     /* enqueue iccp_msg (add) */
-    if (MLACP(csm).current_state == MLACP_STATE_EXCHANGE)
-    {
-        ndisc_msg->op_type = NEIGH_SYNC_ADD;
-        if (iccp_csm_init_msg(&msg_send, (char *)ndisc_msg, msg_len) == 0)
-        {
-            TAILQ_INSERT_TAIL(&(MLACP(csm).ndisc_msg_list), msg_send, tail);
-            /* ICCPD_LOG_DEBUG(__FUNCTION__, "Enqueue ND[ADD] for %s", show_ipv6_str((char *)ndisc_msg->ipv6_addr)); */
-        }
-        else
-            ICCPD_LOG_WARN(__FUNCTION__, "Failed to enqueue ND[ADD] message for %s", show_ipv6_str((char *)ndisc_msg->ipv6_addr));
-    }
+    if (mlacp_sync_enqueue_or_journal(csm, MLACP_SYNC_TABLE_NDISC, ndisc_msg, NEIGH_SYNC_ADD) < 0)
+        ICCPD_LOG_WARN(__FUNCTION__, "Failed to enqueue ND[ADD] message for %s", show_ipv6_str((char *)ndisc_msg->ipv6_addr));
 
     return;
 }
@@ -999,13 +957,12 @@ void iccp_parse_if_vlan_info_from_netlink(struct nlmsghdr *n)
             {
                 struct rtattr *i, *list = tb[IFLA_AF_SPEC];
                 int rem = RTA_PAYLOAD(list);
-                struct VLAN_ID *vlan = NULL;
+                struct VlanBitmap vlans;
+                int range_begin = -1;
+                int vid;
 
-                /*set vlan flag is removed*/
-                LIST_FOREACH(vlan, &(lif->vlan_list), port_next)
-                {
-                    vlan->vlan_removed = 1;
-                }
+                /* Collect the whole vlan table, then apply it at once*/
+                vlan_bitmap_clear_all(&vlans);
 
                 for (i = RTA_DATA(list); RTA_OK(i, rem); i = RTA_NEXT(i, rem))
                 {
@@ -1016,20 +973,25 @@ void iccp_parse_if_vlan_info_from_netlink(struct nlmsghdr *n)
 
                     vinfo = RTA_DATA(i);
 
-                    local_if_add_vlan(lif, vinfo->vid);
-                }
-
-                /*After update vlan list, remove unused item*/
-                LIST_FOREACH(vlan, &(lif->vlan_list), port_next)
-                {
-                    if (vlan->vlan_removed == 1)
+                    /* Compressed dump reports a range as its two ends*/
+                    if (vinfo->flags & BRIDGE_VLAN_INFO_RANGE_BEGIN)
                     {
-                        ICCPD_LOG_DEBUG(__FUNCTION__, "Remove %s from VLAN %d", lif->name, vlan->vid);
+                        range_begin = vinfo->vid;
+                        continue;
+                    }
 
-                        LIST_REMOVE(vlan, port_next);
-                        free(vlan);
+                    if ((vinfo->flags & BRIDGE_VLAN_INFO_RANGE_END) && range_begin >= 0)
+                    {
+                        for (vid = range_begin; vid <= vinfo->vid; vid++)
+                            vlan_bitmap_set(&vlans, vid);
+                        range_begin = -1;
+                        continue;
                     }
+
+                    vlan_bitmap_set(&vlans, vinfo->vid);
                 }
+
+                local_if_set_vlans(lif, &vlans);
             }
         }
 
@@ -0,0 +1,503 @@
+/*
+ *  iccp_ingest.c
+ *  Kernel event ingestion thread, feeds the main thread by a SPSC ring.
+ *
+ * Copyright(c) 2016-2019 Nephos/Estinet.
+ *
+ * This program is free software; you can redistribute it and/or modify it
+ * under the terms and conditions of the GNU General Public License,
+ * version 2, as published by the Free Software Foundation.
+ *
+ * This program is distributed in the hope it will be useful, but WITHOUT
+ * ANY WARRANTY; without even the implied warranty of MERCHANTABILITY or
+ * FITNESS FOR A PARTICULAR PURPOSE.  See the GNU General Public License for
+ * more details.
+ *
+ * You should have received a copy of the GNU General Public License along with
+ * this program; if not, see <http://www.gnu.org/licenses/>.
+ *
+ * The full GNU General Public License is included in this distribution in
+ * the file called "COPYING".
+ *
+ *  Maintainer: jianjun, grace Li from nephos
+ */
+
+#include <errno.h>
+#include <stdio.h>
+#include <stdlib.h>
+#include <string.h>
+#include <unistd.h>
+#include <signal.h>
+#include <pthread.h>
+#include <sys/epoll.h>
+#include <sys/eventfd.h>
+
+#include "../include/system.h"
+#include "../include/logger.h"
+#include "../include/iccp_ifm.h"
+#include "../include/iccp_netlink.h"
+#include "../include/iccp_ingest.h"
+#include "../include/iccp_latency.h"
+#include "../include/iccp_capture.h"
+
+#define ICCP_INGEST_CACHE_LINE      64
+#define ICCP_INGEST_GOLDEN_RATIO    0x9E3779B97F4A7C15ULL
+
+struct IngestDedupEntry
+{
+    uint64_t usec;
+    uint32_t ifindex;
+    uint8_t family;
+    uint8_t dst[16];
+    uint8_t mac[ETHER_ADDR_LEN];
+};
+
+/* The ingestion thread reads the route event socket and the ARP/ND packet
+ * sockets, decodes the msgs and hands them over by the ring. Tables are only
+ * touched by the main thread.
+ * head is written by the thread only, tail by the main thread only.*/
+struct IccpIngest
+{
+    struct IngestEvent* ring;
+    uint32_t size;
+    uint32_t mask;
+    int epoll_fd;
+    int event_fd;   /* ring not empty, polled by the main thread*/
+    int stop_fd;
+    int running;
+    pthread_t thread;
+    uint32_t notified;  /* head at the last wakeup*/
+
+    uint32_t head __attribute__((aligned(ICCP_INGEST_CACHE_LINE)));
+    uint32_t lost;  /* NETLINK_RESYNC_* of the events dropped since the last handler run*/
+    struct IngestStats stats;
+    struct IngestDedupEntry dedup[ICCP_INGEST_DEDUP_SIZE];
+
+    uint32_t tail __attribute__((aligned(ICCP_INGEST_CACHE_LINE)));
+    uint64_t wakeups;
+    uint64_t resyncs;
+};
+
+static struct IccpIngest iccp_ingest = { .epoll_fd = -1, .event_fd = -1, .stop_fd = -1 };
+
+/* Kernel objects to dump again for a dropped event*/
+static uint32_t iccp_ingest_lost_types(struct IngestEvent* ev)
+{
+    switch (ev->type)
+    {
+        case INGEST_EV_NEIGH:
+        case INGEST_EV_ARP_REPLY:
+        case INGEST_EV_NA:
+            return ev->u.neigh.family == AF_INET6 ? NETLINK_RESYNC_NEIGH6 : NETLINK_RESYNC_NEIGH4;
+
+        case INGEST_EV_ROUTE_MSG:
+            if (ev->u.nlh->nlmsg_type == RTM_NEWLINK || ev->u.nlh->nlmsg_type == RTM_DELLINK)
+                return NETLINK_RESYNC_LINK;
+            return NETLINK_RESYNC_ADDR;
+
+        default:
+            return NETLINK_RESYNC_ROUTE;
+    }
+}
+
+int iccp_ingest_push(struct IngestEvent* ev)
+{
+    struct IccpIngest* ingest = &iccp_ingest;
+    uint32_t head = ingest->head;
+    uint32_t depth = head - __atomic_load_n(&ingest->tail, __ATOMIC_ACQUIRE);
+
+    if (depth >= ingest->size)
+    {
+        __atomic_fetch_or(&ingest->lost, iccp_ingest_lost_types(ev), __ATOMIC_RELEASE);
+        if (ev->type == INGEST_EV_ROUTE_MSG)
+            free(ev->u.nlh);
+
+        ingest->stats.dropped++;
+        return MCLAG_ERROR;
+    }
+
+    ev->rx_usec = iccp_latency_now_usec();
+    ingest->ring[head & ingest->mask] = *ev;
+    __atomic_store_n(&ingest->head, head + 1, __ATOMIC_RELEASE);
+
+    ingest->stats.events++;
+    if (ev->type == INGEST_EV_NEIGH)
+        ingest->stats.neigh++;
+    else if (ev->type == INGEST_EV_ROUTE_MSG)
+        ingest->stats.route_msgs++;
+    else if (ev->type == INGEST_EV_ARP_REPLY || ev->type == INGEST_EV_NA)
+        ingest->stats.packets++;
+    if (depth + 1 > ingest->stats.depth_peak)
+        ingest->stats.depth_peak = depth + 1;
+
+    return 0;
+}
+
+/* One wakeup per read round, not per event*/
+static void iccp_ingest_notify(struct IccpIngest* ingest)
+{
+    uint64_t val = 1;
+
+    if (ingest->notified == ingest->head)
+        return;
+
+    ingest->notified = ingest->head;
+    if (write(ingest->event_fd, &val, sizeof(val)) < 0 && errno != EAGAIN)
+        ICCPD_LOG_WARN(__FUNCTION__, "Ingest eventfd write error: %s", strerror(errno));
+}
+
+static void iccp_ingest_read_route(struct System* sys, struct IccpIngest* ingest)
+{
+    struct IngestEvent ev;
+    int ret;
+
+    ret = nl_recvmsgs_default(sys->route_event_sock);
+    if (ret < 0)
+    {
+        /* Socket overrun, the main thread syncs again*/
+        ingest->stats.recv_errors++;
+        memset(&ev, 0, sizeof(ev));
+        ev.type = INGEST_EV_ROUTE_ERR;
+        iccp_ingest_push(&ev);
+        ICCPD_LOG_DEBUG(__FUNCTION__, "fd %d recvmsg error ret = %d  errno = %d ",
+                        nl_socket_get_fd(sys->route_event_sock), ret, errno);
+    }
+}
+
+/* Keyed by the address only, so a new MAC or port of it is never suppressed.
+ * The window is not extended by duplicates, a steady stream still refreshes
+ * the entry once per window*/
+static int iccp_ingest_dedup(struct IccpIngest* ingest, const struct NeighEvent* ev, uint64_t now)
+{
+    struct IngestDedupEntry* entry = NULL;
+    uint32_t addr[4];
+    uint64_t key;
+    int len = (ev->family == AF_INET6) ? 16 : 4;
+
+    memset(addr, 0, sizeof(addr));
+    memcpy(addr, ev->dst, len);
+    key = (((uint64_t)(addr[0] ^ addr[1]) << 32) | (addr[2] ^ addr[3])) ^ ev->family;
+    entry = &ingest->dedup[((key * ICCP_INGEST_GOLDEN_RATIO) >> 40) & (ICCP_INGEST_DEDUP_SIZE - 1)];
+
+    if (entry->family == ev->family
+        && entry->ifindex == ev->ifindex
+        && now - entry->usec < ICCP_INGEST_DEDUP_USEC
+        && memcmp(entry->dst, ev->dst, len) == 0
+        && memcmp(entry->mac, ev->mac, ETHER_ADDR_LEN) == 0)
+        return 1;
+
+    entry->usec = now;
+    entry->family = ev->family;
+    entry->ifindex = ev->ifindex;
+    memcpy(entry->dst, ev->dst, len);
+    memcpy(entry->mac, ev->mac, ETHER_ADDR_LEN);
+
+    return 0;
+}
+
+/* Up to ICCP_INGEST_PKT_BUDGET frames, the rest keeps the fd readable
+ * and is read after the other fds are served*/
+static void iccp_ingest_read_packets(struct System* sys, struct IccpIngest* ingest, uint8_t type)
+{
+    struct NeighEvent evs[ICCP_INGEST_PKT_BATCH];
+    struct IngestEvent ev;
+    uint64_t now;
+    int frames = 0;
+    int n, num, i;
+
+    while (frames < ICCP_INGEST_PKT_BUDGET)
+    {
+        if (type == INGEST_EV_ARP_REPLY)
+            n = iccp_netlink_read_arp_packets(sys, evs, ICCP_INGEST_PKT_BATCH, &num);
+        else
+            n = iccp_netlink_read_ndisc_packets(sys, evs, ICCP_INGEST_PKT_BATCH, &num);
+        if (n <= 0)
+            break;
+
+        frames += n;
+        ingest->stats.pkt_batches++;
+        now = iccp_latency_now_usec();
+
+        for (i = 0; i < num; i++)
+        {
+            if (iccp_ingest_dedup(ingest, &evs[i], now))
+            {
+                ingest->stats.pkt_dups++;
+                continue;
+            }
+
+            memset(&ev, 0, sizeof(ev));
+            ev.type = type;
+            ev.u.neigh = evs[i];
+            iccp_ingest_push(&ev);
+        }
+
+        /* Socket drained*/
+        if (n < ICCP_INGEST_PKT_BATCH)
+            break;
+    }
+
+    ingest->stats.pkt_frames += frames;
+    ingest->stats.pkt_kernel_drops += iccp_netlink_packet_drops(sys);
+}
+
+static void* iccp_ingest_thread(void* arg)
+{
+    struct System* sys = (struct System*)arg;
+    struct IccpIngest* ingest = &iccp_ingest;
+    struct epoll_event events[4];
+    sigset_t mask;
+    int nfds, i, fd;
+    int timeout = -1;
+
+    /* Signals are handled by the main thread*/
+    sigfillset(&mask);
+    pthread_sigmask(SIG_BLOCK, &mask, NULL);
+
+    while (1)
+    {
+        nfds = epoll_wait(ingest->epoll_fd, events, 4, timeout);
+        if (nfds < 0)
+        {
+            if (errno == EINTR)
+                continue;
+
+            ICCPD_LOG_ERR(__FUNCTION__, "Ingest epoll error: %s", strerror(errno));
+            break;
+        }
+
+        for (i = 0; i < nfds; i++)
+        {
+            fd = events[i].data.fd;
+
+            if (fd == ingest->stop_fd)
+                return NULL;
+            else if (fd == nl_socket_get_fd(sys->route_event_sock))
+                iccp_ingest_read_route(sys, ingest);
+            else if (fd == sys->arp_receive_fd)
+                iccp_ingest_read_packets(sys, ingest, INGEST_EV_ARP_REPLY);
+            else if (fd == sys->ndisc_receive_fd)
+                iccp_ingest_read_packets(sys, ingest, INGEST_EV_NA);
+        }
+
+        iccp_ingest_notify(ingest);
+
+        /* Wake up once the window closes to report suppressed logs*/
+        timeout = log_rate_flush() ? LOG_RATE_WINDOW_MSEC : -1;
+    }
+
+    return NULL;
+}
+
+static int iccp_ingest_epoll_add(int efd, int fd)
+{
+    struct epoll_event event;
+
+    memset(&event, 0, sizeof(event));
+    event.data.fd = fd;
+    event.events = EPOLLIN;
+
+    return epoll_ctl(efd, EPOLL_CTL_ADD, fd, &event);
+}
+
+/* Before the main thread event fds are set up*/
+int iccp_ingest_init(struct System* sys)
+{
+    struct IccpIngest* ingest = &iccp_ingest;
+
+    memset(ingest, 0, sizeof(struct IccpIngest));
+    ingest->epoll_fd = -1;
+    ingest->stop_fd = -1;
+    ingest->size = ICCP_INGEST_RING_SIZE;
+    ingest->mask = ICCP_INGEST_RING_SIZE - 1;
+
+    ingest->ring = (struct IngestEvent*)calloc(ingest->size, sizeof(struct IngestEvent));
+    ingest->event_fd = eventfd(0, EFD_NONBLOCK | EFD_CLOEXEC);
+    if (!ingest->ring || ingest->event_fd < 0)
+    {
+        ICCPD_LOG_ERR(__FUNCTION__, "Failed to allocate ingest ring.");
+        goto err;
+    }
+
+    ingest->stop_fd = eventfd(0, EFD_NONBLOCK | EFD_CLOEXEC);
+    ingest->epoll_fd = epoll_create1(EPOLL_CLOEXEC);
+    if (ingest->stop_fd < 0 || ingest->epoll_fd < 0)
+        goto err;
+
+    if (iccp_ingest_epoll_add(ingest->epoll_fd, ingest->stop_fd) < 0
+        || iccp_ingest_epoll_add(ingest->epoll_fd, nl_socket_get_fd(sys->route_event_sock)) < 0
+        || iccp_ingest_epoll_add(ingest->epoll_fd, sys->arp_receive_fd) < 0
+        || iccp_ingest_epoll_add(ingest->epoll_fd, sys->ndisc_receive_fd) < 0)
+    {
+        ICCPD_LOG_ERR(__FUNCTION__, "Failed to add ingest fds: %s", strerror(errno));
+        goto err;
+    }
+
+    return 0;
+
+ err:
+    iccp_ingest_finalize(sys);
+    return MCLAG_ERROR;
+}
+
+/* Kernel sockets are read by the thread from now on*/
+int iccp_ingest_start(struct System* sys)
+{
+    struct IccpIngest* ingest = &iccp_ingest;
+    int err;
+
+    if (ingest->running || ingest->epoll_fd < 0)
+        return MCLAG_ERROR;
+
+    err = pthread_create(&ingest->thread, NULL, iccp_ingest_thread, sys);
+    if (err)
+    {
+        ICCPD_LOG_ERR(__FUNCTION__, "Failed to create ingest thread: %s", strerror(err));
+        return MCLAG_ERROR;
+    }
+
+    ingest->running = 1;
+
+    return 0;
+}
+
+void iccp_ingest_finalize(struct System* sys)
+{
+    struct IccpIngest* ingest = &iccp_ingest;
+    struct IngestEvent* ev = NULL;
+    uint64_t val = 1;
+
+    if (ingest->running)
+    {
+        if (write(ingest->stop_fd, &val, sizeof(val)) < 0)
+            pthread_cancel(ingest->thread);
+        pthread_join(ingest->thread, NULL);
+        ingest->running = 0;
+    }
+
+    if (ingest->ring)
+    {
+        for (; ingest->tail != ingest->head; ingest->tail++)
+        {
+            ev = &ingest->ring[ingest->tail & ingest->mask];
+            if (ev->type == INGEST_EV_ROUTE_MSG)
+                free(ev->u.nlh);
+        }
+
+        free(ingest->ring);
+        ingest->ring = NULL;
+    }
+
+    if (ingest->epoll_fd >= 0)
+        close(ingest->epoll_fd);
+    if (ingest->stop_fd >= 0)
+        close(ingest->stop_fd);
+    if (ingest->event_fd >= 0)
+        close(ingest->event_fd);
+
+    ingest->epoll_fd = -1;
+    ingest->stop_fd = -1;
+    ingest->event_fd = -1;
+
+    return;
+}
+
+void iccp_ingest_get_stats(struct IngestStats* stats)
+{
+    struct IccpIngest* ingest = &iccp_ingest;
+
+    /* Written by the thread, a torn read only skews the dump*/
+    *stats = ingest->stats;
+    stats->wakeups = ingest->wakeups;
+    stats->resyncs = ingest->resyncs;
+    stats->depth = __atomic_load_n(&ingest->head, __ATOMIC_RELAXED) - ingest->tail;
+}
+
+int iccp_ingest_get_fd(struct System* sys)
+{
+    return iccp_ingest.event_fd;
+}
+
+/* Also called for the events read from a capture file*/
+void iccp_ingest_dispatch(struct System* sys, struct IngestEvent* ev)
+{
+    uint32_t addr;
+
+    iccp_capture_ingest(ev);
+    iccp_latency_begin(ICCP_LAT_CTX_KERNEL, ev->rx_usec);
+
+    switch (ev->type)
+    {
+        case INGEST_EV_NEIGH:
+            do_one_neigh_event(&ev->u.neigh);
+            break;
+
+        case INGEST_EV_ARP_REPLY:
+            memcpy(&addr, ev->u.neigh.dst, 4);
+            do_arp_update_from_reply_packet(ev->u.neigh.ifindex, addr, ev->u.neigh.mac);
+            break;
+
+        case INGEST_EV_NA:
+            do_ndisc_update_from_reply_packet(ev->u.neigh.ifindex, (char *)ev->u.neigh.dst, ev->u.neigh.mac);
+            break;
+
+        case INGEST_EV_ROUTE_MSG:
+            iccp_netlink_route_event_input(ev->u.nlh);
+            free(ev->u.nlh);
+            ev->u.nlh = NULL;
+            break;
+
+        case INGEST_EV_ROUTE_ERR:
+            /* No telling which objects were lost*/
+            sys->netlink_resync_stats.route_losses++;
+            iccp_ingest.resyncs++;
+            iccp_netlink_resync_mark(sys, NETLINK_RESYNC_ROUTE);
+            break;
+
+        default:
+            break;
+    }
+
+    iccp_latency_end();
+}
+
+int iccp_ingest_handler(struct System* sys)
+{
+    struct IccpIngest* ingest = &iccp_ingest;
+    uint32_t head, tail;
+    uint32_t lost;
+    uint64_t val;
+    int budget = ICCP_INGEST_RX_BUDGET;
+
+    if (read(ingest->event_fd, &val, sizeof(val)) < 0 && errno != EAGAIN)
+        return MCLAG_ERROR;
+
+    ingest->wakeups++;
+    tail = ingest->tail;
+    head = __atomic_load_n(&ingest->head, __ATOMIC_ACQUIRE);
+
+    while (tail != head && budget-- > 0)
+    {
+        iccp_ingest_dispatch(sys, &ingest->ring[tail & ingest->mask]);
+        __atomic_store_n(&ingest->tail, ++tail, __ATOMIC_RELEASE);
+    }
+
+    /* Leave the rest for the next loop, keep the fd readable*/
+    if (tail != head)
+    {
+        val = 1;
+        if (write(ingest->event_fd, &val, sizeof(val)) < 0 && errno != EAGAIN)
+            ICCPD_LOG_WARN(__FUNCTION__, "Ingest eventfd write error: %s", strerror(errno));
+    }
+
+    lost = __atomic_exchange_n(&ingest->lost, 0, __ATOMIC_ACQ_REL);
+    if (lost)
+    {
+        ICCPD_LOG_WARN(__FUNCTION__, "Ingest ring overflow, resync type 0x%x", lost);
+        sys->netlink_resync_stats.ring_losses++;
+        ingest->resyncs++;
+        iccp_netlink_resync_mark(sys, lost);
+    }
+
+    return 0;
+}
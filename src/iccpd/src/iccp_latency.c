@@ -0,0 +1,223 @@
+/*
+ *  iccp_latency.c
+ *  Latency tracing of the MAC/ARP/ND sync pipeline.
+ *
+ * Copyright(c) 2016-2019 Nephos/Estinet.
+ *
+ * This program is free software; you can redistribute it and/or modify it
+ * under the terms and conditions of the GNU General Public License,
+ * version 2, as published by the Free Software Foundation.
+ *
+ * This program is distributed in the hope it will be useful, but WITHOUT
+ * ANY WARRANTY; without even the implied warranty of MERCHANTABILITY or
+ * FITNESS FOR A PARTICULAR PURPOSE.  See the GNU General Public License for
+ * more details.
+ *
+ * You should have received a copy of the GNU General Public License along with
+ * this program; if not, see <http://www.gnu.org/licenses/>.
+ *
+ * The full GNU General Public License is included in this distribution in
+ * the file called "COPYING".
+ *
+ *  Maintainer: jianjun, grace Li from nephos
+ */
+
+#include <string.h>
+#include <time.h>
+#include <arpa/inet.h>
+
+#include "../include/msg_format.h"
+#include "../include/iccp_latency.h"
+
+/* mLACP TLV types are folded after the ICC ones*/
+#define ICCP_LAT_TLV_ICC_MAX        0x0040
+#define ICCP_LAT_TLV_MLACP_BASE     0x1030
+
+struct IccpLatency
+{
+    int ctx;
+    uint64_t origin_usec;
+    struct IccpLatencyStats stats;
+};
+
+static struct IccpLatency iccp_latency;
+
+/* Stage of each point, -1 if the point is not traced in the context*/
+static const int8_t iccp_latency_stage_map[ICCP_LAT_CTX_MAX][ICCP_LAT_POINT_MAX] =
+{
+    [ICCP_LAT_CTX_NONE]   = { -1, -1, -1 },
+    [ICCP_LAT_CTX_SYNCD]  = { ICCP_LAT_STAGE_SYNCD_TO_TABLE, ICCP_LAT_STAGE_SYNCD_TO_ENQUEUE, -1 },
+    [ICCP_LAT_CTX_PEER]   = { ICCP_LAT_STAGE_PEER_TO_TABLE, -1, ICCP_LAT_STAGE_PEER_TO_PROGRAM },
+    [ICCP_LAT_CTX_KERNEL] = { ICCP_LAT_STAGE_KERNEL_TO_TABLE, ICCP_LAT_STAGE_KERNEL_TO_ENQUEUE, -1 },
+};
+
+static const char* iccp_latency_stage_str[ICCP_LAT_STAGE_MAX] =
+{
+    [ICCP_LAT_STAGE_SYNCD_TO_TABLE]     = "syncd rx -> table",
+    [ICCP_LAT_STAGE_SYNCD_TO_ENQUEUE]   = "syncd rx -> enqueue",
+    [ICCP_LAT_STAGE_PEER_TO_FSM]        = "peer rx -> fsm",
+    [ICCP_LAT_STAGE_PEER_TO_TABLE]      = "peer rx -> table",
+    [ICCP_LAT_STAGE_PEER_TO_PROGRAM]    = "peer rx -> program",
+    [ICCP_LAT_STAGE_KERNEL_TO_TABLE]    = "kernel rx -> table",
+    [ICCP_LAT_STAGE_KERNEL_TO_ENQUEUE]  = "kernel rx -> enqueue",
+    [ICCP_LAT_STAGE_LOCAL_TO_SEND]      = "local rx -> peer send",
+    [ICCP_LAT_STAGE_PO_DOWN_TO_REDIRECT] = "po down -> redirect",
+};
+
+uint64_t iccp_latency_now_usec()
+{
+    struct timespec now;
+
+    clock_gettime(CLOCK_MONOTONIC, &now);
+
+    return (uint64_t)now.tv_sec * 1000000 + now.tv_nsec / 1000;
+}
+
+/* Entries handled until iccp_latency_end() are traced from origin_usec*/
+void iccp_latency_begin(int ctx, uint64_t origin_usec)
+{
+    if (ctx <= ICCP_LAT_CTX_NONE || ctx >= ICCP_LAT_CTX_MAX || origin_usec == 0)
+    {
+        iccp_latency_end();
+        return;
+    }
+
+    iccp_latency.ctx = ctx;
+    iccp_latency.origin_usec = origin_usec;
+}
+
+void iccp_latency_end()
+{
+    iccp_latency.ctx = ICCP_LAT_CTX_NONE;
+    iccp_latency.origin_usec = 0;
+}
+
+uint64_t iccp_latency_origin()
+{
+    return iccp_latency.origin_usec;
+}
+
+void iccp_latency_record(int stage, uint64_t origin_usec)
+{
+    struct IccpLatencyStage* st = NULL;
+    uint64_t now, usec;
+    uint64_t limit = 10;
+    int i;
+
+    if (origin_usec == 0 || stage < 0 || stage >= ICCP_LAT_STAGE_MAX)
+        return;
+
+    now = iccp_latency_now_usec();
+    usec = now > origin_usec ? now - origin_usec : 0;
+
+    st = &iccp_latency.stats.stages[stage];
+    st->count++;
+    st->sum_usec += usec;
+    if (usec > st->max_usec)
+        st->max_usec = usec;
+
+    for (i = 0; i < ICCP_LAT_BUCKETS - 1; i++, limit *= 10)
+    {
+        if (usec < limit)
+            break;
+    }
+    st->hist[i]++;
+
+    return;
+}
+
+uint64_t iccp_latency_mark(int point)
+{
+    int stage;
+
+    if (iccp_latency.ctx == ICCP_LAT_CTX_NONE || point < 0 || point >= ICCP_LAT_POINT_MAX)
+        return 0;
+
+    stage = iccp_latency_stage_map[iccp_latency.ctx][point];
+    if (stage < 0)
+        return 0;
+
+    iccp_latency_record(stage, iccp_latency.origin_usec);
+
+    return iccp_latency.origin_usec;
+}
+
+static int iccp_latency_tlv_slot(uint16_t type)
+{
+    if (type < ICCP_LAT_TLV_ICC_MAX)
+        return type;
+
+    if (type >= ICCP_LAT_TLV_MLACP_BASE
+        && type < ICCP_LAT_TLV_MLACP_BASE + ICCP_LAT_TLV_SLOTS - ICCP_LAT_TLV_ICC_MAX)
+        return ICCP_LAT_TLV_ICC_MAX + type - ICCP_LAT_TLV_MLACP_BASE;
+
+    return -1;
+}
+
+int iccp_latency_tlv_type(int slot)
+{
+    if (slot < ICCP_LAT_TLV_ICC_MAX)
+        return slot;
+
+    return ICCP_LAT_TLV_MLACP_BASE + slot - ICCP_LAT_TLV_ICC_MAX;
+}
+
+void iccp_latency_count_msg(int dir, const char* buf, int len)
+{
+    const LDPHdr* ldp_hdr = (const LDPHdr*)buf;
+    const ICCParameter* param = NULL;
+    int offset;
+    int slot;
+
+    if (buf == NULL || len < (int)sizeof(LDPHdr))
+        return;
+
+    if (ntohs(ldp_hdr->msg_type) == MSG_T_CAPABILITY)
+        offset = sizeof(LDPHdr);
+    else
+        offset = sizeof(ICCHdr);
+
+    if (len < offset + (int)sizeof(ICCParameter))
+        return;
+
+    param = (const ICCParameter*)&buf[offset];
+    slot = iccp_latency_tlv_slot(ntohs(param->type));
+
+    if (dir == ICCP_LAT_TX)
+    {
+        if (slot < 0)
+            iccp_latency.stats.tlv_other_tx++;
+        else
+            iccp_latency.stats.tlv_tx[slot]++;
+    }
+    else
+    {
+        if (slot < 0)
+            iccp_latency.stats.tlv_other_rx++;
+        else
+            iccp_latency.stats.tlv_rx[slot]++;
+    }
+
+    return;
+}
+
+const char* iccp_latency_stage_name(int stage)
+{
+    if (stage < 0 || stage >= ICCP_LAT_STAGE_MAX)
+        return "unknown";
+
+    return iccp_latency_stage_str[stage];
+}
+
+const struct IccpLatencyStats* iccp_latency_get_stats()
+{
+    return &iccp_latency.stats;
+}
+
+void iccp_latency_reset()
+{
+    memset(&iccp_latency.stats, 0, sizeof(struct IccpLatencyStats));
+    iccp_latency.stats.since_sec = iccp_latency_now_usec() / 1000000;
+
+    return;
+}
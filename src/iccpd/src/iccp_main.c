@@ -32,6 +32,8 @@
 #include "../include/logger.h"
 #include "../include/scheduler.h"
 #include "../include/system.h"
+#include "../include/iccp_timer.h"
+#include "../include/iccp_netlink.h"
 
 int check_instance(char* pid_file_path)
 {
@@ -226,12 +228,16 @@ int main(int argc, char* argv[])
         return MCLAG_ERROR;
     }
 
-    pid_file_fd = check_instance(parser.pid_file_path);
-    if (pid_file_fd < 0)
+    /*A replay can run beside the live daemon*/
+    if (parser.replay_file_path == NULL)
     {
-        fprintf(stderr, "Check instance with invalidate arguments, iccpd is terminated.\n");
-        parser.finalize(&parser);
-        exit(EXIT_FAILURE);
+        pid_file_fd = check_instance(parser.pid_file_path);
+        if (pid_file_fd < 0)
+        {
+            fprintf(stderr, "Check instance with invalidate arguments, iccpd is terminated.\n");
+            parser.finalize(&parser);
+            exit(EXIT_FAILURE);
+        }
     }
 
     sys = system_get_instance();
@@ -257,8 +263,26 @@ int main(int argc, char* argv[])
     sys->cmd_file_path = strdup(parser.cmd_file_path);
     sys->config_file_path = strdup(parser.config_file_path);
     sys->mclagdctl_file_path = strdup(parser.mclagdctl_file_path);
+    if (sys->checkpoint_file_path != NULL)
+        free(sys->checkpoint_file_path);
+    sys->checkpoint_file_path = strdup(parser.checkpoint_file_path);
+    if (parser.capture_file_path != NULL)
+        sys->capture_file_path = strdup(parser.capture_file_path);
+    if (parser.replay_file_path != NULL)
+        sys->replay_file_path = strdup(parser.replay_file_path);
+    sys->replay_speed = parser.replay_speed;
     sys->pid_file_fd = pid_file_fd;
     sys->telnet_port = parser.telnet_port;
+    sys->fdb_bulk_redirect = parser.fdb_bulk_redirect;
+    iccp_timer_set_tick(parser.timer_tick_msec);
+    if (system_init_sockets(sys) < 0)
+    {
+        fprintf(stderr, "Can't set up the event fds, iccpd is terminated.\n");
+        parser.finalize(&parser);
+        exit(EXIT_FAILURE);
+    }
+    if (parser.netlink_rcvbuf_kb && sys->replay_file_path == NULL)
+        iccp_netlink_set_event_rcvbuf(sys, parser.netlink_rcvbuf_kb * 1024);
     parser.finalize(&parser);
     iccpd_signal_init(sys);
     ICCPD_LOG_INFO(__FUNCTION__, "Iccpd is started, process id = %d.  uid  %d ", getpid(), getuid());
@@ -21,11 +21,18 @@
  *  Maintainer: jianjun, grace Li from nephos
  */
 
+/* recvmmsg*/
+#define _GNU_SOURCE
+
 #include <stdio.h>
 #include <stdbool.h>
 #include <unistd.h>
 #include <stdlib.h>
 
+#include <errno.h>
+#include <poll.h>
+#include <time.h>
+
 #include <sys/epoll.h>
 #include <sys/types.h>
 #include <sys/socket.h>
@@ -44,6 +51,7 @@
 #include <linux/if_ether.h>
 #include <linux/if_arp.h>
 #include <linux/if_team.h>
+#include <linux/if_packet.h>
 #include <linux/types.h>
 #include <linux/socket.h>
 #include <linux/in6.h>
@@ -57,6 +65,31 @@
 #include "../include/mlacp_link_handler.h"
 #include "../include/msg_format.h"
 #include "../include/iccp_netlink.h"
+#include "../include/iccp_timer.h"
+#include "../include/iccp_ingest.h"
+#include "../include/iccp_latency.h"
+#include "../include/iccp_capture.h"
+
+/* Wait for a loss burst to pass before dumping, at most MAX_DELAY*/
+#define NETLINK_RESYNC_HOLDOFF_MSEC     200
+#define NETLINK_RESYNC_MAX_DELAY_MSEC   2000
+/* Gap between two dump steps*/
+#define NETLINK_RESYNC_STEP_MSEC        50
+/* Port-channels whose members are dumped in one step*/
+#define NETLINK_RESYNC_TEAM_BATCH       8
+/* Neighbors read from a dump in one step, the rest is left in the socket*/
+#define NETLINK_RESYNC_NEIGH_BATCH      2048
+
+struct IccpNetlinkResync
+{
+    struct iccp_timer timer;
+    uint64_t first_usec;    /* first loss since the last step, 0 if none*/
+    int team_cursor;        /* ifindex of the last port-channel dumped*/
+    int neigh_family;       /* of the neighbor dump being read, AF_UNSPEC if none*/
+    uint32_t neigh_seq;
+};
+
+static struct IccpNetlinkResync iccp_netlink_resync;
 
 /**
  * SECTION: Netlink helpers
@@ -166,6 +199,7 @@ int iccp_get_portchannel_member_list_handler(struct nl_msg *msg, void * arg)
     if (sys == NULL)
         return 0;
 
+    iccp_capture_write(ICCP_CAPTURE_TEAM, -1, nlh, nlh->nlmsg_len);
     genlmsg_parse(nlh, 0, attrs, TEAM_ATTR_MAX, NULL);
 
     if (attrs[TEAM_ATTR_TEAM_IFINDEX])
@@ -388,6 +422,10 @@ int iccp_get_port_member_list(struct LocalInterface* lif)
     if (sys == NULL)
         return 0;
 
+    /*On replay the captured team msgs are fed instead*/
+    if (sys->genric_sock == NULL)
+        return 0;
+
     msg = nlmsg_alloc();
     if (!msg)
         return -ENOMEM;
@@ -423,6 +461,10 @@ int iccp_netlink_if_hwaddr_set(uint32_t ifindex, uint8_t *addr, unsigned int add
     if (!(sys = system_get_instance()))
         return MCLAG_ERROR;
 
+    /*Nothing is programmed on replay*/
+    if (sys->route_sock == NULL)
+        return 0;
+
     link = rtnl_link_alloc();
     if (!link)
         return -ENOMEM;
@@ -496,8 +538,7 @@ void iccp_set_interface_ipadd_mac(struct LocalInterface *lif, char * mac_addr )
     msg_hdr->len += sub_msg->op_len;
 
     /*send msg*/
-    if (sys->sync_fd)
-        write(sys->sync_fd, msg_buf, msg_hdr->len);
+    iccp_syncd_send(sys, msg_buf, msg_hdr->len);
 
     return;
 }
@@ -511,6 +552,10 @@ int iccp_netlink_if_startup_set(uint32_t ifindex)
     if (!(sys = system_get_instance()))
         return MCLAG_ERROR;
 
+    /*Nothing is programmed on replay*/
+    if (sys->route_sock == NULL)
+        return 0;
+
     link = rtnl_link_alloc();
     if (!link)
         return -ENOMEM;
@@ -534,6 +579,10 @@ int iccp_netlink_if_shutdown_set(uint32_t ifindex)
     if (!(sys = system_get_instance()))
         return MCLAG_ERROR;
 
+    /*Nothing is programmed on replay*/
+    if (sys->route_sock == NULL)
+        return 0;
+
     link = rtnl_link_alloc();
     if (!link)
         return -ENOMEM;
@@ -716,20 +765,370 @@ void recover_if_ipmac_on_standby(struct LocalInterface* lif_po)
     return;
 }
 
+/*****************************************
+* Kernel neighbor programming
+*
+* ARP/ND add/del requests are appended to a batch buffer, each batch is
+* sent by a single sendto. Batches the socket does not take are kept in
+* order and sent on EPOLLOUT, the request path never waits. The kernel
+* acks each request on neigh_sock. Requests are kept by sequence until
+* acked, so failures are logged with the entry they belong to. Requests
+* that can not be sent or acked mark the neighbor table for a resync.
+*
+* ***************************************/
+static const char *iccp_neigh_str(int family, uint8_t *addr)
+{
+    return (family == AF_INET) ? show_ip_str(*((int *)addr)) : show_ipv6_str((char *)addr);
+}
+
+static uint32_t iccp_neigh_elapsed_usec(struct timespec *start)
+{
+    struct timespec now;
+    int64_t usec;
+
+    clock_gettime(CLOCK_MONOTONIC, &now);
+    usec = (int64_t)(now.tv_sec - start->tv_sec) * 1000000 + (now.tv_nsec - start->tv_nsec) / 1000;
+
+    return usec < 0 ? 0 : (uint32_t)usec;
+}
+
+/* The kernel table may not have what iccpd requested, dump it again*/
+static void iccp_neigh_resync(struct System *sys, int family)
+{
+    sys->neigh_stats.resyncs++;
+    iccp_netlink_resync_mark(sys, (family == AF_INET) ? NETLINK_RESYNC_NEIGH4 : NETLINK_RESYNC_NEIGH6);
+
+    return;
+}
+
+static void iccp_neigh_set_pollout(struct System *sys, int enable)
+{
+    struct epoll_event event;
+
+    if (sys->neigh_tx_pollout == enable || sys->epoll_fd <= 0)
+        return;
+
+    event.data.fd = nl_socket_get_fd(sys->neigh_sock);
+    event.events = enable ? (EPOLLIN | EPOLLOUT) : EPOLLIN;
+    if (epoll_ctl(sys->epoll_fd, EPOLL_CTL_MOD, event.data.fd, &event) == 0)
+        sys->neigh_tx_pollout = enable;
+
+    return;
+}
+
+static void iccp_neigh_batch_done(struct System *sys, struct NeighBatch *batch)
+{
+    uint32_t usec;
+    uint32_t limit = 100;
+    int i;
+
+    usec = iccp_neigh_elapsed_usec(&batch->sent);
+    if (usec > sys->neigh_stats.latency_max_usec)
+        sys->neigh_stats.latency_max_usec = usec;
+
+    for (i = 0; i < NEIGH_LATENCY_BUCKETS - 1; i++, limit *= 10)
+    {
+        if (usec < limit)
+            break;
+    }
+    sys->neigh_stats.latency_hist[i]++;
+    batch->msgs = 0;
+
+    return;
+}
+
+static void iccp_neigh_ack(struct System *sys, uint32_t seq, int error)
+{
+    struct NeighPending *pending = NULL;
+    struct NeighBatch *batch = NULL;
+
+    pending = &sys->neigh_pending[seq & (NEIGH_PENDING_MAX - 1)];
+    if (!pending->in_use || pending->seq != seq)
+        return;
+
+    sys->neigh_stats.acks++;
+    pending->error = error;
+    if (error)
+    {
+        sys->neigh_stats.failures++;
+        ICCPD_LOG_WARN(__FUNCTION__, "%s %s (ip:%s, mac:%02x:%02x:%02x:%02x:%02x:%02x, intf:%s) error, err = %d",
+                       pending->add ? "Add" : "Del", (pending->family == AF_INET) ? "ARP" : "ND",
+                       iccp_neigh_str(pending->family, pending->addr),
+                       pending->mac[0], pending->mac[1], pending->mac[2], pending->mac[3], pending->mac[4], pending->mac[5],
+                       pending->ifname, error);
+    }
+
+    batch = &sys->neigh_batch[pending->batch & (NEIGH_BATCH_RING_SIZE - 1)];
+    if (batch->msgs && batch->last_seq == seq)
+        iccp_neigh_batch_done(sys, batch);
+
+    pending->in_use = 0;
+    sys->neigh_pending_num--;
+
+    return;
+}
+
+/* The ack of a request is lost, its result is unknown*/
+static void iccp_neigh_lost(struct System *sys, struct NeighPending *pending)
+{
+    pending->in_use = 0;
+    sys->neigh_pending_num--;
+    sys->neigh_stats.lost_acks++;
+    iccp_neigh_resync(sys, pending->family);
+
+    return;
+}
+
+/* The acks of the requests in flight are lost, e.g. on ENOBUFS. The
+ * requests not sent yet keep their slots*/
+static void iccp_neigh_drop_pending(struct System *sys)
+{
+    int i;
+
+    for (i = 0; i < NEIGH_PENDING_MAX; i++)
+    {
+        if (!sys->neigh_pending[i].in_use || !sys->neigh_pending[i].sent)
+            continue;
+        iccp_neigh_lost(sys, &sys->neigh_pending[i]);
+    }
+
+    for (i = 0; i < NEIGH_BATCH_RING_SIZE; i++)
+        sys->neigh_batch[i].msgs = 0;
+
+    return;
+}
+
+/* Kernel refused a batch, its requests are not applied*/
+static void iccp_neigh_drop_batch(struct System *sys, struct Msg *msg)
+{
+    struct NeighPending *pending = NULL;
+    struct nlmsghdr *nlh = NULL;
+    int len = msg->len;
+
+    for (nlh = (struct nlmsghdr *)msg->buf; NLMSG_OK(nlh, len); nlh = NLMSG_NEXT(nlh, len))
+    {
+        pending = &sys->neigh_pending[nlh->nlmsg_seq & (NEIGH_PENDING_MAX - 1)];
+        if (!pending->in_use || pending->seq != nlh->nlmsg_seq)
+            continue;
+        pending->in_use = 0;
+        sys->neigh_pending_num--;
+        sys->neigh_stats.dropped++;
+        iccp_neigh_resync(sys, pending->family);
+    }
+
+    return;
+}
+
+/* Slot of the next sequence is free, or its ack is overdue and taken as lost*/
+static int iccp_neigh_slot_free(struct System *sys, struct NeighPending *pending)
+{
+    if (!pending->in_use)
+        return 1;
+
+    if (!pending->sent || iccp_neigh_elapsed_usec(&pending->sent_time) < NEIGH_ACK_WAIT_MSEC * 1000)
+        return 0;
+
+    ICCPD_LOG_WARN(__FUNCTION__, "No ack for %s %s (ip:%s, intf:%s) in %d ms",
+                   pending->add ? "add" : "del", (pending->family == AF_INET) ? "ARP" : "ND",
+                   iccp_neigh_str(pending->family, pending->addr), pending->ifname, NEIGH_ACK_WAIT_MSEC);
+    iccp_neigh_lost(sys, pending);
+
+    return 1;
+}
+
+static int iccp_get_netlink_neigh_sock_fd(struct System *sys)
+{
+    if (sys->neigh_sock == NULL)
+        return -1;
+
+    return nl_socket_get_fd(sys->neigh_sock);
+}
+
+/* Read the acks of neighbor requests*/
+static int iccp_neigh_read_acks(struct System *sys)
+{
+    char buf[16384];
+    struct nlmsghdr *nlh = NULL;
+    struct nlmsgerr *nl_err = NULL;
+    int len;
+
+    while (1)
+    {
+        len = recv(nl_socket_get_fd(sys->neigh_sock), buf, sizeof(buf), MSG_DONTWAIT);
+        if (len < 0)
+        {
+            if (errno == EINTR)
+                continue;
+            if (errno == EAGAIN || errno == EWOULDBLOCK)
+                break;
+            if (errno == ENOBUFS)
+            {
+                ICCPD_LOG_WARN(__FUNCTION__, "Neighbor ack overflow, %u requests unconfirmed", sys->neigh_pending_num);
+                iccp_neigh_drop_pending(sys);
+                continue;
+            }
+            return MCLAG_ERROR;
+        }
+
+        for (nlh = (struct nlmsghdr *)buf; NLMSG_OK(nlh, len); nlh = NLMSG_NEXT(nlh, len))
+        {
+            if (nlh->nlmsg_type != NLMSG_ERROR)
+                continue;
+
+            nl_err = (struct nlmsgerr *)NLMSG_DATA(nlh);
+            iccp_neigh_ack(sys, nlh->nlmsg_seq, nl_err->error);
+        }
+    }
+
+    return 0;
+}
+
+/* Read the acks, then send what is queued*/
+static int iccp_netlink_neigh_sock_handler(struct System *sys)
+{
+    if (iccp_neigh_read_acks(sys) < 0)
+        return MCLAG_ERROR;
+
+    /* Also the EPOLLOUT of a busy socket*/
+    return iccp_netlink_neigh_flush(sys);
+}
+
+/* A batch is taken by the kernel, its acks are expected from now on*/
+static void iccp_neigh_batch_sent(struct System *sys, struct Msg *msg)
+{
+    struct NeighBatch *batch = NULL;
+    struct NeighPending *pending = NULL;
+    struct nlmsghdr *nlh = NULL;
+    int len = msg->len;
+
+    batch = &sys->neigh_batch[sys->neigh_batch_id & (NEIGH_BATCH_RING_SIZE - 1)];
+    batch->msgs = 0;
+    clock_gettime(CLOCK_MONOTONIC, &batch->sent);
+
+    for (nlh = (struct nlmsghdr *)msg->buf; NLMSG_OK(nlh, len); nlh = NLMSG_NEXT(nlh, len))
+    {
+        batch->last_seq = nlh->nlmsg_seq;
+        batch->msgs++;
+
+        pending = &sys->neigh_pending[nlh->nlmsg_seq & (NEIGH_PENDING_MAX - 1)];
+        if (!pending->in_use || pending->seq != nlh->nlmsg_seq)
+            continue;
+        pending->batch = sys->neigh_batch_id;
+        pending->sent = 1;
+        pending->sent_time = batch->sent;
+    }
+
+    sys->neigh_stats.batches++;
+    sys->neigh_stats.bytes += msg->len;
+    sys->neigh_batch_id++;
+
+    return;
+}
+
+/* Send the queued batches in order. A busy socket keeps them queued
+ * and they are sent on EPOLLOUT*/
+int iccp_netlink_neigh_flush(struct System *sys)
+{
+    struct sockaddr_nl nladdr;
+    struct Msg *msg = NULL;
+    int n;
+
+    if (!sys->neigh_sock)
+        return 0;
+
+    memset(&nladdr, 0, sizeof(nladdr));
+    nladdr.nl_family = AF_NETLINK;
+
+    while ((msg = TAILQ_FIRST(&(sys->neigh_tx_list))) != NULL)
+    {
+        do
+        {
+            n = sendto(nl_socket_get_fd(sys->neigh_sock), msg->buf, msg->len, MSG_DONTWAIT,
+                       (struct sockaddr *)&nladdr, sizeof(nladdr));
+        } while (n < 0 && errno == EINTR);
+
+        if (n < 0 && (errno == EAGAIN || errno == EWOULDBLOCK || errno == ENOBUFS))
+        {
+            sys->neigh_stats.eagain++;
+            iccp_neigh_set_pollout(sys, 1);
+            return 0;
+        }
+
+        if (n < 0)
+        {
+            ICCPD_LOG_WARN(__FUNCTION__, "Send neighbor requests error, errno = %d, resync the table", errno);
+            iccp_neigh_drop_batch(sys, msg);
+        }
+        else
+        {
+            iccp_neigh_batch_sent(sys, msg);
+        }
+
+        TAILQ_REMOVE(&(sys->neigh_tx_list), msg, tail);
+        iccp_csm_free_msg(msg);
+        if (TAILQ_EMPTY(&(sys->neigh_tx_list)))
+            sys->neigh_tx_msgs = 0;
+
+        /* The kernel acks a batch within the sendto, the receive buffer
+         * holds the acks of about one batch*/
+        if (!TAILQ_EMPTY(&(sys->neigh_tx_list)))
+            iccp_neigh_read_acks(sys);
+    }
+
+    iccp_neigh_set_pollout(sys, 0);
+
+    return 0;
+}
+
+/* Batch the next request goes to, a new one if the open batch is full*/
+static struct Msg *iccp_neigh_tx_batch(struct System *sys, uint32_t len)
+{
+    struct Msg *msg = NULL;
+
+    msg = TAILQ_LAST(&(sys->neigh_tx_list), neigh_tx_list);
+    if (msg && msg->len + len <= NEIGH_BATCH_BUF_SIZE && sys->neigh_tx_msgs < NEIGH_BATCH_MAX_MSGS)
+        return msg;
+
+    msg = iccp_csm_alloc_msg();
+    if (msg == NULL)
+        return NULL;
+
+    msg->buf = (char *)malloc(NEIGH_BATCH_BUF_SIZE);
+    if (msg->buf == NULL)
+    {
+        iccp_csm_free_msg(msg);
+        return NULL;
+    }
+
+    TAILQ_INSERT_TAIL(&(sys->neigh_tx_list), msg, tail);
+    sys->neigh_tx_msgs = 0;
+
+    return msg;
+}
+
+/* Queue an ARP/ND add or del to the kernel. Kernel errors are reported
+ * when the ack is received*/
 int iccp_netlink_neighbor_request(int family, uint8_t *addr, int add, uint8_t *mac, char *portname)
 {
     struct System *sys = NULL;
     struct rtnl_neigh *neigh = NULL;
     struct nl_addr *nl_addr_mac = NULL;
     struct nl_addr *nl_addr_dst = NULL;
+    struct nl_msg *nl_msg = NULL;
+    struct nlmsghdr *nlh = NULL;
+    struct NeighPending *pending = NULL;
     struct LocalInterface *lif = NULL;
-    struct nl_cache *link_cache;
+    struct Msg *batch = NULL;
     char mac_str[18] = "";
+    uint32_t len;
     int err = 0;
 
     if (!(sys = system_get_instance()))
         return MCLAG_ERROR;
 
+    if (!sys->neigh_sock)
+        return MCLAG_ERROR;
+
     lif = local_if_find_by_name(portname);
     if (!lif)
         return MCLAG_ERROR;
@@ -745,7 +1144,7 @@ int iccp_netlink_neighbor_request(int family, uint8_t *addr, int add, uint8_t *m
 
     ICCPD_LOG_NOTICE(__FUNCTION__, "Notify kernel %s %s entry(ip:%s, mac:%s, intf:%s)",
                    add ? "add" : "del", (family == AF_INET) ? "ARP" : "ND",
-                   (family == AF_INET) ? show_ip_str(*((int *)addr)) : show_ipv6_str(addr), mac_str, portname);
+                   iccp_neigh_str(family, addr), mac_str, portname);
 
     nl_addr_mac = nl_addr_build(AF_LLC, (void *)mac, ETHER_ADDR_LEN);
     if (!nl_addr_mac)
@@ -771,19 +1170,65 @@ int iccp_netlink_neighbor_request(int family, uint8_t *addr, int add, uint8_t *m
     rtnl_neigh_set_state(neigh, NUD_REACHABLE);
 
     if (add)
+        err = rtnl_neigh_build_add_request(neigh, NLM_F_REPLACE | NLM_F_CREATE, &nl_msg);
+    else
+        err = rtnl_neigh_build_delete_request(neigh, 0, &nl_msg);
+
+    if (err < 0)
     {
-        if ((err = rtnl_neigh_add(sys->route_sock, neigh, NLM_F_REPLACE | NLM_F_CREATE)) < 0)
-            ICCPD_LOG_WARN(__FUNCTION__, "Add %s (ip:%s, mac:%s) error, err = %d", (family == AF_INET) ? "ARP" : "ND",
-                            (family == AF_INET) ? show_ip_str(*((int *)addr)) : show_ipv6_str(addr), mac_str, err);
+        ICCPD_LOG_WARN(__FUNCTION__, "Build %s request (ip:%s, mac:%s) error, err = %d", (family == AF_INET) ? "ARP" : "ND",
+                       iccp_neigh_str(family, addr), mac_str, err);
+        err = MCLAG_ERROR;
+        goto errout;
     }
-    else
+
+    nlh = nlmsg_hdr(nl_msg);
+    len = NLMSG_ALIGN(nlh->nlmsg_len);
+
+    /* Too many requests in flight or no memory, the kernel table is
+     * dumped again instead*/
+    pending = &sys->neigh_pending[(sys->neigh_seq + 1) & (NEIGH_PENDING_MAX - 1)];
+    if (!iccp_neigh_slot_free(sys, pending) || (batch = iccp_neigh_tx_batch(sys, len)) == NULL)
     {
-        if ((err = rtnl_neigh_delete(sys->route_sock, neigh, 0)) < 0)
-            ICCPD_LOG_WARN(__FUNCTION__, "Del %s (ip:%s, mac:%s) error, err = %d", (family == AF_INET) ? "ARP" : "ND",
-                            (family == AF_INET) ? show_ip_str(*((int *)addr)) : show_ipv6_str(addr), mac_str, err);
+        ICCPD_LOG_WARN(__FUNCTION__, "Can not queue %s %s entry(ip:%s, intf:%s), %u requests pending, resync the table",
+                       add ? "add" : "del", (family == AF_INET) ? "ARP" : "ND",
+                       iccp_neigh_str(family, addr), portname, sys->neigh_pending_num);
+        sys->neigh_stats.dropped++;
+        iccp_neigh_resync(sys, family);
+        err = MCLAG_ERROR;
+        goto errout;
     }
 
+    sys->neigh_seq++;
+    nlh->nlmsg_seq = sys->neigh_seq;
+    nlh->nlmsg_pid = nl_socket_get_local_port(sys->neigh_sock);
+    nlh->nlmsg_flags |= NLM_F_ACK | NLM_F_REQUEST;
+    memcpy(batch->buf + batch->len, nlh, nlh->nlmsg_len);
+    batch->len += len;
+    sys->neigh_tx_msgs++;
+
+    pending->seq = sys->neigh_seq;
+    pending->batch = sys->neigh_batch_id;
+    pending->in_use = 1;
+    pending->sent = 0;
+    pending->error = 0;
+    pending->add = add ? 1 : 0;
+    pending->family = family;
+    memcpy(pending->mac, mac, ETHER_ADDR_LEN);
+    memset(pending->addr, 0, sizeof(pending->addr));
+    memcpy(pending->addr, addr, (family == AF_INET) ? 4 : 16);
+    snprintf(pending->ifname, MAX_L_PORT_NAME, "%s", portname);
+
+    sys->neigh_pending_num++;
+    if (sys->neigh_pending_num > sys->neigh_stats.pending_peak)
+        sys->neigh_stats.pending_peak = sys->neigh_pending_num;
+    sys->neigh_stats.requests++;
+    iccp_latency_mark(ICCP_LAT_POINT_PROGRAM);
+    err = 0;
+
 errout:
+    if (nl_msg)
+        nlmsg_free(nl_msg);
     nl_addr_put(nl_addr_mac);
     nl_addr_put(nl_addr_dst);
     rtnl_neigh_put(neigh);
@@ -872,6 +1317,10 @@ void iccp_event_handler_obj_input_newlink(struct nl_object *obj, void *arg)
     }
     else /*update*/
     {
+        /*Interface is renamed, keep the name index consistent*/
+        if (strcmp(lif->name, ifname) != 0)
+            local_if_rename(lif, ifname);
+
         /*update*/
         if (lif->state == PORT_STATE_DOWN && op_state == IF_OPER_UP)
         {
@@ -1013,6 +1462,8 @@ int iccp_addr_valid_handler(struct nl_msg *msg, void *arg)
     if (nlh->nlmsg_type != RTM_NEWADDR)
         return 0;
 
+    iccp_capture_write(ICCP_CAPTURE_DUMP, -1, nlh, nlh->nlmsg_len);
+
     if (nl_msg_parse(msg, &iccp_event_handler_obj_input_newaddr, &event) < 0)
         ICCPD_LOG_ERR(__FUNCTION__, "Unknown message type.");
 
@@ -1043,6 +1494,17 @@ int iccp_check_if_addr_from_netlink(int family, uint8_t *addr, struct LocalInter
         return 0;
     }
 
+    /*On replay the kernel is not asked, the addresses learned from the
+       captured dumps are used*/
+    if (sys->route_sock == NULL)
+    {
+        if (!lif)
+            return 0;
+        if (family == AF_INET)
+            return lif->ipv4_addr != 0 && *(uint32_t *)addr == ntohl(lif->ipv4_addr);
+        return memcmp((uint8_t *)lif->ipv6_addr, addr, 16) == 0;
+    }
+
     memset(&req, 0, sizeof(req));
     req.nlh.nlmsg_len = NLMSG_LENGTH(sizeof(struct ifaddrmsg));
     req.nlh.nlmsg_type = RTM_GETADDR;
@@ -1211,6 +1673,101 @@ static int iccp_route_event_handler(struct nl_msg *msg, void *arg)
     return NL_STOP;
 }
 
+/* Link and addr msgs from the ingestion ring*/
+void iccp_netlink_route_event_input(struct nlmsghdr *nlh)
+{
+    struct nl_msg *msg = NULL;
+
+    if ((msg = nlmsg_convert(nlh)) == NULL)
+        return;
+
+    /*nl_msg_parse() looks up the cache ops by protocol*/
+    nlmsg_set_proto(msg, NETLINK_ROUTE);
+    iccp_route_event_handler(msg, NULL);
+    nlmsg_free(msg);
+}
+
+/* Dumped msgs read from a capture file*/
+void iccp_netlink_dump_input(struct nlmsghdr *nlh)
+{
+    struct nl_msg *msg = NULL;
+    unsigned int event = 0;
+
+    switch (nlh->nlmsg_type)
+    {
+        case RTM_NEWLINK:
+            if ((msg = nlmsg_convert(nlh)) == NULL)
+                return;
+            nlmsg_set_proto(msg, NETLINK_ROUTE);
+            if (nl_msg_parse(msg, &iccp_event_handler_obj_input_newlink, &event) < 0)
+                ICCPD_LOG_ERR(__FUNCTION__, "Unknown message type.");
+            nlmsg_free(msg);
+            break;
+
+        case RTM_NEWADDR:
+            if ((msg = nlmsg_convert(nlh)) == NULL)
+                return;
+            nlmsg_set_proto(msg, NETLINK_ROUTE);
+            iccp_addr_valid_handler(msg, NULL);
+            nlmsg_free(msg);
+            break;
+
+        default:
+            do_one_neigh_request(nlh);
+            break;
+    }
+}
+
+/* Team msgs read from a capture file*/
+void iccp_netlink_team_input(struct nlmsghdr *nlh)
+{
+    struct nl_msg *msg = NULL;
+
+    if ((msg = nlmsg_convert(nlh)) == NULL)
+        return;
+
+    iccp_get_portchannel_member_list_handler(msg, NULL);
+    nlmsg_free(msg);
+}
+
+/* Route event socket callback, runs in the ingestion thread.
+ * Neighbor msgs are decoded here, the rare link and addr msgs are copied*/
+static int iccp_route_event_ingest_handler(struct nl_msg *msg, void *arg)
+{
+    struct nlmsghdr *nlh = nlmsg_hdr(msg);
+    struct IngestEvent ev;
+
+    memset(&ev, 0, sizeof(ev));
+
+    switch (nlh->nlmsg_type)
+    {
+        case RTM_NEWNEIGH:
+        case RTM_DELNEIGH:
+            if (!iccp_neigh_event_decode(nlh, &ev.u.neigh))
+                break;
+            ev.type = INGEST_EV_NEIGH;
+            iccp_ingest_push(&ev);
+            break;
+
+        case RTM_NEWLINK:
+        case RTM_DELLINK:
+        case RTM_NEWADDR:
+        case RTM_DELADDR:
+            ev.type = INGEST_EV_ROUTE_MSG;
+            ev.u.nlh = (struct nlmsghdr *)malloc(nlh->nlmsg_len);
+            if (!ev.u.nlh)
+                break;
+            memcpy(ev.u.nlh, nlh, nlh->nlmsg_len);
+            iccp_ingest_push(&ev);
+            break;
+
+        default:
+            return NL_OK;
+    }
+
+    return NL_STOP;
+}
+
 /**
  * SECTION: Context functions
  */
@@ -1259,6 +1816,10 @@ int iccp_make_nd_socket(void)
     }
 #endif
 
+    /* Kernel drop count in each frame*/
+    if (setsockopt(sock, SOL_SOCKET, SO_RXQ_OVFL, &val, sizeof(val)) < 0)
+        ICCPD_LOG_WARN(__FUNCTION__, "Failed to set SO_RXQ_OVFL for nd socket");
+
     ICMP6_FILTER_SETBLOCKALL(&filter);
     ICMP6_FILTER_SETPASS(ND_NEIGHBOR_ADVERT, &filter);
 
@@ -1274,6 +1835,28 @@ int iccp_make_nd_socket(void)
     return sock;
 }
 
+/* Root can go beyond net.core.rmem_max with SO_RCVBUFFORCE*/
+static int iccp_netlink_set_rcvbuf(struct nl_sock* sk, int bytes)
+{
+    if (setsockopt(nl_socket_get_fd(sk), SOL_SOCKET, SO_RCVBUFFORCE, &bytes, sizeof(bytes)) == 0)
+        return 0;
+
+    return nl_socket_set_buffer_size(sk, bytes, 0);
+}
+
+/* Event bursts beyond the buffer are lost and dumped again*/
+int iccp_netlink_set_event_rcvbuf(struct System* sys, int bytes)
+{
+    if (iccp_netlink_set_rcvbuf(sys->route_event_sock, bytes) < 0
+        || iccp_netlink_set_rcvbuf(sys->genric_event_sock, bytes) < 0)
+    {
+        ICCPD_LOG_WARN(__FUNCTION__, "Failed to set event sock receive buffer to %d bytes", bytes);
+        return MCLAG_ERROR;
+    }
+
+    return 0;
+}
+
 /*init netlink socket*/
 int iccp_system_init_netlink_socket()
 {
@@ -1321,6 +1904,50 @@ int iccp_system_init_netlink_socket()
         goto err_route_sock_connect;
     }
 
+    sys->neigh_sock = nl_socket_alloc();
+    if (!sys->neigh_sock)
+        goto err_neigh_sock_alloc;
+    err = nl_connect(sys->neigh_sock, NETLINK_ROUTE);
+    if (err)
+    {
+        ICCPD_LOG_ERR(__FUNCTION__, "Failed to connect to netlink sys->neigh_sock.");
+        goto err_neigh_sock_connect;
+    }
+
+    err = nl_socket_set_buffer_size(sys->neigh_sock, 4 * NEIGH_BATCH_BUF_SIZE, 983040);
+    if (err)
+    {
+        ICCPD_LOG_ERR(__FUNCTION__, "Failed to set buffer size of netlink neigh sock.");
+        goto err_neigh_sock_connect;
+    }
+
+    /* Error acks without the request, it is known by the seq. Older
+     * kernels echo it*/
+    val = 1;
+    setsockopt(nl_socket_get_fd(sys->neigh_sock), SOL_NETLINK, NETLINK_CAP_ACK, &val, sizeof(val));
+
+    sys->neigh_pending = (struct NeighPending *)calloc(NEIGH_PENDING_MAX, sizeof(struct NeighPending));
+    if (!sys->neigh_pending)
+    {
+        ICCPD_LOG_ERR(__FUNCTION__, "Failed to allocate neighbor batch.");
+        err = MCLAG_ERROR;
+        goto err_neigh_sock_connect;
+    }
+
+    sys->neigh_dump_sock = nl_socket_alloc();
+    if (!sys->neigh_dump_sock)
+    {
+        err = MCLAG_ERROR;
+        goto err_neigh_dump_sock_connect;
+    }
+    err = nl_connect(sys->neigh_dump_sock, NETLINK_ROUTE);
+    if (err)
+    {
+        ICCPD_LOG_ERR(__FUNCTION__, "Failed to connect to netlink sys->neigh_dump_sock.");
+        goto err_neigh_dump_sock_connect;
+    }
+    nl_socket_disable_auto_ack(sys->neigh_dump_sock);
+
     sys->route_event_sock = nl_socket_alloc();
     if (!sys->route_event_sock)
         goto err_route_event_sock_alloc;
@@ -1332,7 +1959,7 @@ int iccp_system_init_netlink_socket()
         goto err_route_event_sock_connect;
     }
 
-    err = nl_socket_set_buffer_size(sys->route_event_sock, 983040, 0);
+    err = iccp_netlink_set_rcvbuf(sys->route_event_sock, NETLINK_EVENT_RCVBUF_DEFAULT);
     if (err)
     {
         ICCPD_LOG_ERR(__FUNCTION__, "Failed to set buffer size of netlink route event sock.");
@@ -1355,7 +1982,7 @@ int iccp_system_init_netlink_socket()
         goto err_return;
     }
 
-    err = nl_socket_set_buffer_size(sys->genric_event_sock, 98304, 0);
+    err = iccp_netlink_set_rcvbuf(sys->genric_event_sock, NETLINK_EVENT_RCVBUF_DEFAULT);
     if (err)
     {
         ICCPD_LOG_ERR(__FUNCTION__, "Failed to set buffer size of netlink event sock.");
@@ -1368,7 +1995,7 @@ int iccp_system_init_netlink_socket()
 
     nl_socket_disable_seq_check(sys->route_event_sock);
     nl_socket_modify_cb(sys->route_event_sock, NL_CB_VALID, NL_CB_CUSTOM,
-                        iccp_route_event_handler, sys);
+                        iccp_route_event_ingest_handler, sys);
 
     err = nl_socket_add_membership(sys->route_event_sock, RTNLGRP_NEIGH);
     if (err < 0)
@@ -1432,11 +2059,22 @@ int iccp_system_init_netlink_socket()
  err_route_event_sock_connect:
     nl_socket_free(sys->route_event_sock);
 
+ err_route_event_sock_alloc:
+ err_neigh_dump_sock_connect:
+    nl_socket_free(sys->neigh_dump_sock);
+    sys->neigh_dump_sock = NULL;
+
+ err_neigh_sock_connect:
+    free(sys->neigh_pending);
+    sys->neigh_pending = NULL;
+    nl_socket_free(sys->neigh_sock);
+    sys->neigh_sock = NULL;
+
+ err_neigh_sock_alloc:
  err_route_sock_alloc:
  err_route_sock_connect:
     nl_socket_free(sys->route_sock);
 
- err_route_event_sock_alloc:
  err_genric_event_sock_connect:
     nl_socket_free(sys->genric_event_sock);
 
@@ -1455,19 +2093,37 @@ int iccp_system_init_netlink_socket()
 void iccp_system_dinit_netlink_socket()
 {
     struct System* sys = NULL;
+    struct Msg* msg = NULL;
 
     if ((sys = system_get_instance()) == NULL )
         return;
 
+    iccp_timer_stop(&iccp_netlink_resync.timer);
+    iccp_netlink_resync.neigh_family = AF_UNSPEC;
     nl_socket_free(sys->route_event_sock);
+    nl_socket_free(sys->neigh_dump_sock);
+    nl_socket_free(sys->neigh_sock);
     nl_socket_free(sys->route_sock);
     nl_socket_free(sys->genric_event_sock);
     nl_socket_free(sys->genric_sock);
+    while (!TAILQ_EMPTY(&(sys->neigh_tx_list)))
+    {
+        msg = TAILQ_FIRST(&(sys->neigh_tx_list));
+        TAILQ_REMOVE(&(sys->neigh_tx_list), msg, tail);
+        iccp_csm_free_msg(msg);
+    }
+    free(sys->neigh_pending);
+    sys->neigh_sock = NULL;
+    sys->neigh_dump_sock = NULL;
+    sys->neigh_pending = NULL;
     return;
 }
 
 static int iccp_get_netlink_genic_sock_event_fd(struct System *sys)
 {
+    if (sys->genric_event_sock == NULL)
+        return -1;
+
     return nl_socket_get_fd(sys->genric_event_sock);
 }
 
@@ -1478,74 +2134,117 @@ static int iccp_netlink_genic_sock_event_handler(struct System *sys)
     ret = nl_recvmsgs_default(sys->genric_event_sock);
     if (ret)
     {
-        sys->need_sync_team_again = 1;
+        sys->netlink_resync_stats.team_losses++;
+        iccp_netlink_resync_mark(sys, NETLINK_RESYNC_TEAM);
         ICCPD_LOG_DEBUG(__FUNCTION__, "genric_event_sock %d recvmsg error ret = %d ", nl_socket_get_fd(sys->genric_event_sock), ret);
     }
 
     return ret;
 }
 
-static int iccp_get_netlink_route_sock_event_fd(struct System *sys)
-{
-    return nl_socket_get_fd(sys->route_event_sock);
-}
-
-static int iccp_get_receive_arp_packet_sock_fd(struct System *sys)
+/* Frames of one recvmmsg. The packet sockets are read by the ingestion
+ * thread only*/
+struct IccpPacketBatch
 {
-    return sys->arp_receive_fd;
-}
+    struct mmsghdr msgs[ICCP_INGEST_PKT_BATCH];
+    struct iovec iov[ICCP_INGEST_PKT_BATCH];
+    union
+    {
+        struct sockaddr_ll ll;
+        struct sockaddr_in6 in6;
+    } from[ICCP_INGEST_PKT_BATCH];
+    uint8_t ctrl[ICCP_INGEST_PKT_BATCH][256];
+    uint8_t buf[ICCP_INGEST_PKT_BATCH][4096];
+};
 
-static int iccp_get_receive_ndisc_packet_sock_fd(struct System *sys)
-{
-    return sys->ndisc_receive_fd;
-}
+static struct IccpPacketBatch iccp_arp_batch;
+static struct IccpPacketBatch iccp_ndisc_batch;
+static uint32_t iccp_ndisc_rxq_ovfl;    /* kernel drop count of the last ND frame*/
+static uint32_t iccp_ndisc_drops;
 
-static int iccp_receive_arp_packet_handler(struct System *sys)
+static int iccp_netlink_recv_batch(int fd, struct IccpPacketBatch *batch, int max)
 {
-    unsigned char buf[1024];
-    struct sockaddr_ll sll;
-    socklen_t sll_len = sizeof(sll);
-    struct arphdr *a = (struct arphdr*)buf;
-    int n;
-    unsigned int ifindex;
-    unsigned int addr;
-    uint8_t mac_addr[ETHER_ADDR_LEN];
+    struct msghdr *hdr;
+    int i, n;
+
+    if (max > ICCP_INGEST_PKT_BATCH)
+        max = ICCP_INGEST_PKT_BATCH;
+
+    /* The lengths are overwritten by each recvmmsg*/
+    for (i = 0; i < max; i++)
+    {
+        hdr = &batch->msgs[i].msg_hdr;
+        batch->iov[i].iov_base = batch->buf[i];
+        batch->iov[i].iov_len = sizeof(batch->buf[i]);
+        hdr->msg_name = &batch->from[i];
+        hdr->msg_namelen = sizeof(batch->from[i]);
+        hdr->msg_iov = &batch->iov[i];
+        hdr->msg_iovlen = 1;
+        hdr->msg_control = batch->ctrl[i];
+        hdr->msg_controllen = sizeof(batch->ctrl[i]);
+        hdr->msg_flags = 0;
+    }
 
-    n = recvfrom(sys->arp_receive_fd, buf, sizeof(buf), MSG_DONTWAIT,
-                 (struct sockaddr*)&sll, &sll_len);
+    n = recvmmsg(fd, batch->msgs, max, MSG_DONTWAIT, NULL);
     if (n < 0)
     {
-        ICCPD_LOG_WARN(__FUNCTION__, "ARP recvfrom error: %s", buf);
+        if (errno == EAGAIN || errno == EWOULDBLOCK || errno == EINTR)
+            return 0;
+
+        ICCPD_LOG_WARN(__FUNCTION__, "fd %d recvmmsg error: %s", fd, strerror(errno));
         return MCLAG_ERROR;
     }
 
+    return n;
+}
+
+static int iccp_netlink_decode_arp_packet(const uint8_t *buf, int n, const struct sockaddr_ll *sll, struct NeighEvent *ev)
+{
+    const struct arphdr *a = (const struct arphdr*)buf;
+
     /* Sanity checks */
     /*Only process ARPOP_REPLY*/
     if (n < sizeof(*a) ||
         a->ar_op != htons(ARPOP_REPLY) ||
         a->ar_pln != 4 ||
         a->ar_pro != htons(ETH_P_IP) ||
-        a->ar_hln != sll.sll_halen ||
+        a->ar_hln != sll->sll_halen ||
         sizeof(*a) + 2 * 4 + 2 * a->ar_hln > n)
         return 0;
 
-    ifindex = sll.sll_ifindex;
-    memcpy(mac_addr,  (char*)(a + 1), ETHER_ADDR_LEN);
-    memcpy(&addr, (char*)(a + 1) + a->ar_hln, 4);
+    ev->ifindex = sll->sll_ifindex;
+    ev->family = AF_INET;
+    memcpy(ev->mac, (const char*)(a + 1), ETHER_ADDR_LEN);
+    memcpy(ev->dst, (const char*)(a + 1) + a->ar_hln, 4);
+
+    return 1;
+}
+
+/* Called by the ingestion thread, decode only.
+ * Read up to max frames, the ARP replies are put in evs and counted in num.
+ * Return the frames read, 0 if none is left*/
+int iccp_netlink_read_arp_packets(struct System *sys, struct NeighEvent *evs, int max, int *num)
+{
+    struct IccpPacketBatch *batch = &iccp_arp_batch;
+    int i, n;
 
-    do_arp_update_from_reply_packet(ifindex, addr, mac_addr);
+    *num = 0;
+    n = iccp_netlink_recv_batch(sys->arp_receive_fd, batch, max);
 
-    return 0;
+    for (i = 0; i < n; i++)
+    {
+        memset(&evs[*num], 0, sizeof(struct NeighEvent));
+        if (iccp_netlink_decode_arp_packet(batch->buf[i], batch->msgs[i].msg_len,
+                                           &batch->from[i].ll, &evs[*num]) > 0)
+            (*num)++;
+    }
+
+    return n;
 }
 
-int iccp_receive_ndisc_packet_handler(struct System *sys)
+static int iccp_netlink_decode_ndisc_packet(uint8_t *buf, int len, struct msghdr *msg, struct NeighEvent *ev)
 {
-    uint8_t buf[4096];
-    uint8_t adata[1024];
-    struct sockaddr_in6 from;
     unsigned int ifindex = 0;
-    struct msghdr msg;
-    struct iovec iov;
     struct cmsghdr *cmsgptr;
     struct nd_msg *ndmsg = NULL;
     struct nd_opt_hdr *nd_opt = NULL;
@@ -1553,30 +2252,11 @@ int iccp_receive_ndisc_packet_handler(struct System *sys)
     uint8_t mac_addr[ETHER_ADDR_LEN];
     int8_t *opt = NULL;
     int opt_len = 0, l = 0;
-    int len;
 
     memset(mac_addr, 0, ETHER_ADDR_LEN);
 
-    /* Fill in message and iovec. */
-    msg.msg_name = (void *)(&from);
-    msg.msg_namelen = sizeof(struct sockaddr_in6);
-    msg.msg_iov = &iov;
-    msg.msg_iovlen = 1;
-    msg.msg_control = (void *)adata;
-    msg.msg_controllen = sizeof adata;
-    iov.iov_base = buf;
-    iov.iov_len = 4096;
-
-    len = recvmsg(sys->ndisc_receive_fd, &msg, 0);
-
-    if (len < 0)
-    {
-        ICCPD_LOG_WARN(__FUNCTION__, "Ndisc recvmsg error!");
-        return MCLAG_ERROR;
-    }
-
-    if (msg.msg_controllen >= sizeof(struct cmsghdr))
-        for (cmsgptr = CMSG_FIRSTHDR(&msg); cmsgptr != NULL; cmsgptr = CMSG_NXTHDR(&msg, cmsgptr))
+    if (msg->msg_controllen >= sizeof(struct cmsghdr))
+        for (cmsgptr = CMSG_FIRSTHDR(msg); cmsgptr != NULL; cmsgptr = CMSG_NXTHDR(msg, cmsgptr))
         {
             /* I want interface index which this packet comes from. */
             if (cmsgptr->cmsg_level == IPPROTO_IPV6 && cmsgptr->cmsg_type == IPV6_PKTINFO)
@@ -1586,11 +2266,19 @@ int iccp_receive_ndisc_packet_handler(struct System *sys)
                 ptr = (struct in6_pktinfo *)CMSG_DATA(cmsgptr);
                 ifindex = ptr->ipi6_ifindex;
             }
+            else if (cmsgptr->cmsg_level == SOL_SOCKET && cmsgptr->cmsg_type == SO_RXQ_OVFL)
+            {
+                uint32_t ovfl;
+
+                memcpy(&ovfl, CMSG_DATA(cmsgptr), sizeof(ovfl));
+                iccp_ndisc_drops += ovfl - iccp_ndisc_rxq_ovfl;
+                iccp_ndisc_rxq_ovfl = ovfl;
+            }
         }
 
     ndmsg = (struct nd_msg *)buf;
 
-    if (ndmsg->icmph.icmp6_type != NDISC_NEIGHBOUR_ADVERTISEMENT)
+    if (len < sizeof(struct nd_msg) || ndmsg->icmph.icmp6_type != NDISC_NEIGHBOUR_ADVERTISEMENT)
         return 0;
 
     memcpy((char *)(&target), (char *)(&ndmsg->target), sizeof(struct in6_addr));
@@ -1610,7 +2298,7 @@ int iccp_receive_ndisc_packet_handler(struct System *sys)
 
             l = nd_opt->nd_opt_len << 3;
 
-            if (l == 0)
+            if (l == 0 || l > opt_len)
                 return 0;
 
             if (nd_opt->nd_opt_type == ND_OPT_TARGET_LL_ADDR)
@@ -1626,61 +2314,280 @@ int iccp_receive_ndisc_packet_handler(struct System *sys)
 
     /* ICCPD_LOG_DEBUG(__FUNCTION__, "Recv na pkt(%s,%02X:%02X:%02X:%02X:%02X:%02X)!", show_ipv6_str((char *)&target), mac_addr[0], mac_addr[1],
        mac_addr[2], mac_addr[3], mac_addr[4], mac_addr[5]); */
-    do_ndisc_update_from_reply_packet(ifindex, (char *)&target, mac_addr);
+    ev->ifindex = ifindex;
+    ev->family = AF_INET6;
+    memcpy(ev->dst, &target, sizeof(struct in6_addr));
+    memcpy(ev->mac, mac_addr, ETHER_ADDR_LEN);
 
-    return 0;
+    return 1;
 }
 
-void iccp_netlink_sync_again()
+/* Called by the ingestion thread, decode only.
+ * Read up to max frames, the ND advertisements are put in evs and counted
+ * in num. Return the frames read, 0 if none is left*/
+int iccp_netlink_read_ndisc_packets(struct System *sys, struct NeighEvent *evs, int max, int *num)
 {
-    struct System* sys = NULL;
-    struct LocalInterface* lif = NULL;
+    struct IccpPacketBatch *batch = &iccp_ndisc_batch;
+    int i, n;
 
-    if ((sys = system_get_instance()) == NULL )
-        return;
+    *num = 0;
+    n = iccp_netlink_recv_batch(sys->ndisc_receive_fd, batch, max);
 
-    if (sys->need_sync_netlink_again)
+    for (i = 0; i < n; i++)
     {
-        sys->need_sync_netlink_again = 0;
+        memset(&evs[*num], 0, sizeof(struct NeighEvent));
+        if (iccp_netlink_decode_ndisc_packet(batch->buf[i], batch->msgs[i].msg_len,
+                                             &batch->msgs[i].msg_hdr, &evs[*num]) > 0)
+            (*num)++;
+    }
+
+    return n;
+}
 
-        /*Get kernel interface and port */
-        iccp_sys_local_if_list_get_init();
+/* Called by the ingestion thread.
+ * Frames dropped by the kernel on the ARP/ND sockets since the last call*/
+uint32_t iccp_netlink_packet_drops(struct System *sys)
+{
+    struct tpacket_stats st;
+    socklen_t len = sizeof(st);
+    uint32_t drops = iccp_ndisc_drops;
+
+    /* Cleared by each read*/
+    if (getsockopt(sys->arp_receive_fd, SOL_PACKET, PACKET_STATISTICS, &st, &len) == 0)
+        drops += st.tp_drops;
+
+    iccp_ndisc_drops = 0;
+
+    return drops;
+}
+
+/* Dump the members of the next port-channels by ifindex order,
+ * return 1 when all port-channels are done*/
+static int iccp_netlink_resync_team(struct System* sys)
+{
+    struct LocalInterface* lif = NULL;
+    struct LocalInterface* next_lif = NULL;
+    int count;
+
+    for (count = 0; count < NETLINK_RESYNC_TEAM_BATCH; count++)
+    {
+        next_lif = NULL;
+        LIST_FOREACH(lif, &(sys->lif_list), system_next)
+        {
+            if (lif->type != IF_T_PORT_CHANNEL || lif->ifindex <= iccp_netlink_resync.team_cursor)
+                continue;
+            if (next_lif == NULL || lif->ifindex < next_lif->ifindex)
+                next_lif = lif;
+        }
+
+        if (next_lif == NULL)
+            return 1;
+
+        iccp_netlink_resync.team_cursor = next_lif->ifindex;
+        iccp_get_port_member_list(next_lif);
+        sys->netlink_resync_stats.team_dumps++;
     }
 
-    if (sys->need_sync_team_again)
+    return 0;
+}
+
+/* Request a neighbor dump, its replies are read by the next steps*/
+static int iccp_netlink_resync_neigh_start(struct System* sys, int family)
+{
+    struct nl_msg* msg = NULL;
+    struct rtgenmsg rt_hdr = {
+        .rtgen_family = family,
+    };
+    char buf[4096];
+    int err;
+
+    /* Replies left by a dump that failed*/
+    while (recv(nl_socket_get_fd(sys->neigh_dump_sock), buf, sizeof(buf), MSG_DONTWAIT) > 0)
+        ;
+
+    msg = nlmsg_alloc_simple(RTM_GETNEIGH, NLM_F_DUMP);
+    if (!msg)
+        return -ENOMEM;
+
+    err = nlmsg_append(msg, &rt_hdr, sizeof(rt_hdr), NLMSG_ALIGNTO);
+    if (err == 0)
     {
-        sys->need_sync_team_again = 0;
+        iccp_netlink_resync.neigh_seq = nl_socket_use_seq(sys->neigh_dump_sock);
+        nlmsg_hdr(msg)->nlmsg_seq = iccp_netlink_resync.neigh_seq;
+        err = nl_send_auto(sys->neigh_dump_sock, msg);
+    }
+    nlmsg_free(msg);
 
-        LIST_FOREACH(lif, &(sys->lif_list), system_next)
+    if (err < 0)
+        return err;
+
+    iccp_netlink_resync.neigh_family = family;
+
+    return 0;
+}
+
+/* Read up to NETLINK_RESYNC_NEIGH_BATCH neighbors of the dump. The kernel
+ * fills the socket as it is read, so the rest waits for the next step.
+ * Return 1 when the dump is done, 0 if there is more*/
+static int iccp_netlink_resync_neigh_read(struct System* sys)
+{
+    char buf[16384];
+    struct nlmsghdr *nlh = NULL;
+    struct nlmsgerr *nl_err = NULL;
+    int num = 0;
+    int len;
+
+    while (num < NETLINK_RESYNC_NEIGH_BATCH)
+    {
+        len = recv(nl_socket_get_fd(sys->neigh_dump_sock), buf, sizeof(buf), MSG_DONTWAIT);
+        if (len < 0)
+        {
+            if (errno == EINTR)
+                continue;
+            if (errno == EAGAIN || errno == EWOULDBLOCK)
+                return 0;
+            return -errno;
+        }
+
+        for (nlh = (struct nlmsghdr *)buf; NLMSG_OK(nlh, len); nlh = NLMSG_NEXT(nlh, len))
         {
-            if (lif->type == IF_T_PORT_CHANNEL)
+            if (nlh->nlmsg_seq != iccp_netlink_resync.neigh_seq)
+                continue;
+
+            /* Table changed during the dump, dump it again*/
+            if (nlh->nlmsg_flags & NLM_F_DUMP_INTR)
+                return -EAGAIN;
+
+            if (nlh->nlmsg_type == NLMSG_DONE)
+                return 1;
+
+            if (nlh->nlmsg_type == NLMSG_ERROR)
             {
-                iccp_get_port_member_list(lif);
+                nl_err = (struct nlmsgerr *)NLMSG_DATA(nlh);
+                return nl_err->error ? nl_err->error : -EIO;
             }
+
+            iccp_neigh_dump_input(nlh);
+            num++;
         }
     }
 
-    return;
+    return 0;
 }
 
-static int iccp_netlink_route_sock_event_handler(struct System *sys)
+/* One object type per step, the loop serves the peer and mclagsyncd in between*/
+static void iccp_netlink_resync_handler(void* arg)
 {
+    struct System* sys = (struct System*)arg;
+    struct NetlinkResyncStats* stats = &sys->netlink_resync_stats;
+    uint64_t start = iccp_latency_now_usec();
+    uint32_t type = 0;
+    uint32_t usec;
     int ret = 0;
 
-    ret = nl_recvmsgs_default(sys->route_event_sock);
+    iccp_netlink_resync.first_usec = 0;
 
-    if (ret)
+    /* Cleared before the dump, a loss during it marks the type again*/
+    if (iccp_netlink_resync.neigh_family != AF_UNSPEC)
+    {
+        type = (iccp_netlink_resync.neigh_family == AF_INET) ? NETLINK_RESYNC_NEIGH4 : NETLINK_RESYNC_NEIGH6;
+        ret = iccp_netlink_resync_neigh_read(sys);
+    }
+    else if (sys->netlink_resync_dirty & NETLINK_RESYNC_LINK)
     {
-        sys->need_sync_netlink_again = 1;
-        ICCPD_LOG_DEBUG(__FUNCTION__, "fd %d recvmsg error ret = %d  errno = %d ", nl_socket_get_fd(sys->route_event_sock), ret, errno);
+        type = NETLINK_RESYNC_LINK;
+        sys->netlink_resync_dirty &= ~type;
+        ret = iccp_sys_local_if_list_get_init();
+        stats->link_dumps++;
     }
-    /*get netlink info again when error happens */
-    if (ret == 0 && sys->need_sync_netlink_again == 1)
+    else if (sys->netlink_resync_dirty & NETLINK_RESYNC_ADDR)
     {
-        iccp_netlink_sync_again();
+        type = NETLINK_RESYNC_ADDR;
+        sys->netlink_resync_dirty &= ~type;
+        ret = iccp_sys_local_if_list_get_addr();
+        stats->addr_dumps++;
+    }
+    else if (sys->netlink_resync_dirty & NETLINK_RESYNC_NEIGH4)
+    {
+        type = NETLINK_RESYNC_NEIGH4;
+        sys->netlink_resync_dirty &= ~type;
+        ret = iccp_netlink_resync_neigh_start(sys, AF_INET);
+        if (ret == 0)
+            ret = iccp_netlink_resync_neigh_read(sys);
+        stats->neigh4_dumps++;
+    }
+    else if (sys->netlink_resync_dirty & NETLINK_RESYNC_NEIGH6)
+    {
+        type = NETLINK_RESYNC_NEIGH6;
+        sys->netlink_resync_dirty &= ~type;
+        ret = iccp_netlink_resync_neigh_start(sys, AF_INET6);
+        if (ret == 0)
+            ret = iccp_netlink_resync_neigh_read(sys);
+        stats->neigh6_dumps++;
+    }
+    else if (sys->netlink_resync_dirty & NETLINK_RESYNC_TEAM)
+    {
+        if (iccp_netlink_resync_team(sys))
+            sys->netlink_resync_dirty &= ~NETLINK_RESYNC_TEAM;
     }
 
-    return ret;
+    usec = (uint32_t)(iccp_latency_now_usec() - start);
+    stats->steps++;
+    stats->total_usec += usec;
+    if (usec > stats->max_step_usec)
+        stats->max_step_usec = usec;
+
+    /* A neighbor dump is read until done or failed*/
+    if (ret != 0)
+        iccp_netlink_resync.neigh_family = AF_UNSPEC;
+
+    if (ret < 0)
+    {
+        ICCPD_LOG_WARN(__FUNCTION__, "Resync dump of type 0x%x failed ret = %d, retry later", type, ret);
+        iccp_netlink_resync_mark(sys, type);
+        return;
+    }
+
+    if (sys->netlink_resync_dirty || iccp_netlink_resync.neigh_family != AF_UNSPEC)
+        iccp_timer_start(&iccp_netlink_resync.timer, NETLINK_RESYNC_STEP_MSEC);
+    else
+        ICCPD_LOG_DEBUG(__FUNCTION__, "Netlink resync done");
+}
+
+/* Kernel events of the types were lost. The dump waits for the burst to
+ * pass, but not longer than NETLINK_RESYNC_MAX_DELAY_MSEC after the loss*/
+void iccp_netlink_resync_mark(struct System* sys, uint32_t types)
+{
+    uint64_t now = iccp_latency_now_usec();
+    uint64_t waited;
+    uint32_t msec = NETLINK_RESYNC_HOLDOFF_MSEC;
+
+    /*On replay the dumps of the captured resync are fed instead*/
+    if (sys->route_sock == NULL)
+        return;
+
+    if (types & NETLINK_RESYNC_TEAM)
+        iccp_netlink_resync.team_cursor = 0;
+
+    if (sys->netlink_resync_dirty == 0)
+        ICCPD_LOG_WARN(__FUNCTION__, "Kernel events lost, resync type 0x%x", types);
+    sys->netlink_resync_dirty |= types;
+
+    if (iccp_netlink_resync.first_usec == 0)
+    {
+        iccp_netlink_resync.first_usec = now;
+    }
+    else
+    {
+        sys->netlink_resync_stats.deferred++;
+        waited = (now - iccp_netlink_resync.first_usec) / 1000;
+        if (waited + msec > NETLINK_RESYNC_MAX_DELAY_MSEC)
+            msec = waited < NETLINK_RESYNC_MAX_DELAY_MSEC ? NETLINK_RESYNC_MAX_DELAY_MSEC - waited : 0;
+        if (msec < NETLINK_RESYNC_STEP_MSEC)
+            msec = NETLINK_RESYNC_STEP_MSEC;
+    }
+
+    iccp_timer_start(&iccp_netlink_resync.timer, msec);
 }
 
 extern int iccp_get_receive_fdb_sock_fd(struct System *sys);
@@ -1704,17 +2611,17 @@ static const struct iccp_eventfd iccp_eventfds[] = {
         .event_handler = iccp_netlink_genic_sock_event_handler,
     },
     {
-        .get_fd = iccp_get_netlink_route_sock_event_fd,
-        .event_handler = iccp_netlink_route_sock_event_handler,
+        .get_fd = iccp_ingest_get_fd,
+        .event_handler = iccp_ingest_handler,
     },
     {
-        .get_fd = iccp_get_receive_arp_packet_sock_fd,
-        .event_handler = iccp_receive_arp_packet_handler,
+        .get_fd = iccp_get_netlink_neigh_sock_fd,
+        .event_handler = iccp_netlink_neigh_sock_handler,
     },
     {
-        .get_fd = iccp_get_receive_ndisc_packet_sock_fd,
-        .event_handler = iccp_receive_ndisc_packet_handler,
-     }
+        .get_fd = iccp_timer_get_fd,
+        .event_handler = iccp_timer_handler,
+    }
 };
 
 /* \cond HIDDEN_SYMBOLS */
@@ -1745,6 +2652,10 @@ int iccp_init_netlink_event_fd(struct System *sys)
     {
         int fd = iccp_eventfds[i].get_fd(sys);
 
+        /*Not opened on replay*/
+        if (fd < 0)
+            continue;
+
         event.data.fd = fd;
         event.events = EPOLLIN;
         err = epoll_ctl(efd, EPOLL_CTL_ADD, fd, &event);
@@ -1756,6 +2667,7 @@ int iccp_init_netlink_event_fd(struct System *sys)
     }
 
     sys->epoll_fd = efd;
+    iccp_timer_init(&iccp_netlink_resync.timer, iccp_netlink_resync_handler, sys);
 
     return 0;
 
@@ -1772,7 +2684,7 @@ int iccp_init_netlink_event_fd(struct System *sys)
  * @return Zero on success or negative number in case of an error.
  **/
 
-int iccp_handle_events(struct System * sys)
+int iccp_handle_events(struct System * sys, int timeout_msec)
 {
     struct epoll_event events[ICCP_EVENT_FDS_COUNT + sys->readfd_count];
     struct CSM* csm = NULL;
@@ -1784,7 +2696,11 @@ int iccp_handle_events(struct System * sys)
 
     max_nfds = ICCP_EVENT_FDS_COUNT + sys->readfd_count;
 
-    nfds = epoll_wait(sys->epoll_fd, events, max_nfds, EPOLL_TIMEOUT_MSEC);
+    nfds = epoll_wait(sys->epoll_fd, events, max_nfds, timeout_msec);
+
+    /* Any event may have work for the FSMs*/
+    if (nfds > 0)
+        sys->fsm_kick = 1;
 
     /* Go over list of event fds and handle them sequentially */
     for (i = 0; i < nfds; i++)
@@ -1809,15 +2725,19 @@ int iccp_handle_events(struct System * sys)
             int client_fd = mclagd_ctl_sock_accept(sys->sync_ctrl_fd);
             if (client_fd > 0)
             {
-                mclagd_ctl_interactive_process(client_fd);
-                close(client_fd);
+                if (mclagd_ctl_interactive_process(client_fd) != 1)
+                    close(client_fd);
             }
             continue;
         }
 
         if (events[i].data.fd == sys->sync_fd)
         {
-            iccp_receive_fdb_handler_from_syncd(sys);
+            if (events[i].events & EPOLLOUT)
+                iccp_syncd_flush(sys);
+
+            if (events[i].events & (EPOLLIN | EPOLLERR | EPOLLHUP))
+                iccp_receive_fdb_handler_from_syncd(sys);
 
             continue;
         }
@@ -1829,13 +2749,21 @@ int iccp_handle_events(struct System * sys)
             continue;
         }
 
+        /* Streamed mclagdctl dumps*/
+        if (mclagd_ctl_dump_handler(events[i].data.fd, events[i].events) == 0)
+            continue;
+
         if (FD_ISSET(events[i].data.fd, &sys->readfd))
         {
             LIST_FOREACH(csm, &(sys->csm_list), next)
             {
                 if (csm->sock_fd == events[i].data.fd )
                 {
-                    scheduler_csm_read_callback(csm);
+                    if (events[i].events & EPOLLOUT)
+                        scheduler_csm_write_callback(csm);
+
+                    if (csm->sock_fd > 0 && (events[i].events & (EPOLLIN | EPOLLERR | EPOLLHUP)))
+                        scheduler_csm_read_callback(csm);
                     break;
                 }
             }
@@ -0,0 +1,164 @@
+/*
+ *  iccp_pool.c
+ *  Slab pools for the fixed size ICCP objects.
+ *
+ * Copyright(c) 2016-2019 Nephos/Estinet.
+ *
+ * This program is free software; you can redistribute it and/or modify it
+ * under the terms and conditions of the GNU General Public License,
+ * version 2, as published by the Free Software Foundation.
+ *
+ * This program is distributed in the hope it will be useful, but WITHOUT
+ * ANY WARRANTY; without even the implied warranty of MERCHANTABILITY or
+ * FITNESS FOR A PARTICULAR PURPOSE.  See the GNU General Public License for
+ * more details.
+ *
+ * You should have received a copy of the GNU General Public License along with
+ * this program; if not, see <http://www.gnu.org/licenses/>.
+ *
+ * The full GNU General Public License is included in this distribution in
+ * the file called "COPYING".
+ *
+ *  Maintainer: jianjun, grace Li from nephos
+ */
+
+#include <stdio.h>
+#include <stdlib.h>
+#include <string.h>
+
+#include "../include/system.h"
+#include "../include/iccp_csm.h"
+#include "../include/logger.h"
+#include "../include/mlacp_tlv.h"
+#include "../include/iccp_pool.h"
+
+/* Free objects are linked through their first bytes*/
+struct IccpPoolObj
+{
+    struct IccpPoolObj* next;
+};
+
+struct IccpPoolSlab
+{
+    struct IccpPoolSlab* next;
+};
+
+struct IccpPool
+{
+    const char* name;
+    uint32_t obj_size;
+    struct IccpPoolObj* free_list;
+    struct IccpPoolSlab* slab_list;
+    struct IccpPoolStats stats;
+};
+
+#define ICCP_POOL_ALIGN(size) \
+    (((size) + sizeof(void*) - 1) & ~(sizeof(void*) - 1))
+
+static struct IccpPool iccp_pools[ICCP_POOL_MAX] =
+{
+    [ICCP_POOL_MSG] = { .name = "msg", .obj_size = ICCP_POOL_ALIGN(sizeof(struct Msg)) },
+    [ICCP_POOL_MAC] = { .name = "mac", .obj_size = ICCP_POOL_ALIGN(sizeof(struct MACMsg)) },
+    [ICCP_POOL_ARP] = { .name = "arp", .obj_size = ICCP_POOL_ALIGN(sizeof(struct ARPMsg)) },
+    [ICCP_POOL_NDISC] = { .name = "nd", .obj_size = ICCP_POOL_ALIGN(sizeof(struct NDISCMsg)) },
+};
+
+/* Carve a new slab into the free list. Slabs are kept for the life of
+ * the process, so the pools never fragment the heap*/
+static int iccp_pool_grow(struct IccpPool* pool)
+{
+    struct IccpPoolSlab* slab = NULL;
+    struct IccpPoolObj* obj = NULL;
+    char* base = NULL;
+    int i;
+
+    slab = (struct IccpPoolSlab*)malloc(ICCP_POOL_ALIGN(sizeof(struct IccpPoolSlab))
+                                        + ICCP_POOL_SLAB_OBJS * pool->obj_size);
+    if (slab == NULL)
+    {
+        ICCPD_LOG_ERR(__FUNCTION__, "Failed to grow %s pool, %u slabs", pool->name, pool->stats.slabs);
+        return MCLAG_ERROR;
+    }
+
+    slab->next = pool->slab_list;
+    pool->slab_list = slab;
+    pool->stats.slabs++;
+
+    base = (char*)slab + ICCP_POOL_ALIGN(sizeof(struct IccpPoolSlab));
+    for (i = ICCP_POOL_SLAB_OBJS - 1; i >= 0; i--)
+    {
+        obj = (struct IccpPoolObj*)(base + i * pool->obj_size);
+        obj->next = pool->free_list;
+        pool->free_list = obj;
+    }
+
+    return 0;
+}
+
+void* iccp_pool_alloc(int type)
+{
+    struct IccpPool* pool = NULL;
+    struct IccpPoolObj* obj = NULL;
+
+    if (type < 0 || type >= ICCP_POOL_MAX)
+        return NULL;
+
+    pool = &iccp_pools[type];
+    pool->stats.obj_size = pool->obj_size;
+
+    if (pool->free_list == NULL && iccp_pool_grow(pool) < 0)
+        return NULL;
+
+    obj = pool->free_list;
+    pool->free_list = obj->next;
+
+    pool->stats.allocs++;
+    pool->stats.live++;
+    if (pool->stats.live > pool->stats.peak)
+        pool->stats.peak = pool->stats.live;
+
+    return obj;
+}
+
+void iccp_pool_free(int type, void* obj)
+{
+    struct IccpPool* pool = NULL;
+
+    if (obj == NULL || type < 0 || type >= ICCP_POOL_MAX)
+        return;
+
+    pool = &iccp_pools[type];
+    ((struct IccpPoolObj*)obj)->next = pool->free_list;
+    pool->free_list = (struct IccpPoolObj*)obj;
+
+    pool->stats.frees++;
+    pool->stats.live--;
+
+    return;
+}
+
+uint32_t iccp_pool_obj_size(int type)
+{
+    if (type < 0 || type >= ICCP_POOL_MAX)
+        return 0;
+
+    return iccp_pools[type].obj_size;
+}
+
+const char* iccp_pool_name(int type)
+{
+    if (type < 0 || type >= ICCP_POOL_MAX)
+        return "unknown";
+
+    return iccp_pools[type].name;
+}
+
+const struct IccpPoolStats* iccp_pool_get_stats(int type)
+{
+    if (type < 0 || type >= ICCP_POOL_MAX)
+        return NULL;
+
+    iccp_pools[type].stats.obj_size = iccp_pools[type].obj_size;
+
+    return &iccp_pools[type].stats;
+}
@@ -0,0 +1,367 @@
+/*
+ *  iccp_timer.c
+ *  Hierarchical timer wheel driven by one timerfd.
+ *
+ * Copyright(c) 2016-2019 Nephos/Estinet.
+ *
+ * This program is free software; you can redistribute it and/or modify it
+ * under the terms and conditions of the GNU General Public License,
+ * version 2, as published by the Free Software Foundation.
+ *
+ * This program is distributed in the hope it will be useful, but WITHOUT
+ * ANY WARRANTY; without even the implied warranty of MERCHANTABILITY or
+ * FITNESS FOR A PARTICULAR PURPOSE.  See the GNU General Public License for
+ * more details.
+ *
+ * You should have received a copy of the GNU General Public License along with
+ * this program; if not, see <http://www.gnu.org/licenses/>.
+ *
+ * The full GNU General Public License is included in this distribution in
+ * the file called "COPYING".
+ *
+ *  Maintainer: jianjun, grace Li from nephos
+ */
+
+#include <errno.h>
+#include <stdio.h>
+#include <stdlib.h>
+#include <string.h>
+#include <time.h>
+#include <unistd.h>
+#include <sys/timerfd.h>
+
+#include "../include/system.h"
+#include "../include/logger.h"
+#include "../include/iccp_timer.h"
+
+#define ICCP_TIMER_SLOT_MASK        (ICCP_TIMER_WHEEL_SLOTS - 1)
+#define ICCP_TIMER_LEVEL_SHIFT(l)   ((l) * ICCP_TIMER_WHEEL_BITS)
+#define ICCP_TIMER_TICK_NONE        ((uint64_t)-1)
+
+LIST_HEAD(iccp_timer_slot, iccp_timer);
+
+/* Level 0 holds the timers of the next 256 ticks, level n holds one
+ * slot per 256^n ticks and is cascaded down when the level below
+ * wraps*/
+struct IccpTimerWheel
+{
+    int fd;
+    uint32_t tick_msec;
+    struct timespec base;
+    uint64_t now_tick;
+    uint64_t armed_tick;
+    struct iccp_timer_slot slots[ICCP_TIMER_WHEEL_LEVELS][ICCP_TIMER_WHEEL_SLOTS];
+    struct IccpTimerStats stats;
+};
+
+static struct IccpTimerWheel iccp_timer_wheel = { .fd = -1 };
+
+static uint64_t iccp_timer_current_tick()
+{
+    struct IccpTimerWheel* wheel = &iccp_timer_wheel;
+    struct timespec now;
+    uint64_t msec;
+
+    clock_gettime(CLOCK_MONOTONIC, &now);
+    msec = (uint64_t)(now.tv_sec - wheel->base.tv_sec) * 1000
+           + (now.tv_nsec - wheel->base.tv_nsec) / 1000000;
+
+    return msec / wheel->tick_msec;
+}
+
+static void iccp_timer_add(struct iccp_timer* timer)
+{
+    struct IccpTimerWheel* wheel = &iccp_timer_wheel;
+    uint64_t max_expire;
+    int level;
+
+    /* Past or current tick goes to the next slot*/
+    if (timer->expire <= wheel->now_tick)
+        timer->expire = wheel->now_tick + 1;
+
+    max_expire = wheel->now_tick + ((uint64_t)ICCP_TIMER_SLOT_MASK << ICCP_TIMER_LEVEL_SHIFT(ICCP_TIMER_WHEEL_LEVELS - 1));
+    if (timer->expire > max_expire)
+        timer->expire = max_expire;
+
+    /* Lowest level where the expire is within one round*/
+    for (level = 0; level < ICCP_TIMER_WHEEL_LEVELS - 1; level++)
+    {
+        if ((timer->expire >> ICCP_TIMER_LEVEL_SHIFT(level)) - (wheel->now_tick >> ICCP_TIMER_LEVEL_SHIFT(level))
+            < ICCP_TIMER_WHEEL_SLOTS)
+            break;
+    }
+
+    LIST_INSERT_HEAD(&wheel->slots[level][(timer->expire >> ICCP_TIMER_LEVEL_SHIFT(level)) & ICCP_TIMER_SLOT_MASK],
+                     timer, next);
+
+    return;
+}
+
+/* Earliest tick the wheel has work at, exact for level 0, slot start
+ * for the levels that are cascaded*/
+static uint64_t iccp_timer_next_tick()
+{
+    struct IccpTimerWheel* wheel = &iccp_timer_wheel;
+    uint64_t next = ICCP_TIMER_TICK_NONE;
+    uint64_t slot_tick;
+    uint64_t base;
+    int level;
+    int i;
+
+    for (level = 0; level < ICCP_TIMER_WHEEL_LEVELS; level++)
+    {
+        base = wheel->now_tick >> ICCP_TIMER_LEVEL_SHIFT(level);
+        for (i = (level == 0) ? 1 : 0; i < ICCP_TIMER_WHEEL_SLOTS; i++)
+        {
+            if (LIST_EMPTY(&wheel->slots[level][(base + i) & ICCP_TIMER_SLOT_MASK]))
+                continue;
+
+            slot_tick = (base + i) << ICCP_TIMER_LEVEL_SHIFT(level);
+            if (slot_tick <= wheel->now_tick)
+                slot_tick = wheel->now_tick + 1;
+            if (slot_tick < next)
+                next = slot_tick;
+            break;
+        }
+    }
+
+    return next;
+}
+
+static void iccp_timer_arm(uint64_t tick)
+{
+    struct IccpTimerWheel* wheel = &iccp_timer_wheel;
+    struct itimerspec its;
+    uint64_t msec;
+
+    if (wheel->fd < 0)
+        return;
+
+    memset(&its, 0, sizeof(its));
+    if (tick != ICCP_TIMER_TICK_NONE)
+    {
+        msec = tick * wheel->tick_msec;
+        its.it_value.tv_sec = wheel->base.tv_sec + msec / 1000;
+        its.it_value.tv_nsec = wheel->base.tv_nsec + (msec % 1000) * 1000000;
+        if (its.it_value.tv_nsec >= 1000000000)
+        {
+            its.it_value.tv_sec++;
+            its.it_value.tv_nsec -= 1000000000;
+        }
+    }
+
+    if (timerfd_settime(wheel->fd, TFD_TIMER_ABSTIME, &its, NULL) < 0)
+    {
+        ICCPD_LOG_WARN(__FUNCTION__, "Failed to arm timer, errno = %d", errno);
+        return;
+    }
+
+    wheel->armed_tick = tick;
+
+    return;
+}
+
+/* Move the timers of a higher level slot down*/
+static void iccp_timer_cascade(int level)
+{
+    struct IccpTimerWheel* wheel = &iccp_timer_wheel;
+    struct iccp_timer_slot* slot = NULL;
+    struct iccp_timer* timer = NULL;
+    struct iccp_timer_slot list;
+
+    slot = &wheel->slots[level][(wheel->now_tick >> ICCP_TIMER_LEVEL_SHIFT(level)) & ICCP_TIMER_SLOT_MASK];
+
+    LIST_INIT(&list);
+    while (!LIST_EMPTY(slot))
+    {
+        timer = LIST_FIRST(slot);
+        LIST_REMOVE(timer, next);
+        LIST_INSERT_HEAD(&list, timer, next);
+    }
+
+    while (!LIST_EMPTY(&list))
+    {
+        timer = LIST_FIRST(&list);
+        LIST_REMOVE(timer, next);
+        iccp_timer_add(timer);
+    }
+
+    return;
+}
+
+int iccp_timer_wheel_init(uint32_t tick_msec)
+{
+    struct IccpTimerWheel* wheel = &iccp_timer_wheel;
+    int level, i;
+
+    if (wheel->fd >= 0)
+        return 0;
+
+    for (level = 0; level < ICCP_TIMER_WHEEL_LEVELS; level++)
+        for (i = 0; i < ICCP_TIMER_WHEEL_SLOTS; i++)
+            LIST_INIT(&wheel->slots[level][i]);
+
+    wheel->fd = timerfd_create(CLOCK_MONOTONIC, TFD_NONBLOCK | TFD_CLOEXEC);
+    if (wheel->fd < 0)
+    {
+        ICCPD_LOG_ERR(__FUNCTION__, "Failed to create timerfd, errno = %d", errno);
+        return MCLAG_ERROR;
+    }
+
+    wheel->tick_msec = (tick_msec > 0 && tick_msec <= ICCP_TIMER_TICK_MAX_MSEC) ? tick_msec : ICCP_TIMER_TICK_MSEC;
+    clock_gettime(CLOCK_MONOTONIC, &wheel->base);
+    wheel->now_tick = 0;
+    wheel->armed_tick = ICCP_TIMER_TICK_NONE;
+    memset(&wheel->stats, 0, sizeof(struct IccpTimerStats));
+
+    return 0;
+}
+
+void iccp_timer_wheel_finalize()
+{
+    struct IccpTimerWheel* wheel = &iccp_timer_wheel;
+    struct iccp_timer* timer = NULL;
+    int level, i;
+
+    for (level = 0; level < ICCP_TIMER_WHEEL_LEVELS; level++)
+    {
+        for (i = 0; i < ICCP_TIMER_WHEEL_SLOTS; i++)
+        {
+            while (!LIST_EMPTY(&wheel->slots[level][i]))
+            {
+                timer = LIST_FIRST(&wheel->slots[level][i]);
+                LIST_REMOVE(timer, next);
+                timer->pending = 0;
+            }
+        }
+    }
+
+    if (wheel->fd >= 0)
+        close(wheel->fd);
+    wheel->fd = -1;
+    wheel->stats.pending = 0;
+
+    return;
+}
+
+/* Only before any timer is started*/
+int iccp_timer_set_tick(uint32_t tick_msec)
+{
+    struct IccpTimerWheel* wheel = &iccp_timer_wheel;
+
+    if (tick_msec == 0 || tick_msec > ICCP_TIMER_TICK_MAX_MSEC)
+        return MCLAG_ERROR;
+    if (wheel->stats.pending)
+        return MCLAG_ERROR;
+
+    wheel->tick_msec = tick_msec;
+    clock_gettime(CLOCK_MONOTONIC, &wheel->base);
+    wheel->now_tick = 0;
+
+    return 0;
+}
+
+uint32_t iccp_timer_get_tick()
+{
+    return iccp_timer_wheel.tick_msec;
+}
+
+const struct IccpTimerStats* iccp_timer_get_stats()
+{
+    return &iccp_timer_wheel.stats;
+}
+
+void iccp_timer_init(struct iccp_timer* timer, void (*handler)(void*), void* arg)
+{
+    memset(timer, 0, sizeof(struct iccp_timer));
+    timer->handler = handler;
+    timer->arg = arg;
+
+    return;
+}
+
+/* (Re)start the timer, it fires once after msec*/
+void iccp_timer_start(struct iccp_timer* timer, uint32_t msec)
+{
+    struct IccpTimerWheel* wheel = &iccp_timer_wheel;
+
+    if (timer->pending)
+        iccp_timer_stop(timer);
+
+    timer->expire = iccp_timer_current_tick() + (msec + wheel->tick_msec - 1) / wheel->tick_msec;
+    iccp_timer_add(timer);
+    timer->pending = 1;
+    wheel->stats.pending++;
+
+    if (timer->expire < wheel->armed_tick)
+        iccp_timer_arm(iccp_timer_next_tick());
+
+    return;
+}
+
+/* timerfd is not re-armed, an early wakeup finds nothing to do*/
+void iccp_timer_stop(struct iccp_timer* timer)
+{
+    if (!timer->pending)
+        return;
+
+    LIST_REMOVE(timer, next);
+    timer->pending = 0;
+    iccp_timer_wheel.stats.pending--;
+
+    return;
+}
+
+int iccp_timer_get_fd(struct System* sys)
+{
+    return iccp_timer_wheel.fd;
+}
+
+/* Run the timers up to the current tick*/
+int iccp_timer_handler(struct System* sys)
+{
+    struct IccpTimerWheel* wheel = &iccp_timer_wheel;
+    struct iccp_timer_slot* slot = NULL;
+    struct iccp_timer* timer = NULL;
+    uint64_t expirations;
+    uint64_t target;
+    int level;
+
+    if (read(wheel->fd, &expirations, sizeof(expirations)) < 0 && errno != EAGAIN)
+        return MCLAG_ERROR;
+
+    wheel->stats.wakeups++;
+    wheel->armed_tick = ICCP_TIMER_TICK_NONE;
+    target = iccp_timer_current_tick();
+
+    while (wheel->now_tick < target)
+    {
+        wheel->now_tick++;
+
+        /* Cascade from the highest level that wraps at this tick*/
+        for (level = 1; level < ICCP_TIMER_WHEEL_LEVELS; level++)
+        {
+            if ((wheel->now_tick & ((1ULL << ICCP_TIMER_LEVEL_SHIFT(level)) - 1)) != 0)
+                break;
+        }
+        for (level = level - 1; level >= 1; level--)
+            iccp_timer_cascade(level);
+
+        slot = &wheel->slots[0][wheel->now_tick & ICCP_TIMER_SLOT_MASK];
+        while (!LIST_EMPTY(slot))
+        {
+            timer = LIST_FIRST(slot);
+            LIST_REMOVE(timer, next);
+            timer->pending = 0;
+            wheel->stats.pending--;
+            wheel->stats.expired++;
+
+            /* Handler may start the timer again*/
+            timer->handler(timer->arg);
+        }
+    }
+
+    iccp_timer_arm(iccp_timer_next_tick());
+
+    return 0;
+}
@@ -20,14 +20,61 @@
  *
  *  Maintainer: jianjun, grace Li from nephos
  */
+#include <errno.h>
+#include <fcntl.h>
+#include <poll.h>
 #include <stdio.h>
 #include <stdarg.h>
 #include <stdlib.h>
+#include <string.h>
+#include <signal.h>
+#include <pthread.h>
 #include <time.h>
+#include <unistd.h>
+#include <sys/eventfd.h>
 
 #include "../include/cmd_option.h"
 #include "../include/logger.h"
 
+#define LOG_RING_CACHE_LINE     64
+
+/* Multi producer, single consumer ring. A producer claims a slot by head
+ * and publishes it by the slot seq, the writer thread is the only consumer.
+ * Producers never wait, the record is dropped if the ring is full.*/
+struct LogRing
+{
+    struct LogRecord* ring;
+    uint64_t mask;
+    int event_fd;
+    int running;    /* records go to the ring, syslog directly otherwise*/
+    int stop;
+    pthread_t thread;
+
+    uint64_t head __attribute__((aligned(LOG_RING_CACHE_LINE)));
+    uint64_t dropped;
+    uint64_t suppressed;
+
+    uint64_t tail __attribute__((aligned(LOG_RING_CACHE_LINE)));
+    uint64_t written;
+    int sleeping;   /* writer waits on event_fd*/
+};
+
+/* Rate limit state of a call site, keyed by the format string*/
+struct LogRateSite
+{
+    const char* format;
+    const char* tag;
+    uint64_t window_msec;
+    uint32_t count;
+    uint32_t suppressed;
+    int level;
+};
+
+static struct LogRing log_ring = { .event_fd = -1 };
+
+/* Per thread, so that the check takes no lock*/
+static __thread struct LogRateSite log_rate_sites[LOG_RATE_SITES];
+
 static uint32_t _iccpd_log_level_map[] =
 {
     LOG_CRIT,
@@ -88,16 +135,400 @@ void logger_set_configuration(int log_level)
     return;
 }
 
+static uint64_t log_now_msec()
+{
+    struct timespec now;
+
+    clock_gettime(CLOCK_MONOTONIC_COARSE, &now);
+
+    return (uint64_t)now.tv_sec * 1000 + now.tv_nsec / 1000000;
+}
+
+static int log_ring_push(int level, const char* text, int len)
+{
+    struct LogRing* lr = &log_ring;
+    struct LogRecord* rec = NULL;
+    struct timespec now;
+    uint64_t pos, seq;
+    uint64_t val = 1;
+    int64_t dif;
+
+    pos = __atomic_load_n(&lr->head, __ATOMIC_RELAXED);
+    while (1)
+    {
+        rec = &lr->ring[pos & lr->mask];
+        seq = __atomic_load_n(&rec->seq, __ATOMIC_ACQUIRE);
+        dif = (int64_t)(seq - pos);
+
+        if (dif == 0)
+        {
+            if (__atomic_compare_exchange_n(&lr->head, &pos, pos + 1, 1, __ATOMIC_RELAXED, __ATOMIC_RELAXED))
+                break;
+        }
+        else if (dif < 0)
+        {
+            __atomic_fetch_add(&lr->dropped, 1, __ATOMIC_RELAXED);
+            return -1;
+        }
+        else
+        {
+            pos = __atomic_load_n(&lr->head, __ATOMIC_RELAXED);
+        }
+    }
+
+    /* pos first, a ring dump drops the slot if pos and seq do not match*/
+    __atomic_store_n(&rec->pos, pos, __ATOMIC_RELAXED);
+    __atomic_thread_fence(__ATOMIC_RELEASE);
+
+    if (len >= LOG_RING_TEXT_SIZE)
+        len = LOG_RING_TEXT_SIZE - 1;
+    clock_gettime(CLOCK_REALTIME, &now);
+    rec->usec = (uint64_t)now.tv_sec * 1000000 + now.tv_nsec / 1000;
+    rec->level = level;
+    rec->len = len;
+    memcpy(rec->text, text, len);
+    rec->text[len] = '\0';
+
+    __atomic_store_n(&rec->seq, pos + 1, __ATOMIC_RELEASE);
+
+    /* Wake up the writer only if it is idle*/
+    __atomic_thread_fence(__ATOMIC_SEQ_CST);
+    if (__atomic_load_n(&lr->sleeping, __ATOMIC_RELAXED)
+        && __atomic_exchange_n(&lr->sleeping, 0, __ATOMIC_ACQ_REL))
+    {
+        if (write(lr->event_fd, &val, sizeof(val)) < 0)
+        {
+            /*Writer wakes up by the poll timeout*/
+        }
+    }
+
+    return 0;
+}
+
+static void log_emit(int level, const char* text, int len)
+{
+    if (__atomic_load_n(&log_ring.running, __ATOMIC_ACQUIRE))
+    {
+        log_ring_push(level, text, len);
+        return;
+    }
+
+    ICCPD_UTILS_SYSLOG(_iccpd_log_level_map[level], "%s", text);
+}
+
+static void log_rate_summary(struct LogRateSite* site)
+{
+    char buf[LOGBUF_SIZE];
+    int len;
+
+    len = snprintf(buf, LOGBUF_SIZE, "[%s.%s] %u similar messages suppressed: %s",
+                   site->tag, log_level_to_string(site->level), site->suppressed, site->format);
+    if (len >= LOGBUF_SIZE)
+        len = LOGBUF_SIZE - 1;
+
+    log_emit(site->level, buf, len);
+    site->suppressed = 0;
+}
+
+/* Return 0 if the call site is over its burst in this window*/
+static int log_rate_check(int level, const char* tag, const char* format)
+{
+    struct LogRateSite* site = NULL;
+    uint64_t now;
+
+    if (level == CRITICAL_LOG_LEVEL)
+        return 1;
+
+    site = &log_rate_sites[(((uintptr_t)format) >> 3) & (LOG_RATE_SITES - 1)];
+    now = log_now_msec();
+
+    if (site->format != format)
+    {
+        if (site->suppressed)
+            log_rate_summary(site);
+
+        site->format = format;
+        site->tag = tag;
+        site->level = level;
+        site->window_msec = now;
+        site->count = 0;
+    }
+    else if (now - site->window_msec >= LOG_RATE_WINDOW_MSEC)
+    {
+        if (site->suppressed)
+            log_rate_summary(site);
+
+        site->window_msec = now;
+        site->count = 0;
+    }
+
+    if (++site->count <= LOG_RATE_BURST)
+        return 1;
+
+    site->suppressed++;
+    __atomic_fetch_add(&log_ring.suppressed, 1, __ATOMIC_RELAXED);
+
+    return 0;
+}
+
+/* Write the summary of the sites of this thread whose window closed without
+ * another record, return the number of sites still holding suppressed ones*/
+int log_rate_flush()
+{
+    struct LogRateSite* site = NULL;
+    uint64_t now;
+    int i, pending = 0;
+
+    now = log_now_msec();
+    for (i = 0; i < LOG_RATE_SITES; i++)
+    {
+        site = &log_rate_sites[i];
+        if (site->suppressed == 0)
+            continue;
+
+        if (now - site->window_msec < LOG_RATE_WINDOW_MSEC)
+        {
+            pending++;
+            continue;
+        }
+
+        log_rate_summary(site);
+        site->window_msec = now;
+        site->count = 0;
+    }
+
+    return pending;
+}
+
+static int log_ring_drain(struct LogRing* lr)
+{
+    struct LogRecord* rec = NULL;
+    uint64_t seq;
+    int num = 0;
+
+    while (1)
+    {
+        rec = &lr->ring[lr->tail & lr->mask];
+        seq = __atomic_load_n(&rec->seq, __ATOMIC_ACQUIRE);
+        if (seq != lr->tail + 1)
+            break;
+
+        ICCPD_UTILS_SYSLOG(_iccpd_log_level_map[rec->level], "%s", rec->text);
+
+        __atomic_store_n(&rec->seq, lr->tail + LOG_RING_SIZE, __ATOMIC_RELEASE);
+        lr->tail++;
+        __atomic_store_n(&lr->written, lr->written + 1, __ATOMIC_RELAXED);
+        num++;
+    }
+
+    return num;
+}
+
+static void* log_ring_thread(void* arg)
+{
+    struct LogRing* lr = (struct LogRing*)arg;
+    struct pollfd pfd;
+    uint64_t dropped = 0;
+    uint64_t now_dropped;
+    uint64_t val;
+    sigset_t mask;
+
+    /* Signals are handled by the main thread*/
+    sigfillset(&mask);
+    pthread_sigmask(SIG_BLOCK, &mask, NULL);
+
+    pfd.fd = lr->event_fd;
+    pfd.events = POLLIN;
+
+    while (1)
+    {
+        log_ring_drain(lr);
+
+        now_dropped = __atomic_load_n(&lr->dropped, __ATOMIC_RELAXED);
+        if (now_dropped != dropped)
+        {
+            ICCPD_UTILS_SYSLOG(LOG_WARNING, "[%s.%s] %llu log messages dropped, log ring is full",
+                               __FUNCTION__, log_level_to_string(WARN_LOG_LEVEL),
+                               (unsigned long long)(now_dropped - dropped));
+            dropped = now_dropped;
+        }
+
+        if (__atomic_load_n(&lr->stop, __ATOMIC_ACQUIRE))
+        {
+            log_ring_drain(lr);
+            break;
+        }
+
+        /* Check the ring again after sleeping is visible to the producers*/
+        __atomic_store_n(&lr->sleeping, 1, __ATOMIC_RELAXED);
+        __atomic_thread_fence(__ATOMIC_SEQ_CST);
+        if (__atomic_load_n(&lr->ring[lr->tail & lr->mask].seq, __ATOMIC_ACQUIRE) == lr->tail + 1)
+        {
+            __atomic_store_n(&lr->sleeping, 0, __ATOMIC_RELAXED);
+            continue;
+        }
+
+        if (poll(&pfd, 1, 1000) > 0)
+        {
+            if (read(lr->event_fd, &val, sizeof(val)) < 0)
+            {
+                /*Nothing to do, the ring is checked anyway*/
+            }
+        }
+        __atomic_store_n(&lr->sleeping, 0, __ATOMIC_RELAXED);
+    }
+
+    return NULL;
+}
+
+static void log_fatal_signal_handler(int sig)
+{
+    log_ring_dump(LOG_RING_FILE);
+    raise(sig);
+}
+
+static void log_ring_start()
+{
+    struct LogRing* lr = &log_ring;
+    struct sigaction sa;
+    static const int fatal_sigs[] = { SIGSEGV, SIGBUS, SIGFPE, SIGILL, SIGABRT };
+    uint64_t i;
+
+    if (lr->ring)
+        return;
+
+    lr->ring = (struct LogRecord*)calloc(LOG_RING_SIZE, sizeof(struct LogRecord));
+    if (!lr->ring)
+        return;
+
+    for (i = 0; i < LOG_RING_SIZE; i++)
+        lr->ring[i].seq = i;
+    lr->mask = LOG_RING_SIZE - 1;
+
+    lr->event_fd = eventfd(0, EFD_NONBLOCK | EFD_CLOEXEC);
+    if (lr->event_fd < 0)
+        goto free_ring;
+
+    if (pthread_create(&lr->thread, NULL, log_ring_thread, lr) != 0)
+        goto close_fd;
+
+    __atomic_store_n(&lr->running, 1, __ATOMIC_RELEASE);
+
+    /* Dump the ring for post-mortem, then die by the default action*/
+    memset(&sa, 0, sizeof(sa));
+    sa.sa_handler = log_fatal_signal_handler;
+    sigemptyset(&sa.sa_mask);
+    sa.sa_flags = SA_RESETHAND;
+    for (i = 0; i < sizeof(fatal_sigs) / sizeof(fatal_sigs[0]); i++)
+        sigaction(fatal_sigs[i], &sa, NULL);
+
+    return;
+
+ close_fd:
+    close(lr->event_fd);
+    lr->event_fd = -1;
+ free_ring:
+    free(lr->ring);
+    lr->ring = NULL;
+    return;
+}
+
 void log_init(struct CmdOptionParser* parser)
 {
     struct LoggerConfig* config = logger_get_configuration();
 
     config->console_log_enabled = parser->console_log;
+
+    log_ring_start();
 }
 
 void log_finalize()
 {
-    /*do nothing*/
+    struct LogRing* lr = &log_ring;
+    uint64_t val = 1;
+
+    if (!__atomic_load_n(&lr->running, __ATOMIC_ACQUIRE))
+        return;
+
+    /* Later records go to syslog directly, the ring is kept for the
+     * producers that already passed the running check*/
+    __atomic_store_n(&lr->running, 0, __ATOMIC_RELEASE);
+    __atomic_store_n(&lr->stop, 1, __ATOMIC_RELEASE);
+    if (write(lr->event_fd, &val, sizeof(val)) < 0)
+    {
+        /*Writer stops by the poll timeout*/
+    }
+    pthread_join(lr->thread, NULL);
+
+    close(lr->event_fd);
+    lr->event_fd = -1;
+
+    return;
+}
+
+void log_get_stats(struct LogStats* stats)
+{
+    stats->written = __atomic_load_n(&log_ring.written, __ATOMIC_RELAXED);
+    stats->dropped = __atomic_load_n(&log_ring.dropped, __ATOMIC_RELAXED);
+    stats->suppressed = __atomic_load_n(&log_ring.suppressed, __ATOMIC_RELAXED);
+
+    return;
+}
+
+static int log_write_all(int fd, const char* buf, size_t left)
+{
+    ssize_t len;
+
+    while (left > 0)
+    {
+        len = write(fd, buf, left);
+        if (len < 0 && errno == EINTR)
+            continue;
+        if (len <= 0)
+            return -1;
+
+        buf += len;
+        left -= len;
+    }
+
+    return 0;
+}
+
+/* Raw slots are written as is, records queued while dumping may be torn
+ * and are dropped by the reader*/
+int log_ring_dump(const char* path)
+{
+    struct LogRing* lr = &log_ring;
+    struct LogRingFileHdr hdr;
+    int fd;
+
+    if (!lr->ring)
+        return -1;
+
+    fd = open(path, O_WRONLY | O_CREAT | O_TRUNC | O_CLOEXEC, 0644);
+    if (fd < 0)
+        return -1;
+
+    memset(&hdr, 0, sizeof(hdr));
+    hdr.magic = LOG_RING_MAGIC;
+    hdr.version = LOG_RING_VERSION;
+    hdr.record_size = sizeof(struct LogRecord);
+    hdr.records = LOG_RING_SIZE;
+    hdr.head = __atomic_load_n(&lr->head, __ATOMIC_RELAXED);
+    hdr.tail = __atomic_load_n(&lr->tail, __ATOMIC_RELAXED);
+    hdr.dropped = __atomic_load_n(&lr->dropped, __ATOMIC_RELAXED);
+    hdr.suppressed = __atomic_load_n(&lr->suppressed, __ATOMIC_RELAXED);
+
+    if (log_write_all(fd, (const char*)&hdr, sizeof(hdr)) < 0
+        || log_write_all(fd, (const char*)lr->ring, LOG_RING_SIZE * sizeof(struct LogRecord)) < 0)
+    {
+        close(fd);
+        return -1;
+    }
+
+    close(fd);
+
+    return LOG_RING_SIZE;
 }
 
 void write_log(const int level, const char* tag, const char* format, ...)
@@ -117,6 +548,9 @@ void write_log(const int level, const char* tag, const char* format, ...)
     if (level > config->log_level)
         return;
 
+    if (!log_rate_check(level, tag, format))
+        return;
+
     prefix_len = snprintf(buf, LOGBUF_SIZE, "[%s.%s] ", tag, log_level_to_string(level));
     avbl_buf_len = LOGBUF_SIZE - prefix_len;
 
@@ -127,13 +561,13 @@ void write_log(const int level, const char* tag, const char* format, ...)
     /* Since osal_vsnprintf doesn't always return the exact size written to the buffer,
      * we must check if the user string length exceeds the remaing buffer size.
      */
-    if (print_len > avbl_buf_len)
+    if (print_len >= avbl_buf_len)
     {
-        print_len = avbl_buf_len;
+        print_len = avbl_buf_len - 1;
     }
 
     buf[prefix_len + print_len] = '\0';
-    ICCPD_UTILS_SYSLOG(_iccpd_log_level_map[level], "%s", buf);
+    log_emit(level, buf, prefix_len + print_len);
 
     return;
 }
@@ -0,0 +1,1681 @@
+/*
+ *  mclagbench.c
+ *  MC-LAG scale benchmark, two iccpd instances with a stand-in mclagsyncd.
+ *
+ * Copyright(c) 2016-2019 Nephos/Estinet.
+ *
+ * This program is free software; you can redistribute it and/or modify it
+ * under the terms and conditions of the GNU General Public License,
+ * version 2, as published by the Free Software Foundation.
+ *
+ * This program is distributed in the hope it will be useful, but WITHOUT
+ * ANY WARRANTY; without even the implied warranty of MERCHANTABILITY or
+ * FITNESS FOR A PARTICULAR PURPOSE.  See the GNU General Public License for
+ * more details.
+ *
+ * You should have received a copy of the GNU General Public License along with
+ * this program; if not, see <http://www.gnu.org/licenses/>.
+ *
+ * The full GNU General Public License is included in this distribution in
+ * the file called "COPYING".
+ *
+ *  Maintainer: jianjun, grace Li from nephos
+ */
+
+/*
+ * Each iccpd runs in its own network and mount namespace, created from
+ * a user namespace when not started by root:
+ *
+ *   node 1                                   node 2
+ *   bench0 10.250.0.1  <---- veth ---->  bench0 10.250.0.2    ICCP session
+ *   Ethernet0          <---- veth ---->  Ethernet0            peer-link
+ *   PortChannelNNNN (team or veth)       PortChannelNNNN      mclag itfs
+ *   Bridge, Vlan1000 192.168.0.1/16      Bridge, Vlan1000 192.168.0.2/16
+ *
+ * The benchmark listens on 127.0.0.6:2626 of each node as mclagsyncd.
+ * MACs are injected into node 1 and are synced when node 2 programs them.
+ * ARP/ND entries are added to the kernel of node 1 and are synced when
+ * they show up in the kernel of node 2. Port-channel flaps toggle the
+ * carrier of a node 1 port-channel and wait for the FDB to settle.
+ *
+ * Needs the veth, bridge (with VLAN filtering) and 8021q drivers, the
+ * exit status is 77 if the topology can't be built. A port-channel is a
+ * team device if the team driver is loaded, else a veth to PoPeerNNNN
+ * whose admin state drives the carrier; iccpd only tells port-channels
+ * by their name.
+ */
+
+#define _GNU_SOURCE
+
+#include <stdio.h>
+#include <stdlib.h>
+#include <stdarg.h>
+#include <stdint.h>
+#include <string.h>
+#include <unistd.h>
+#include <errno.h>
+#include <fcntl.h>
+#include <limits.h>
+#include <poll.h>
+#include <sched.h>
+#include <signal.h>
+#include <time.h>
+#include <ftw.h>
+#include <net/if.h>
+#include <arpa/inet.h>
+#include <netinet/in.h>
+#include <sys/mount.h>
+#include <sys/prctl.h>
+#include <sys/socket.h>
+#include <sys/stat.h>
+#include <sys/un.h>
+#include <sys/wait.h>
+#include <linux/netlink.h>
+#include <linux/rtnetlink.h>
+#include <linux/neighbour.h>
+
+#include "../../include/mlacp_tlv.h"
+#include "../mclagdctl/mclagdctl.h"
+
+#define BENCH_NODE_NUM          2
+/* Exit status of a skipped automake test*/
+#define BENCH_EXIT_SKIP         77
+#define BENCH_MCLAG_ID          1
+#define BENCH_VLAN_ID           1000
+#define BENCH_PEER_LINK         "Ethernet0"
+#define BENCH_SESSION_IF        "bench0"
+/* Peer end of a veth port-channel*/
+#define BENCH_PO_PEER           "PoPeer"
+#define BENCH_WORK_DIR          "/tmp/mclagbench.XXXXXX"
+#define BENCH_RUN_DIR           "/var/run"
+/* Under the run dir*/
+#define BENCH_CTL_SOCK_PATH     "/iccpd/mclagdctl.sock"
+
+/* Where iccpd connects to mclagsyncd*/
+#define BENCH_SYNCD_ADDR        0x7f000006
+#define BENCH_SYNCD_PORT        2626
+#define BENCH_SYNCD_RX_SIZE     65536
+
+/* FDB entries per mclagsyncd msg, the msg len is 16 bits*/
+#define BENCH_FDB_BATCH         1000
+
+#define BENCH_POLL_MSEC         5
+#define BENCH_NEIGH_POLL_MSEC   50
+/* No mclagsyncd msg for this long, the FDB is settled*/
+#define BENCH_SETTLE_MSEC       500
+/* Wait after the session is up, for the initial sync to finish*/
+#define BENCH_SESSION_GRACE_MSEC 2000
+
+/* 192.168.1.1 - 192.168.255.250 in the Vlan /16*/
+#define BENCH_ARP_MAX           (255 * 250)
+
+enum bench_phase_type
+{
+    BENCH_PHASE_MAC = 0,
+    BENCH_PHASE_ARP,
+    BENCH_PHASE_ND,
+    BENCH_PHASE_FLAP_DOWN,
+    BENCH_PHASE_FLAP_UP,
+    BENCH_PHASE_MAX
+};
+
+static const char* bench_phase_name[BENCH_PHASE_MAX] =
+{
+    [BENCH_PHASE_MAC]       = "mac-sync",
+    [BENCH_PHASE_ARP]       = "arp-sync",
+    [BENCH_PHASE_ND]        = "nd-sync",
+    [BENCH_PHASE_FLAP_DOWN] = "po-down",
+    [BENCH_PHASE_FLAP_UP]   = "po-up",
+};
+
+struct bench_config
+{
+    int entries;
+    int po_num;
+    int flaps;
+    int timeout_sec;
+    int bulk_redirect;
+    int keep_dir;
+    int phases;     /* bit per bench_phase_type*/
+    char iccpd_path[PATH_MAX];
+};
+
+/* Stand-in mclagsyncd of one node*/
+struct bench_syncd
+{
+    int listen_fd;
+    int fd;
+    char rx_buf[BENCH_SYNCD_RX_SIZE];
+    uint32_t rx_len;
+    char* tx_buf;
+    size_t tx_len;
+    size_t tx_off;
+
+    uint64_t frames;
+    uint64_t fdb_add;
+    uint64_t fdb_del;
+    uint64_t fdb_peer_link;     /* ADD entries pointing to the peer-link*/
+    uint64_t redirects;
+    uint64_t last_usec;         /* last msg from iccpd*/
+    int subscribed;             /* FDB changes are pushed as deltas*/
+    uint32_t seq;               /* seq of the last delta*/
+};
+
+struct bench_proc_stats
+{
+    uint64_t syscalls;      /* read and write class syscalls*/
+    uint64_t cpu_msec;
+    uint64_t hwm_kb;
+    uint64_t iccp_tx_msgs;
+    uint64_t iccp_rx_msgs;
+};
+
+struct bench_node
+{
+    int id;
+    pid_t holder;       /* keeps the netns of node 2*/
+    int netns_fd;
+    int nl_fd;          /* rtnetlink socket in the node netns*/
+    int vlan_ifindex;
+    pid_t iccpd;
+    char dir[PATH_MAX];
+    struct bench_syncd syncd;
+};
+
+struct bench_result
+{
+    int runs;
+    int failed;
+    uint64_t entries;
+    uint64_t usec;
+    uint64_t max_usec;
+    uint64_t iccp_msgs;
+    uint64_t syscalls[BENCH_NODE_NUM];
+    uint64_t cpu_msec[BENCH_NODE_NUM];
+};
+
+static struct bench_config bench_cfg =
+{
+    .entries = 10000,
+    .po_num = 4,
+    .flaps = 4,
+    .timeout_sec = 60,
+    .bulk_redirect = 0,
+    .keep_dir = 0,
+    .phases = (1 << BENCH_PHASE_MAX) - 1,
+};
+
+static struct bench_node bench_nodes[BENCH_NODE_NUM];
+static struct bench_result bench_results[BENCH_PHASE_MAX];
+static char bench_dir[sizeof(BENCH_WORK_DIR)];
+static int bench_self_netns = -1;
+/* Symlinks in /proc/<pid>/root paths resolve in our own root, the run
+ * dir is often a link to /run*/
+static char bench_run_dir[PATH_MAX];
+
+static uint64_t bench_now_usec()
+{
+    struct timespec now;
+
+    clock_gettime(CLOCK_MONOTONIC, &now);
+
+    return (uint64_t)now.tv_sec * 1000000 + now.tv_nsec / 1000;
+}
+
+static int bench_write_file(const char* path, const char* fmt, ...)
+{
+    va_list ap;
+    FILE* fp = NULL;
+    int ret;
+
+    if ((fp = fopen(path, "w")) == NULL)
+        return -1;
+
+    va_start(ap, fmt);
+    ret = vfprintf(fp, fmt, ap);
+    va_end(ap);
+
+    if (fclose(fp) != 0)
+        ret = -1;
+
+    return ret < 0 ? -1 : 0;
+}
+
+/****************************************
+* Namespaces
+****************************************/
+
+/* The benchmark itself becomes node 1*/
+static int bench_enter_namespaces()
+{
+    uid_t uid = getuid();
+    gid_t gid = getgid();
+    int flags = CLONE_NEWNET | CLONE_NEWNS;
+
+    if (uid != 0)
+        flags |= CLONE_NEWUSER;
+
+    if (unshare(flags) < 0)
+    {
+        fprintf(stderr, "Failed to create namespaces: %s\n", strerror(errno));
+        return -1;
+    }
+
+    if (uid != 0)
+    {
+        if (bench_write_file("/proc/self/setgroups", "deny") < 0
+            || bench_write_file("/proc/self/uid_map", "0 %u 1", uid) < 0
+            || bench_write_file("/proc/self/gid_map", "0 %u 1", gid) < 0)
+        {
+            fprintf(stderr, "Failed to map uid %u in the user namespace\n", uid);
+            return -1;
+        }
+    }
+
+    /* Mounts of each iccpd stay in its own namespace*/
+    if (mount(NULL, "/", NULL, MS_REC | MS_PRIVATE, NULL) < 0)
+    {
+        fprintf(stderr, "Failed to make mounts private: %s\n", strerror(errno));
+        return -1;
+    }
+
+    bench_self_netns = open("/proc/self/ns/net", O_RDONLY | O_CLOEXEC);
+
+    return bench_self_netns < 0 ? -1 : 0;
+}
+
+static int bench_node_netns_create(struct bench_node* node)
+{
+    char path[64];
+    int pfd[2];
+    char c = 0;
+
+    if (node->id == 1)
+    {
+        node->netns_fd = dup(bench_self_netns);
+        return node->netns_fd < 0 ? -1 : 0;
+    }
+
+    if (pipe(pfd) < 0)
+        return -1;
+
+    node->holder = fork();
+    if (node->holder < 0)
+        return -1;
+
+    if (node->holder == 0)
+    {
+        prctl(PR_SET_PDEATHSIG, SIGKILL);
+        close(pfd[0]);
+        if (unshare(CLONE_NEWNET) == 0)
+            write(pfd[1], "1", 1);
+        close(pfd[1]);
+        pause();
+        _exit(0);
+    }
+
+    close(pfd[1]);
+    if (read(pfd[0], &c, 1) != 1)
+    {
+        close(pfd[0]);
+        fprintf(stderr, "Failed to create the netns of node %d\n", node->id);
+        return -1;
+    }
+    close(pfd[0]);
+
+    snprintf(path, sizeof(path), "/proc/%d/ns/net", node->holder);
+    node->netns_fd = open(path, O_RDONLY | O_CLOEXEC);
+
+    return node->netns_fd < 0 ? -1 : 0;
+}
+
+static int bench_node_enter(struct bench_node* node)
+{
+    return setns(node->netns_fd, CLONE_NEWNET);
+}
+
+static void bench_node_leave()
+{
+    setns(bench_self_netns, CLONE_NEWNET);
+
+    return;
+}
+
+/****************************************
+* Stand-in mclagsyncd
+****************************************/
+
+static int bench_syncd_listen(struct bench_node* node)
+{
+    struct sockaddr_in addr;
+    int optval = 1;
+    int fd;
+
+    if (bench_node_enter(node) < 0)
+        return -1;
+
+    fd = socket(AF_INET, SOCK_STREAM | SOCK_NONBLOCK | SOCK_CLOEXEC, 0);
+    bench_node_leave();
+    if (fd < 0)
+        return -1;
+
+    setsockopt(fd, SOL_SOCKET, SO_REUSEADDR, &optval, sizeof(optval));
+
+    memset(&addr, 0, sizeof(addr));
+    addr.sin_family = AF_INET;
+    addr.sin_port = htons(BENCH_SYNCD_PORT);
+    addr.sin_addr.s_addr = htonl(BENCH_SYNCD_ADDR);
+
+    if (bind(fd, (struct sockaddr*)&addr, sizeof(addr)) < 0 || listen(fd, 1) < 0)
+    {
+        fprintf(stderr, "Node %d: failed to listen on the mclagsyncd port: %s\n", node->id, strerror(errno));
+        close(fd);
+        return -1;
+    }
+
+    node->syncd.listen_fd = fd;
+    node->syncd.fd = -1;
+
+    return 0;
+}
+
+static void bench_syncd_accept(struct bench_node* node)
+{
+    struct bench_syncd* syncd = &node->syncd;
+    int fd;
+
+    fd = accept4(syncd->listen_fd, NULL, NULL, SOCK_NONBLOCK | SOCK_CLOEXEC);
+    if (fd < 0)
+        return;
+
+    /* iccpd reconnected, the old connection is gone*/
+    if (syncd->fd >= 0)
+        close(syncd->fd);
+
+    syncd->fd = fd;
+    syncd->rx_len = 0;
+    syncd->subscribed = 0;
+
+    return;
+}
+
+static void bench_syncd_close(struct bench_syncd* syncd)
+{
+    if (syncd->fd >= 0)
+        close(syncd->fd);
+
+    syncd->fd = -1;
+    syncd->rx_len = 0;
+
+    return;
+}
+
+/* Append to what is left to write*/
+static int bench_syncd_queue(struct bench_syncd* syncd, const char* buf, size_t len)
+{
+    char* tx_buf = NULL;
+
+    tx_buf = (char*)realloc(syncd->tx_buf, syncd->tx_len + len);
+    if (tx_buf == NULL)
+        return -1;
+
+    memcpy(tx_buf + syncd->tx_len, buf, len);
+    syncd->tx_buf = tx_buf;
+    syncd->tx_len += len;
+
+    return 0;
+}
+
+/* The bench FDB is empty between phases, the snapshot has no entry*/
+static void bench_syncd_subscribe(struct bench_syncd* syncd)
+{
+    char buf[sizeof(struct IccpSyncdHDr) + sizeof(struct mclag_fdb_delta_hdr)];
+    struct IccpSyncdHDr* msg_hdr = (struct IccpSyncdHDr*)buf;
+    struct mclag_fdb_delta_hdr* delta = (struct mclag_fdb_delta_hdr*)(msg_hdr + 1);
+
+    memset(buf, 0, sizeof(buf));
+    msg_hdr->ver = 1;
+    msg_hdr->type = MCLAG_SYNCD_MSG_TYPE_FDB_DELTA;
+    msg_hdr->len = sizeof(buf);
+    delta->seq = ++syncd->seq;
+    delta->flags = MCLAG_FDB_DELTA_SNAPSHOT | MCLAG_FDB_DELTA_SNAPSHOT_END;
+
+    if (bench_syncd_queue(syncd, buf, sizeof(buf)) == 0)
+        syncd->subscribed = 1;
+
+    return;
+}
+
+static void bench_syncd_handle_msg(struct bench_syncd* syncd, const char* buf, int len)
+{
+    const struct IccpSyncdHDr* msg_hdr = (const struct IccpSyncdHDr*)buf;
+    const struct mclag_fdb_info* fdb = NULL;
+    int count;
+    int i;
+
+    syncd->frames++;
+    syncd->last_usec = bench_now_usec();
+
+    if (msg_hdr->type == MCLAG_MSG_TYPE_REDIRECT_FDB)
+    {
+        syncd->redirects++;
+        return;
+    }
+
+    if (msg_hdr->type == MCLAG_MSG_TYPE_SUBSCRIBE_FDB)
+    {
+        bench_syncd_subscribe(syncd);
+        return;
+    }
+
+    if (msg_hdr->type != MCLAG_MSG_TYPE_SET_FDB)
+        return;
+
+    count = (len - sizeof(struct IccpSyncdHDr)) / sizeof(struct mclag_fdb_info);
+    for (i = 0; i < count; i++)
+    {
+        fdb = (const struct mclag_fdb_info*)(buf + sizeof(struct IccpSyncdHDr) + i * sizeof(struct mclag_fdb_info));
+
+        if (fdb->op_type == MAC_SYNC_ADD)
+        {
+            syncd->fdb_add++;
+            if (strncmp(fdb->port_name, BENCH_PEER_LINK, MAX_L_PORT_NAME) == 0)
+                syncd->fdb_peer_link++;
+        }
+        else if (fdb->op_type == MAC_SYNC_DEL)
+        {
+            syncd->fdb_del++;
+        }
+    }
+
+    return;
+}
+
+static void bench_syncd_read(struct bench_syncd* syncd)
+{
+    const struct IccpSyncdHDr* msg_hdr = NULL;
+    uint32_t pos = 0;
+    ssize_t n;
+
+    n = read(syncd->fd, syncd->rx_buf + syncd->rx_len, sizeof(syncd->rx_buf) - syncd->rx_len);
+    if (n < 0 && (errno == EAGAIN || errno == EINTR))
+        return;
+
+    if (n <= 0)
+    {
+        bench_syncd_close(syncd);
+        return;
+    }
+
+    syncd->rx_len += n;
+
+    while (syncd->rx_len - pos >= sizeof(struct IccpSyncdHDr))
+    {
+        msg_hdr = (const struct IccpSyncdHDr*)(syncd->rx_buf + pos);
+        if (msg_hdr->len < sizeof(struct IccpSyncdHDr))
+        {
+            bench_syncd_close(syncd);
+            return;
+        }
+
+        if (syncd->rx_len - pos < msg_hdr->len)
+            break;
+
+        bench_syncd_handle_msg(syncd, syncd->rx_buf + pos, msg_hdr->len);
+        pos += msg_hdr->len;
+    }
+
+    if (pos > 0)
+    {
+        syncd->rx_len -= pos;
+        memmove(syncd->rx_buf, syncd->rx_buf + pos, syncd->rx_len);
+    }
+
+    return;
+}
+
+static void bench_syncd_write(struct bench_syncd* syncd)
+{
+    ssize_t n;
+
+    n = write(syncd->fd, syncd->tx_buf + syncd->tx_off, syncd->tx_len - syncd->tx_off);
+    if (n < 0)
+    {
+        if (errno != EAGAIN && errno != EINTR)
+            bench_syncd_close(syncd);
+        return;
+    }
+
+    syncd->tx_off += n;
+    if (syncd->tx_off == syncd->tx_len)
+    {
+        free(syncd->tx_buf);
+        syncd->tx_buf = NULL;
+        syncd->tx_len = 0;
+        syncd->tx_off = 0;
+    }
+
+    return;
+}
+
+/* Service the mclagsyncd sockets of all nodes for up to msec*/
+static void bench_poll(int msec)
+{
+    struct pollfd pfds[BENCH_NODE_NUM * 2];
+    struct bench_node* owner[BENCH_NODE_NUM * 2];
+    int is_listen[BENCH_NODE_NUM * 2];
+    struct bench_syncd* syncd = NULL;
+    int num = 0;
+    int i;
+
+    for (i = 0; i < BENCH_NODE_NUM; i++)
+    {
+        syncd = &bench_nodes[i].syncd;
+
+        if (syncd->listen_fd >= 0)
+        {
+            pfds[num].fd = syncd->listen_fd;
+            pfds[num].events = POLLIN;
+            owner[num] = &bench_nodes[i];
+            is_listen[num++] = 1;
+        }
+
+        if (syncd->fd >= 0)
+        {
+            pfds[num].fd = syncd->fd;
+            pfds[num].events = POLLIN | (syncd->tx_buf ? POLLOUT : 0);
+            owner[num] = &bench_nodes[i];
+            is_listen[num++] = 0;
+        }
+    }
+
+    if (poll(pfds, num, msec) <= 0)
+        return;
+
+    for (i = 0; i < num; i++)
+    {
+        syncd = &owner[i]->syncd;
+
+        if (pfds[i].revents == 0)
+            continue;
+
+        if (is_listen[i])
+        {
+            bench_syncd_accept(owner[i]);
+            continue;
+        }
+
+        /* Closed or replaced by a new connection in this round*/
+        if (syncd->fd != pfds[i].fd)
+            continue;
+
+        if (pfds[i].revents & (POLLIN | POLLERR | POLLHUP))
+            bench_syncd_read(syncd);
+
+        if (syncd->fd >= 0 && (pfds[i].revents & POLLOUT))
+            bench_syncd_write(syncd);
+    }
+
+    return;
+}
+
+/****************************************
+* Commands and processes
+****************************************/
+
+static pid_t bench_spawn(struct bench_node* node, const char* cmd)
+{
+    pid_t pid;
+
+    pid = fork();
+    if (pid != 0)
+        return pid;
+
+    prctl(PR_SET_PDEATHSIG, SIGKILL);
+    if (bench_node_enter(node) < 0)
+        _exit(126);
+
+    execl("/bin/sh", "sh", "-c", cmd, (char*)NULL);
+    _exit(127);
+}
+
+/* Run a shell command in the node, mclagsyncd is serviced meanwhile*/
+static int bench_run(struct bench_node* node, const char* fmt, ...)
+{
+    char cmd[4096];
+    va_list ap;
+    pid_t pid;
+    int status = 0;
+
+    va_start(ap, fmt);
+    vsnprintf(cmd, sizeof(cmd), fmt, ap);
+    va_end(ap);
+
+    if ((pid = bench_spawn(node, cmd)) < 0)
+        return -1;
+
+    while (waitpid(pid, &status, WNOHANG) == 0)
+        bench_poll(BENCH_POLL_MSEC);
+
+    if (!WIFEXITED(status) || WEXITSTATUS(status) != 0)
+    {
+        fprintf(stderr, "Node %d: command failed: %s\n", node->id, cmd);
+        return -1;
+    }
+
+    return 0;
+}
+
+static int bench_iccpd_start(struct bench_node* node)
+{
+    char conf[PATH_MAX + 16];
+    char log[PATH_MAX + 16];
+    char ckpt[PATH_MAX + 16];
+    char out[PATH_MAX + 16];
+    char* argv[16];
+    int argc = 0;
+    int fd;
+
+    snprintf(conf, sizeof(conf), "%s/iccpd.conf", node->dir);
+    snprintf(log, sizeof(log), "%s/iccpd.log", node->dir);
+    snprintf(ckpt, sizeof(ckpt), "%s/tables.ckpt", node->dir);
+    snprintf(out, sizeof(out), "%s/iccpd.out", node->dir);
+
+    argv[argc++] = bench_cfg.iccpd_path;
+    argv[argc++] = "-f";
+    argv[argc++] = conf;
+    argv[argc++] = "-l";
+    argv[argc++] = log;
+    argv[argc++] = "-w";
+    argv[argc++] = ckpt;
+    if (bench_cfg.bulk_redirect)
+        argv[argc++] = "-b";
+    argv[argc] = NULL;
+
+    node->iccpd = fork();
+    if (node->iccpd != 0)
+        return node->iccpd < 0 ? -1 : 0;
+
+    prctl(PR_SET_PDEATHSIG, SIGTERM);
+    if (bench_node_enter(node) < 0 || unshare(CLONE_NEWNS) < 0)
+        _exit(126);
+
+    /* pid file, mclagdctl socket and log ring of this instance*/
+    if (mount("tmpfs", bench_run_dir, "tmpfs", 0, "mode=0755") < 0)
+        _exit(126);
+
+    if ((fd = open(out, O_WRONLY | O_CREAT | O_TRUNC, 0644)) >= 0)
+    {
+        dup2(fd, STDOUT_FILENO);
+        dup2(fd, STDERR_FILENO);
+        close(fd);
+    }
+
+    execv(argv[0], argv);
+    _exit(127);
+}
+
+static void bench_iccpd_stop(struct bench_node* node)
+{
+    uint64_t deadline = bench_now_usec() + 2000000;
+
+    if (node->iccpd <= 0)
+        return;
+
+    kill(node->iccpd, SIGTERM);
+    while (waitpid(node->iccpd, NULL, WNOHANG) == 0)
+    {
+        if (bench_now_usec() > deadline)
+        {
+            kill(node->iccpd, SIGKILL);
+            waitpid(node->iccpd, NULL, 0);
+            break;
+        }
+        usleep(10000);
+    }
+
+    node->iccpd = 0;
+
+    return;
+}
+
+static int bench_iccpd_alive(struct bench_node* node)
+{
+    if (node->iccpd <= 0)
+        return 0;
+
+    if (waitpid(node->iccpd, NULL, WNOHANG) == node->iccpd)
+    {
+        fprintf(stderr, "Node %d: iccpd exited, see %s/iccpd.out\n", node->id, node->dir);
+        node->iccpd = 0;
+        return 0;
+    }
+
+    return 1;
+}
+
+/****************************************
+* Topology
+****************************************/
+
+static int bench_po_carrier(struct bench_node* node, int po, int on)
+{
+    return bench_run(node, "ip link set PortChannel%04d carrier %s 2>/dev/null || ip link set " BENCH_PO_PEER "%04d %s",
+                     po, on ? "on" : "off", po, on ? "up" : "down");
+}
+
+static int bench_node_setup(struct bench_node* node)
+{
+    char path[PATH_MAX + 16];
+    FILE* fp = NULL;
+    int i;
+
+    if (bench_run(node, "ip link set lo up") < 0
+        || bench_run(node, "ip addr add 10.250.0.%d/24 dev %s && ip link set %s up",
+                     node->id, BENCH_SESSION_IF, BENCH_SESSION_IF) < 0
+        || bench_run(node, "ip link add Bridge type bridge vlan_filtering 1 && ip link set Bridge up") < 0
+        || bench_run(node, "ip link set %s master Bridge && ip link set %s up", BENCH_PEER_LINK, BENCH_PEER_LINK) < 0)
+        return -1;
+
+    for (i = 1; i <= bench_cfg.po_num; i++)
+    {
+        /* Without the team driver a veth stands in, its carrier follows the peer end*/
+        if (bench_run(node, "{ ip link add PortChannel%04d type team 2>/dev/null"
+                      " || ip link add PortChannel%04d type veth peer name " BENCH_PO_PEER "%04d; }"
+                      " && ip link set PortChannel%04d master Bridge && ip link set PortChannel%04d up", i, i, i, i, i) < 0
+            || bench_po_carrier(node, i, 1) < 0)
+            return -1;
+    }
+
+    if (bench_run(node, "bridge vlan add vid %d dev Bridge self && ip link add link Bridge name Vlan%d type vlan id %d"
+                  " && ip addr add 192.168.0.%d/16 dev Vlan%d && ip -6 addr add fd00::%d/64 dev Vlan%d nodad"
+                  " && ip link set Vlan%d up",
+                  BENCH_VLAN_ID, BENCH_VLAN_ID, BENCH_VLAN_ID, node->id, BENCH_VLAN_ID, node->id,
+                  BENCH_VLAN_ID, BENCH_VLAN_ID) < 0)
+        return -1;
+
+    snprintf(path, sizeof(path), "%s/iccpd.conf", node->dir);
+    if ((fp = fopen(path, "w")) == NULL)
+        return -1;
+
+    fprintf(fp, "mclag_id:%d\n", BENCH_MCLAG_ID);
+    fprintf(fp, "local_ip:10.250.0.%d\n", node->id);
+    fprintf(fp, "peer_ip:10.250.0.%d\n", BENCH_NODE_NUM + 1 - node->id);
+    fprintf(fp, "peer_link:%s\n", BENCH_PEER_LINK);
+    fprintf(fp, "mclag_interface:");
+    for (i = 1; i <= bench_cfg.po_num; i++)
+        fprintf(fp, "%sPortChannel%04d", i > 1 ? "," : "", i);
+    fprintf(fp, "\n");
+    fclose(fp);
+
+    if (bench_node_enter(node) < 0)
+        return -1;
+
+    node->nl_fd = socket(AF_NETLINK, SOCK_RAW | SOCK_CLOEXEC, NETLINK_ROUTE);
+    snprintf(path, sizeof(path), "Vlan%d", BENCH_VLAN_ID);
+    node->vlan_ifindex = if_nametoindex(path);
+    bench_node_leave();
+
+    if (node->nl_fd < 0 || node->vlan_ifindex == 0)
+        return -1;
+
+    return bench_syncd_listen(node);
+}
+
+static int bench_topology_create()
+{
+    struct bench_node* node1 = &bench_nodes[0];
+    struct bench_node* node2 = &bench_nodes[1];
+    int i;
+
+    for (i = 0; i < BENCH_NODE_NUM; i++)
+    {
+        bench_nodes[i].id = i + 1;
+        bench_nodes[i].nl_fd = -1;
+        bench_nodes[i].syncd.listen_fd = -1;
+        bench_nodes[i].syncd.fd = -1;
+        snprintf(bench_nodes[i].dir, sizeof(bench_nodes[i].dir), "%s/node%d", bench_dir, i + 1);
+
+        if (mkdir(bench_nodes[i].dir, 0755) < 0 || bench_node_netns_create(&bench_nodes[i]) < 0)
+            return -1;
+    }
+
+    if (bench_run(node1, "ip link add %s type veth peer name %s netns %d",
+                  BENCH_SESSION_IF, BENCH_SESSION_IF, node2->holder) < 0
+        || bench_run(node1, "ip link add %s type veth peer name %s netns %d",
+                     BENCH_PEER_LINK, BENCH_PEER_LINK, node2->holder) < 0)
+        return -1;
+
+    for (i = 0; i < BENCH_NODE_NUM; i++)
+    {
+        if (bench_node_setup(&bench_nodes[i]) < 0)
+            return -1;
+    }
+
+    return 0;
+}
+
+/* iccpd learns the VLAN members from the bridge events only*/
+static int bench_vlan_members_add(struct bench_node* node)
+{
+    int i;
+
+    if (bench_run(node, "bridge vlan add vid %d dev %s", BENCH_VLAN_ID, BENCH_PEER_LINK) < 0)
+        return -1;
+
+    for (i = 1; i <= bench_cfg.po_num; i++)
+    {
+        if (bench_run(node, "bridge vlan add vid %d dev PortChannel%04d", BENCH_VLAN_ID, i) < 0)
+            return -1;
+    }
+
+    return 0;
+}
+
+/****************************************
+* Statistics
+****************************************/
+
+/* Send one mclagdctl request, the reply data is copied to buf*/
+static int bench_ctl_query(struct bench_node* node, int info_type, char* buf, int size)
+{
+    struct mclagdctl_req_hdr req;
+    struct mclagd_reply_hdr* reply = NULL;
+    struct sockaddr_un addr;
+    struct timeval tv = { 1, 0 };
+    int len = 0;
+    int got = 0;
+    int fd;
+    int n;
+
+    if ((fd = socket(AF_UNIX, SOCK_STREAM | SOCK_CLOEXEC, 0)) < 0)
+        return -1;
+
+    setsockopt(fd, SOL_SOCKET, SO_RCVTIMEO, &tv, sizeof(tv));
+
+    memset(&addr, 0, sizeof(addr));
+    addr.sun_family = AF_UNIX;
+    snprintf(addr.sun_path, sizeof(addr.sun_path), "/proc/%d/root%s%s",
+             node->iccpd, bench_run_dir, BENCH_CTL_SOCK_PATH);
+
+    memset(&req, 0, sizeof(req));
+    req.info_type = info_type;
+    req.mclag_id = BENCH_MCLAG_ID;
+
+    if (connect(fd, (struct sockaddr*)&addr, sizeof(addr)) < 0
+        || write(fd, &req, sizeof(req)) != sizeof(req)
+        || read(fd, &len, sizeof(int)) != sizeof(int)
+        || len < (int)sizeof(struct mclagd_reply_hdr) || len > size)
+    {
+        close(fd);
+        return -1;
+    }
+
+    while (got < len)
+    {
+        n = read(fd, buf + got, len - got);
+        if (n <= 0)
+        {
+            close(fd);
+            return -1;
+        }
+        got += n;
+    }
+    close(fd);
+
+    reply = (struct mclagd_reply_hdr*)buf;
+    if (reply->exec_result != EXEC_TYPE_SUCCESS)
+        return -1;
+
+    len -= sizeof(struct mclagd_reply_hdr);
+    memmove(buf, buf + sizeof(struct mclagd_reply_hdr), len);
+
+    return len;
+}
+
+static int bench_session_up(struct bench_node* node)
+{
+    char buf[MCLAGDCTL_CMD_SIZE];
+    int len;
+
+    len = bench_ctl_query(node, INFO_TYPE_DUMP_STATE, buf, sizeof(buf));
+    if (len < (int)sizeof(struct mclagd_state))
+        return 0;
+
+    return ((struct mclagd_state*)buf)->keepalive == 1;
+}
+
+static uint64_t bench_proc_field(const char* path, const char* key)
+{
+    char line[256];
+    uint64_t val = 0;
+    FILE* fp = NULL;
+    size_t key_len = strlen(key);
+
+    if ((fp = fopen(path, "r")) == NULL)
+        return 0;
+
+    while (fgets(line, sizeof(line), fp))
+    {
+        if (strncmp(line, key, key_len) == 0)
+        {
+            val = strtoull(line + key_len, NULL, 10);
+            break;
+        }
+    }
+    fclose(fp);
+
+    return val;
+}
+
+static void bench_proc_sample(struct bench_node* node, struct bench_proc_stats* st)
+{
+    char path[64];
+    char line[1024];
+    char buf[MCLAGDCTL_CMD_SIZE * 4];
+    struct mclagd_session_counters* session = NULL;
+    unsigned long long utime = 0, stime = 0;
+    FILE* fp = NULL;
+    char* p = NULL;
+    int len;
+    int i;
+
+    memset(st, 0, sizeof(*st));
+
+    if (node->iccpd <= 0)
+        return;
+
+    snprintf(path, sizeof(path), "/proc/%d/io", node->iccpd);
+    st->syscalls = bench_proc_field(path, "syscr:") + bench_proc_field(path, "syscw:");
+
+    snprintf(path, sizeof(path), "/proc/%d/status", node->iccpd);
+    st->hwm_kb = bench_proc_field(path, "VmHWM:");
+
+    snprintf(path, sizeof(path), "/proc/%d/stat", node->iccpd);
+    if ((fp = fopen(path, "r")) != NULL)
+    {
+        /* utime and stime are the 12th and 13th fields after the comm*/
+        if (fgets(line, sizeof(line), fp) && (p = strrchr(line, ')')) != NULL)
+            sscanf(p + 2, "%*c %*d %*d %*d %*d %*d %*u %*u %*u %*u %*u %llu %llu", &utime, &stime);
+        fclose(fp);
+    }
+    st->cpu_msec = (utime + stime) * 1000 / sysconf(_SC_CLK_TCK);
+
+    len = bench_ctl_query(node, INFO_TYPE_DUMP_COUNTERS, buf, sizeof(buf));
+    if (len < (int)sizeof(struct mclagd_counters))
+        return;
+
+    len -= sizeof(struct mclagd_counters);
+    for (i = 0; len >= (int)sizeof(struct mclagd_session_counters); i++, len -= sizeof(struct mclagd_session_counters))
+    {
+        session = (struct mclagd_session_counters*)(buf + sizeof(struct mclagd_counters)) + i;
+        st->iccp_tx_msgs += session->tx_msgs;
+        st->iccp_rx_msgs += session->rx_msgs;
+    }
+
+    return;
+}
+
+static void bench_result_add(int phase, uint64_t entries, uint64_t usec, int failed,
+                             struct bench_proc_stats* before, struct bench_proc_stats* after)
+{
+    struct bench_result* res = &bench_results[phase];
+    int i;
+
+    res->runs++;
+    res->failed += failed;
+    res->entries += entries;
+    res->usec += usec;
+    if (usec > res->max_usec)
+        res->max_usec = usec;
+
+    for (i = 0; i < BENCH_NODE_NUM; i++)
+    {
+        res->iccp_msgs += after[i].iccp_tx_msgs - before[i].iccp_tx_msgs;
+        res->syscalls[i] += after[i].syscalls - before[i].syscalls;
+        res->cpu_msec[i] += after[i].cpu_msec - before[i].cpu_msec;
+    }
+
+    return;
+}
+
+static void bench_sample_all(struct bench_proc_stats* st)
+{
+    int i;
+
+    for (i = 0; i < BENCH_NODE_NUM; i++)
+        bench_proc_sample(&bench_nodes[i], &st[i]);
+
+    return;
+}
+
+/****************************************
+* Phases
+****************************************/
+
+static uint64_t bench_deadline()
+{
+    return bench_now_usec() + (uint64_t)bench_cfg.timeout_sec * 1000000;
+}
+
+static int bench_nodes_alive()
+{
+    int i;
+
+    for (i = 0; i < BENCH_NODE_NUM; i++)
+    {
+        if (!bench_iccpd_alive(&bench_nodes[i]))
+            return 0;
+    }
+
+    return 1;
+}
+
+static int bench_wait_session()
+{
+    uint64_t deadline = bench_deadline();
+    uint64_t grace;
+    int i;
+
+    while (bench_now_usec() < deadline && bench_nodes_alive())
+    {
+        for (i = 0; i < BENCH_NODE_NUM; i++)
+        {
+            if (!bench_session_up(&bench_nodes[i]) || bench_nodes[i].syncd.fd < 0)
+                break;
+        }
+
+        if (i == BENCH_NODE_NUM)
+        {
+            grace = bench_now_usec() + BENCH_SESSION_GRACE_MSEC * 1000;
+            while (bench_now_usec() < grace)
+                bench_poll(BENCH_POLL_MSEC);
+            return 0;
+        }
+
+        bench_poll(100);
+    }
+
+    fprintf(stderr, "The ICCP session or mclagsyncd connection is not up\n");
+
+    return -1;
+}
+
+/* MACs are spread round-robin over the port-channels*/
+static void bench_po_of(int index, char* name)
+{
+    snprintf(name, MAX_L_PORT_NAME, "PortChannel%04hu", (unsigned short)(index % bench_cfg.po_num + 1));
+
+    return;
+}
+
+/* MACs learnt by node 1 are programmed by node 2.
+ * Pushed as deltas if iccpd subscribed, as polled changes otherwise*/
+static int bench_phase_mac()
+{
+    struct bench_node* node1 = &bench_nodes[0];
+    struct bench_syncd* syncd1 = &node1->syncd;
+    struct bench_syncd* syncd2 = &bench_nodes[1].syncd;
+    struct bench_proc_stats before[BENCH_NODE_NUM], after[BENCH_NODE_NUM];
+    struct IccpSyncdHDr* msg_hdr = NULL;
+    struct mclag_fdb_delta_hdr* delta = NULL;
+    struct mclag_fdb_info* fdb = NULL;
+    uint64_t base = syncd2->fdb_add;
+    uint64_t deadline, start, end;
+    size_t frame_num = (bench_cfg.entries + BENCH_FDB_BATCH - 1) / BENCH_FDB_BATCH;
+    size_t hdr_len = sizeof(struct IccpSyncdHDr);
+    size_t pos = 0;
+    char* buf = NULL;
+    int i;
+
+    if (syncd1->subscribed)
+        hdr_len += sizeof(struct mclag_fdb_delta_hdr);
+
+    buf = (char*)calloc(1, frame_num * hdr_len + bench_cfg.entries * sizeof(struct mclag_fdb_info));
+    if (buf == NULL)
+        return -1;
+
+    for (i = 0; i < bench_cfg.entries; i++)
+    {
+        if (i % BENCH_FDB_BATCH == 0)
+        {
+            msg_hdr = (struct IccpSyncdHDr*)(buf + pos);
+            msg_hdr->ver = 1;
+            msg_hdr->len = hdr_len;
+            if (syncd1->subscribed)
+            {
+                msg_hdr->type = MCLAG_SYNCD_MSG_TYPE_FDB_DELTA;
+                delta = (struct mclag_fdb_delta_hdr*)(msg_hdr + 1);
+                delta->seq = ++syncd1->seq;
+            }
+            else
+            {
+                msg_hdr->type = MCLAG_SYNCD_MSG_TYPE_FDB_OPERATION;
+            }
+            pos += hdr_len;
+        }
+
+        fdb = (struct mclag_fdb_info*)(buf + pos);
+        snprintf(fdb->mac, ETHER_ADDR_STR_LEN, "00:bb:%02x:%02x:%02x:%02x",
+                 (i >> 24) & 0xff, (i >> 16) & 0xff, (i >> 8) & 0xff, i & 0xff);
+        fdb->vid = BENCH_VLAN_ID;
+        bench_po_of(i, fdb->port_name);
+        fdb->type = MAC_TYPE_DYNAMIC;
+        fdb->op_type = MAC_SYNC_ADD;
+
+        msg_hdr->len += sizeof(struct mclag_fdb_info);
+        if (syncd1->subscribed)
+            delta->count++;
+        pos += sizeof(struct mclag_fdb_info);
+    }
+
+    i = bench_syncd_queue(syncd1, buf, pos);
+    free(buf);
+    if (i < 0)
+        return -1;
+
+    bench_sample_all(before);
+    start = bench_now_usec();
+    deadline = bench_deadline();
+
+    while (syncd2->fdb_add - base < (uint64_t)bench_cfg.entries && bench_now_usec() < deadline)
+        bench_poll(BENCH_POLL_MSEC);
+
+    end = bench_now_usec();
+    bench_sample_all(after);
+
+    bench_result_add(BENCH_PHASE_MAC, syncd2->fdb_add - base, end - start,
+                     syncd2->fdb_add - base < (uint64_t)bench_cfg.entries, before, after);
+
+    return 0;
+}
+
+static int bench_neigh_match(int family, const unsigned char* addr)
+{
+    if (family == AF_INET)
+        return addr[0] == 192 && addr[1] == 168 && addr[2] >= 1;
+
+    /* fd00::1:x:y*/
+    return addr[0] == 0xfd && addr[1] == 0 && addr[10] == 0 && addr[11] == 1;
+}
+
+/* Number of the benchmark neighbors in the kernel of the node*/
+static int bench_neigh_count(struct bench_node* node, int family)
+{
+    struct
+    {
+        struct nlmsghdr nlh;
+        struct ndmsg ndm;
+    } req;
+    static char buf[65536];
+    struct nlmsghdr* nlh = NULL;
+    struct ndmsg* ndm = NULL;
+    struct rtattr* rta = NULL;
+    int count = 0;
+    int rta_len;
+    int len;
+
+    memset(&req, 0, sizeof(req));
+    req.nlh.nlmsg_len = NLMSG_LENGTH(sizeof(struct ndmsg));
+    req.nlh.nlmsg_type = RTM_GETNEIGH;
+    req.nlh.nlmsg_flags = NLM_F_REQUEST | NLM_F_DUMP;
+    req.ndm.ndm_family = family;
+
+    if (send(node->nl_fd, &req, req.nlh.nlmsg_len, 0) < 0)
+        return -1;
+
+    while ((len = recv(node->nl_fd, buf, sizeof(buf), 0)) > 0)
+    {
+        for (nlh = (struct nlmsghdr*)buf; NLMSG_OK(nlh, len); nlh = NLMSG_NEXT(nlh, len))
+        {
+            if (nlh->nlmsg_type == NLMSG_DONE || nlh->nlmsg_type == NLMSG_ERROR)
+                return count;
+
+            if (nlh->nlmsg_type != RTM_NEWNEIGH)
+                continue;
+
+            ndm = (struct ndmsg*)NLMSG_DATA(nlh);
+            if (ndm->ndm_ifindex != node->vlan_ifindex || (ndm->ndm_state & (NUD_INCOMPLETE | NUD_FAILED)))
+                continue;
+
+            rta_len = nlh->nlmsg_len - NLMSG_LENGTH(sizeof(struct ndmsg));
+            for (rta = (struct rtattr*)((char*)ndm + NLMSG_ALIGN(sizeof(struct ndmsg)));
+                 RTA_OK(rta, rta_len); rta = RTA_NEXT(rta, rta_len))
+            {
+                if (rta->rta_type == NDA_DST && bench_neigh_match(family, RTA_DATA(rta)))
+                    count++;
+            }
+        }
+    }
+
+    return count;
+}
+
+/* Neighbors added to the kernel of node 1 are added by node 2*/
+static int bench_phase_neigh(int phase, int family)
+{
+    struct bench_node* node1 = &bench_nodes[0];
+    struct bench_node* node2 = &bench_nodes[1];
+    struct bench_proc_stats before[BENCH_NODE_NUM], after[BENCH_NODE_NUM];
+    char path[PATH_MAX + 16];
+    char cmd[PATH_MAX + 32];
+    uint64_t deadline, start, end, next_check = 0;
+    int entries = bench_cfg.entries;
+    int count = 0;
+    FILE* fp = NULL;
+    pid_t pid = 0;
+    int i;
+
+    if (family == AF_INET && entries > BENCH_ARP_MAX)
+        entries = BENCH_ARP_MAX;
+
+    snprintf(path, sizeof(path), "%s/%s.batch", bench_dir, bench_phase_name[phase]);
+    if ((fp = fopen(path, "w")) == NULL)
+        return -1;
+
+    for (i = 0; i < entries; i++)
+    {
+        if (family == AF_INET)
+            fprintf(fp, "neigh replace 192.168.%d.%d", 1 + i / 250, 1 + i % 250);
+        else
+            fprintf(fp, "neigh replace fd00::1:%x:%x", (i >> 16) & 0xffff, i & 0xffff);
+
+        fprintf(fp, " lladdr 00:aa:%02x:%02x:%02x:%02x dev Vlan%d nud reachable\n",
+                family == AF_INET ? 0 : 1, (i >> 16) & 0xff, (i >> 8) & 0xff, i & 0xff, BENCH_VLAN_ID);
+    }
+    fclose(fp);
+
+    snprintf(cmd, sizeof(cmd), "ip -batch %s", path);
+
+    bench_sample_all(before);
+    start = bench_now_usec();
+    deadline = bench_deadline();
+
+    if ((pid = bench_spawn(node1, cmd)) < 0)
+        return -1;
+
+    while (bench_now_usec() < deadline)
+    {
+        bench_poll(BENCH_POLL_MSEC);
+
+        if (pid > 0 && waitpid(pid, NULL, WNOHANG) == pid)
+            pid = 0;
+
+        if (bench_now_usec() < next_check)
+            continue;
+
+        next_check = bench_now_usec() + BENCH_NEIGH_POLL_MSEC * 1000;
+        if ((count = bench_neigh_count(node2, family)) >= entries)
+            break;
+    }
+
+    end = bench_now_usec();
+    bench_sample_all(after);
+
+    if (pid > 0)
+    {
+        kill(pid, SIGKILL);
+        waitpid(pid, NULL, 0);
+    }
+
+    bench_result_add(phase, count, end - start, count < entries, before, after);
+
+    return 0;
+}
+
+/* Wait until the expected FDB updates are seen, or the FDB settles*/
+static uint64_t bench_wait_fdb(uint64_t start, uint64_t expect, int* failed)
+{
+    struct bench_syncd* syncd1 = &bench_nodes[0].syncd;
+    uint64_t base_updates = syncd1->fdb_peer_link + syncd1->fdb_del;
+    uint64_t base_redirects = syncd1->redirects;
+    uint64_t deadline = bench_deadline();
+    uint64_t last, now;
+    int i;
+
+    *failed = 1;
+
+    while ((now = bench_now_usec()) < deadline)
+    {
+        bench_poll(BENCH_POLL_MSEC);
+
+        if (expect > 0 && (syncd1->fdb_peer_link + syncd1->fdb_del - base_updates >= expect
+                           || syncd1->redirects > base_redirects))
+        {
+            *failed = 0;
+            return bench_now_usec() - start;
+        }
+
+        last = start;
+        for (i = 0; i < BENCH_NODE_NUM; i++)
+        {
+            if (bench_nodes[i].syncd.last_usec > last)
+                last = bench_nodes[i].syncd.last_usec;
+        }
+
+        /* Settled short of the expected updates is a failure*/
+        if (now - last >= BENCH_SETTLE_MSEC * 1000)
+        {
+            *failed = expect > 0;
+            return last - start;
+        }
+    }
+
+    return bench_now_usec() - start;
+}
+
+/* Flap the carrier of a node 1 port-channel, with the MACs injected on it*/
+static int bench_phase_flap(int flap)
+{
+    struct bench_node* node1 = &bench_nodes[0];
+    struct bench_proc_stats before[BENCH_NODE_NUM], after[BENCH_NODE_NUM];
+    int po = flap % bench_cfg.po_num;
+    uint64_t expect = 0;
+    uint64_t start, usec;
+    int failed = 0;
+    int i;
+
+    if (bench_cfg.phases & (1 << BENCH_PHASE_MAC))
+    {
+        for (i = po; i < bench_cfg.entries; i += bench_cfg.po_num)
+            expect++;
+    }
+
+    bench_sample_all(before);
+    start = bench_now_usec();
+    if (bench_po_carrier(node1, po + 1, 0) < 0)
+        return -1;
+    usec = bench_wait_fdb(start, expect, &failed);
+    bench_sample_all(after);
+    bench_result_add(BENCH_PHASE_FLAP_DOWN, expect, usec, failed, before, after);
+
+    bench_sample_all(before);
+    start = bench_now_usec();
+    if (bench_po_carrier(node1, po + 1, 1) < 0)
+        return -1;
+    usec = bench_wait_fdb(start, 0, &failed);
+    bench_sample_all(after);
+    bench_result_add(BENCH_PHASE_FLAP_UP, 0, usec, failed, before, after);
+
+    return 0;
+}
+
+/****************************************
+* Report
+****************************************/
+
+static int bench_report()
+{
+    struct bench_proc_stats st[BENCH_NODE_NUM];
+    struct bench_result* res = NULL;
+    uint64_t avg_usec;
+    int failed = 0;
+    int i;
+
+    bench_sample_all(st);
+
+    fprintf(stdout, "mclagbench: %d entries, %d port-channels, %d flaps%s\n\n",
+            bench_cfg.entries, bench_cfg.po_num, bench_cfg.flaps,
+            bench_cfg.bulk_redirect ? ", bulk FDB redirect" : "");
+    fprintf(stdout, "%-10s%-6s%-10s%-12s%-12s%-12s%-12s%-12s%-20s%s\n",
+            "Phase", "Runs", "Entries", "Avg ms", "Max ms", "Entries/s", "ICCP msgs", "Msgs/s",
+            "Syscalls n1/n2", "CPU ms n1/n2");
+
+    for (i = 0; i < BENCH_PHASE_MAX; i++)
+    {
+        char syscalls[32], cpu[32];
+
+        res = &bench_results[i];
+        if (res->runs == 0)
+            continue;
+
+        avg_usec = res->usec / res->runs;
+        snprintf(syscalls, sizeof(syscalls), "%llu/%llu",
+                 (unsigned long long)res->syscalls[0], (unsigned long long)res->syscalls[1]);
+        snprintf(cpu, sizeof(cpu), "%llu/%llu",
+                 (unsigned long long)res->cpu_msec[0], (unsigned long long)res->cpu_msec[1]);
+
+        fprintf(stdout, "%-10s%-6d%-10llu%-12.1f%-12.1f%-12.0f%-12llu%-12.0f%-20s%s%s\n",
+                bench_phase_name[i], res->runs, (unsigned long long)res->entries,
+                avg_usec / 1000.0, res->max_usec / 1000.0,
+                res->usec ? res->entries * 1000000.0 / res->usec : 0.0,
+                (unsigned long long)res->iccp_msgs,
+                res->usec ? res->iccp_msgs * 1000000.0 / res->usec : 0.0,
+                syscalls, cpu, res->failed ? "  FAILED" : "");
+
+        failed += res->failed;
+    }
+
+    fprintf(stdout, "\nPeak RSS: node1 %llu kB, node2 %llu kB\n",
+            (unsigned long long)st[0].hwm_kb, (unsigned long long)st[1].hwm_kb);
+
+    return failed ? -1 : 0;
+}
+
+/****************************************
+* Main
+****************************************/
+
+static int bench_rm_entry(const char* path, const struct stat* sb, int flag, struct FTW* ftw)
+{
+    remove(path);
+
+    return 0;
+}
+
+static void bench_cleanup(int keep)
+{
+    int i;
+
+    for (i = 0; i < BENCH_NODE_NUM; i++)
+    {
+        bench_iccpd_stop(&bench_nodes[i]);
+
+        if (bench_nodes[i].holder > 0)
+        {
+            kill(bench_nodes[i].holder, SIGKILL);
+            waitpid(bench_nodes[i].holder, NULL, 0);
+        }
+    }
+
+    if (bench_dir[0] == '\0')
+        return;
+
+    if (keep)
+        fprintf(stdout, "Logs are kept in %s\n", bench_dir);
+    else
+        nftw(bench_dir, bench_rm_entry, 16, FTW_DEPTH | FTW_PHYS);
+
+    return;
+}
+
+static int bench_parse_phases(const char* arg)
+{
+    char buf[128];
+    char* tok = NULL;
+    int phases = 0;
+
+    snprintf(buf, sizeof(buf), "%s", arg);
+    for (tok = strtok(buf, ","); tok; tok = strtok(NULL, ","))
+    {
+        if (strcmp(tok, "mac") == 0)
+            phases |= 1 << BENCH_PHASE_MAC;
+        else if (strcmp(tok, "arp") == 0)
+            phases |= 1 << BENCH_PHASE_ARP;
+        else if (strcmp(tok, "nd") == 0)
+            phases |= 1 << BENCH_PHASE_ND;
+        else if (strcmp(tok, "flap") == 0)
+            phases |= (1 << BENCH_PHASE_FLAP_DOWN) | (1 << BENCH_PHASE_FLAP_UP);
+        else
+            return -1;
+    }
+
+    return phases;
+}
+
+/* Default to the iccpd of the same build tree*/
+static void bench_default_iccpd(const char* argv0)
+{
+    char self[PATH_MAX];
+    char* p = NULL;
+    ssize_t n;
+
+    snprintf(bench_cfg.iccpd_path, sizeof(bench_cfg.iccpd_path), "/usr/bin/iccpd");
+
+    n = readlink("/proc/self/exe", self, sizeof(self) - 1);
+    if (n <= 0)
+        return;
+
+    self[n] = '\0';
+    if ((p = strrchr(self, '/')) == NULL)
+        return;
+
+    *p = '\0';
+    snprintf(bench_cfg.iccpd_path, sizeof(bench_cfg.iccpd_path), "%.*s/../iccpd", PATH_MAX - 16, self);
+    if (access(bench_cfg.iccpd_path, X_OK) != 0)
+        snprintf(bench_cfg.iccpd_path, sizeof(bench_cfg.iccpd_path), "/usr/bin/iccpd");
+
+    return;
+}
+
+static void bench_print_help(const char* argv0)
+{
+    fprintf(stdout, "Usage: %s [Options]\n\n", argv0);
+    fprintf(stdout, "Options:\n");
+    fprintf(stdout, "    -n <ENTRIES>        MACs, ARPs and NDs to sync (Default: %d)\n", bench_cfg.entries);
+    fprintf(stdout, "    -p <PORTCHANNELS>   MC-LAG port-channels (Default: %d)\n", bench_cfg.po_num);
+    fprintf(stdout, "    -f <FLAPS>          Port-channel flaps (Default: %d)\n", bench_cfg.flaps);
+    fprintf(stdout, "    -s <PHASES>         Comma list of mac,arp,nd,flap (Default: all)\n");
+    fprintf(stdout, "    -t <SECONDS>        Timeout of each phase (Default: %d)\n", bench_cfg.timeout_sec);
+    fprintf(stdout, "    -i <ICCPD>          iccpd binary (Default: ../iccpd of this binary)\n");
+    fprintf(stdout, "    -b                  Run iccpd with bulk FDB redirect\n");
+    fprintf(stdout, "    -k                  Keep the logs and configs\n");
+    fprintf(stdout, "    -h                  Show the usage\n");
+
+    return;
+}
+
+int main(int argc, char* argv[])
+{
+    int ret = EXIT_FAILURE;
+    int opt;
+    int i;
+
+    bench_default_iccpd(argv[0]);
+
+    while ((opt = getopt(argc, argv, "n:p:f:s:t:i:bkh")) != -1)
+    {
+        switch (opt)
+        {
+            case 'n':
+                bench_cfg.entries = atoi(optarg);
+                break;
+
+            case 'p':
+                bench_cfg.po_num = atoi(optarg);
+                break;
+
+            case 'f':
+                bench_cfg.flaps = atoi(optarg);
+                break;
+
+            case 's':
+                bench_cfg.phases = bench_parse_phases(optarg);
+                break;
+
+            case 't':
+                bench_cfg.timeout_sec = atoi(optarg);
+                break;
+
+            case 'i':
+                snprintf(bench_cfg.iccpd_path, sizeof(bench_cfg.iccpd_path), "%s", optarg);
+                break;
+
+            case 'b':
+                bench_cfg.bulk_redirect = 1;
+                break;
+
+            case 'k':
+                bench_cfg.keep_dir = 1;
+                break;
+
+            default:
+                bench_print_help(argv[0]);
+                return opt == 'h' ? EXIT_SUCCESS : EXIT_FAILURE;
+        }
+    }
+
+    if (bench_cfg.entries <= 0 || bench_cfg.po_num <= 0 || bench_cfg.po_num > 9999
+        || bench_cfg.flaps < 0 || bench_cfg.phases <= 0 || bench_cfg.timeout_sec <= 0)
+    {
+        bench_print_help(argv[0]);
+        return EXIT_FAILURE;
+    }
+
+    if (access(bench_cfg.iccpd_path, X_OK) != 0)
+    {
+        fprintf(stderr, "Can't execute %s, use -i to set the iccpd binary\n", bench_cfg.iccpd_path);
+        return EXIT_FAILURE;
+    }
+
+    signal(SIGPIPE, SIG_IGN);
+
+    if (realpath(BENCH_RUN_DIR, bench_run_dir) == NULL)
+        snprintf(bench_run_dir, sizeof(bench_run_dir), "%s", BENCH_RUN_DIR);
+
+    snprintf(bench_dir, sizeof(bench_dir), "%s", BENCH_WORK_DIR);
+    if (mkdtemp(bench_dir) == NULL)
+    {
+        bench_dir[0] = '\0';
+        fprintf(stderr, "Failed to create the work directory: %s\n", strerror(errno));
+        return EXIT_FAILURE;
+    }
+
+    /* No privileges or drivers for the topology, "make check" skips it*/
+    if (bench_enter_namespaces() < 0 || bench_topology_create() < 0)
+    {
+        ret = BENCH_EXIT_SKIP;
+        goto out;
+    }
+
+    for (i = 0; i < BENCH_NODE_NUM; i++)
+    {
+        if (bench_iccpd_start(&bench_nodes[i]) < 0)
+            goto out;
+    }
+
+    if (bench_wait_session() < 0)
+        goto out;
+
+    for (i = 0; i < BENCH_NODE_NUM; i++)
+    {
+        if (bench_vlan_members_add(&bench_nodes[i]) < 0)
+            goto out;
+    }
+
+    if ((bench_cfg.phases & (1 << BENCH_PHASE_MAC)) && bench_phase_mac() < 0)
+        goto out;
+
+    if ((bench_cfg.phases & (1 << BENCH_PHASE_ARP)) && bench_phase_neigh(BENCH_PHASE_ARP, AF_INET) < 0)
+        goto out;
+
+    if ((bench_cfg.phases & (1 << BENCH_PHASE_ND)) && bench_phase_neigh(BENCH_PHASE_ND, AF_INET6) < 0)
+        goto out;
+
+    if (bench_cfg.phases & (1 << BENCH_PHASE_FLAP_DOWN))
+    {
+        for (i = 0; i < bench_cfg.flaps; i++)
+        {
+            if (bench_phase_flap(i) < 0)
+                goto out;
+        }
+    }
+
+    if (bench_report() == 0 && bench_nodes_alive())
+        ret = EXIT_SUCCESS;
+
+ out:
+    bench_cleanup(bench_cfg.keep_dir || ret == EXIT_FAILURE);
+
+    return ret;
+}
@@ -26,6 +26,7 @@
 #include <string.h>
 #include <stdbool.h>
 #include <getopt.h>
+#include <time.h>
 #include <errno.h>
 #include <sys/socket.h>
 #include <sys/un.h>
@@ -34,13 +35,28 @@
 static int mclagdctl_sock_fd = -1;
 char *mclagdctl_sock_path = "/var/run/iccpd/mclagdctl.sock";
 
+/* Filters and output of the MAC/ARP/ND dumps, their reply is streamed*/
+static struct mclagdctl_dump_filter mclagdctl_filter;
+static struct
+{
+    int json;
+    int frames;     /* frames parsed of the reply*/
+    int index;      /* entries printed of the reply*/
+    int last;       /* parsing the last frame*/
+} mclagdctl_dump;
+
 /*
    Already implemented command:
    mclagdctl -i dump state
    mclagdctl -i dump arp
    mclagdctl -i dump mac
+   mclagdctl -i [-v vid] [-p port] [-m mac-prefix] [-a age] [-c] [-j] dump mac|arp|nd
    mclagdctl -i dump portlist local
    mclagdctl -i dump portlist peer
+   mclagdctl dump counters
+   mclagdctl dump latency
+   mclagdctl dump logring
+   mclagdctl clear latency
  */
 
 static struct command_type command_types[] =
@@ -104,6 +120,30 @@ static struct command_type command_types[] =
         .enca_msg = mclagdctl_enca_dump_peer_portlist,
         .parse_msg = mclagdctl_parse_dump_peer_portlist,
     },
+    {
+        .id = ID_CMDTYPE_D_C,
+        .parent_id = ID_CMDTYPE_D,
+        .info_type = INFO_TYPE_DUMP_COUNTERS,
+        .name = "counters",
+        .enca_msg = mclagdctl_enca_dump_counters,
+        .parse_msg = mclagdctl_parse_dump_counters,
+    },
+    {
+        .id = ID_CMDTYPE_D_L,
+        .parent_id = ID_CMDTYPE_D,
+        .info_type = INFO_TYPE_DUMP_LATENCY,
+        .name = "latency",
+        .enca_msg = mclagdctl_enca_dump_latency,
+        .parse_msg = mclagdctl_parse_dump_latency,
+    },
+    {
+        .id = ID_CMDTYPE_D_LR,
+        .parent_id = ID_CMDTYPE_D,
+        .info_type = INFO_TYPE_DUMP_LOG_RING,
+        .name = "logring",
+        .enca_msg = mclagdctl_enca_dump_log_ring,
+        .parse_msg = mclagdctl_parse_dump_log_ring,
+    },
     {
         .id = ID_CMDTYPE_C,
         .name = "config",
@@ -118,6 +158,20 @@ static struct command_type command_types[] =
         .enca_msg = mclagdctl_enca_config_loglevel,
         .parse_msg = mclagdctl_parse_config_loglevel,
     },    
+    {
+        .id = ID_CMDTYPE_CL,
+        .name = "clear",
+        .enca_msg = NULL,
+        .parse_msg = NULL,
+    },
+    {
+        .id = ID_CMDTYPE_CL_L,
+        .parent_id = ID_CMDTYPE_CL,
+        .info_type = INFO_TYPE_CLEAR_LATENCY,
+        .name = "latency",
+        .enca_msg = mclagdctl_enca_clear_latency,
+        .parse_msg = mclagdctl_parse_clear_latency,
+    },
 };
 
 #define ARRAY_SIZE(x) (sizeof(x) / sizeof((x)[0]))
@@ -295,6 +349,7 @@ int mclagdctl_enca_dump_arp(char *msg, int mclag_id, int argc, char **argv)
     memset(&req, 0, sizeof(struct mclagdctl_req_hdr));
     req.info_type = INFO_TYPE_DUMP_ARP;
     req.mclag_id = mclag_id;
+    memcpy(&req.filter, &mclagdctl_filter, sizeof(struct mclagdctl_dump_filter));
     memcpy((struct mclagdctl_req_hdr *)msg, &req, sizeof(struct mclagdctl_req_hdr));
 
     return 1;
@@ -313,22 +368,66 @@ int mclagdctl_enca_dump_ndisc(char *msg, int mclag_id, int argc, char **argv)
     memset(&req, 0, sizeof(struct mclagdctl_req_hdr));
     req.info_type = INFO_TYPE_DUMP_NDISC;
     req.mclag_id = mclag_id;
+    memcpy(&req.filter, &mclagdctl_filter, sizeof(struct mclagdctl_dump_filter));
     memcpy((struct mclagdctl_req_hdr *)msg, &req, sizeof(struct mclagdctl_req_hdr));
 
     return 1;
 }
 
+/* Count only reply, the last frame carries the matched count*/
+static int mclagdctl_parse_dump_count(char *msg, int data_len)
+{
+    unsigned int count = 0;
+
+    if (!mclagdctl_dump.last)
+        return 0;
+
+    if (data_len < sizeof(unsigned int))
+        return MCLAG_ERROR;
+
+    memcpy(&count, msg, sizeof(unsigned int));
+
+    if (mclagdctl_dump.json)
+        fprintf(stdout, "{\"count\": %u}\n", count);
+    else
+        fprintf(stdout, "%s: %u\n", "Entries", count);
+
+    return 0;
+}
+
+static void mclagdctl_dump_json_begin()
+{
+    if (mclagdctl_dump.frames == 0)
+        fprintf(stdout, "[");
+}
+
+static void mclagdctl_dump_json_end()
+{
+    if (mclagdctl_dump.last)
+        fprintf(stdout, "%s]\n", mclagdctl_dump.index ? "\n" : "");
+}
+
 int mclagdctl_parse_dump_arp(char *msg, int data_len)
 {
     struct mclagd_arp_msg * arp_info = NULL;
     int len = 0;
     int count = 0;
 
-    fprintf(stdout, "%-6s", "No.");
-    fprintf(stdout, "%-20s", "IP");
-    fprintf(stdout, "%-20s", "MAC");
-    fprintf(stdout, "%-20s", "DEV");
-    fprintf(stdout, "\n");
+    if (mclagdctl_filter.flags & MCLAGDCTL_FILTER_COUNT_ONLY)
+        return mclagdctl_parse_dump_count(msg, data_len);
+
+    if (mclagdctl_dump.json)
+    {
+        mclagdctl_dump_json_begin();
+    }
+    else if (mclagdctl_dump.frames == 0)
+    {
+        fprintf(stdout, "%-6s", "No.");
+        fprintf(stdout, "%-20s", "IP");
+        fprintf(stdout, "%-20s", "MAC");
+        fprintf(stdout, "%-20s", "DEV");
+        fprintf(stdout, "\n");
+    }
 
     len = sizeof(struct mclagd_arp_msg);
 
@@ -336,7 +435,18 @@ int mclagdctl_parse_dump_arp(char *msg, int data_len)
     {
         arp_info = (struct mclagd_arp_msg*)(msg + len * count);
 
-        fprintf(stdout, "%-6d", count + 1);
+        if (mclagdctl_dump.json)
+        {
+            fprintf(stdout, "%s\n  {\"ip\": \"%s\", \"mac\": \"%02x:%02x:%02x:%02x:%02x:%02x\", \"dev\": \"%s\"}",
+                    mclagdctl_dump.index ? "," : "", arp_info->ipv4_addr,
+                    arp_info->mac_addr[0], arp_info->mac_addr[1],
+                    arp_info->mac_addr[2], arp_info->mac_addr[3],
+                    arp_info->mac_addr[4], arp_info->mac_addr[5], arp_info->ifname);
+            mclagdctl_dump.index++;
+            continue;
+        }
+
+        fprintf(stdout, "%-6d", ++mclagdctl_dump.index);
         fprintf(stdout, "%-20s", arp_info->ipv4_addr);
         fprintf(stdout, "%02x:%02x:%02x:%02x:%02x:%02x",
                 arp_info->mac_addr[0], arp_info->mac_addr[1],
@@ -347,6 +457,9 @@ int mclagdctl_parse_dump_arp(char *msg, int data_len)
         fprintf(stdout, "\n");
     }
 
+    if (mclagdctl_dump.json)
+        mclagdctl_dump_json_end();
+
     return 0;
 }
 
@@ -356,11 +469,21 @@ int mclagdctl_parse_dump_ndisc(char *msg, int data_len)
     int len = 0;
     int count = 0;
 
-    fprintf(stdout, "%-6s", "No.");
-    fprintf(stdout, "%-52s", "IPv6");
-    fprintf(stdout, "%-20s", "MAC");
-    fprintf(stdout, "%-20s", "DEV");
-    fprintf(stdout, "\n");
+    if (mclagdctl_filter.flags & MCLAGDCTL_FILTER_COUNT_ONLY)
+        return mclagdctl_parse_dump_count(msg, data_len);
+
+    if (mclagdctl_dump.json)
+    {
+        mclagdctl_dump_json_begin();
+    }
+    else if (mclagdctl_dump.frames == 0)
+    {
+        fprintf(stdout, "%-6s", "No.");
+        fprintf(stdout, "%-52s", "IPv6");
+        fprintf(stdout, "%-20s", "MAC");
+        fprintf(stdout, "%-20s", "DEV");
+        fprintf(stdout, "\n");
+    }
 
     len = sizeof(struct mclagd_ndisc_msg);
 
@@ -368,7 +491,18 @@ int mclagdctl_parse_dump_ndisc(char *msg, int data_len)
     {
         ndisc_info = (struct mclagd_ndisc_msg *)(msg + len * count);
 
-        fprintf(stdout, "%-6d", count + 1);
+        if (mclagdctl_dump.json)
+        {
+            fprintf(stdout, "%s\n  {\"ip\": \"%s\", \"mac\": \"%02x:%02x:%02x:%02x:%02x:%02x\", \"dev\": \"%s\"}",
+                    mclagdctl_dump.index ? "," : "", ndisc_info->ipv6_addr,
+                    ndisc_info->mac_addr[0], ndisc_info->mac_addr[1],
+                    ndisc_info->mac_addr[2], ndisc_info->mac_addr[3],
+                    ndisc_info->mac_addr[4], ndisc_info->mac_addr[5], ndisc_info->ifname);
+            mclagdctl_dump.index++;
+            continue;
+        }
+
+        fprintf(stdout, "%-6d", ++mclagdctl_dump.index);
         fprintf(stdout, "%-52s", ndisc_info->ipv6_addr);
         fprintf(stdout, "%02x:%02x:%02x:%02x:%02x:%02x",
                 ndisc_info->mac_addr[0], ndisc_info->mac_addr[1],
@@ -379,6 +513,9 @@ int mclagdctl_parse_dump_ndisc(char *msg, int data_len)
         fprintf(stdout, "\n");
     }
 
+    if (mclagdctl_dump.json)
+        mclagdctl_dump_json_end();
+
     return 0;
 }
 
@@ -395,27 +532,50 @@ int mclagdctl_enca_dump_mac(char *msg, int mclag_id, int argc, char **argv)
     memset(&req, 0, sizeof(struct mclagdctl_req_hdr));
     req.info_type = INFO_TYPE_DUMP_MAC;
     req.mclag_id = mclag_id;
+    memcpy(&req.filter, &mclagdctl_filter, sizeof(struct mclagdctl_dump_filter));
     memcpy((struct mclagdctl_req_hdr *)msg, &req, sizeof(struct mclagdctl_req_hdr));
 
     return 1;
 }
 
+static const char *mclagdctl_mac_age_str(unsigned char age_flag)
+{
+    if ((age_flag & MAC_AGE_LOCAL_CTL) && (age_flag & MAC_AGE_PEER_CTL))
+        return "LP";
+    else if (age_flag & MAC_AGE_LOCAL_CTL)
+        return "L";
+    else if (age_flag & MAC_AGE_PEER_CTL)
+        return "P";
+
+    return " ";
+}
+
 int mclagdctl_parse_dump_mac(char *msg, int data_len)
 {
     struct mclagd_mac_msg * mac_info = NULL;
     int len = 0;
     int count = 0;
 
-    fprintf(stdout, "%-60s\n", "TYPE: S-STATIC, D-DYNAMIC; AGE: L-Local age, P-Peer age");
+    if (mclagdctl_filter.flags & MCLAGDCTL_FILTER_COUNT_ONLY)
+        return mclagdctl_parse_dump_count(msg, data_len);
 
-    fprintf(stdout, "%-6s", "No.");
-    fprintf(stdout, "%-5s", "TYPE");
-    fprintf(stdout, "%-20s", "MAC");
-    fprintf(stdout, "%-5s", "VID");
-    fprintf(stdout, "%-20s", "DEV");
-    fprintf(stdout, "%-20s", "ORIGIN-DEV");
-    fprintf(stdout, "%-5s", "AGE");
-    fprintf(stdout, "\n");
+    if (mclagdctl_dump.json)
+    {
+        mclagdctl_dump_json_begin();
+    }
+    else if (mclagdctl_dump.frames == 0)
+    {
+        fprintf(stdout, "%-60s\n", "TYPE: S-STATIC, D-DYNAMIC; AGE: L-Local age, P-Peer age");
+
+        fprintf(stdout, "%-6s", "No.");
+        fprintf(stdout, "%-5s", "TYPE");
+        fprintf(stdout, "%-20s", "MAC");
+        fprintf(stdout, "%-5s", "VID");
+        fprintf(stdout, "%-20s", "DEV");
+        fprintf(stdout, "%-20s", "ORIGIN-DEV");
+        fprintf(stdout, "%-5s", "AGE");
+        fprintf(stdout, "\n");
+    }
 
     len = sizeof(struct mclagd_mac_msg);
 
@@ -423,7 +583,20 @@ int mclagdctl_parse_dump_mac(char *msg, int data_len)
     {
         mac_info = (struct mclagd_mac_msg*)(msg + len * count);
 
-        fprintf(stdout, "%-6d", count + 1);
+        if (mclagdctl_dump.json)
+        {
+            fprintf(stdout, "%s\n  {\"type\": \"%s\", \"mac\": \"%s\", \"vid\": %d, \"dev\": \"%s\", "
+                    "\"origin_dev\": \"%s\", \"age\": \"%s\"}",
+                    mclagdctl_dump.index ? "," : "",
+                    (mac_info->fdb_type == MAC_TYPE_STATIC_CTL) ? "S" : "D",
+                    mac_info->mac_str, mac_info->vid, mac_info->ifname, mac_info->origin_ifname,
+                    (mac_info->age_flag & (MAC_AGE_LOCAL_CTL | MAC_AGE_PEER_CTL)) ?
+                    mclagdctl_mac_age_str(mac_info->age_flag) : "");
+            mclagdctl_dump.index++;
+            continue;
+        }
+
+        fprintf(stdout, "%-6d", ++mclagdctl_dump.index);
 
         if (mac_info->fdb_type == MAC_TYPE_STATIC_CTL)
             fprintf(stdout, "%-5s", "S");
@@ -434,18 +607,13 @@ int mclagdctl_parse_dump_mac(char *msg, int data_len)
         fprintf(stdout, "%-5d", mac_info->vid);
         fprintf(stdout, "%-20s", mac_info->ifname);
         fprintf(stdout, "%-20s", mac_info->origin_ifname);
-
-        if ((mac_info->age_flag & MAC_AGE_LOCAL_CTL) && (mac_info->age_flag & MAC_AGE_PEER_CTL))
-            fprintf(stdout, "%-5s", "LP");
-        else if (mac_info->age_flag & MAC_AGE_LOCAL_CTL)
-            fprintf(stdout, "%-5s", "L");
-        else if (mac_info->age_flag & MAC_AGE_PEER_CTL)
-            fprintf(stdout, "%-5s", "P");
-        else
-            fprintf(stdout, "%-5s", " ");
+        fprintf(stdout, "%-5s", mclagdctl_mac_age_str(mac_info->age_flag));
         fprintf(stdout, "\n");
     }
 
+    if (mclagdctl_dump.json)
+        mclagdctl_dump_json_end();
+
     return 0;
 }
 
@@ -584,6 +752,389 @@ int mclagdctl_parse_dump_peer_portlist(char *msg, int data_len)
     return 0;
 }
 
+int mclagdctl_enca_dump_counters(char *msg, int mclag_id, int argc, char **argv)
+{
+    struct mclagdctl_req_hdr req;
+
+    memset(&req, 0, sizeof(struct mclagdctl_req_hdr));
+    req.info_type = INFO_TYPE_DUMP_COUNTERS;
+    req.mclag_id = mclag_id;
+    memcpy((struct mclagdctl_req_hdr *)msg, &req, sizeof(struct mclagdctl_req_hdr));
+
+    return 1;
+}
+
+static const char *neigh_latency_bucket_str[MCLAGDCTL_NEIGH_LATENCY_BUCKETS] =
+{
+    "Batch latency <100us", "Batch latency <1ms", "Batch latency <10ms",
+    "Batch latency <100ms", "Batch latency <1s", "Batch latency >=1s"
+};
+
+int mclagdctl_parse_dump_counters(char *msg, int data_len)
+{
+    struct mclagd_counters * counters = NULL;
+    struct mclagd_session_counters * session = NULL;
+    struct mclagd_pool_counters * pool = NULL;
+    int len = 0;
+    int count = 0;
+    int i = 0;
+
+    if (data_len < sizeof(struct mclagd_counters))
+        return MCLAG_ERROR;
+
+    counters = (struct mclagd_counters*)msg;
+
+    fprintf(stdout, "%s\n", "mclagsyncd channel:");
+    fprintf(stdout, "    %-24s%llu\n", "TX frames", counters->syncd_tx_frames);
+    fprintf(stdout, "    %-24s%llu\n", "TX FDB entries", counters->syncd_tx_fdb_entries);
+    fprintf(stdout, "    %-24s%llu\n", "TX bytes", counters->syncd_tx_bytes);
+    fprintf(stdout, "    %-24s%llu\n", "writev calls", counters->syncd_writev_calls);
+    fprintf(stdout, "    %-24s%llu\n", "EAGAIN", counters->syncd_eagain);
+    fprintf(stdout, "    %-24s%llu\n", "High-water hits", counters->syncd_hwm_hits);
+    fprintf(stdout, "    %-24s%llu\n", "Dropped frames", counters->syncd_dropped_frames);
+    fprintf(stdout, "    %-24s%llu\n", "Dropped FDB entries", counters->syncd_dropped_fdb_entries);
+    fprintf(stdout, "    %-24s%llu\n", "FDB redirects", counters->syncd_fdb_redirects);
+    fprintf(stdout, "    %-24s%llu\n", "Stalls", counters->syncd_stalls);
+    fprintf(stdout, "    %-24s%llu\n", "Deferred frames", counters->syncd_deferred_frames);
+    fprintf(stdout, "    %-24s%llu\n", "Deferred FDB entries", counters->syncd_deferred_fdb_entries);
+    fprintf(stdout, "    %-24s%llu\n", "Deferred coalesced", counters->syncd_deferred_coalesced);
+    fprintf(stdout, "    %-24s%u\n", "Deferred pending", counters->syncd_deferred);
+    fprintf(stdout, "    %-24s%u\n", "Queued bytes", counters->syncd_queued_bytes);
+    fprintf(stdout, "    %-24s%u\n", "Queued bytes peak", counters->syncd_queued_bytes_peak);
+
+    fprintf(stdout, "%s\n", "mclagsyncd FDB subscription:");
+    fprintf(stdout, "    %-24s%s\n", "State", counters->fdb_sub_state ? "Subscribed" : "Polling");
+    fprintf(stdout, "    %-24s%u\n", "Last seq", counters->fdb_sub_seq);
+    fprintf(stdout, "    %-24s%llu\n", "Subscribes", counters->fdb_sub_subscribes);
+    fprintf(stdout, "    %-24s%llu\n", "Delta msgs", counters->fdb_sub_deltas);
+    fprintf(stdout, "    %-24s%llu\n", "Delta entries", counters->fdb_sub_delta_entries);
+    fprintf(stdout, "    %-24s%llu\n", "Snapshots", counters->fdb_sub_snapshots);
+    fprintf(stdout, "    %-24s%llu\n", "Snapshot entries", counters->fdb_sub_snapshot_entries);
+    fprintf(stdout, "    %-24s%llu\n", "Seq gaps", counters->fdb_sub_gaps);
+    fprintf(stdout, "    %-24s%llu\n", "Reconciled deletes", counters->fdb_sub_reconciled);
+    fprintf(stdout, "    %-24s%llu\n", "Polls", counters->fdb_sub_polls);
+
+    fprintf(stdout, "%s\n", "Memory pools:");
+    fprintf(stdout, "    %-8s%-10s%-12s%-14s%-12s%-14s%-14s%-16s%s\n", "Pool", "ObjSize",
+            "Live", "LiveBytes", "Peak", "PeakBytes", "SlabBytes", "Allocs", "Frees");
+    for (i = 0; i < MCLAGDCTL_POOL_MAX; i++)
+    {
+        pool = &counters->pools[i];
+        if (pool->obj_size == 0)
+            continue;
+
+        fprintf(stdout, "    %-8s%-10u%-12u%-14llu%-12u%-14llu%-14llu%-16llu%llu\n", pool->name,
+                pool->obj_size, pool->live, (unsigned long long)pool->live * pool->obj_size,
+                pool->peak, (unsigned long long)pool->peak * pool->obj_size,
+                pool->slab_bytes,
+                pool->allocs, pool->frees);
+    }
+
+    fprintf(stdout, "%s\n", "Kernel neighbor programming:");
+    fprintf(stdout, "    %-24s%llu\n", "Requests", counters->neigh_requests);
+    fprintf(stdout, "    %-24s%llu\n", "Batches", counters->neigh_batches);
+    fprintf(stdout, "    %-24s%llu\n", "Bytes", counters->neigh_bytes);
+    fprintf(stdout, "    %-24s%llu\n", "Acks", counters->neigh_acks);
+    fprintf(stdout, "    %-24s%llu\n", "Failures", counters->neigh_failures);
+    fprintf(stdout, "    %-24s%llu\n", "EAGAIN", counters->neigh_eagain);
+    fprintf(stdout, "    %-24s%llu\n", "Resyncs", counters->neigh_resyncs);
+    fprintf(stdout, "    %-24s%llu\n", "Lost acks", counters->neigh_lost_acks);
+    fprintf(stdout, "    %-24s%llu\n", "Dropped", counters->neigh_dropped);
+    fprintf(stdout, "    %-24s%u\n", "Pending", counters->neigh_pending);
+    fprintf(stdout, "    %-24s%u\n", "Pending peak", counters->neigh_pending_peak);
+    fprintf(stdout, "    %-24s%u\n", "Batch latency max (us)", counters->neigh_latency_max_usec);
+    for (i = 0; i < MCLAGDCTL_NEIGH_LATENCY_BUCKETS; i++)
+    {
+        fprintf(stdout, "    %-24s%llu\n", neigh_latency_bucket_str[i], counters->neigh_latency_hist[i]);
+    }
+
+    fprintf(stdout, "%s\n", "Kernel event ingestion:");
+    fprintf(stdout, "    %-24s%llu\n", "Events", counters->ingest_events);
+    fprintf(stdout, "    %-24s%llu\n", "Neighbor msgs", counters->ingest_neigh);
+    fprintf(stdout, "    %-24s%llu\n", "Link/addr msgs", counters->ingest_route_msgs);
+    fprintf(stdout, "    %-24s%llu\n", "ARP/ND packets", counters->ingest_packets);
+    fprintf(stdout, "    %-24s%llu\n", "ARP/ND frames", counters->ingest_pkt_frames);
+    fprintf(stdout, "    %-24s%llu\n", "ARP/ND batches", counters->ingest_pkt_batches);
+    fprintf(stdout, "    %-24s%llu\n", "ARP/ND duplicates", counters->ingest_pkt_dups);
+    fprintf(stdout, "    %-24s%llu\n", "ARP/ND kernel drops", counters->ingest_pkt_kernel_drops);
+    fprintf(stdout, "    %-24s%llu\n", "Wakeups", counters->ingest_wakeups);
+    fprintf(stdout, "    %-24s%llu\n", "Socket overruns", counters->ingest_recv_errors);
+    fprintf(stdout, "    %-24s%llu\n", "Ring dropped", counters->ingest_dropped);
+    fprintf(stdout, "    %-24s%llu\n", "Resyncs", counters->ingest_resyncs);
+    fprintf(stdout, "    %-24s%u\n", "Ring depth", counters->ingest_depth);
+    fprintf(stdout, "    %-24s%u\n", "Ring depth peak", counters->ingest_depth_peak);
+
+    fprintf(stdout, "%s\n", "Kernel resync:");
+    fprintf(stdout, "    %-24s%llu\n", "Route sock overruns", counters->resync_route_losses);
+    fprintf(stdout, "    %-24s%llu\n", "Team sock overruns", counters->resync_team_losses);
+    fprintf(stdout, "    %-24s%llu\n", "Ring overflows", counters->resync_ring_losses);
+    fprintf(stdout, "    %-24s%llu\n", "Deferred", counters->resync_deferred);
+    fprintf(stdout, "    %-24s%llu\n", "Link dumps", counters->resync_link_dumps);
+    fprintf(stdout, "    %-24s%llu\n", "Addr dumps", counters->resync_addr_dumps);
+    fprintf(stdout, "    %-24s%llu\n", "ARP dumps", counters->resync_neigh4_dumps);
+    fprintf(stdout, "    %-24s%llu\n", "ND dumps", counters->resync_neigh6_dumps);
+    fprintf(stdout, "    %-24s%llu\n", "Port-channel dumps", counters->resync_team_dumps);
+    fprintf(stdout, "    %-24s%llu\n", "Steps", counters->resync_steps);
+    fprintf(stdout, "    %-24s%llu\n", "Total usec", counters->resync_total_usec);
+    fprintf(stdout, "    %-24s%u\n", "Max step usec", counters->resync_max_step_usec);
+    fprintf(stdout, "    %-24s0x%x\n", "Pending types", counters->resync_pending);
+
+    msg += sizeof(struct mclagd_counters);
+    data_len -= sizeof(struct mclagd_counters);
+    len = sizeof(struct mclagd_session_counters);
+
+    for (; data_len >= len; data_len -= len, count++)
+    {
+        session = (struct mclagd_session_counters*)(msg + len * count);
+
+        fprintf(stdout, "Peer session %d (%s):\n", session->mclag_id, session->peer_ip);
+        fprintf(stdout, "    %-24s%llu\n", "TX msgs", session->tx_msgs);
+        fprintf(stdout, "    %-24s%llu\n", "TX bytes", session->tx_bytes);
+        fprintf(stdout, "    %-24s%llu\n", "TX EAGAIN", session->tx_eagain);
+        fprintf(stdout, "    %-24s%llu\n", "TX dropped", session->tx_dropped);
+        fprintf(stdout, "    %-24s%u\n", "TX queued bytes", session->tx_queued_bytes);
+        fprintf(stdout, "    %-24s%u\n", "TX queued bytes peak", session->tx_queued_bytes_peak);
+        fprintf(stdout, "    %-24s%llu\n", "TX stalls", session->tx_stalls);
+        fprintf(stdout, "    %-24s%llu\n", "TX stall time (ms)", session->tx_stall_msec);
+        fprintf(stdout, "    %-24s%u\n", "TX stall max (ms)", session->tx_stall_max_msec);
+        fprintf(stdout, "    %-24s%llu\n", "RX msgs", session->rx_msgs);
+        fprintf(stdout, "    %-24s%llu\n", "RX bytes", session->rx_bytes);
+        fprintf(stdout, "    %-24s%llu\n", "RX blocks", session->rx_blocks);
+        fprintf(stdout, "    %-24s%llu\n", "RX bytes copied", session->rx_copy_bytes);
+        fprintf(stdout, "    %-24s%llu\n", "RX copied per msg",
+                session->rx_msgs ? session->rx_copy_bytes / session->rx_msgs : 0);
+        fprintf(stdout, "    %-24s%u x %u\n", "Fast hello (ms)",
+                session->fast_hello_interval_msec, session->fast_hello_multiplier);
+        fprintf(stdout, "    %-24s%u x %u\n", "Fast hello peer (ms)",
+                session->fast_hello_peer_interval_msec, session->fast_hello_peer_multiplier);
+        fprintf(stdout, "    %-24s%llu\n", "Fast hello TX", session->fast_hello_tx);
+        fprintf(stdout, "    %-24s%llu\n", "Fast hello RX", session->fast_hello_rx);
+        fprintf(stdout, "    %-24s%llu\n", "Fast hello RX lost", session->fast_hello_rx_lost);
+        fprintf(stdout, "    %-24s%u\n", "Fast hello jitter avg(us)", session->fast_hello_jitter_avg_usec);
+        fprintf(stdout, "    %-24s%u\n", "Fast hello jitter max(us)", session->fast_hello_jitter_max_usec);
+        fprintf(stdout, "    %-24s%llu\n", "Peer down detects", session->fast_hello_detects);
+        fprintf(stdout, "    %-24s%u\n", "Last detect time (ms)", session->fast_hello_last_detect_msec);
+    }
+
+    return 0;
+}
+
+int mclagdctl_enca_dump_latency(char *msg, int mclag_id, int argc, char **argv)
+{
+    struct mclagdctl_req_hdr req;
+
+    memset(&req, 0, sizeof(struct mclagdctl_req_hdr));
+    req.info_type = INFO_TYPE_DUMP_LATENCY;
+    req.mclag_id = mclag_id;
+    memcpy((struct mclagdctl_req_hdr *)msg, &req, sizeof(struct mclagdctl_req_hdr));
+
+    return 1;
+}
+
+static const char *latency_bucket_str[MCLAGDCTL_LATENCY_BUCKETS] =
+{
+    "<10us", "<100us", "<1ms", "<10ms", "<100ms", "<1s", ">=1s"
+};
+
+int mclagdctl_parse_dump_latency(char *msg, int data_len)
+{
+    struct mclagd_latency * latency = NULL;
+    struct mclagd_latency_stage * stage = NULL;
+    struct mclagd_tlv_counters * tlv = NULL;
+    int len = 0;
+    int count = 0;
+    int i = 0;
+    int j = 0;
+
+    if (data_len < sizeof(struct mclagd_latency))
+        return MCLAG_ERROR;
+
+    latency = (struct mclagd_latency*)msg;
+
+    fprintf(stdout, "Pipeline latency (us), %llu seconds since the last clear:\n", latency->elapsed_sec);
+    fprintf(stdout, "    %-24s%-10s%-10s%-10s", "Stage", "Count", "Avg", "Max");
+    for (j = 0; j < MCLAGDCTL_LATENCY_BUCKETS; j++)
+        fprintf(stdout, "%-10s", latency_bucket_str[j]);
+    fprintf(stdout, "\n");
+
+    for (i = 0; i < latency->stage_num && i < MCLAGDCTL_LATENCY_STAGE_MAX; i++)
+    {
+        stage = &latency->stages[i];
+        fprintf(stdout, "    %-24s%-10llu%-10llu%-10llu", stage->name, stage->count,
+                stage->count ? stage->sum_usec / stage->count : 0, stage->max_usec);
+        for (j = 0; j < MCLAGDCTL_LATENCY_BUCKETS; j++)
+            fprintf(stdout, "%-10llu", stage->hist[j]);
+        fprintf(stdout, "\n");
+    }
+
+    msg += sizeof(struct mclagd_latency);
+    data_len -= sizeof(struct mclagd_latency);
+    len = sizeof(struct mclagd_tlv_counters);
+
+    fprintf(stdout, "%s\n", "Peer msgs by TLV type:");
+    fprintf(stdout, "    %-8s%-34s%-14s%s\n", "Type", "Name", "RX", "TX");
+    for (; data_len >= len; data_len -= len, count++)
+    {
+        tlv = (struct mclagd_tlv_counters*)(msg + len * count);
+        fprintf(stdout, "    0x%04x  %-34s%-14llu%llu\n", tlv->type, tlv->name, tlv->rx, tlv->tx);
+    }
+    fprintf(stdout, "    %-8s%-34s%-14llu%llu\n", "-", "Other", latency->tlv_other_rx, latency->tlv_other_tx);
+
+    return 0;
+}
+
+int mclagdctl_enca_clear_latency(char *msg, int mclag_id, int argc, char **argv)
+{
+    struct mclagdctl_req_hdr req;
+
+    memset(&req, 0, sizeof(struct mclagdctl_req_hdr));
+    req.info_type = INFO_TYPE_CLEAR_LATENCY;
+    req.mclag_id = mclag_id;
+    memcpy((struct mclagdctl_req_hdr *)msg, &req, sizeof(struct mclagdctl_req_hdr));
+
+    return 1;
+}
+
+int mclagdctl_parse_clear_latency(char *msg, int data_len)
+{
+    fprintf(stdout, "%s\n", "Clear latency success!");
+
+    return 0;
+}
+
+int mclagdctl_enca_dump_log_ring(char *msg, int mclag_id, int argc, char **argv)
+{
+    struct mclagdctl_req_hdr req;
+
+    memset(&req, 0, sizeof(struct mclagdctl_req_hdr));
+    req.info_type = INFO_TYPE_DUMP_LOG_RING;
+    req.mclag_id = mclag_id;
+    memcpy((struct mclagdctl_req_hdr *)msg, &req, sizeof(struct mclagdctl_req_hdr));
+
+    return 1;
+}
+
+static const char *log_level_str[] =
+{
+    "CRITICAL", "ERROR", "WARN", "NOTICE", "INFO", "DEBUG"
+};
+
+static int mclagdctl_log_record_cmp(const void *a, const void *b)
+{
+    const struct mclagd_log_record *ra = *(const struct mclagd_log_record **)a;
+    const struct mclagd_log_record *rb = *(const struct mclagd_log_record **)b;
+
+    if (ra->pos < rb->pos)
+        return -1;
+
+    return ra->pos > rb->pos;
+}
+
+/* Print the records of a ring dump file in order, records not yet written
+ * to syslog are marked by '*'*/
+static int mclagdctl_decode_log_ring(const char *path)
+{
+    struct mclagd_log_ring_hdr hdr;
+    struct mclagd_log_record *records = NULL;
+    struct mclagd_log_record **sorted = NULL;
+    struct mclagd_log_record *rec = NULL;
+    char time_str[32];
+    struct tm tm;
+    time_t sec;
+    FILE *fp = NULL;
+    int num = 0;
+    int ret = MCLAG_ERROR;
+    unsigned int i;
+
+    fp = fopen(path, "rb");
+    if (!fp)
+    {
+        fprintf(stderr, "Failed to open %s: %s\n", path, strerror(errno));
+        return MCLAG_ERROR;
+    }
+
+    if (fread(&hdr, sizeof(hdr), 1, fp) != 1 || hdr.magic != MCLAGDCTL_LOG_RING_MAGIC
+        || hdr.record_size != sizeof(struct mclagd_log_record) || hdr.records == 0
+        || (hdr.records & (hdr.records - 1)))
+    {
+        fprintf(stderr, "%s is not a log ring dump\n", path);
+        goto out;
+    }
+
+    records = (struct mclagd_log_record *)malloc(hdr.records * sizeof(struct mclagd_log_record));
+    sorted = (struct mclagd_log_record **)malloc(hdr.records * sizeof(struct mclagd_log_record *));
+    if (!records || !sorted)
+    {
+        fprintf(stderr, "Failed to malloc log records\n");
+        goto out;
+    }
+
+    if (fread(records, sizeof(struct mclagd_log_record), hdr.records, fp) != hdr.records)
+    {
+        fprintf(stderr, "%s is truncated\n", path);
+        goto out;
+    }
+
+    for (i = 0; i < hdr.records; i++)
+    {
+        rec = &records[i];
+        if (rec->usec == 0 || (rec->pos & (hdr.records - 1)) != i)
+            continue;
+        if (rec->seq != rec->pos + 1 && rec->seq != rec->pos + hdr.records)
+            continue;
+
+        rec->text[MCLAGDCTL_LOG_RING_TEXT_SIZE - 1] = '\0';
+        sorted[num++] = rec;
+    }
+
+    qsort(sorted, num, sizeof(struct mclagd_log_record *), mclagdctl_log_record_cmp);
+
+    fprintf(stdout, "Log ring %s: %d records, %llu dropped, %llu suppressed\n",
+            path, num, hdr.dropped, hdr.suppressed);
+
+    for (i = 0; i < num; i++)
+    {
+        rec = sorted[i];
+        sec = rec->usec / 1000000;
+        localtime_r(&sec, &tm);
+        strftime(time_str, sizeof(time_str), "%Y-%m-%d %H:%M:%S", &tm);
+
+        fprintf(stdout, "%c %s.%06llu %-9s%s\n", rec->seq == rec->pos + 1 ? '*' : ' ',
+                time_str, rec->usec % 1000000,
+                rec->level < sizeof(log_level_str) / sizeof(log_level_str[0]) ? log_level_str[rec->level] : "-",
+                rec->text);
+    }
+
+    ret = 0;
+
+ out:
+    if (records)
+        free(records);
+    if (sorted)
+        free(sorted);
+    fclose(fp);
+
+    return ret;
+}
+
+int mclagdctl_parse_dump_log_ring(char *msg, int data_len)
+{
+    struct mclagd_log_ring * ring = NULL;
+
+    if (data_len < sizeof(struct mclagd_log_ring))
+        return MCLAG_ERROR;
+
+    ring = (struct mclagd_log_ring*)msg;
+
+    fprintf(stdout, "%-24s%llu\n", "Written", ring->written);
+    fprintf(stdout, "%-24s%llu\n", "Dropped", ring->dropped);
+    fprintf(stdout, "%-24s%llu\n", "Suppressed", ring->suppressed);
+
+    ring->path[MCLAGDCTL_LOG_RING_PATH_LEN - 1] = '\0';
+
+    return mclagdctl_decode_log_ring(ring->path);
+}
+
 int mclagdctl_enca_config_loglevel(char *msg, int log_level,  int argc, char **argv)
 {
     struct mclagdctl_req_hdr req;
@@ -726,7 +1277,13 @@ static void mclagdctl_print_help(const char *argv0)
     fprintf(stdout, "%s [options] command [command args]\n"
             "    -h --help                Show this help\n"
             "    -i --mclag-id            Specify one mclag id\n"
-            "    -l --level               Specify log level     critical,err,warn,notice,info,debug\n",
+            "    -l --level               Specify log level     critical,err,warn,notice,info,debug\n"
+            "    -v --vlan                Dump the entries of one vlan\n"
+            "    -p --port                Dump the entries of one interface\n"
+            "    -m --mac                 Dump the entries of a MAC prefix, xx:xx:xx\n"
+            "    -a --age                 Dump the entries of age flag  local,peer,both,none\n"
+            "    -c --count               Dump the number of entries only\n"
+            "    -j --json                Dump in JSON\n",
             argv0);
     fprintf(stdout, "Commands:\n");
 
@@ -755,6 +1312,12 @@ int main(int argc, char **argv)
         { "help",      no_argument,             NULL,        'h' },
         { "mclag id",  required_argument,       NULL,        'i' },
         { "log level", required_argument,       NULL,        'l' },
+        { "vlan",      required_argument,       NULL,        'v' },
+        { "port",      required_argument,       NULL,        'p' },
+        { "mac",       required_argument,       NULL,        'm' },
+        { "age",       required_argument,       NULL,        'a' },
+        { "count",     no_argument,             NULL,        'c' },
+        { "json",      no_argument,             NULL,        'j' },
         { NULL,        0,                       NULL,        0   }
     };
     int opt;
@@ -767,7 +1330,7 @@ int main(int argc, char **argv)
     char *data;
     struct mclagd_reply_hdr *reply;
 
-    while ((opt = getopt_long(argc, argv, "hi:l:", long_options, NULL)) >= 0)
+    while ((opt = getopt_long(argc, argv, "hi:l:v:p:m:a:cj", long_options, NULL)) >= 0)
     {
         switch (opt)
         {
@@ -813,6 +1376,47 @@ int main(int argc, char **argv)
             }
             break;
 
+        case 'v':
+            mclagdctl_filter.flags |= MCLAGDCTL_FILTER_VLAN;
+            mclagdctl_filter.vid = atoi(optarg);
+            break;
+
+        case 'p':
+            mclagdctl_filter.flags |= MCLAGDCTL_FILTER_IFNAME;
+            snprintf(mclagdctl_filter.ifname, MCLAGDCTL_MAX_L_PORT_NANE, "%s", optarg);
+            break;
+
+        case 'm':
+            mclagdctl_filter.flags |= MCLAGDCTL_FILTER_MAC;
+            snprintf(mclagdctl_filter.mac_prefix, ETHER_ADDR_STR_LEN, "%s", optarg);
+            break;
+
+        case 'a':
+            mclagdctl_filter.flags |= MCLAGDCTL_FILTER_AGE;
+            if (!strcmp(optarg, "local"))
+                mclagdctl_filter.age_flag = MAC_AGE_LOCAL_CTL;
+            else if (!strcmp(optarg, "peer"))
+                mclagdctl_filter.age_flag = MAC_AGE_PEER_CTL;
+            else if (!strcmp(optarg, "both"))
+                mclagdctl_filter.age_flag = MAC_AGE_LOCAL_CTL | MAC_AGE_PEER_CTL;
+            else if (!strcmp(optarg, "none"))
+                mclagdctl_filter.age_flag = 0;
+            else
+            {
+                fprintf(stderr, "unknown age \"%s\".\n", optarg);
+                mclagdctl_print_help(argv0);
+                return EXIT_FAILURE;
+            }
+            break;
+
+        case 'c':
+            mclagdctl_filter.flags |= MCLAGDCTL_FILTER_COUNT_ONLY;
+            break;
+
+        case 'j':
+            mclagdctl_dump.json = 1;
+            break;
+
             case '?':
                 fprintf(stderr, "unknown option.\n");
                 mclagdctl_print_help(argv0);
@@ -846,7 +1450,13 @@ int main(int argc, char **argv)
     {
         ret = mclagdctl_sock_connect();
         if (ret < 0)
+        {
+            /*Post-mortem, the ring is dumped when iccpd dies by a signal*/
+            if (cmd_type->info_type == INFO_TYPE_DUMP_LOG_RING)
+                return mclagdctl_decode_log_ring(MCLAGDCTL_LOG_RING_FILE) < 0 ? EXIT_FAILURE : EXIT_SUCCESS;
+
             return EXIT_FAILURE;
+        }
     }
 
     if (cmd_type->enca_msg(buf, para_int, argc, argv) < 0)
@@ -864,71 +1474,80 @@ int main(int argc, char **argv)
         goto mclagdctl_disconnect;
     }
 
-    /*read data length*/
-    memset(buf, 0, MCLAGDCTL_CMD_SIZE);
-    ret = mclagdctl_sock_read(mclagdctl_sock_fd, buf, sizeof(int));
-    if (ret <= 0)
+    /*MAC/ARP/ND dumps are streamed, read frames until the last one*/
+    do
     {
-        fprintf(stderr, "Failed to read data length from mclagd\n");
-        ret = EXIT_FAILURE;
-        goto mclagdctl_disconnect;
-    }
+        /*read data length*/
+        memset(buf, 0, MCLAGDCTL_CMD_SIZE);
+        ret = mclagdctl_sock_read(mclagdctl_sock_fd, buf, sizeof(int));
+        if (ret <= 0)
+        {
+            fprintf(stderr, "Failed to read data length from mclagd\n");
+            ret = EXIT_FAILURE;
+            goto mclagdctl_disconnect;
+        }
 
-    /*cont length*/
-    len = *((int*)buf);
-    if (len <= 0)
-    {
-        ret = EXIT_FAILURE;
-        fprintf(stderr, "pkt len = %d, error\n", len);
-        goto mclagdctl_disconnect;
-    }
+        /*cont length*/
+        len = *((int*)buf);
+        if (len <= 0)
+        {
+            ret = EXIT_FAILURE;
+            fprintf(stderr, "pkt len = %d, error\n", len);
+            goto mclagdctl_disconnect;
+        }
 
-    rcv_buf = (char *)malloc(len);
-    if (!rcv_buf)
-    {
-        fprintf(stderr, "Failed to malloc rcv_buf for mclagdctl\n");
-        goto mclagdctl_disconnect;
-    }
+        rcv_buf = (char *)malloc(len);
+        if (!rcv_buf)
+        {
+            fprintf(stderr, "Failed to malloc rcv_buf for mclagdctl\n");
+            goto mclagdctl_disconnect;
+        }
 
-    /*read data*/
-    ret = mclagdctl_sock_read(mclagdctl_sock_fd, rcv_buf, len);
-    if (ret <= 0)
-    {
-        fprintf(stderr, "Failed to read data from mclagd\n");
-        ret = EXIT_FAILURE;
-        goto mclagdctl_disconnect;
-    }
+        /*read data*/
+        ret = mclagdctl_sock_read(mclagdctl_sock_fd, rcv_buf, len);
+        if (ret <= 0)
+        {
+            fprintf(stderr, "Failed to read data from mclagd\n");
+            ret = EXIT_FAILURE;
+            goto mclagdctl_disconnect;
+        }
 
-    reply = (struct mclagd_reply_hdr *)rcv_buf;
-    if (reply->info_type != cmd_type->info_type)
-    {
-        fprintf(stderr, "Reply info type from mclagd error\n");
-        ret = EXIT_FAILURE;
-        goto mclagdctl_disconnect;
-    }
+        reply = (struct mclagd_reply_hdr *)rcv_buf;
+        if (reply->info_type != cmd_type->info_type)
+        {
+            fprintf(stderr, "Reply info type from mclagd error\n");
+            ret = EXIT_FAILURE;
+            goto mclagdctl_disconnect;
+        }
 
-    if (reply->exec_result == EXEC_TYPE_NO_EXIST_SYS)
-    {
-        fprintf(stderr, "No exist sys in iccpd!\n");
-        ret = EXIT_FAILURE;
-        goto mclagdctl_disconnect;
-    }
+        if (reply->exec_result == EXEC_TYPE_NO_EXIST_SYS)
+        {
+            fprintf(stderr, "No exist sys in iccpd!\n");
+            ret = EXIT_FAILURE;
+            goto mclagdctl_disconnect;
+        }
 
-    if (reply->exec_result == EXEC_TYPE_NO_EXIST_MCLAGID)
-    {
-        fprintf(stderr, "Mclag-id %d hasn't been configured in iccpd!\n", para_int);
-        ret = EXIT_FAILURE;
-        goto mclagdctl_disconnect;
-    }
+        if (reply->exec_result == EXEC_TYPE_NO_EXIST_MCLAGID)
+        {
+            fprintf(stderr, "Mclag-id %d hasn't been configured in iccpd!\n", para_int);
+            ret = EXIT_FAILURE;
+            goto mclagdctl_disconnect;
+        }
 
-    if (reply->exec_result == EXEC_TYPE_FAILED)
-    {
-        fprintf(stderr, "exec error in iccpd!\n");
-        ret = EXIT_FAILURE;
-        goto mclagdctl_disconnect;
-    }
+        if (reply->exec_result == EXEC_TYPE_FAILED)
+        {
+            fprintf(stderr, "exec error in iccpd!\n");
+            ret = EXIT_FAILURE;
+            goto mclagdctl_disconnect;
+        }
 
-    cmd_type->parse_msg((char *)(rcv_buf + sizeof(struct mclagd_reply_hdr)), len - sizeof(struct mclagd_reply_hdr));
+        mclagdctl_dump.last = (reply->exec_result != EXEC_TYPE_MORE);
+        cmd_type->parse_msg((char *)(rcv_buf + sizeof(struct mclagd_reply_hdr)), len - sizeof(struct mclagd_reply_hdr));
+        mclagdctl_dump.frames++;
+
+        free(rcv_buf);
+        rcv_buf = NULL;
+    } while (!mclagdctl_dump.last);
 
     ret = EXIT_SUCCESS;
 
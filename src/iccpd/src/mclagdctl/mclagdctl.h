@@ -28,6 +28,16 @@
 #define MCLAGDCTL_INET6_ADDR_LEN 64
 #define MCLAGDCTL_ETHER_ADDR_LEN 6
 #define MCLAGDCTL_PORT_MEMBER_BUF_LEN 512
+#define MCLAGDCTL_POOL_NAME_LEN 16
+#define MCLAGDCTL_POOL_MAX 4
+#define MCLAGDCTL_NEIGH_LATENCY_BUCKETS 6
+#define MCLAGDCTL_LATENCY_STAGE_MAX 16
+#define MCLAGDCTL_LATENCY_BUCKETS 7
+#define MCLAGDCTL_LATENCY_NAME_LEN 32
+#define MCLAGDCTL_LOG_RING_FILE "/var/run/iccpd/iccpd_log_ring.bin"
+#define MCLAGDCTL_LOG_RING_MAGIC 0x49434c52
+#define MCLAGDCTL_LOG_RING_TEXT_SIZE 512
+#define MCLAGDCTL_LOG_RING_PATH_LEN 64
 #define ETHER_ADDR_STR_LEN 18
 
 typedef int (*call_enca_msg_fun)(char *msg, int mclag_id,  int argc, char **argv);
@@ -54,8 +64,13 @@ enum id_command_type
     ID_CMDTYPE_D_P,
     ID_CMDTYPE_D_P_L,
     ID_CMDTYPE_D_P_P,
+    ID_CMDTYPE_D_C,
+    ID_CMDTYPE_D_L,
+    ID_CMDTYPE_D_LR,
     ID_CMDTYPE_C,
     ID_CMDTYPE_C_L,
+    ID_CMDTYPE_CL,
+    ID_CMDTYPE_CL_L,
 };
 
 enum mclagdctl_notify_peer_type
@@ -68,6 +83,10 @@ enum mclagdctl_notify_peer_type
     INFO_TYPE_DUMP_LOCAL_PORTLIST,
     INFO_TYPE_DUMP_PEER_PORTLIST,
     INFO_TYPE_CONFIG_LOGLEVEL,
+    INFO_TYPE_DUMP_COUNTERS,
+    INFO_TYPE_DUMP_LATENCY,
+    INFO_TYPE_CLEAR_LATENCY,
+    INFO_TYPE_DUMP_LOG_RING,
     INFO_TYPE_FINISH,
 };
 
@@ -81,6 +100,24 @@ enum log_level_type
     DEBUG = 5
 };
 
+/* Server side filters of the MAC/ARP/ND dumps*/
+#define MCLAGDCTL_FILTER_VLAN       0x01
+#define MCLAGDCTL_FILTER_IFNAME     0x02
+#define MCLAGDCTL_FILTER_MAC        0x04
+#define MCLAGDCTL_FILTER_AGE        0x08
+#define MCLAGDCTL_FILTER_COUNT_ONLY 0x80
+
+struct mclagdctl_dump_filter
+{
+    unsigned int flags;
+    unsigned short vid;
+    /* MAC_AGE_*_CTL bits the entry must have, 0 for not aged*/
+    unsigned char age_flag;
+    char ifname[MCLAGDCTL_MAX_L_PORT_NANE];
+    /* Case insensitive prefix of "xx:xx:xx:xx:xx:xx"*/
+    char mac_prefix[ETHER_ADDR_STR_LEN];
+};
+
 struct mclagdctl_req_hdr
 {
     int info_type;
@@ -88,6 +125,7 @@ struct mclagdctl_req_hdr
     char para1[MCLAGDCTL_PARA2_LEN];
     char para2[MCLAGDCTL_PARA2_LEN];
     char para3[MCLAGDCTL_PARA2_LEN];
+    struct mclagdctl_dump_filter filter;
 };
 
 struct mclagd_reply_hdr
@@ -101,6 +139,8 @@ struct mclagd_reply_hdr
 #define EXEC_TYPE_NO_EXIST_SYS  -2
 #define EXEC_TYPE_NO_EXIST_MCLAGID  -3
 #define EXEC_TYPE_FAILED -4
+/* Streamed reply, more frames follow*/
+#define EXEC_TYPE_MORE -5
 
 #define MCLAG_ERROR -1
 
@@ -193,6 +233,186 @@ struct mclagd_peer_if
     unsigned char po_active;
 };
 
+struct mclagd_pool_counters
+{
+    char name[MCLAGDCTL_POOL_NAME_LEN];
+    unsigned int obj_size;
+    unsigned int live;
+    unsigned int peak;
+    unsigned long long slab_bytes;
+    unsigned long long allocs;
+    unsigned long long frees;
+};
+
+struct mclagd_counters
+{
+    /* mclagsyncd outbound channel*/
+    unsigned long long syncd_tx_frames;
+    unsigned long long syncd_tx_fdb_entries;
+    unsigned long long syncd_tx_bytes;
+    unsigned long long syncd_writev_calls;
+    unsigned long long syncd_eagain;
+    unsigned long long syncd_hwm_hits;
+    unsigned long long syncd_dropped_frames;
+    unsigned long long syncd_dropped_fdb_entries;
+    unsigned long long syncd_fdb_redirects;
+    unsigned long long syncd_stalls;
+    unsigned long long syncd_deferred_frames;
+    unsigned long long syncd_deferred_fdb_entries;
+    unsigned long long syncd_deferred_coalesced;
+    unsigned int syncd_deferred;
+    unsigned int syncd_queued_bytes;
+    unsigned int syncd_queued_bytes_peak;
+    /* FDB changes pushed by mclagsyncd*/
+    unsigned long long fdb_sub_subscribes;
+    unsigned long long fdb_sub_deltas;
+    unsigned long long fdb_sub_delta_entries;
+    unsigned long long fdb_sub_snapshots;
+    unsigned long long fdb_sub_snapshot_entries;
+    unsigned long long fdb_sub_gaps;
+    unsigned long long fdb_sub_reconciled;
+    unsigned long long fdb_sub_polls;
+    unsigned int fdb_sub_state;     /* 1 if subscribed*/
+    unsigned int fdb_sub_seq;
+    /* Msg and MAC/ARP/ND entry pools*/
+    struct mclagd_pool_counters pools[MCLAGDCTL_POOL_MAX];
+    /* ARP/ND programming to kernel*/
+    unsigned long long neigh_requests;
+    unsigned long long neigh_batches;
+    unsigned long long neigh_bytes;
+    unsigned long long neigh_acks;
+    unsigned long long neigh_failures;
+    unsigned long long neigh_eagain;
+    unsigned long long neigh_lost_acks;
+    unsigned long long neigh_dropped;
+    unsigned long long neigh_resyncs;
+    unsigned int neigh_pending;
+    unsigned int neigh_pending_peak;
+    unsigned int neigh_latency_max_usec;
+    unsigned long long neigh_latency_hist[MCLAGDCTL_NEIGH_LATENCY_BUCKETS];
+    /* Kernel event ingestion thread*/
+    unsigned long long ingest_events;
+    unsigned long long ingest_neigh;
+    unsigned long long ingest_route_msgs;
+    unsigned long long ingest_packets;
+    unsigned long long ingest_recv_errors;
+    unsigned long long ingest_dropped;
+    unsigned long long ingest_wakeups;
+    unsigned long long ingest_resyncs;
+    unsigned long long ingest_pkt_frames;
+    unsigned long long ingest_pkt_batches;
+    unsigned long long ingest_pkt_dups;
+    unsigned long long ingest_pkt_kernel_drops;
+    unsigned int ingest_depth;
+    unsigned int ingest_depth_peak;
+    /* Kernel dumps after lost events*/
+    unsigned long long resync_route_losses;
+    unsigned long long resync_team_losses;
+    unsigned long long resync_ring_losses;
+    unsigned long long resync_deferred;
+    unsigned long long resync_link_dumps;
+    unsigned long long resync_addr_dumps;
+    unsigned long long resync_neigh4_dumps;
+    unsigned long long resync_neigh6_dumps;
+    unsigned long long resync_team_dumps;
+    unsigned long long resync_steps;
+    unsigned long long resync_total_usec;
+    unsigned int resync_max_step_usec;
+    unsigned int resync_pending;
+};
+
+/* Followed the mclagd_counters, one per peer session*/
+struct mclagd_session_counters
+{
+    int mclag_id;
+    char peer_ip[MCLAGDCTL_INET_ADDR_LEN];
+    unsigned long long tx_msgs;
+    unsigned long long tx_bytes;
+    unsigned long long tx_eagain;
+    unsigned long long tx_dropped;
+    unsigned long long tx_stalls;
+    unsigned long long tx_stall_msec;
+    unsigned long long rx_msgs;
+    unsigned long long rx_bytes;
+    unsigned long long rx_copy_bytes;
+    unsigned long long rx_blocks;
+    unsigned int tx_queued_bytes;
+    unsigned int tx_queued_bytes_peak;
+    unsigned int tx_stall_max_msec;
+    unsigned int fast_hello_interval_msec;
+    unsigned int fast_hello_multiplier;
+    unsigned int fast_hello_peer_interval_msec;
+    unsigned int fast_hello_peer_multiplier;
+    unsigned int fast_hello_last_detect_msec;
+    unsigned int fast_hello_jitter_max_usec;
+    unsigned int fast_hello_jitter_avg_usec;
+    unsigned long long fast_hello_tx;
+    unsigned long long fast_hello_rx;
+    unsigned long long fast_hello_rx_lost;
+    unsigned long long fast_hello_detects;
+};
+
+struct mclagd_latency_stage
+{
+    char name[MCLAGDCTL_LATENCY_NAME_LEN];
+    unsigned long long count;
+    unsigned long long sum_usec;
+    unsigned long long max_usec;
+    unsigned long long hist[MCLAGDCTL_LATENCY_BUCKETS];
+};
+
+struct mclagd_latency
+{
+    unsigned long long elapsed_sec;     /* since the last clear*/
+    unsigned long long tlv_other_rx;
+    unsigned long long tlv_other_tx;
+    int stage_num;
+    struct mclagd_latency_stage stages[MCLAGDCTL_LATENCY_STAGE_MAX];
+};
+
+/* Followed the mclagd_latency, one per TLV type seen*/
+struct mclagd_tlv_counters
+{
+    unsigned int type;
+    char name[MCLAGDCTL_LATENCY_NAME_LEN];
+    unsigned long long rx;
+    unsigned long long tx;
+};
+
+struct mclagd_log_ring
+{
+    unsigned long long written;
+    unsigned long long dropped;
+    unsigned long long suppressed;
+    int records;
+    char path[MCLAGDCTL_LOG_RING_PATH_LEN];
+};
+
+/* Log ring dump file, the head followed by the records*/
+struct mclagd_log_ring_hdr
+{
+    unsigned int magic;
+    unsigned int version;
+    unsigned int record_size;
+    unsigned int records;
+    unsigned long long head;
+    unsigned long long tail;
+    unsigned long long dropped;
+    unsigned long long suppressed;
+};
+
+struct mclagd_log_record
+{
+    unsigned long long seq;
+    unsigned long long pos;
+    unsigned long long usec;
+    unsigned char level;
+    unsigned char pad;
+    unsigned short len;
+    unsigned int pad2;
+    char text[MCLAGDCTL_LOG_RING_TEXT_SIZE];
+};
+
 extern int mclagdctl_enca_dump_state(char *msg, int mclag_id,  int argc, char **argv);
 extern int mclagdctl_parse_dump_state(char *msg, int data_len);
 extern int mclagdctl_enca_dump_arp(char *msg, int mclag_id, int argc, char **argv);
@@ -207,4 +427,12 @@ extern int mclagdctl_enca_dump_peer_portlist(char *msg, int mclag_id,  int argc,
 extern int mclagdctl_parse_dump_peer_portlist(char *msg, int data_len);
 int mclagdctl_enca_config_loglevel(char *msg, int log_level,  int argc, char **argv);
 int mclagdctl_parse_config_loglevel(char *msg, int data_len);
+extern int mclagdctl_enca_dump_counters(char *msg, int mclag_id, int argc, char **argv);
+extern int mclagdctl_parse_dump_counters(char *msg, int data_len);
+extern int mclagdctl_enca_dump_latency(char *msg, int mclag_id, int argc, char **argv);
+extern int mclagdctl_parse_dump_latency(char *msg, int data_len);
+extern int mclagdctl_enca_clear_latency(char *msg, int mclag_id, int argc, char **argv);
+extern int mclagdctl_parse_clear_latency(char *msg, int data_len);
+extern int mclagdctl_enca_dump_log_ring(char *msg, int mclag_id, int argc, char **argv);
+extern int mclagdctl_parse_dump_log_ring(char *msg, int data_len);
 
@@ -0,0 +1,209 @@
+/*
+ *  mlacp_fast_hello.c
+ *  Sub-second peer liveness detection.
+ *
+ * Copyright(c) 2016-2019 Nephos/Estinet.
+ *
+ * This program is free software; you can redistribute it and/or modify it
+ * under the terms and conditions of the GNU General Public License,
+ * version 2, as published by the Free Software Foundation.
+ *
+ * This program is distributed in the hope it will be useful, but WITHOUT
+ * ANY WARRANTY; without even the implied warranty of MERCHANTABILITY or
+ * FITNESS FOR A PARTICULAR PURPOSE.  See the GNU General Public License for
+ * more details.
+ *
+ * You should have received a copy of the GNU General Public License along with
+ * this program; if not, see <http://www.gnu.org/licenses/>.
+ *
+ * The full GNU General Public License is included in this distribution in
+ * the file called "COPYING".
+ *
+ *  Maintainer: jianjun, grace Li from nephos
+ */
+
+#include <stdio.h>
+#include <stdlib.h>
+#include <string.h>
+#include <time.h>
+#include <arpa/inet.h>
+
+#include "../include/system.h"
+#include "../include/logger.h"
+#include "../include/scheduler.h"
+#include "../include/iccp_csm.h"
+#include "../include/iccp_timer.h"
+#include "../include/mlacp_tlv.h"
+#include "../include/mlacp_sync_prepare.h"
+#include "../include/mlacp_fast_hello.h"
+
+/* Time between two monotonic stamps*/
+static uint64_t mlacp_fast_hello_elapsed_usec(const struct timespec* start, const struct timespec* now)
+{
+    return (uint64_t)(now->tv_sec - start->tv_sec) * 1000000 +
+           (now->tv_nsec - start->tv_nsec) / 1000;
+}
+
+/* Hello sender, runs each tx_interval_msec while the session is operational*/
+static void mlacp_fast_hello_tx_handler(void* arg)
+{
+    struct CSM* csm = (struct CSM*)arg;
+    struct CSMFastHello* fh = &csm->fast_hello;
+    int msg_len = 0;
+
+    if (fh->tx_interval_msec == 0)
+        return;
+
+    if (csm->sock_fd > 0 && csm->app_csm.current_state == APP_OPERATIONAL)
+    {
+        msg_len = mlacp_prepare_for_fast_hello(csm, g_csm_buf, CSM_BUFFER_SIZE, ++fh->tx_seq);
+        if (msg_len > 0 && iccp_csm_send_prio(csm, g_csm_buf, msg_len) >= 0)
+            fh->tx_hellos++;
+    }
+
+    iccp_timer_start(&fh->tx_timer, fh->tx_interval_msec);
+}
+
+/* Nothing was received for peer_interval * peer_multiplier*/
+static void mlacp_fast_hello_detect_handler(void* arg)
+{
+    struct CSM* csm = (struct CSM*)arg;
+    struct CSMFastHello* fh = &csm->fast_hello;
+    struct timespec now;
+
+    if (fh->peer_interval_msec == 0 || csm->sock_fd <= 0)
+        return;
+
+    clock_gettime(CLOCK_MONOTONIC, &now);
+    fh->last_detect_msec = mlacp_fast_hello_elapsed_usec(&fh->last_rx, &now) / 1000;
+    fh->detects++;
+
+    ICCPD_LOG_WARN(__FUNCTION__, "Peer %s silent for %u ms (hello %u ms x %u), disconnect",
+                   csm->peer_ip, fh->last_detect_msec, fh->peer_interval_msec, fh->peer_multiplier);
+
+    scheduler_session_disconnect_handler(csm);
+    scheduler_fsm_kick();
+}
+
+void mlacp_fast_hello_init(struct CSM* csm)
+{
+    struct CSMFastHello* fh = &csm->fast_hello;
+
+    memset(fh, 0, sizeof(struct CSMFastHello));
+    fh->multiplier = MLACP_FAST_HELLO_MULT_DEFAULT;
+    iccp_timer_init(&fh->tx_timer, mlacp_fast_hello_tx_handler, csm);
+    iccp_timer_init(&fh->detect_timer, mlacp_fast_hello_detect_handler, csm);
+}
+
+void mlacp_fast_hello_finalize(struct CSM* csm)
+{
+    iccp_timer_stop(&csm->fast_hello.tx_timer);
+    iccp_timer_stop(&csm->fast_hello.detect_timer);
+}
+
+/* interval_msec 0 turns fast hello off, the peer then falls back to the heartbeat*/
+int mlacp_fast_hello_config(struct CSM* csm, uint32_t interval_msec, uint8_t multiplier)
+{
+    struct CSMFastHello* fh = &csm->fast_hello;
+
+    if (interval_msec != 0 &&
+        (interval_msec < MLACP_FAST_HELLO_MIN_MSEC || interval_msec > MLACP_FAST_HELLO_MAX_MSEC))
+        return MCLAG_ERROR;
+
+    if (multiplier < MLACP_FAST_HELLO_MULT_MIN || multiplier > MLACP_FAST_HELLO_MULT_MAX)
+        return MCLAG_ERROR;
+
+    fh->tx_interval_msec = interval_msec;
+    fh->multiplier = multiplier;
+
+    if (interval_msec)
+        iccp_timer_start(&fh->tx_timer, interval_msec);
+    else
+        iccp_timer_stop(&fh->tx_timer);
+
+    ICCPD_LOG_INFO(__FUNCTION__, "Fast hello %u ms x %u", interval_msec, multiplier);
+
+    return 0;
+}
+
+/* Session is down, forget the peer until it sends hellos again*/
+void mlacp_fast_hello_reset(struct CSM* csm)
+{
+    struct CSMFastHello* fh = &csm->fast_hello;
+
+    iccp_timer_stop(&fh->detect_timer);
+    fh->peer_interval_msec = 0;
+    fh->peer_multiplier = 0;
+    fh->peer_seq = 0;
+    fh->tx_seq = 0;
+    memset(&fh->last_hello, 0, sizeof(struct timespec));
+}
+
+void mlacp_fast_hello_recv(struct CSM* csm, struct Msg* msg)
+{
+    struct CSMFastHello* fh = &csm->fast_hello;
+    struct mLACPFastHelloTLV* tlv = NULL;
+    struct timespec now;
+    uint32_t interval, seq;
+    uint64_t delta, expect, jitter;
+
+    if (msg->len < sizeof(ICCHdr) + sizeof(struct mLACPFastHelloTLV))
+        return;
+
+    tlv = (struct mLACPFastHelloTLV*)&msg->buf[sizeof(ICCHdr)];
+    interval = ntohl(tlv->tx_interval);
+    seq = ntohl(tlv->seq);
+
+    if (interval < MLACP_FAST_HELLO_MIN_MSEC || interval > MLACP_FAST_HELLO_MAX_MSEC
+        || tlv->multiplier < MLACP_FAST_HELLO_MULT_MIN || tlv->multiplier > MLACP_FAST_HELLO_MULT_MAX)
+    {
+        ICCPD_LOG_DEBUG(__FUNCTION__, "Ignore fast hello %u ms x %u", interval, tlv->multiplier);
+        return;
+    }
+
+    clock_gettime(CLOCK_MONOTONIC, &now);
+    fh->rx_hellos++;
+
+    if (fh->peer_interval_msec == interval && fh->last_hello.tv_sec)
+    {
+        if (seq - fh->peer_seq > 1)
+            fh->rx_lost += seq - fh->peer_seq - 1;
+
+        /* Only back to back hellos tell the arrival jitter*/
+        if (seq - fh->peer_seq == 1)
+        {
+            delta = mlacp_fast_hello_elapsed_usec(&fh->last_hello, &now);
+            expect = (uint64_t)interval * 1000;
+            jitter = delta > expect ? delta - expect : expect - delta;
+            if (jitter > fh->jitter_max_usec)
+                fh->jitter_max_usec = jitter;
+            fh->jitter_sum_usec += jitter;
+            fh->jitter_samples++;
+        }
+    }
+    else if (fh->peer_interval_msec != interval)
+    {
+        ICCPD_LOG_INFO(__FUNCTION__, "Peer %s fast hello %u ms x %u",
+                       csm->peer_ip, interval, tlv->multiplier);
+    }
+
+    fh->peer_interval_msec = interval;
+    fh->peer_multiplier = tlv->multiplier;
+    fh->peer_seq = seq;
+    fh->last_hello = now;
+    fh->last_rx = now;
+
+    iccp_timer_start(&fh->detect_timer, interval * tlv->multiplier);
+}
+
+/* Any data from the peer proves it alive*/
+void mlacp_fast_hello_rx_activity(struct CSM* csm)
+{
+    struct CSMFastHello* fh = &csm->fast_hello;
+
+    if (fh->peer_interval_msec == 0)
+        return;
+
+    clock_gettime(CLOCK_MONOTONIC, &fh->last_rx);
+    iccp_timer_start(&fh->detect_timer, fh->peer_interval_msec * fh->peer_multiplier);
+}
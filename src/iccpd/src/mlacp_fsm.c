@@ -39,6 +39,9 @@
 #include "../include/mlacp_sync_prepare.h"
 #include "../include/mlacp_link_handler.h"
 #include "../include/mlacp_sync_update.h"
+#include "../include/iccp_pool.h"
+#include "../include/mlacp_fast_hello.h"
+#include "../include/iccp_latency.h"
 
 #include <signal.h>
 
@@ -52,12 +55,41 @@
         while (!TAILQ_EMPTY(&(list))) { \
             msg = TAILQ_FIRST(&(list)); \
             TAILQ_REMOVE(&(list), msg, tail); \
-            free(msg->buf); \
-            free(msg); \
+            iccp_csm_free_msg(msg); \
         } \
         TAILQ_INIT(&(list)); \
     }
 
+/* Entries not sent yet are journaled, the peer gets them on resync*/
+#define MLACP_MSG_QUEUE_JOURNAL(csm, list, table) \
+    { \
+        struct Msg* msg = NULL; \
+        while (!TAILQ_EMPTY(&(list))) { \
+            msg = TAILQ_FIRST(&(list)); \
+            TAILQ_REMOVE(&(list), msg, tail); \
+            if (!msg->journaled) \
+                mlacp_journal_record(csm, table, msg->buf); \
+            iccp_csm_free_msg(msg); \
+        } \
+        TAILQ_INIT(&(list)); \
+    }
+
+/* Queue the journal after seq ahead of the queued entries, in order.
+ * Replayed entries keep their seq and are not journaled again*/
+#define MLACP_MSG_QUEUE_REPLAY(csm, list, table, pool, from_seq) \
+    { \
+        struct Msg* msg = NULL; \
+        const void* entry = NULL; \
+        uint32_t cur; \
+        for (cur = MLACP(csm).journal[table].seq; cur > (from_seq); cur--) { \
+            entry = mlacp_journal_get(csm, table, cur); \
+            if (entry && iccp_csm_init_pool_msg(&msg, pool, (char*)entry, MLACP(csm).journal[table].entry_size) == 0) { \
+                msg->journaled = 1; \
+                TAILQ_INSERT_HEAD(&(list), msg, tail); \
+            } \
+        } \
+    }
+
 #define PIF_QUEUE_REINIT(list) \
     { \
         while (!LIST_EMPTY(&(list))) { \
@@ -123,6 +155,47 @@ static void mlacp_sync_recv_syncReq(struct CSM* csm, struct Msg* msg);
 static void mlacp_sync_recv_portChanInfo(struct CSM* csm, struct Msg* msg);
 static void mlacp_sync_recv_peerLlinkInfo(struct CSM* csm, struct Msg* msg);
 static void mlacp_sync_recv_arpInfo(struct CSM* csm, struct Msg* msg);
+static void mlacp_sync_recv_ifIdMap(struct CSM* csm, struct Msg* msg)
+{
+    struct mLACPIfIdMapTLV* if_id_map = NULL;
+
+    if_id_map = (struct mLACPIfIdMapTLV *)&(msg->buf[sizeof(ICCHdr)]);
+    mlacp_fsm_update_if_id_map(csm, if_id_map);
+
+    return;
+}
+
+static void mlacp_sync_recv_compactMacInfo(struct CSM* csm, struct Msg* msg)
+{
+    struct mLACPMACCompactInfoTLV* mac_info = NULL;
+
+    mac_info = (struct mLACPMACCompactInfoTLV *)&(msg->buf[sizeof(ICCHdr)]);
+    mlacp_fsm_update_mac_info_compact(csm, mac_info);
+
+    return;
+}
+
+static void mlacp_sync_recv_compactArpInfo(struct CSM* csm, struct Msg* msg)
+{
+    struct mLACPARPCompactInfoTLV* arp_info = NULL;
+
+    arp_info = (struct mLACPARPCompactInfoTLV *)&(msg->buf[sizeof(ICCHdr)]);
+    mlacp_fsm_update_arp_info_compact(csm, arp_info);
+
+    return;
+}
+
+static void mlacp_sync_recv_compactNdiscInfo(struct CSM* csm, struct Msg* msg)
+{
+    struct mLACPNDISCCompactInfoTLV* ndisc_info = NULL;
+
+    ndisc_info = (struct mLACPNDISCCompactInfoTLV *)&(msg->buf[sizeof(ICCHdr)]);
+    mlacp_fsm_update_ndisc_info_compact(csm, ndisc_info);
+
+    return;
+}
+
+static void mlacp_sync_recv_syncSeq(struct CSM* csm, struct Msg* msg);
 static void mlacp_sync_recv_stpInfo(struct CSM* csm, struct Msg* msg);
 
 /* Sync Handler*/
@@ -205,6 +278,276 @@ static void mlacp_sync_send_aggState(struct CSM* csm)
 
     return;
 }
+static void mlacp_sync_send_seq(struct CSM* csm, uint8_t op, uint8_t flags, uint32_t epoch, const uint32_t* seq)
+{
+    char buf[sizeof(ICCHdr) + sizeof(struct mLACPSyncSeqTLV)];
+    int msg_len = 0;
+
+    msg_len = mlacp_prepare_for_sync_seq(csm, buf, sizeof(buf), op, flags, epoch, seq);
+    if (msg_len > 0)
+        iccp_csm_send(csm, buf, msg_len);
+
+    return;
+}
+
+/* Tell the peer up to which sequence it got our entries*/
+static void mlacp_sync_send_seqMark(struct CSM* csm)
+{
+    uint32_t seq[MLACP_SYNC_TABLE_MAX];
+    int changed = 0;
+    int i;
+
+    for (i = 0; i < MLACP_SYNC_TABLE_MAX; i++)
+    {
+        seq[i] = MLACP(csm).journal[i].seq;
+        if (seq[i] != MLACP(csm).mark_seq[i])
+            changed = 1;
+    }
+
+    if (!changed)
+        return;
+
+    mlacp_sync_send_seq(csm, MLACP_SYNC_SEQ_MARK, 0, MLACP(csm).sync_epoch, seq);
+    memcpy(MLACP(csm).mark_seq, seq, sizeof(seq));
+
+    return;
+}
+
+/* Queue the MAC/ARP/ND entries for the peer that requests sync, either
+ * the journal after the sequence the peer resumes from or the full table*/
+static void mlacp_resync_tables(struct CSM* csm)
+{
+    int i;
+
+    for (i = 0; i < MLACP_SYNC_TABLE_MAX; i++)
+    {
+        if (MLACP(csm).resync_delta & MLACP_SYNC_TABLE_BIT(i))
+            ICCPD_LOG_NOTICE(__FUNCTION__, "Resume %s sync to peer, %u changes", mlacp_journal_table_name(i),
+                             MLACP(csm).journal[i].seq - MLACP(csm).resync_seq[i]);
+        else
+            ICCPD_LOG_NOTICE(__FUNCTION__, "Full %s sync to peer", mlacp_journal_table_name(i));
+    }
+
+    /* The peer must know which tables are resumed before any entry*/
+    mlacp_sync_send_seq(csm, MLACP_SYNC_SEQ_REPLY, MLACP(csm).resync_delta,
+                        MLACP(csm).sync_epoch, MLACP(csm).resync_seq);
+
+    /* Full MAC sync is queued by mlacp_peer_conn_handler*/
+    if (MLACP(csm).resync_delta & MLACP_SYNC_TABLE_BIT(MLACP_SYNC_TABLE_MAC))
+        MLACP_MSG_QUEUE_REPLAY(csm, MLACP(csm).mac_msg_list, MLACP_SYNC_TABLE_MAC, ICCP_POOL_MAC,
+                               MLACP(csm).resync_seq[MLACP_SYNC_TABLE_MAC]);
+
+    if (MLACP(csm).resync_delta & MLACP_SYNC_TABLE_BIT(MLACP_SYNC_TABLE_ARP))
+    {
+        MLACP_MSG_QUEUE_REPLAY(csm, MLACP(csm).arp_msg_list, MLACP_SYNC_TABLE_ARP, ICCP_POOL_ARP,
+                               MLACP(csm).resync_seq[MLACP_SYNC_TABLE_ARP]);
+    }
+    else
+    {
+        mlacp_resync_arp(csm);
+    }
+
+    if (MLACP(csm).resync_delta & MLACP_SYNC_TABLE_BIT(MLACP_SYNC_TABLE_NDISC))
+    {
+        MLACP_MSG_QUEUE_REPLAY(csm, MLACP(csm).ndisc_msg_list, MLACP_SYNC_TABLE_NDISC, ICCP_POOL_NDISC,
+                               MLACP(csm).resync_seq[MLACP_SYNC_TABLE_NDISC]);
+    }
+    else
+    {
+        mlacp_resync_ndisc(csm);
+    }
+
+    return;
+}
+
+/* Interface id of ifname for the compact TLVs, the id is advertised to
+ * the peer the first time it is used in the session*/
+static int mlacp_sync_send_if_id(struct CSM* csm, const char* ifname)
+{
+    char buf[sizeof(ICCHdr) + sizeof(struct mLACPIfIdMapTLV) + sizeof(struct mLACPIfIdData)];
+    int msg_len = 0;
+    int is_new = 0;
+    int if_id;
+
+    if_id = mlacp_if_id_get(&MLACP(csm).tx_if_id, ifname, &is_new);
+    if (if_id < 0)
+    {
+        ICCPD_LOG_WARN(__FUNCTION__, "No interface id left for %s", ifname);
+        return MCLAG_ERROR;
+    }
+
+    if (is_new)
+    {
+        msg_len = mlacp_prepare_for_if_id_map(csm, buf, sizeof(buf), if_id, ifname);
+        if (msg_len > 0)
+            iccp_csm_send(csm, buf, msg_len);
+    }
+
+    return if_id;
+}
+
+static void mlacp_sync_send_compactMacInfo(struct CSM* csm)
+{
+    struct MACMsg* mac_msg = NULL;
+    struct Msg* msg = NULL;
+    int msg_len = 0;
+    int len = 0;
+    int if_id = 0;
+    int count = 0;
+    uint64_t trace_usec = 0;
+
+    while (!TAILQ_EMPTY(&(MLACP(csm).mac_msg_list)))
+    {
+        msg = TAILQ_FIRST(&(MLACP(csm).mac_msg_list));
+        TAILQ_REMOVE(&(MLACP(csm).mac_msg_list), msg, tail);
+        if (!msg->journaled)
+            mlacp_journal_record(csm, MLACP_SYNC_TABLE_MAC, msg->buf);
+        mac_msg = (struct MACMsg*)msg->buf;
+
+        if_id = mlacp_sync_send_if_id(csm, mac_msg->origin_ifname);
+        if (if_id >= 0)
+        {
+            len = mlacp_prepare_for_mac_info_compact(csm, g_csm_buf, MLACP(csm).sync_pdu_size, mac_msg, if_id, count);
+            if (len < 0 && count > 0)
+            {
+                /* PDU is full, send it and start the next one*/
+                iccp_csm_send(csm, g_csm_buf, msg_len);
+                iccp_latency_record(ICCP_LAT_STAGE_LOCAL_TO_SEND, trace_usec);
+                trace_usec = 0;
+                count = 0;
+                len = mlacp_prepare_for_mac_info_compact(csm, g_csm_buf, MLACP(csm).sync_pdu_size, mac_msg, if_id, count);
+            }
+
+            if (len > 0)
+            {
+                msg_len = len;
+                count++;
+                /* The oldest entry of the PDU*/
+                if (trace_usec == 0)
+                    trace_usec = msg->trace_usec;
+            }
+        }
+
+        iccp_csm_free_msg(msg);
+    }
+
+    if (count)
+    {
+        iccp_csm_send(csm, g_csm_buf, msg_len);
+        iccp_latency_record(ICCP_LAT_STAGE_LOCAL_TO_SEND, trace_usec);
+    }
+
+    return;
+}
+
+static void mlacp_sync_send_compactArpInfo(struct CSM* csm)
+{
+    struct ARPMsg* arp_msg = NULL;
+    struct Msg* msg = NULL;
+    int msg_len = 0;
+    int len = 0;
+    int if_id = 0;
+    int count = 0;
+    uint64_t trace_usec = 0;
+
+    while (!TAILQ_EMPTY(&(MLACP(csm).arp_msg_list)))
+    {
+        msg = TAILQ_FIRST(&(MLACP(csm).arp_msg_list));
+        TAILQ_REMOVE(&(MLACP(csm).arp_msg_list), msg, tail);
+        if (!msg->journaled)
+            mlacp_journal_record(csm, MLACP_SYNC_TABLE_ARP, msg->buf);
+        arp_msg = (struct ARPMsg*)msg->buf;
+
+        if_id = mlacp_sync_send_if_id(csm, arp_msg->ifname);
+        if (if_id >= 0)
+        {
+            len = mlacp_prepare_for_arp_info_compact(csm, g_csm_buf, MLACP(csm).sync_pdu_size, arp_msg, if_id, count);
+            if (len < 0 && count > 0)
+            {
+                /* PDU is full, send it and start the next one*/
+                iccp_csm_send(csm, g_csm_buf, msg_len);
+                iccp_latency_record(ICCP_LAT_STAGE_LOCAL_TO_SEND, trace_usec);
+                trace_usec = 0;
+                count = 0;
+                len = mlacp_prepare_for_arp_info_compact(csm, g_csm_buf, MLACP(csm).sync_pdu_size, arp_msg, if_id, count);
+            }
+
+            if (len > 0)
+            {
+                msg_len = len;
+                count++;
+                /* The oldest entry of the PDU*/
+                if (trace_usec == 0)
+                    trace_usec = msg->trace_usec;
+            }
+        }
+
+        iccp_csm_free_msg(msg);
+    }
+
+    if (count)
+    {
+        iccp_csm_send(csm, g_csm_buf, msg_len);
+        iccp_latency_record(ICCP_LAT_STAGE_LOCAL_TO_SEND, trace_usec);
+    }
+
+    return;
+}
+
+static void mlacp_sync_send_compactNdiscInfo(struct CSM* csm)
+{
+    struct NDISCMsg* ndisc_msg = NULL;
+    struct Msg* msg = NULL;
+    int msg_len = 0;
+    int len = 0;
+    int if_id = 0;
+    int count = 0;
+    uint64_t trace_usec = 0;
+
+    while (!TAILQ_EMPTY(&(MLACP(csm).ndisc_msg_list)))
+    {
+        msg = TAILQ_FIRST(&(MLACP(csm).ndisc_msg_list));
+        TAILQ_REMOVE(&(MLACP(csm).ndisc_msg_list), msg, tail);
+        if (!msg->journaled)
+            mlacp_journal_record(csm, MLACP_SYNC_TABLE_NDISC, msg->buf);
+        ndisc_msg = (struct NDISCMsg*)msg->buf;
+
+        if_id = mlacp_sync_send_if_id(csm, ndisc_msg->ifname);
+        if (if_id >= 0)
+        {
+            len = mlacp_prepare_for_ndisc_info_compact(csm, g_csm_buf, MLACP(csm).sync_pdu_size, ndisc_msg, if_id, count);
+            if (len < 0 && count > 0)
+            {
+                /* PDU is full, send it and start the next one*/
+                iccp_csm_send(csm, g_csm_buf, msg_len);
+                iccp_latency_record(ICCP_LAT_STAGE_LOCAL_TO_SEND, trace_usec);
+                trace_usec = 0;
+                count = 0;
+                len = mlacp_prepare_for_ndisc_info_compact(csm, g_csm_buf, MLACP(csm).sync_pdu_size, ndisc_msg, if_id, count);
+            }
+
+            if (len > 0)
+            {
+                msg_len = len;
+                count++;
+                /* The oldest entry of the PDU*/
+                if (trace_usec == 0)
+                    trace_usec = msg->trace_usec;
+            }
+        }
+
+        iccp_csm_free_msg(msg);
+    }
+
+    if (count)
+    {
+        iccp_csm_send(csm, g_csm_buf, msg_len);
+        iccp_latency_record(ICCP_LAT_STAGE_LOCAL_TO_SEND, trace_usec);
+    }
+
+    return;
+}
+
 #define MAX_MAC_ENTRY_NUM 30
 #define MAX_NEIGH_ENTRY_NUM 40
 static void mlacp_sync_send_syncMacInfo(struct CSM* csm)
@@ -212,6 +555,14 @@ static void mlacp_sync_send_syncMacInfo(struct CSM* csm)
     int msg_len = 0;
     struct Msg* msg = NULL;
     int count = 0;
+    uint64_t trace_usec = 0;
+
+    if (MLACP(csm).compact_sync)
+    {
+        mlacp_sync_send_compactMacInfo(csm);
+        mlacp_sync_send_seqMark(csm);
+        return;
+    }
 
     memset(g_csm_buf, 0, CSM_BUFFER_SIZE);
 
@@ -219,13 +570,18 @@ static void mlacp_sync_send_syncMacInfo(struct CSM* csm)
     {
         msg = TAILQ_FIRST(&(MLACP(csm).mac_msg_list));
         TAILQ_REMOVE(&(MLACP(csm).mac_msg_list), msg, tail);
+        if (!msg->journaled)
+            mlacp_journal_record(csm, MLACP_SYNC_TABLE_MAC, msg->buf);
         msg_len = mlacp_prepare_for_mac_info_to_peer(csm, g_csm_buf, CSM_BUFFER_SIZE, (struct MACMsg*)msg->buf, count);
         count++;
-        free(msg->buf);
-        free(msg);
+        if (trace_usec == 0)
+            trace_usec = msg->trace_usec;
+        iccp_csm_free_msg(msg);
         if (count >= MAX_MAC_ENTRY_NUM)
         {
             iccp_csm_send(csm, g_csm_buf, msg_len);
+            iccp_latency_record(ICCP_LAT_STAGE_LOCAL_TO_SEND, trace_usec);
+            trace_usec = 0;
             count = 0;
             memset(g_csm_buf, 0, CSM_BUFFER_SIZE);
         }
@@ -233,7 +589,12 @@ static void mlacp_sync_send_syncMacInfo(struct CSM* csm)
     }
 
     if (count)
+    {
         iccp_csm_send(csm, g_csm_buf, msg_len);
+        iccp_latency_record(ICCP_LAT_STAGE_LOCAL_TO_SEND, trace_usec);
+    }
+
+    mlacp_sync_send_seqMark(csm);
 
     return;
 }
@@ -243,6 +604,14 @@ static void mlacp_sync_send_syncArpInfo(struct CSM* csm)
     int msg_len = 0;
     struct Msg* msg = NULL;
     int count = 0;
+    uint64_t trace_usec = 0;
+
+    if (MLACP(csm).compact_sync)
+    {
+        mlacp_sync_send_compactArpInfo(csm);
+        mlacp_sync_send_seqMark(csm);
+        return;
+    }
 
     memset(g_csm_buf, 0, CSM_BUFFER_SIZE);
 
@@ -250,14 +619,19 @@ static void mlacp_sync_send_syncArpInfo(struct CSM* csm)
     {
         msg = TAILQ_FIRST(&(MLACP(csm).arp_msg_list));
         TAILQ_REMOVE(&(MLACP(csm).arp_msg_list), msg, tail);
+        if (!msg->journaled)
+            mlacp_journal_record(csm, MLACP_SYNC_TABLE_ARP, msg->buf);
 
         msg_len = mlacp_prepare_for_arp_info(csm, g_csm_buf, CSM_BUFFER_SIZE, (struct ARPMsg*)msg->buf, count);
         count++;
-        free(msg->buf);
-        free(msg);
+        if (trace_usec == 0)
+            trace_usec = msg->trace_usec;
+        iccp_csm_free_msg(msg);
         if (count >= MAX_NEIGH_ENTRY_NUM)
         {
             iccp_csm_send(csm, g_csm_buf, msg_len);
+            iccp_latency_record(ICCP_LAT_STAGE_LOCAL_TO_SEND, trace_usec);
+            trace_usec = 0;
             count = 0;
             memset(g_csm_buf, 0, CSM_BUFFER_SIZE);
         }
@@ -265,7 +639,12 @@ static void mlacp_sync_send_syncArpInfo(struct CSM* csm)
     }
 
     if (count)
+    {
         iccp_csm_send(csm, g_csm_buf, msg_len);
+        iccp_latency_record(ICCP_LAT_STAGE_LOCAL_TO_SEND, trace_usec);
+    }
+
+    mlacp_sync_send_seqMark(csm);
 
     return;
 }
@@ -275,6 +654,14 @@ static void mlacp_sync_send_syncNdiscInfo(struct CSM *csm)
     int msg_len = 0;
     struct Msg *msg = NULL;
     int count = 0;
+    uint64_t trace_usec = 0;
+
+    if (MLACP(csm).compact_sync)
+    {
+        mlacp_sync_send_compactNdiscInfo(csm);
+        mlacp_sync_send_seqMark(csm);
+        return;
+    }
 
     memset(g_csm_buf, 0, CSM_BUFFER_SIZE);
 
@@ -282,14 +669,19 @@ static void mlacp_sync_send_syncNdiscInfo(struct CSM *csm)
     {
         msg = TAILQ_FIRST(&(MLACP(csm).ndisc_msg_list));
         TAILQ_REMOVE(&(MLACP(csm).ndisc_msg_list), msg, tail);
+        if (!msg->journaled)
+            mlacp_journal_record(csm, MLACP_SYNC_TABLE_NDISC, msg->buf);
 
         msg_len = mlacp_prepare_for_ndisc_info(csm, g_csm_buf, CSM_BUFFER_SIZE, (struct NDISCMsg *)msg->buf, count);
         count++;
-        free(msg->buf);
-        free(msg);
+        if (trace_usec == 0)
+            trace_usec = msg->trace_usec;
+        iccp_csm_free_msg(msg);
         if (count >= MAX_NEIGH_ENTRY_NUM)
         {
             iccp_csm_send(csm, g_csm_buf, msg_len);
+            iccp_latency_record(ICCP_LAT_STAGE_LOCAL_TO_SEND, trace_usec);
+            trace_usec = 0;
             count = 0;
             memset(g_csm_buf, 0, CSM_BUFFER_SIZE);
         }
@@ -297,7 +689,12 @@ static void mlacp_sync_send_syncNdiscInfo(struct CSM *csm)
     }
 
     if (count)
+    {
         iccp_csm_send(csm, g_csm_buf, msg_len);
+        iccp_latency_record(ICCP_LAT_STAGE_LOCAL_TO_SEND, trace_usec);
+    }
+
+    mlacp_sync_send_seqMark(csm);
 
     return;
 }
@@ -518,6 +915,65 @@ static void mlacp_sync_recv_ndiscInfo(struct CSM *csm, struct Msg *msg)
 
     return;
 }
+static void mlacp_sync_recv_syncSeq(struct CSM* csm, struct Msg* msg)
+{
+    struct mLACPSyncSeqTLV* tlv = NULL;
+    uint32_t epoch;
+    int i;
+
+    tlv = (struct mLACPSyncSeqTLV*)&msg->buf[sizeof(ICCHdr)];
+    if (ntohs(tlv->icc_parameter.len) < sizeof(struct mLACPSyncSeqTLV) - sizeof(ICCParameter))
+        return;
+
+    epoch = ntohl(tlv->epoch);
+
+    switch (tlv->op)
+    {
+        case MLACP_SYNC_SEQ_MARK:
+            /* Peer has sent us everything up to seq*/
+            MLACP(csm).peer_epoch = epoch;
+            for (i = 0; i < MLACP_SYNC_TABLE_MAX; i++)
+                MLACP(csm).peer_seq[i] = ntohl(tlv->seq[i]);
+            MLACP(csm).peer_seq_valid = MLACP_SYNC_TABLE_ALL;
+            break;
+
+        case MLACP_SYNC_SEQ_RESUME:
+            /* Peer requests sync next, only send what it has not got*/
+            MLACP(csm).resync_delta = 0;
+            for (i = 0; i < MLACP_SYNC_TABLE_MAX; i++)
+            {
+                MLACP(csm).resync_seq[i] = ntohl(tlv->seq[i]);
+                if ((tlv->flags & MLACP_SYNC_TABLE_BIT(i))
+                    && mlacp_journal_can_resume(csm, i, epoch, MLACP(csm).resync_seq[i]))
+                    MLACP(csm).resync_delta |= MLACP_SYNC_TABLE_BIT(i);
+            }
+            break;
+
+        case MLACP_SYNC_SEQ_REPLY:
+            /* Tables not resumed are synced in full, drop what is held
+             * from the old session. ARP/ND entries are updated in place*/
+            for (i = 0; i < MLACP_SYNC_TABLE_MAX; i++)
+            {
+                if (tlv->flags & MLACP_SYNC_TABLE_BIT(i))
+                    continue;
+
+                if (i == MLACP_SYNC_TABLE_MAC && MLACP(csm).resync_hold_time != 0)
+                    mlacp_peer_disconn_fdb(csm);
+
+                MLACP(csm).peer_seq_valid &= ~MLACP_SYNC_TABLE_BIT(i);
+            }
+
+            MLACP(csm).resync_hold_time = 0;
+            ICCPD_LOG_NOTICE(__FUNCTION__, "Peer resync, resumed tables 0x%x", tlv->flags);
+            break;
+
+        default:
+            break;
+    }
+
+    return;
+}
+
 static void mlacp_sync_recv_stpInfo(struct CSM* csm, struct Msg* msg)
 {
     /*Don't support currently*/
@@ -559,22 +1015,29 @@ void mlacp_init(struct CSM* csm, int all)
 
     MLACP(csm).current_state = MLACP_STATE_INIT;
     memset(MLACP(csm).remote_system.system_id, 0, ETHER_ADDR_LEN);
+    mlacp_compact_sync_reset(csm);
 
     MLACP_MSG_QUEUE_REINIT(MLACP(csm).mlacp_msg_list);
-    MLACP_MSG_QUEUE_REINIT(MLACP(csm).arp_msg_list);
-    MLACP_MSG_QUEUE_REINIT(MLACP(csm).ndisc_msg_list);
-    MLACP_MSG_QUEUE_REINIT(MLACP(csm).mac_msg_list);
+    MLACP_MSG_QUEUE_JOURNAL(csm, MLACP(csm).arp_msg_list, MLACP_SYNC_TABLE_ARP);
+    MLACP_MSG_QUEUE_JOURNAL(csm, MLACP(csm).ndisc_msg_list, MLACP_SYNC_TABLE_NDISC);
+    MLACP_MSG_QUEUE_JOURNAL(csm, MLACP(csm).mac_msg_list, MLACP_SYNC_TABLE_MAC);
     PIF_QUEUE_REINIT(MLACP(csm).pif_list);
     LIF_PURGE_QUEUE_REINIT(MLACP(csm).lif_purge_list);
 
     if (all != 0)
     {
         /* if no clean all, keep the arp info & local interface info for next connection*/
-        MLACP_MSG_QUEUE_REINIT(MLACP(csm).arp_list);
-        MLACP_MSG_QUEUE_REINIT(MLACP(csm).ndisc_list);
-        MLACP_MSG_QUEUE_REINIT(MLACP(csm).mac_list);
+        mlacp_arp_table_flush(csm);
+        mlacp_ndisc_table_flush(csm);
+        mlacp_mac_table_flush(csm);
         LIF_QUEUE_REINIT(MLACP(csm).lif_list);
 
+        mlacp_journal_init(csm);
+        memset(MLACP(csm).mark_seq, 0, sizeof(MLACP(csm).mark_seq));
+        MLACP(csm).peer_seq_valid = 0;
+        MLACP(csm).resync_delta = 0;
+        MLACP(csm).resync_hold_time = 0;
+
         MLACP(csm).node_id = MLACP_SYSCONF_NODEID_MSB_MASK;
         MLACP(csm).node_id |= (((inet_addr(csm->sender_ip) >> 24) << 4) & MLACP_SYSCONF_NODEID_NODEID_MASK);
         MLACP(csm).node_id |= rand() % MLACP_SYSCONF_NODEID_FREE_MASK;
@@ -583,6 +1046,24 @@ void mlacp_init(struct CSM* csm, int all)
     return;
 }
 
+/*****************************************
+* Compact sync TLVs are off until the peer advertises them again,
+* interface ids are only valid for one session
+*
+* ***************************************/
+void mlacp_compact_sync_reset(struct CSM* csm)
+{
+    if (csm == NULL)
+        return;
+
+    MLACP(csm).compact_sync = 0;
+    MLACP(csm).sync_pdu_size = 0;
+    mlacp_if_id_flush(&MLACP(csm).tx_if_id);
+    mlacp_if_id_flush(&MLACP(csm).rx_if_id);
+
+    return;
+}
+
 /*****************************************
 * MLACP finalize
 *
@@ -597,9 +1078,11 @@ void mlacp_finalize(struct CSM* csm)
     MLACP_MSG_QUEUE_REINIT(MLACP(csm).arp_msg_list);
     MLACP_MSG_QUEUE_REINIT(MLACP(csm).ndisc_msg_list);
     MLACP_MSG_QUEUE_REINIT(MLACP(csm).mac_msg_list);
-    MLACP_MSG_QUEUE_REINIT(MLACP(csm).arp_list);
-    MLACP_MSG_QUEUE_REINIT(MLACP(csm).ndisc_list);
-    MLACP_MSG_QUEUE_REINIT(MLACP(csm).mac_list);
+    mlacp_arp_table_flush(csm);
+    mlacp_ndisc_table_flush(csm);
+    mlacp_mac_table_flush(csm);
+    mlacp_compact_sync_reset(csm);
+    mlacp_journal_finalize(csm);
 
     /* remove lif & lif-purge queue */
     LIF_QUEUE_REINIT(MLACP(csm).lif_list);
@@ -628,6 +1111,22 @@ void mlacp_fsm_transit(struct CSM* csm)
     if ((sys = system_get_instance()) == NULL)
         return;
 
+    /* Peer did not come back to resume the MAC sync in time, or the
+     * peer-link went down and the held MACs would blackhole traffic*/
+    if (MLACP(csm).resync_hold_time != 0)
+    {
+        if (!csm->peer_link_if || csm->peer_link_if->state != PORT_STATE_UP)
+        {
+            ICCPD_LOG_NOTICE(__FUNCTION__, "Peer-link down during MAC resync hold, age peer MACs");
+            mlacp_peer_disconn_fdb(csm);
+        }
+        else if ((time(NULL) - MLACP(csm).resync_hold_time) >= MLACP_RESYNC_HOLD_SEC)
+        {
+            ICCPD_LOG_NOTICE(__FUNCTION__, "Peer MAC resync hold timeout, age peer MACs");
+            mlacp_peer_disconn_fdb(csm);
+        }
+    }
+
     /* torn down event */
     if (csm->sock_fd <= 0 || csm->app_csm.current_state != APP_OPERATIONAL)
     {
@@ -635,9 +1134,10 @@ void mlacp_fsm_transit(struct CSM* csm)
         if (MLACP(csm).current_state != MLACP_STATE_INIT)
         {
             MLACP_MSG_QUEUE_REINIT(MLACP(csm).mlacp_msg_list);
-            MLACP_MSG_QUEUE_REINIT(MLACP(csm).arp_msg_list);
-            MLACP_MSG_QUEUE_REINIT(MLACP(csm).ndisc_msg_list);
-            MLACP_MSG_QUEUE_REINIT(MLACP(csm).mac_msg_list);
+            MLACP_MSG_QUEUE_JOURNAL(csm, MLACP(csm).arp_msg_list, MLACP_SYNC_TABLE_ARP);
+            MLACP_MSG_QUEUE_JOURNAL(csm, MLACP(csm).ndisc_msg_list, MLACP_SYNC_TABLE_NDISC);
+            MLACP_MSG_QUEUE_JOURNAL(csm, MLACP(csm).mac_msg_list, MLACP_SYNC_TABLE_MAC);
+            mlacp_compact_sync_reset(csm);
             MLACP(csm).current_state = MLACP_STATE_INIT;
         }
         return;
@@ -674,8 +1174,7 @@ void mlacp_fsm_transit(struct CSM* csm)
                 if (icc_hdr->ldp_hdr.msg_type == MSG_T_NOTIFICATION && icc_param->type == TLV_T_NAK)
                 {
                     mlacp_sync_recv_nak_handler(csm, msg);
-                    free(msg->buf);
-                    free(msg);
+                    iccp_csm_free_msg(msg);
                     continue;
                 }
             }
@@ -697,8 +1196,8 @@ void mlacp_fsm_transit(struct CSM* csm)
         {
             MLACP(csm).wait_for_sync_data = 0;
             MLACP(csm).current_state = MLACP_STATE_STAGE1;
-            mlacp_resync_arp(csm);
-            mlacp_resync_ndisc(csm);
+            /* MAC/ARP/ND are queued when the peer requests sync*/
+            MLACP(csm).resync_delta = 0;
         }
 
         switch (MLACP(csm).current_state)
@@ -721,8 +1220,7 @@ void mlacp_fsm_transit(struct CSM* csm)
         /*ICCPD_LOG_DEBUG("mlacp_fsm", "  Next State = %s", mlacp_state(csm));*/
         if (msg)
         {
-            free(msg->buf);
-            free(msg);
+            iccp_csm_free_msg(msg);
         }
     }
 }
@@ -760,13 +1258,21 @@ void mlacp_enqueue_msg(struct CSM* csm, struct Msg* msg)
     if (csm == NULL )
     {
         if (msg != NULL )
-            free(msg);
+            iccp_csm_free_msg(msg);
         return;
     }
 
     if (msg == NULL )
         return;
 
+    /* Fast hello is handled on arrival, it must not wait behind the sync msgs*/
+    if (((ICCParameter*)&msg->buf[sizeof(ICCHdr)])->type == TLV_T_MLACP_FAST_HELLO)
+    {
+        mlacp_fast_hello_recv(csm, msg);
+        iccp_csm_free_msg(msg);
+        return;
+    }
+
     #if 0
     icc_hdr = (ICCHdr*)msg->buf;
     icc_param = (ICCParameter*)&msg->buf[sizeof(ICCHdr)];
@@ -778,6 +1284,57 @@ void mlacp_enqueue_msg(struct CSM* csm, struct Msg* msg)
     return;
 }
 
+/* Queue a MAC/ARP/ND change for the peer. Without a session it is only
+ * journaled, a resumed sync replays it from there*/
+int mlacp_sync_enqueue_or_journal(struct CSM* csm, int table, void* entry, int op)
+{
+    struct Msg* msg = NULL;
+    int pool;
+
+    if (csm == NULL || entry == NULL)
+        return MCLAG_ERROR;
+
+    switch (table)
+    {
+        case MLACP_SYNC_TABLE_MAC:
+            ((struct MACMsg*)entry)->op_type = op;
+            pool = ICCP_POOL_MAC;
+            break;
+
+        case MLACP_SYNC_TABLE_ARP:
+            ((struct ARPMsg*)entry)->op_type = op;
+            pool = ICCP_POOL_ARP;
+            break;
+
+        case MLACP_SYNC_TABLE_NDISC:
+            ((struct NDISCMsg*)entry)->op_type = op;
+            pool = ICCP_POOL_NDISC;
+            break;
+
+        default:
+            return MCLAG_ERROR;
+    }
+
+    if (MLACP(csm).current_state == MLACP_STATE_INIT)
+    {
+        mlacp_journal_record(csm, table, entry);
+        return 0;
+    }
+
+    if (iccp_csm_init_pool_msg(&msg, pool, (char*)entry, MLACP(csm).journal[table].entry_size) != 0)
+        return MCLAG_ERROR;
+
+    msg->trace_usec = iccp_latency_mark(ICCP_LAT_POINT_ENQUEUE);
+    if (table == MLACP_SYNC_TABLE_MAC)
+        TAILQ_INSERT_TAIL(&(MLACP(csm).mac_msg_list), msg, tail);
+    else if (table == MLACP_SYNC_TABLE_ARP)
+        TAILQ_INSERT_TAIL(&(MLACP(csm).arp_msg_list), msg, tail);
+    else
+        TAILQ_INSERT_TAIL(&(MLACP(csm).ndisc_msg_list), msg, tail);
+
+    return 0;
+}
+
 /* Get received message from message list */
 struct Msg* mlacp_dequeue_msg(struct CSM* csm)
 {
@@ -807,9 +1364,13 @@ static void mlacp_resync_mac(struct CSM* csm)
     {
         TAILQ_FOREACH(msg, &MLACP(csm).mac_list, tail)
         {
+            /* Restored entry not confirmed yet*/
+            if (msg->stale)
+                continue;
+
             mac_msg = (struct MACMsg*)msg->buf;
             mac_msg->op_type = MAC_SYNC_ADD;
-            if (iccp_csm_init_msg(&msg_send, (char*)mac_msg, sizeof(struct MACMsg)) == 0)
+            if (iccp_csm_init_pool_msg(&msg_send, ICCP_POOL_MAC, (char*)mac_msg, sizeof(struct MACMsg)) == 0)
             {
                 mac_msg->age_flag &= ~MAC_AGE_PEER;
                 TAILQ_INSERT_TAIL(&(MLACP(csm).mac_msg_list), msg_send, tail);
@@ -835,9 +1396,13 @@ static void mlacp_resync_arp(struct CSM* csm)
     {
         TAILQ_FOREACH(msg, &MLACP(csm).arp_list, tail)
         {
+            /* Restored entry not confirmed yet*/
+            if (msg->stale)
+                continue;
+
             arp_msg = (struct ARPMsg*)msg->buf;
             arp_msg->op_type = NEIGH_SYNC_ADD;
-            if (iccp_csm_init_msg(&msg_send, (char*)arp_msg, sizeof(struct ARPMsg)) == 0)
+            if (iccp_csm_init_pool_msg(&msg_send, ICCP_POOL_ARP, (char*)arp_msg, sizeof(struct ARPMsg)) == 0)
             {
                 TAILQ_INSERT_TAIL(&(MLACP(csm).arp_msg_list), msg_send, tail);
             }
@@ -860,9 +1425,13 @@ static void mlacp_resync_ndisc(struct CSM *csm)
     {
         TAILQ_FOREACH(msg, &MLACP(csm).ndisc_list, tail)
         {
+            /* Restored entry not confirmed yet */
+            if (msg->stale)
+                continue;
+
             ndisc_msg = (struct NDISCMsg *)msg->buf;
             ndisc_msg->op_type = NEIGH_SYNC_ADD;
-            if (iccp_csm_init_msg(&msg_send, (char *)ndisc_msg, sizeof(struct NDISCMsg)) == 0)
+            if (iccp_csm_init_pool_msg(&msg_send, ICCP_POOL_NDISC, (char *)ndisc_msg, sizeof(struct NDISCMsg)) == 0)
             {
                 TAILQ_INSERT_TAIL(&(MLACP(csm).ndisc_msg_list), msg_send, tail);
             }
@@ -949,6 +1518,9 @@ static void mlacp_sync_receiver_handler(struct CSM* csm, struct Msg* msg)
 
     icc_param = (ICCParameter*)&(msg->buf[sizeof(ICCHdr)]);
 
+    iccp_latency_record(ICCP_LAT_STAGE_PEER_TO_FSM, msg->trace_usec);
+    iccp_latency_begin(ICCP_LAT_CTX_PEER, msg->trace_usec);
+
     /*fprintf(stderr, " Recv Type [%d]\n", icc_param->type);*/
     switch (icc_param->type)
     {
@@ -1005,6 +1577,26 @@ static void mlacp_sync_receiver_handler(struct CSM* csm, struct Msg* msg)
             mlacp_sync_recv_ndiscInfo(csm, msg);
             break;
 
+        case TLV_T_MLACP_IF_ID_MAP:
+            mlacp_sync_recv_ifIdMap(csm, msg);
+            break;
+
+        case TLV_T_MLACP_MAC_INFO_COMPACT:
+            mlacp_sync_recv_compactMacInfo(csm, msg);
+            break;
+
+        case TLV_T_MLACP_ARP_INFO_COMPACT:
+            mlacp_sync_recv_compactArpInfo(csm, msg);
+            break;
+
+        case TLV_T_MLACP_NDISC_INFO_COMPACT:
+            mlacp_sync_recv_compactNdiscInfo(csm, msg);
+            break;
+
+        case TLV_T_MLACP_SYNC_SEQ:
+            mlacp_sync_recv_syncSeq(csm, msg);
+            break;
+
         case TLV_T_MLACP_STP_INFO:
             mlacp_sync_recv_stpInfo(csm, msg);
             break;
@@ -1018,6 +1610,8 @@ static void mlacp_sync_receiver_handler(struct CSM* csm, struct Msg* msg)
             break;
     }
 
+    iccp_latency_end();
+
     /*ICCPD_LOG_DEBUG("mlacp_fsm", "  [Sync Recv] %s... DONE", get_tlv_type_string(icc_param->type));*/
 
     return;
@@ -1123,8 +1717,14 @@ static void mlacp_stage_sync_send_handler(struct CSM* csm, struct Msg* msg)
                 MLACP(csm).sync_req_num = ntohs(mlacp_sync_req->req_num);
 
                 /* Reply the peer all sync info*/
+                mlacp_resync_tables(csm);
                 mlacp_sync_send_all_info_handler(csm);
             }
+            else if (icc_hdr->ldp_hdr.msg_type == MSG_T_RG_APP_DATA && icc_param->type == TLV_T_MLACP_SYNC_SEQ)
+            {
+                /* Resume point of the peer, comes before the request*/
+                mlacp_sync_receiver_handler(csm, msg);
+            }
         }
     }
 
@@ -1138,6 +1738,10 @@ static void mlacp_stage_sync_request_handler(struct CSM* csm, struct Msg* msg)
     /* Socket server send sync request first*/
     if (MLACP(csm).wait_for_sync_data == 0)
     {
+        /* Tell the peer what we still have from the last session*/
+        mlacp_sync_send_seq(csm, MLACP_SYNC_SEQ_RESUME, MLACP(csm).peer_seq_valid,
+                            MLACP(csm).peer_epoch, MLACP(csm).peer_seq);
+
         // Send out the request for ALL
         memset(g_csm_buf, 0, CSM_BUFFER_SIZE);
         msg_len = mlacp_prepare_for_sync_request_tlv(csm, g_csm_buf, CSM_BUFFER_SIZE);
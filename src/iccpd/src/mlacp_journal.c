@@ -0,0 +1,142 @@
+/*
+ *  mlacp_journal.c
+ *  Change journal of the mLACP MAC, ARP and ND sync.
+ *
+ * Copyright(c) 2016-2019 Nephos/Estinet.
+ *
+ * This program is free software; you can redistribute it and/or modify it
+ * under the terms and conditions of the GNU General Public License,
+ * version 2, as published by the Free Software Foundation.
+ *
+ * This program is distributed in the hope it will be useful, but WITHOUT
+ * ANY WARRANTY; without even the implied warranty of MERCHANTABILITY or
+ * FITNESS FOR A PARTICULAR PURPOSE.  See the GNU General Public License for
+ * more details.
+ *
+ * You should have received a copy of the GNU General Public License along with
+ * this program; if not, see <http://www.gnu.org/licenses/>.
+ *
+ * The full GNU General Public License is included in this distribution in
+ * the file called "COPYING".
+ *
+ *  Maintainer: jianjun, grace Li from nephos
+ */
+
+#include <stdio.h>
+#include <stdlib.h>
+#include <string.h>
+#include <time.h>
+
+#include "../include/system.h"
+#include "../include/logger.h"
+#include "../include/iccp_csm.h"
+#include "../include/mlacp_tlv.h"
+#include "../include/mlacp_journal.h"
+
+static const uint32_t mlacp_journal_entry_size[MLACP_SYNC_TABLE_MAX] =
+{
+    [MLACP_SYNC_TABLE_MAC] = sizeof(struct MACMsg),
+    [MLACP_SYNC_TABLE_ARP] = sizeof(struct ARPMsg),
+    [MLACP_SYNC_TABLE_NDISC] = sizeof(struct NDISCMsg),
+};
+
+/* Start a new journal, the peer can not resume from the old one*/
+void mlacp_journal_init(struct CSM* csm)
+{
+    int i;
+
+    mlacp_journal_finalize(csm);
+
+    do
+    {
+        MLACP(csm).sync_epoch = (uint32_t)rand() ^ (uint32_t)time(NULL);
+    } while (MLACP(csm).sync_epoch == 0);
+
+    for (i = 0; i < MLACP_SYNC_TABLE_MAX; i++)
+        MLACP(csm).journal[i].entry_size = mlacp_journal_entry_size[i];
+
+    return;
+}
+
+void mlacp_journal_finalize(struct CSM* csm)
+{
+    int i;
+
+    for (i = 0; i < MLACP_SYNC_TABLE_MAX; i++)
+    {
+        if (MLACP(csm).journal[i].records)
+            free(MLACP(csm).journal[i].records);
+        memset(&MLACP(csm).journal[i], 0, sizeof(struct mlacp_journal));
+    }
+
+    return;
+}
+
+/* Record an entry sent to the peer, return its sequence*/
+uint32_t mlacp_journal_record(struct CSM* csm, int table, const void* entry)
+{
+    struct mlacp_journal* journal = &MLACP(csm).journal[table];
+
+    if (journal->records == NULL)
+    {
+        journal->records = (char*)malloc(MLACP_JOURNAL_SIZE * journal->entry_size);
+        if (journal->records == NULL)
+        {
+            ICCPD_LOG_WARN(__FUNCTION__, "Failed to allocate %s journal", mlacp_journal_table_name(table));
+            /* Still advance, the peer can not resume past a lost record*/
+            journal->seq += MLACP_JOURNAL_SIZE + 1;
+            return journal->seq;
+        }
+    }
+
+    journal->seq++;
+    memcpy(&journal->records[(journal->seq & (MLACP_JOURNAL_SIZE - 1)) * journal->entry_size],
+           entry, journal->entry_size);
+
+    return journal->seq;
+}
+
+/* The peer has all records up to seq of epoch, can it get the rest?*/
+int mlacp_journal_can_resume(struct CSM* csm, int table, uint32_t epoch, uint32_t seq)
+{
+    struct mlacp_journal* journal = &MLACP(csm).journal[table];
+
+    if (epoch != MLACP(csm).sync_epoch)
+        return 0;
+
+    if (seq > journal->seq)
+        return 0;
+
+    if (seq == journal->seq)
+        return 1;
+
+    return journal->records != NULL && journal->seq - seq <= MLACP_JOURNAL_SIZE;
+}
+
+const void* mlacp_journal_get(struct CSM* csm, int table, uint32_t seq)
+{
+    struct mlacp_journal* journal = &MLACP(csm).journal[table];
+
+    if (journal->records == NULL || seq == 0 || seq > journal->seq
+        || journal->seq - seq >= MLACP_JOURNAL_SIZE)
+        return NULL;
+
+    return &journal->records[(seq & (MLACP_JOURNAL_SIZE - 1)) * journal->entry_size];
+}
+
+const char* mlacp_journal_table_name(int table)
+{
+    switch (table)
+    {
+        case MLACP_SYNC_TABLE_MAC:
+            return "MAC";
+
+        case MLACP_SYNC_TABLE_ARP:
+            return "ARP";
+
+        case MLACP_SYNC_TABLE_NDISC:
+            return "ND";
+    }
+
+    return "UNKNOWN";
+}
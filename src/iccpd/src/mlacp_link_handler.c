@@ -32,14 +32,21 @@
 #include <linux/un.h>
 #include <linux/if_arp.h>
 #include <sys/ioctl.h>
+#include <sys/uio.h>
+#include <fcntl.h>
 #include "../include/system.h"
 #include "../include/logger.h"
 #include "../include/mlacp_tlv.h"
 
 #include "../include/iccp_csm.h"
+#include "../include/iccp_pool.h"
 #include "mclagdctl/mclagdctl.h"
 #include "../include/iccp_cmd_show.h"
 #include "../include/iccp_netlink.h"
+#include "../include/mlacp_link_handler.h"
+#include "../include/iccp_latency.h"
+#include "../include/iccp_capture.h"
+#include "../include/scheduler.h"
 /*****************************************
 * Enum
 *
@@ -125,7 +132,7 @@ static int arp_set_handler(struct CSM* csm,
     if (MLACP(csm).current_state != MLACP_STATE_EXCHANGE)
         return 0;
 
-    TAILQ_FOREACH(msg, &MLACP(csm).arp_list, tail)
+    LIST_FOREACH(msg, MLACP_ARP_IF_BUCKET(csm, lif->name), if_next)
     {
         mac_str[0] = '\0';
         arp_msg = (struct ARPMsg*)msg->buf;
@@ -149,7 +156,7 @@ static int arp_set_handler(struct CSM* csm,
 
  del_arp:
     /* Process Del */
-    TAILQ_FOREACH(msg, &MLACP(csm).arp_list, tail)
+    LIST_FOREACH(msg, MLACP_ARP_IF_BUCKET(csm, lif->name), if_next)
     {
         arp_msg = (struct ARPMsg*)msg->buf;
 
@@ -190,7 +197,7 @@ add_ndisc:
     if (MLACP(csm).current_state != MLACP_STATE_EXCHANGE)
         return 0;
 
-    TAILQ_FOREACH(msg, &MLACP(csm).ndisc_list, tail)
+    LIST_FOREACH(msg, MLACP_NDISC_IF_BUCKET(csm, lif->name), if_next)
     {
         mac_str[0] = '\0';
         ndisc_msg = (struct NDISCMsg *)msg->buf;
@@ -213,7 +220,7 @@ add_ndisc:
 
 del_ndisc:
     /* Process Del */
-    TAILQ_FOREACH(msg, &MLACP(csm).ndisc_list, tail)
+    LIST_FOREACH(msg, MLACP_NDISC_IF_BUCKET(csm, lif->name), if_next)
     {
         ndisc_msg = (struct NDISCMsg *)msg->buf;
 
@@ -250,6 +257,9 @@ static void set_route_by_linux_route(struct CSM* csm,
     char *ptr;
     int ret = 0;
 
+    if (iccp_replaying())
+        return;
+
     /* enable kernel forwarding support*/
     system("echo 1 > /proc/sys/net/ipv4/ip_forward");
 
@@ -391,8 +401,7 @@ static void mlacp_clean_fdb(void)
     msg_hdr->type = MCLAG_MSG_TYPE_FLUSH_FDB;
     msg_hdr->len = sizeof(struct IccpSyncdHDr);
 
-    if (sys->sync_fd)
-        write(sys->sync_fd, msg_buf, msg_hdr->len);
+    iccp_syncd_send(sys, msg_buf, msg_hdr->len);
 
     ICCPD_LOG_NOTICE(__FUNCTION__, "Notify mclagsyncd to clear FDB");
 
@@ -437,8 +446,7 @@ void set_peerlink_mlag_port_learn(struct LocalInterface *lif, int enable)
                     sub_msg->op_type == MCLAG_SUB_OPTION_TYPE_MAC_LEARN_DISABLE ? "DISABLE":"ENABLE", lif->name);
 
     /*send msg*/
-    if (sys->sync_fd)
-        write(sys->sync_fd, msg_buf, msg_hdr->len);
+    iccp_syncd_send(sys, msg_buf, msg_hdr->len);
 
     return;
 }
@@ -448,7 +456,7 @@ static void set_peerlink_mlag_port_kernel_forward(
     struct LocalInterface *lif,
     int enable)
 {
-    if (!csm || !csm->peer_link_if || !lif)
+    if (!csm || !csm->peer_link_if || !lif || iccp_replaying())
         return;
 
     char cmd[256] = { 0 };
@@ -574,8 +582,7 @@ void update_peerlink_isolate_from_all_csm_lif(
     }
 
     /*send msg*/
-    if (sys->sync_fd)
-        write(sys->sync_fd, msg_buf, msg_hdr->len);
+    iccp_syncd_send(sys, msg_buf, msg_hdr->len);
 
     return;
 }
@@ -860,17 +867,17 @@ void syn_arp_info_to_peer(struct CSM *csm, struct LocalInterface *local_if)
 
     if (!TAILQ_EMPTY(&(MLACP(csm).arp_list)))
     {
-        TAILQ_FOREACH(msg, &MLACP(csm).arp_list, tail)
+        LIST_FOREACH(msg, MLACP_ARP_IF_BUCKET(csm, local_if->name), if_next)
         {
             arp_info = (struct ARPMsg*)msg->buf;
 
-            if (strcmp(arp_info->ifname, local_if->name) != 0)
+            if (strcmp(arp_info->ifname, local_if->name) != 0 || msg->stale)
                 continue;
 
             arp_msg = (struct ARPMsg*)msg->buf;
             arp_msg->op_type = NEIGH_SYNC_ADD;
 
-            if (iccp_csm_init_msg(&msg_send, (char*)arp_msg, sizeof(struct ARPMsg)) == 0)
+            if (iccp_csm_init_pool_msg(&msg_send, ICCP_POOL_ARP, (char*)arp_msg, sizeof(struct ARPMsg)) == 0)
             {
                 TAILQ_INSERT_TAIL(&(MLACP(csm).arp_msg_list), msg_send, tail);
                 /*ICCPD_LOG_DEBUG( __FUNCTION__, "Enqueue ARP[ADD] for %s",
@@ -896,17 +903,17 @@ void syn_ndisc_info_to_peer(struct CSM *csm, struct LocalInterface *local_if)
 
     if (!TAILQ_EMPTY(&(MLACP(csm).ndisc_list)))
     {
-        TAILQ_FOREACH(msg, &MLACP(csm).ndisc_list, tail)
+        LIST_FOREACH(msg, MLACP_NDISC_IF_BUCKET(csm, local_if->name), if_next)
         {
             ndisc_info = (struct NDISCMsg *)msg->buf;
 
-            if (strcmp(ndisc_info->ifname, local_if->name) != 0)
+            if (strcmp(ndisc_info->ifname, local_if->name) != 0 || msg->stale)
                 continue;
 
             ndisc_msg = (struct NDISCMsg *)msg->buf;
             ndisc_msg->op_type = NEIGH_SYNC_ADD;
 
-            if (iccp_csm_init_msg(&msg_send, (char *)ndisc_msg, sizeof(struct NDISCMsg)) == 0)
+            if (iccp_csm_init_pool_msg(&msg_send, ICCP_POOL_NDISC, (char *)ndisc_msg, sizeof(struct NDISCMsg)) == 0)
             {
                 TAILQ_INSERT_TAIL(&(MLACP(csm).ndisc_msg_list), msg_send, tail);
                 /*ICCPD_LOG_DEBUG(__FUNCTION__, "Enqueue ND[ADD] for %s", show_ipv6_str((char *)ndisc_msg->ipv6_addr));*/
@@ -993,6 +1000,10 @@ void iccp_get_fdb_change_from_syncd( void)
     if (sys == NULL)
         return;
 
+    /*The changes are pushed already*/
+    if (sys->fdb_subscribed)
+        return;
+
     memset(msg_buf, 0, 512);
 
     msg_hdr = (struct IccpSyncdHDr *)msg_buf;
@@ -1001,46 +1012,75 @@ void iccp_get_fdb_change_from_syncd( void)
     msg_hdr->len = sizeof(struct IccpSyncdHDr);
 
     ICCPD_LOG_DEBUG(__FUNCTION__, "Send get fdb change msg to mclagsyncd");
+    sys->fdb_sub_stats.polls++;
 
     /*send msg*/
-    if (sys->sync_fd > 0)
-        write(sys->sync_fd, msg_buf, msg_hdr->len);
+    iccp_syncd_send(sys, msg_buf, msg_hdr->len);
 
     return;
 }
 
-void iccp_send_fdb_entry_to_syncd( struct MACMsg* mac_msg, uint8_t mac_type)
+/* Ask mclagsyncd to push the FDB changes, the whole table first.
+ * A mclagsyncd without the msg ignores it and is polled as before*/
+void iccp_fdb_subscribe(struct System *sys)
 {
     struct IccpSyncdHDr * msg_hdr;
-    char msg_buf[512];
+    struct mclag_fdb_subscribe_info *sub_info;
+    char msg_buf[sizeof(struct IccpSyncdHDr) + sizeof(struct mclag_fdb_subscribe_info)];
+
+    memset(msg_buf, 0, sizeof(msg_buf));
+
+    msg_hdr = (struct IccpSyncdHDr *)msg_buf;
+    msg_hdr->ver = 1;
+    msg_hdr->type = MCLAG_MSG_TYPE_SUBSCRIBE_FDB;
+    msg_hdr->len = sizeof(msg_buf);
+
+    sub_info = (struct mclag_fdb_subscribe_info *)&msg_buf[sizeof(struct IccpSyncdHDr)];
+    sub_info->window_msec = FDB_SUBSCRIBE_WINDOW_MSEC;
+    sub_info->flags = MCLAG_FDB_SUBSCRIBE_SNAPSHOT;
+
+    ICCPD_LOG_DEBUG(__FUNCTION__, "Send fdb subscribe msg to mclagsyncd");
+    sys->fdb_sub_stats.subscribes++;
+
+    iccp_syncd_send(sys, msg_buf, msg_hdr->len);
+
+    return;
+}
+
+/* Back to polling until the next snapshot ends*/
+static void iccp_fdb_subscribe_reset(struct System *sys)
+{
+    sys->fdb_subscribed = 0;
+    sys->fdb_snapshot = 0;
+    sys->fdb_resubscribing = 0;
+    sys->fdb_seq = 0;
+
+    return;
+}
+
+void iccp_send_fdb_entry_to_syncd( struct MACMsg* mac_msg, uint8_t mac_type)
+{
     struct System *sys;
-    struct mclag_fdb_info * mac_info;
+    struct mclag_fdb_info mac_info;
 
     sys = system_get_instance();
     if (sys == NULL)
         return;
 
-    memset(msg_buf, 0, 512);
-
-    msg_hdr = (struct IccpSyncdHDr *)msg_buf;
-    msg_hdr->ver = 1;
-    msg_hdr->type = MCLAG_MSG_TYPE_SET_FDB;
+    memset(&mac_info, 0, sizeof(struct mclag_fdb_info));
 
     /*mac msg */
-    mac_info = (struct mclag_fdb_info *)&msg_buf[sizeof(struct IccpSyncdHDr)];
-    mac_info->vid = mac_msg->vid;
-    memcpy(mac_info->port_name, mac_msg->ifname, MAX_L_PORT_NAME);
-    memcpy(mac_info->mac, mac_msg->mac_str, ETHER_ADDR_STR_LEN);
-    mac_info->type = mac_type;
-    mac_info->op_type = mac_msg->op_type;
-    msg_hdr->len = sizeof(struct IccpSyncdHDr) + sizeof(struct mclag_fdb_info);
+    mac_info.vid = mac_msg->vid;
+    memcpy(mac_info.port_name, mac_msg->ifname, MAX_L_PORT_NAME);
+    memcpy(mac_info.mac, mac_msg->mac_str, ETHER_ADDR_STR_LEN);
+    mac_info.type = mac_type;
+    mac_info.op_type = mac_msg->op_type;
 
     ICCPD_LOG_NOTICE(__FUNCTION__, "Send mac %s msg to mclagsyncd, vid %d ; ifname %s ; mac %s; type %s",
-                    mac_info->op_type == MAC_SYNC_ADD ? "add" : "del", mac_info->vid, mac_info->port_name, mac_info->mac, mac_info->type == MAC_TYPE_STATIC ? "static" : "dynamic");
+                    mac_info.op_type == MAC_SYNC_ADD ? "add" : "del", mac_info.vid, mac_info.port_name, mac_info.mac, mac_info.type == MAC_TYPE_STATIC ? "static" : "dynamic");
 
-    /*send msg*/
-    if (sys->sync_fd > 0 )
-        write(sys->sync_fd, msg_buf, msg_hdr->len);
+    /*queue msg, it is coalesced with the other entries of this loop*/
+    iccp_syncd_queue_fdb(sys, &mac_info);
 
     return;
 }
@@ -1049,6 +1089,7 @@ void add_mac_to_chip(struct MACMsg* mac_msg, uint8_t mac_type)
 {
     mac_msg->op_type = MAC_SYNC_ADD;
     iccp_send_fdb_entry_to_syncd( mac_msg, mac_type);
+    iccp_latency_mark(ICCP_LAT_POINT_PROGRAM);
 
     return;
 }
@@ -1057,6 +1098,7 @@ void del_mac_from_chip(struct MACMsg* mac_msg)
 {
     mac_msg->op_type = MAC_SYNC_DEL;
     iccp_send_fdb_entry_to_syncd(  mac_msg, mac_msg->fdb_type);
+    iccp_latency_mark(ICCP_LAT_POINT_PROGRAM);
 
     return;
 }
@@ -1064,7 +1106,6 @@ void del_mac_from_chip(struct MACMsg* mac_msg)
 uint8_t set_mac_local_age_flag(struct CSM *csm, struct MACMsg* mac_msg, uint8_t set )
 {
     uint8_t new_age_flag = 0;
-    struct Msg *msg = NULL;
 
     new_age_flag = mac_msg->age_flag;
 
@@ -1076,21 +1117,9 @@ uint8_t set_mac_local_age_flag(struct CSM *csm, struct MACMsg* mac_msg, uint8_t
                             new_age_flag, mac_msg->ifname, mac_msg->mac_str, mac_msg->vid, mac_msg->age_flag);
 
         /*send mac MAC_SYNC_ADD message to peer*/
-        if (MLACP(csm).current_state == MLACP_STATE_EXCHANGE)
-        {
-            mac_msg->op_type = MAC_SYNC_ADD;
-            if (iccp_csm_init_msg(&msg, (char*)mac_msg, sizeof(struct MACMsg)) == 0)
-            {
-                TAILQ_INSERT_TAIL(&(MLACP(csm).mac_msg_list), msg, tail);
-                /*ICCPD_LOG_DEBUG(__FUNCTION__, "MAC-msg-list enqueue: %s, add %s vlan-id %d, age_flag %d",
-                               mac_msg->ifname, mac_msg->mac_str, mac_msg->vid, mac_msg->age_flag);*/
-            }
-            else
-            {
-                ICCPD_LOG_WARN(__FUNCTION__, "Failed to enqueue MAC-msg-list: %s, add %s vlan-id %d, age_flag %d",
-                               mac_msg->ifname, mac_msg->mac_str, mac_msg->vid, mac_msg->age_flag);
-                }
-        }
+        if (mlacp_sync_enqueue_or_journal(csm, MLACP_SYNC_TABLE_MAC, mac_msg, MAC_SYNC_ADD) < 0)
+            ICCPD_LOG_WARN(__FUNCTION__, "Failed to enqueue MAC-msg-list: %s, add %s vlan-id %d, age_flag %d",
+                           mac_msg->ifname, mac_msg->mac_str, mac_msg->vid, mac_msg->age_flag);
     }
     else/*set age flag*/
     {
@@ -1100,39 +1129,84 @@ uint8_t set_mac_local_age_flag(struct CSM *csm, struct MACMsg* mac_msg, uint8_t
                             mac_msg->ifname, mac_msg->mac_str, mac_msg->vid, mac_msg->age_flag);
 
         /*send mac MAC_SYNC_DEL message to peer*/
-        if (MLACP(csm).current_state == MLACP_STATE_EXCHANGE)
-        {
-            mac_msg->op_type = MAC_SYNC_DEL;
-            if (iccp_csm_init_msg(&msg, (char*)mac_msg, sizeof(struct MACMsg)) == 0)
-            {
-                TAILQ_INSERT_TAIL(&(MLACP(csm).mac_msg_list), msg, tail);
-                /*ICCPD_LOG_DEBUG(__FUNCTION__, "MAC-msg-list enqueue: %s, add %s vlan-id %d, age_flag %d",
-                                mac_msg->ifname, mac_msg->mac_str, mac_msg->vid, mac_msg->age_flag);*/
-            }
-            else
-            {
-                ICCPD_LOG_WARN(__FUNCTION__, "Failed to enqueue MAC-msg-list: %s, del %s vlan-id %d, age_flag %d",
-                               mac_msg->ifname, mac_msg->mac_str, mac_msg->vid, mac_msg->age_flag);
-            }
-        }
+        if (mlacp_sync_enqueue_or_journal(csm, MLACP_SYNC_TABLE_MAC, mac_msg, MAC_SYNC_DEL) < 0)
+            ICCPD_LOG_WARN(__FUNCTION__, "Failed to enqueue MAC-msg-list: %s, del %s vlan-id %d, age_flag %d",
+                           mac_msg->ifname, mac_msg->mac_str, mac_msg->vid, mac_msg->age_flag);
     }
 
     return new_age_flag;
 }
 
+/* Move all non-static FDB entries of src_port to dst_port by one msg,
+ * delete them if dst_port is NULL*/
+static int iccp_syncd_redirect_fdb(struct System* sys, char* src_port, char* dst_port)
+{
+    char buf[sizeof(struct IccpSyncdHDr) + sizeof(struct mclag_fdb_redirect_info)];
+    struct IccpSyncdHDr * msg_hdr;
+    struct mclag_fdb_redirect_info * info;
+
+    if (sys == NULL || !sys->fdb_bulk_redirect)
+        return MCLAG_ERROR;
+
+    memset(buf, 0, sizeof(buf));
+    msg_hdr = (struct IccpSyncdHDr *)buf;
+    msg_hdr->ver = 1;
+    msg_hdr->type = MCLAG_MSG_TYPE_REDIRECT_FDB;
+    msg_hdr->len = sizeof(buf);
+
+    info = (struct mclag_fdb_redirect_info *)(buf + sizeof(struct IccpSyncdHDr));
+    memcpy(info->src_port, src_port, MAX_L_PORT_NAME);
+    if (dst_port)
+    {
+        memcpy(info->dst_port, dst_port, MAX_L_PORT_NAME);
+        info->op_type = MCLAG_FDB_REDIRECT_MOVE;
+    }
+    else
+    {
+        info->op_type = MCLAG_FDB_REDIRECT_DEL;
+    }
+    info->vid_num = 0;
+
+    if (iccp_syncd_send(sys, buf, msg_hdr->len) < 0)
+        return MCLAG_ERROR;
+
+    sys->syncd_tx_stats.fdb_redirects++;
+
+    ICCPD_LOG_NOTICE(__FUNCTION__, "Send FDB redirect msg to mclagsyncd, %s all MACs of %s%s%s",
+                     dst_port ? "move" : "del", src_port, dst_port ? " to " : "", dst_port ? dst_port : "");
+
+    return 0;
+}
+
 /*Deal with mac add,del,move when portchannel up or down*/
 static void update_l2_mac_state(struct CSM *csm,
                                 struct LocalInterface *lif,
                                 int po_state)
 {
     struct Msg* msg = NULL;
+    struct Msg* msg_next = NULL;
     struct MACMsg* mac_msg = NULL;
+    int bulk = 0;
+    int peer_link_up = 0;
 
     if (!csm || !lif)
         return;
 
-    TAILQ_FOREACH(msg, &MLACP(csm).mac_list, tail)
+    /* On portchannel down the dynamic MACs in ASIC are moved or deleted by
+     * one msg, the walk below only updates the table and the static MACs.
+     * Portchannel up is not on the failover path and is still per MAC*/
+    if (po_state == 0)
+    {
+        peer_link_up = strlen(csm->peer_itf_name) != 0 && csm->peer_link_if
+                       && csm->peer_link_if->state == PORT_STATE_UP;
+        bulk = (iccp_syncd_redirect_fdb(system_get_instance(), lif->name,
+                                        peer_link_up ? csm->peer_itf_name : NULL) == 0);
+    }
+
+    /* Only walk the MACs hashed to this interface*/
+    for (msg = LIST_FIRST(MLACP_MAC_IF_BUCKET(csm, lif->name)); msg; msg = msg_next)
     {
+        msg_next = LIST_NEXT(msg, if_next);
         mac_msg = (struct MACMsg*)msg->buf;
 
         /* find the MAC for this interface*/
@@ -1149,17 +1223,15 @@ static void update_l2_mac_state(struct CSM *csm,
 
             if (mac_msg->age_flag == (MAC_AGE_LOCAL | MAC_AGE_PEER))
             {
-                /*send mac del message to mclagsyncd.*/
-                if (mac_msg->fdb_type != MAC_TYPE_STATIC)
+                /*send mac del message to mclagsyncd, already gone if bulk deleted*/
+                if (mac_msg->fdb_type != MAC_TYPE_STATIC && !(bulk && !peer_link_up))
                     del_mac_from_chip(mac_msg);
 
                 ICCPD_LOG_DEBUG(__FUNCTION__, "Intf %s down, del MAC %s vlan-id %d",
                                 mac_msg->ifname, mac_msg->mac_str, mac_msg->vid);
 
                 /*If local and peer both aged, del the mac*/
-                TAILQ_REMOVE(&(MLACP(csm).mac_list), msg, tail);
-                free(msg->buf);
-                free(msg);
+                mlacp_mac_table_del(csm, msg);
             }
             else
             {
@@ -1171,13 +1243,15 @@ static void update_l2_mac_state(struct CSM *csm,
                     if (csm->peer_link_if && csm->peer_link_if->state == PORT_STATE_UP)
                     {
                         memcpy(mac_msg->ifname, csm->peer_itf_name, IFNAMSIZ);
-                        add_mac_to_chip(mac_msg, MAC_TYPE_DYNAMIC);
+                        if (!bulk || mac_msg->fdb_type == MAC_TYPE_STATIC)
+                            add_mac_to_chip(mac_msg, MAC_TYPE_DYNAMIC);
                     }
                     else
                     {
                         /*must redirect but peerlink is down, del mac from ASIC*/
                         /*if peerlink change to up, mac will add back to ASIC*/
-                        del_mac_from_chip(mac_msg);
+                        if (!bulk || mac_msg->fdb_type == MAC_TYPE_STATIC)
+                            del_mac_from_chip(mac_msg);
                         memcpy(mac_msg->ifname, csm->peer_itf_name, IFNAMSIZ);
                     }
 
@@ -1187,7 +1261,8 @@ static void update_l2_mac_state(struct CSM *csm,
                 else
                 {
                     /*peer-link is not configured, del mac from ASIC, mac still in mac_list*/
-                    del_mac_from_chip(mac_msg);
+                    if (!bulk || mac_msg->fdb_type == MAC_TYPE_STATIC)
+                        del_mac_from_chip(mac_msg);
 
                     ICCPD_LOG_NOTICE(__FUNCTION__, "Intf %s down, peer-link is not configured: MAC %s vlan-id %d",
                                     mac_msg->ifname, mac_msg->mac_str, mac_msg->vid);
@@ -1241,6 +1316,8 @@ void mlacp_portchannel_state_handler(struct CSM* csm,
     update_peerlink_isolate_from_lif(csm, local_if, po_state);
 
     update_l2_mac_state(csm, local_if, po_state);
+    if (po_state == 0)
+        iccp_latency_record(ICCP_LAT_STAGE_PO_DOWN_TO_REDIRECT, iccp_latency_origin());
 
     if (!local_if_is_l3_mode(local_if))
         update_l2_po_state(csm, local_if, po_state);
@@ -1267,6 +1344,10 @@ static void mlacp_conn_handler_fdb(struct CSM* csm)
         {
             mac_msg = (struct MACMsg*)msg->buf;
 
+            /*Restored MAC not confirmed yet, the peer gets it when it is*/
+            if (msg->stale)
+                continue;
+
             /*Wait the ACK from peer?*/
             /*mac_msg->age_flag &= ~MAC_AGE_PEER;*/
 
@@ -1276,9 +1357,17 @@ static void mlacp_conn_handler_fdb(struct CSM* csm)
               After warm-reboot, this MAC must be learnt by peer and sync to local switch*/
             if (!(mac_msg->age_flag & MAC_AGE_LOCAL))
             {
+                /*Peer resumes the MAC sync, the changes made while it was away
+                  are journaled and replayed, it has all local MACs then*/
+                if (MLACP(csm).resync_delta & MLACP_SYNC_TABLE_BIT(MLACP_SYNC_TABLE_MAC))
+                {
+                    mac_msg->age_flag &= ~MAC_AGE_PEER;
+                    continue;
+                }
+
                 /*Send mac add message to peer*/
                 mac_msg->op_type = MAC_SYNC_ADD;
-                if (iccp_csm_init_msg(&msg_send, (char*)mac_msg, sizeof(struct MACMsg)) == 0)
+                if (iccp_csm_init_pool_msg(&msg_send, ICCP_POOL_MAC, (char*)mac_msg, sizeof(struct MACMsg)) == 0)
                 {
                     mac_msg->age_flag &= ~MAC_AGE_PEER;
                     TAILQ_INSERT_TAIL(&(MLACP(csm).mac_msg_list), msg_send, tail);
@@ -1309,6 +1398,9 @@ static void mlacp_fix_bridge_mac(struct CSM* csm)
     char macaddr[64];
     uint8_t null_mac[] = { 0x00, 0x00, 0x00, 0x00, 0x00, 0x00 };
 
+    if (iccp_replaying())
+        return;
+
     if (memcmp(MLACP(csm).system_id, null_mac, ETHER_ADDR_LEN) != 0)
     {
         memset(macaddr, 0, 64);
@@ -1380,13 +1472,49 @@ void mlacp_peer_conn_handler(struct CSM* csm)
     return;
 }
 
+/* Age the MACs on the peer side, del the MACs that only the peer has*/
+void mlacp_peer_disconn_fdb(struct CSM* csm)
+{
+    struct Msg* msg = NULL;
+    struct Msg* msg_next = NULL;
+    struct MACMsg* mac_msg = NULL;
+
+    if (!csm)
+        return;
+
+    MLACP(csm).resync_hold_time = 0;
+    MLACP(csm).peer_seq_valid &= ~MLACP_SYNC_TABLE_BIT(MLACP_SYNC_TABLE_MAC);
+
+    for (msg = TAILQ_FIRST(&MLACP(csm).mac_list); msg; msg = msg_next)
+    {
+        msg_next = TAILQ_NEXT(msg, tail);
+        mac_msg = (struct MACMsg*)msg->buf;
+
+        mac_msg->age_flag |= MAC_AGE_PEER;
+        ICCPD_LOG_DEBUG(__FUNCTION__, "Add peer age flag: %s, MAC %s vlan-id %d",
+                        mac_msg->ifname, mac_msg->mac_str, mac_msg->vid);
+
+        /* find the MAC that the port is peer-link or local and peer both aged, to be deleted*/
+        if (strcmp(mac_msg->ifname, csm->peer_itf_name) != 0 && mac_msg->age_flag != (MAC_AGE_LOCAL | MAC_AGE_PEER))
+            continue;
+
+        ICCPD_LOG_NOTICE(__FUNCTION__, "Peer disconnect, del MAC for peer-link: %s, MAC %s vlan-id %d",
+                        mac_msg->ifname, mac_msg->mac_str, mac_msg->vid);
+
+        /*Send mac del message to mclagsyncd, may be already deleted*/
+        del_mac_from_chip(mac_msg);
+
+        mlacp_mac_table_del(csm, msg);
+    }
+
+    return;
+}
+
 extern void recover_if_ipmac_on_standby(struct LocalInterface* lif_po);
 void mlacp_peer_disconn_handler(struct CSM* csm)
 {
     uint8_t null_mac[] = { 0x00, 0x00, 0x00, 0x00, 0x00, 0x00 };
     struct LocalInterface* lif = NULL;
-    struct Msg* msg = NULL;
-    struct MACMsg* mac_msg = NULL;
     struct System* sys = NULL;
 
     if (!csm)
@@ -1411,27 +1539,22 @@ void mlacp_peer_disconn_handler(struct CSM* csm)
         return;
     }
 
-    TAILQ_FOREACH(msg, &MLACP(csm).mac_list, tail)
+    /* If the peer can resume the MAC sync and the peer-link is still up,
+     * only the session is gone and its MACs are kept for a while. They are
+     * aged at once when the peer-link goes down, or when the peer does not
+     * come back or asks for a full sync*/
+    if ((MLACP(csm).peer_seq_valid & MLACP_SYNC_TABLE_BIT(MLACP_SYNC_TABLE_MAC))
+        && csm->peer_link_if && csm->peer_link_if->state == PORT_STATE_UP)
     {
-        mac_msg = (struct MACMsg*)msg->buf;
-
-        mac_msg->age_flag |= MAC_AGE_PEER;
-        ICCPD_LOG_DEBUG(__FUNCTION__, "Add peer age flag: %s, MAC %s vlan-id %d",
-                        mac_msg->ifname, mac_msg->mac_str, mac_msg->vid);
-
-        /* find the MAC that the port is peer-link or local and peer both aged, to be deleted*/
-        if (strcmp(mac_msg->ifname, csm->peer_itf_name) != 0 && mac_msg->age_flag != (MAC_AGE_LOCAL | MAC_AGE_PEER))
-            continue;
-
-        ICCPD_LOG_NOTICE(__FUNCTION__, "Peer disconnect, del MAC for peer-link: %s, MAC %s vlan-id %d",
-                        mac_msg->ifname, mac_msg->mac_str, mac_msg->vid);
-
-        /*Send mac del message to mclagsyncd, may be already deleted*/
-        del_mac_from_chip(mac_msg);
-
-        TAILQ_REMOVE(&(MLACP(csm).mac_list), msg, tail);
-        free(msg->buf);
-        free(msg);
+        if (MLACP(csm).resync_hold_time == 0)
+        {
+            time(&MLACP(csm).resync_hold_time);
+            ICCPD_LOG_NOTICE(__FUNCTION__, "Peer disconnect, keep peer MACs %d seconds for resync", MLACP_RESYNC_HOLD_SEC);
+        }
+    }
+    else
+    {
+        mlacp_peer_disconn_fdb(csm);
     }
 
     /* Clean all port block*/
@@ -1481,14 +1604,16 @@ void mlacp_peerlink_up_handler(struct CSM* csm)
 void mlacp_peerlink_down_handler(struct CSM* csm)
 {
     struct Msg* msg = NULL;
+    struct Msg* msg_next = NULL;
     struct MACMsg* mac_msg = NULL;
 
     if (!csm)
         return;
 
     /*If peer link down, remove all the mac that point to the peer-link*/
-    TAILQ_FOREACH(msg, &MLACP(csm).mac_list, tail)
+    for (msg = TAILQ_FIRST(&MLACP(csm).mac_list); msg; msg = msg_next)
     {
+        msg_next = TAILQ_NEXT(msg, tail);
         mac_msg = (struct MACMsg*)msg->buf;
 
         /* Find the MAC that the port is peer-link to be deleted*/
@@ -1507,9 +1632,7 @@ void mlacp_peerlink_down_handler(struct CSM* csm)
         if (mac_msg->age_flag == (MAC_AGE_LOCAL | MAC_AGE_PEER))
         {
             /*If local and peer both aged, del the mac*/
-            TAILQ_REMOVE(&(MLACP(csm).mac_list), msg, tail);
-            free(msg->buf);
-            free(msg);
+            mlacp_mac_table_del(csm, msg);
         }
     }
 
@@ -1545,112 +1668,480 @@ void mlacp_mlag_link_del_handler(struct CSM *csm, struct LocalInterface *lif)
     return;
 }
 
-int iccp_connect_syncd()
+/*****************************************
+* mclagsyncd outbound queue
+*
+* All messages to mclagsyncd are queued on sys->syncd_tx_list and written
+* with writev at the end of each scheduler loop or on EPOLLOUT. SET_FDB
+* entries are coalesced into multi-entry frames.
+* ***************************************/
+static void iccp_syncd_set_pollout(struct System* sys, int enable)
 {
-    struct System* sys = NULL;
-    int ret = 0;
-    int fd = 0;
-    struct sockaddr_in serv;
-    static int count = 0;
     struct epoll_event event;
 
-    if ((sys = system_get_instance()) == NULL)
-        goto conn_fail;
+    if (sys->syncd_tx_pollout == enable || sys->sync_fd <= 0)
+        return;
 
-    if (sys->sync_fd >= 0)
+    event.data.fd = sys->sync_fd;
+    event.events = enable ? (EPOLLIN | EPOLLOUT) : EPOLLIN;
+    if (epoll_ctl(sys->epoll_fd, EPOLL_CTL_MOD, sys->sync_fd, &event) == 0)
+        sys->syncd_tx_pollout = enable;
+
+    return;
+}
+
+static int iccp_syncd_tx_reserve(struct System* sys, size_t len)
+{
+    if (sys->syncd_tx_bytes + len <= SYNCD_TX_HIGH_WATER)
         return 0;
 
-    /*Print the fail log message every 60s*/
-    if (count >= 600)
-    {
-        count = 0;
-    }
+    /*Until the queue drains the caller holds the msg back*/
+    if (sys->syncd_tx_stalled)
+        return MCLAG_ERROR;
 
-    fd = socket(AF_INET, SOCK_STREAM, 0);
-    if (fd < 0)
-    {
-        if (count == 0)
-            ICCPD_LOG_WARN(__FUNCTION__, "Failed to create unix socket: %s", strerror(errno));
-        goto conn_fail;
-    }
+    /*Back-pressure: mclagsyncd is not draining, never wait for it here,
+     * EPOLLOUT flushes the queue and releases the held back msgs*/
+    sys->syncd_tx_stalled = 1;
+    sys->syncd_tx_stats.hwm_hits++;
+    sys->syncd_tx_stats.stalls++;
+    iccp_syncd_set_pollout(sys, 1);
+    ICCPD_LOG_WARN(__FUNCTION__, "mclagsyncd queue is full (%u bytes), hold msgs back until it drains",
+                   sys->syncd_tx_bytes);
 
-    /* Make server socket. */
-    memset(&serv, 0, sizeof(serv));
-    serv.sin_family = AF_INET;
-    serv.sin_port = htons(2626);
-#ifdef HAVE_STRUCT_SOCKADDR_IN_SIN_LEN
-    serv.sin_len = sizeof(struct sockaddr_in);
-#endif /* HAVE_STRUCT_SOCKADDR_IN_SIN_LEN */
-    serv.sin_addr.s_addr = htonl(0x7f000006);
+    return MCLAG_ERROR;
+}
 
-    ret = connect(fd, (struct sockaddr *)&serv, sizeof(serv));
-    if (ret < 0)
+static void iccp_syncd_tx_enqueue(struct System* sys, struct Msg* msg)
+{
+    TAILQ_INSERT_TAIL(&(sys->syncd_tx_list), msg, tail);
+    sys->syncd_tx_bytes += msg->len;
+    if (sys->syncd_tx_bytes > sys->syncd_tx_stats.queued_bytes_peak)
+        sys->syncd_tx_stats.queued_bytes_peak = sys->syncd_tx_bytes;
+
+    return;
+}
+
+/* Append one FDB entry to the open SET_FDB frame*/
+static int iccp_syncd_tx_append_fdb(struct System* sys, struct mclag_fdb_info* mac_info)
+{
+    struct IccpSyncdHDr * msg_hdr;
+    struct Msg* msg = NULL;
+    size_t frame_size = sizeof(struct IccpSyncdHDr) + SYNCD_TX_FDB_BATCH_SIZE * sizeof(struct mclag_fdb_info);
+
+    msg = sys->syncd_tx_fdb_frame;
+    if (msg == NULL || msg->len + sizeof(struct mclag_fdb_info) > frame_size)
     {
-        if (count == 0)
-            ICCPD_LOG_WARN(__FUNCTION__, "Failed to connect to mclag syncd: errno str %s", strerror(errno));
-        close(fd);
-        goto conn_fail;
+        msg = iccp_csm_alloc_msg();
+        if (msg == NULL)
+            return MCLAG_ERROR;
+
+        msg->buf = (char*)malloc(frame_size);
+        if (msg->buf == NULL)
+        {
+            iccp_csm_free_msg(msg);
+            return MCLAG_ERROR;
+        }
+
+        msg_hdr = (struct IccpSyncdHDr *)msg->buf;
+        msg_hdr->ver = 1;
+        msg_hdr->type = MCLAG_MSG_TYPE_SET_FDB;
+        msg_hdr->len = sizeof(struct IccpSyncdHDr);
+        msg->len = msg_hdr->len;
+
+        iccp_syncd_tx_enqueue(sys, msg);
+        sys->syncd_tx_fdb_frame = msg;
     }
 
-    ICCPD_LOG_NOTICE(__FUNCTION__, "Success to link syncd");
-    sys->sync_fd = fd;
+    memcpy(msg->buf + msg->len, mac_info, sizeof(struct mclag_fdb_info));
+    msg->len += sizeof(struct mclag_fdb_info);
+    ((struct IccpSyncdHDr *)msg->buf)->len = msg->len;
 
-    event.data.fd = fd;
-    event.events = EPOLLIN;
-    ret = epoll_ctl(sys->epoll_fd, EPOLL_CTL_ADD, fd, &event);
+    sys->syncd_tx_bytes += sizeof(struct mclag_fdb_info);
+    if (sys->syncd_tx_bytes > sys->syncd_tx_stats.queued_bytes_peak)
+        sys->syncd_tx_stats.queued_bytes_peak = sys->syncd_tx_bytes;
+    sys->syncd_tx_stats.tx_fdb_entries++;
 
-    count = 0;
     return 0;
+}
 
- conn_fail:
-    if (count == 0)
-        ICCPD_LOG_DEBUG(__FUNCTION__, "Mclag syncd socket connect fail");
+static unsigned int iccp_syncd_defer_hash(struct mclag_fdb_info* mac_info)
+{
+    unsigned int hash = 5381 + mac_info->vid;
+    const char* p;
 
-    count++;
+    for (p = mac_info->mac; *p != '\0'; p++)
+        hash = ((hash << 5) + hash) + (unsigned char)*p;
 
-    return MCLAG_ERROR;
+    return hash % SYNCD_TX_DEFER_HASH_SIZE;
 }
 
-void syncd_info_close()
+/* Hold a msg back while mclagsyncd is stalled*/
+static int iccp_syncd_defer(struct System* sys, char* buf, size_t len)
 {
-    struct System* sys = NULL;
+    struct Msg* msg = NULL;
 
-    if ((sys = system_get_instance()) == NULL)
-        return;
+    if (iccp_csm_init_msg(&msg, buf, len) < 0)
+        return MCLAG_ERROR;
 
-    if (sys->sync_fd > 0)
-    {
-        close(sys->sync_fd);
-        sys->sync_fd = -1;
-    }
+    TAILQ_INSERT_TAIL(&(sys->syncd_defer_list), msg, tail);
+    sys->syncd_defer_num++;
+    sys->syncd_tx_stats.deferred_frames++;
 
-    return;
+    return 0;
 }
 
-int iccp_get_receive_fdb_sock_fd(struct System *sys)
+/* Hold an FDB entry back while mclagsyncd is stalled. Only the last op of a
+   MAC matters, it replaces the held back one and moves to the tail so it
+   stays behind the msgs queued before it*/
+static int iccp_syncd_defer_fdb(struct System* sys, struct mclag_fdb_info* mac_info)
 {
-    return sys->sync_fd;
-}
+    char buf[sizeof(struct IccpSyncdHDr) + sizeof(struct mclag_fdb_info)];
+    struct IccpSyncdHDr * msg_hdr = (struct IccpSyncdHDr *)buf;
+    struct mclag_fdb_info* info = NULL;
+    struct Msg* msg = NULL;
+    unsigned int bucket = iccp_syncd_defer_hash(mac_info);
 
-/*When received MAC add and del packets from mclagsyncd, update mac information*/
-void do_mac_update_from_syncd(char mac_str[ETHER_ADDR_STR_LEN], uint16_t vid, char *ifname, uint8_t fdb_type, uint8_t op_type)
-{
-    struct System *sys = NULL;
-    struct CSM *csm = NULL;
-    struct Msg *msg = NULL;
-    struct MACMsg *mac_msg = NULL, *mac_info = NULL;
-    uint8_t mac_exist = 0;
-    char buf[MAX_BUFSIZE];
-    size_t msg_len = 0;
-    uint8_t from_mclag_intf = 0;/*0: orphan port, 1: MCLAG port*/
-    struct CSM *first_csm = NULL;
+    LIST_FOREACH(msg, &(sys->syncd_defer_hash[bucket]), hash_next)
+    {
+        info = (struct mclag_fdb_info*)(msg->buf + sizeof(struct IccpSyncdHDr));
+        if (info->vid == mac_info->vid && strcmp(info->mac, mac_info->mac) == 0)
+        {
+            memcpy(info, mac_info, sizeof(struct mclag_fdb_info));
+            TAILQ_REMOVE(&(sys->syncd_defer_list), msg, tail);
+            TAILQ_INSERT_TAIL(&(sys->syncd_defer_list), msg, tail);
+            sys->syncd_tx_stats.deferred_coalesced++;
+            return 0;
+        }
+    }
 
-    struct LocalInterface *lif_po = NULL, *mac_lif = NULL;
+    msg_hdr->ver = 1;
+    msg_hdr->type = MCLAG_MSG_TYPE_SET_FDB;
+    msg_hdr->len = sizeof(buf);
+    memcpy(buf + sizeof(struct IccpSyncdHDr), mac_info, sizeof(struct mclag_fdb_info));
 
-    if (!(sys = system_get_instance()))
-        return;
+    if (iccp_csm_init_msg(&msg, buf, sizeof(buf)) < 0)
+        return MCLAG_ERROR;
 
-    /* create MAC msg*/
+    TAILQ_INSERT_TAIL(&(sys->syncd_defer_list), msg, tail);
+    LIST_INSERT_HEAD(&(sys->syncd_defer_hash[bucket]), msg, hash_next);
+    sys->syncd_defer_num++;
+    sys->syncd_tx_stats.deferred_fdb_entries++;
+
+    return 0;
+}
+
+/* Move the held back msgs to the queue, in order, up to the high-water*/
+static int iccp_syncd_defer_release(struct System* sys)
+{
+    struct IccpSyncdHDr * msg_hdr;
+    struct Msg* msg = NULL;
+    int cnt = 0;
+
+    while ((msg = TAILQ_FIRST(&(sys->syncd_defer_list))) != NULL)
+    {
+        if (sys->syncd_tx_bytes + msg->len > SYNCD_TX_HIGH_WATER)
+            break;
+
+        msg_hdr = (struct IccpSyncdHDr *)msg->buf;
+        if (msg_hdr->type == MCLAG_MSG_TYPE_SET_FDB)
+        {
+            if (iccp_syncd_tx_append_fdb(sys, (struct mclag_fdb_info*)(msg->buf + sizeof(struct IccpSyncdHDr))) < 0)
+                break;
+
+            TAILQ_REMOVE(&(sys->syncd_defer_list), msg, tail);
+            LIST_REMOVE(msg, hash_next);
+            iccp_csm_free_msg(msg);
+        }
+        else
+        {
+            TAILQ_REMOVE(&(sys->syncd_defer_list), msg, tail);
+            sys->syncd_tx_fdb_frame = NULL;
+            iccp_syncd_tx_enqueue(sys, msg);
+        }
+
+        sys->syncd_defer_num--;
+        cnt++;
+    }
+
+    /*The frames are written next, they must not grow any more*/
+    sys->syncd_tx_fdb_frame = NULL;
+
+    return cnt;
+}
+
+/* Queue a complete message to mclagsyncd*/
+int iccp_syncd_send(struct System* sys, char* buf, size_t len)
+{
+    struct Msg* msg = NULL;
+
+    if (sys == NULL || sys->sync_fd <= 0)
+        return MCLAG_ERROR;
+
+    /*Behind the held back msgs to keep the order*/
+    if (!TAILQ_EMPTY(&(sys->syncd_defer_list)) || iccp_syncd_tx_reserve(sys, len) < 0)
+    {
+        if (iccp_syncd_defer(sys, buf, len) < 0)
+        {
+            sys->syncd_tx_stats.dropped_frames++;
+            ICCPD_LOG_WARN(__FUNCTION__, "Failed to hold back msg type %d, drop it",
+                           ((struct IccpSyncdHDr *)buf)->type);
+            return MCLAG_ERROR;
+        }
+
+        return 0;
+    }
+
+    if (iccp_csm_init_msg(&msg, buf, len) < 0)
+        return MCLAG_ERROR;
+
+    /*Keep the order of FDB entries and other msgs*/
+    sys->syncd_tx_fdb_frame = NULL;
+    iccp_syncd_tx_enqueue(sys, msg);
+
+    return 0;
+}
+
+/* Queue one FDB entry to mclagsyncd, appended to the open SET_FDB frame*/
+int iccp_syncd_queue_fdb(struct System* sys, struct mclag_fdb_info* mac_info)
+{
+    if (sys == NULL || sys->sync_fd <= 0)
+        return MCLAG_ERROR;
+
+    /*Behind the held back msgs to keep the order*/
+    if (!TAILQ_EMPTY(&(sys->syncd_defer_list)) || iccp_syncd_tx_reserve(sys, sizeof(struct mclag_fdb_info)) < 0)
+    {
+        if (iccp_syncd_defer_fdb(sys, mac_info) < 0)
+        {
+            sys->syncd_tx_stats.dropped_fdb_entries++;
+            ICCPD_LOG_WARN(__FUNCTION__, "Failed to hold back mac %s vid %d, drop it",
+                           mac_info->mac, mac_info->vid);
+            return MCLAG_ERROR;
+        }
+
+        return 0;
+    }
+
+    return iccp_syncd_tx_append_fdb(sys, mac_info);
+}
+
+/* Write out the queued messages without blocking*/
+int iccp_syncd_flush(struct System* sys)
+{
+    struct iovec iov[SYNCD_TX_IOV_MAX];
+    struct Msg* msg = NULL;
+    size_t offset;
+    ssize_t n;
+    int cnt;
+
+    if (sys == NULL || sys->sync_fd <= 0)
+        return 0;
+
+    /*A frame being written must not grow any more*/
+    sys->syncd_tx_fdb_frame = NULL;
+
+    while (1)
+    {
+        /*Drained, the stall is over and the held back msgs go out*/
+        if (TAILQ_EMPTY(&(sys->syncd_tx_list)))
+        {
+            sys->syncd_tx_stalled = 0;
+            if (iccp_syncd_defer_release(sys) == 0)
+                break;
+        }
+
+        cnt = 0;
+        offset = sys->syncd_tx_offset;
+        TAILQ_FOREACH(msg, &(sys->syncd_tx_list), tail)
+        {
+            if (cnt >= SYNCD_TX_IOV_MAX)
+                break;
+
+            iov[cnt].iov_base = msg->buf + offset;
+            iov[cnt].iov_len = msg->len - offset;
+            offset = 0;
+            cnt++;
+        }
+
+        n = writev(sys->sync_fd, iov, cnt);
+        sys->syncd_tx_stats.writev_calls++;
+        if (n < 0)
+        {
+            if (errno == EINTR)
+                continue;
+
+            if (errno == EAGAIN || errno == EWOULDBLOCK)
+            {
+                sys->syncd_tx_stats.eagain++;
+                iccp_syncd_set_pollout(sys, 1);
+                return 0;
+            }
+
+            ICCPD_LOG_WARN(__FUNCTION__, "Failed to write to mclagsyncd: %s", strerror(errno));
+            return MCLAG_ERROR;
+        }
+
+        sys->syncd_tx_stats.tx_bytes += n;
+        sys->syncd_tx_bytes -= n;
+
+        while (n > 0 && (msg = TAILQ_FIRST(&(sys->syncd_tx_list))) != NULL)
+        {
+            if (n < msg->len - sys->syncd_tx_offset)
+            {
+                sys->syncd_tx_offset += n;
+                break;
+            }
+
+            n -= msg->len - sys->syncd_tx_offset;
+            sys->syncd_tx_offset = 0;
+            TAILQ_REMOVE(&(sys->syncd_tx_list), msg, tail);
+            iccp_capture_write(ICCP_CAPTURE_SYNCD_TX, -1, msg->buf, msg->len);
+            iccp_csm_free_msg(msg);
+            sys->syncd_tx_stats.tx_frames++;
+        }
+    }
+
+    iccp_syncd_set_pollout(sys, 0);
+
+    return 0;
+}
+
+static void iccp_syncd_tx_purge(struct System* sys)
+{
+    struct Msg* msg = NULL;
+
+    while (!TAILQ_EMPTY(&(sys->syncd_tx_list)))
+    {
+        msg = TAILQ_FIRST(&(sys->syncd_tx_list));
+        TAILQ_REMOVE(&(sys->syncd_tx_list), msg, tail);
+        iccp_csm_free_msg(msg);
+    }
+
+    sys->syncd_tx_fdb_frame = NULL;
+    sys->syncd_tx_offset = 0;
+    sys->syncd_tx_bytes = 0;
+    sys->syncd_tx_pollout = 0;
+    /*The held back msgs are kept for the next connection*/
+    sys->syncd_tx_stalled = 0;
+
+    return;
+}
+
+int iccp_connect_syncd()
+{
+    struct System* sys = NULL;
+    int ret = 0;
+    int fd = 0;
+    struct sockaddr_in serv;
+    static int count = 0;
+    struct epoll_event event;
+
+    if ((sys = system_get_instance()) == NULL)
+        goto conn_fail;
+
+    if (sys->sync_fd >= 0)
+        return 0;
+
+    /*Print the fail log message every 60s*/
+    if (count >= 600)
+    {
+        count = 0;
+    }
+
+    fd = socket(AF_INET, SOCK_STREAM, 0);
+    if (fd < 0)
+    {
+        if (count == 0)
+            ICCPD_LOG_WARN(__FUNCTION__, "Failed to create unix socket: %s", strerror(errno));
+        goto conn_fail;
+    }
+
+    /* Make server socket. */
+    memset(&serv, 0, sizeof(serv));
+    serv.sin_family = AF_INET;
+    serv.sin_port = htons(2626);
+#ifdef HAVE_STRUCT_SOCKADDR_IN_SIN_LEN
+    serv.sin_len = sizeof(struct sockaddr_in);
+#endif /* HAVE_STRUCT_SOCKADDR_IN_SIN_LEN */
+    serv.sin_addr.s_addr = htonl(0x7f000006);
+
+    ret = connect(fd, (struct sockaddr *)&serv, sizeof(serv));
+    if (ret < 0)
+    {
+        if (count == 0)
+            ICCPD_LOG_WARN(__FUNCTION__, "Failed to connect to mclag syncd: errno str %s", strerror(errno));
+        close(fd);
+        goto conn_fail;
+    }
+
+    ICCPD_LOG_NOTICE(__FUNCTION__, "Success to link syncd");
+    sys->sync_fd = fd;
+    fcntl(fd, F_SETFL, fcntl(fd, F_GETFL, 0) | O_NONBLOCK);
+    iccp_syncd_tx_purge(sys);
+    sys->syncd_rx_len = 0;
+
+    event.data.fd = fd;
+    event.events = EPOLLIN;
+    ret = epoll_ctl(sys->epoll_fd, EPOLL_CTL_ADD, fd, &event);
+
+    iccp_fdb_subscribe_reset(sys);
+    iccp_fdb_subscribe(sys);
+
+    count = 0;
+    return 0;
+
+ conn_fail:
+    if (count == 0)
+        ICCPD_LOG_DEBUG(__FUNCTION__, "Mclag syncd socket connect fail");
+
+    count++;
+
+    return MCLAG_ERROR;
+}
+
+void syncd_info_close()
+{
+    struct System* sys = NULL;
+
+    if ((sys = system_get_instance()) == NULL)
+        return;
+
+    if (sys->sync_fd > 0)
+    {
+        close(sys->sync_fd);
+        sys->sync_fd = -1;
+    }
+
+    iccp_syncd_tx_purge(sys);
+    sys->syncd_rx_len = 0;
+    iccp_fdb_subscribe_reset(sys);
+
+    return;
+}
+
+int iccp_get_receive_fdb_sock_fd(struct System *sys)
+{
+    return sys->sync_fd;
+}
+
+/*When received MAC add and del packets from mclagsyncd, update mac information*/
+void do_mac_update_from_syncd(char mac_str[ETHER_ADDR_STR_LEN], uint16_t vid, char *ifname, uint8_t fdb_type, uint8_t op_type)
+{
+    struct System *sys = NULL;
+    struct CSM *csm = NULL;
+    struct Msg *msg = NULL;
+    struct MACMsg *mac_msg = NULL, *mac_info = NULL;
+    uint8_t mac_exist = 0;
+    char buf[MAX_BUFSIZE];
+    size_t msg_len = 0;
+    uint8_t from_mclag_intf = 0;/*0: orphan port, 1: MCLAG port*/
+    struct CSM *first_csm = NULL;
+
+    struct LocalInterface *lif_po = NULL, *mac_lif = NULL;
+
+    if (!(sys = system_get_instance()))
+        return;
+
+    /* create MAC msg*/
     memset(buf, 0, MAX_BUFSIZE);
     msg_len = sizeof(struct MACMsg);
     mac_msg = (struct MACMsg*)buf;
@@ -1699,16 +2190,11 @@ void do_mac_update_from_syncd(char mac_str[ETHER_ADDR_STR_LEN], uint16_t vid, ch
     csm = first_csm;
 
     /* find lif MAC+vid*/
-    TAILQ_FOREACH(msg, &MLACP(csm).mac_list, tail)
+    msg = mlacp_mac_table_find(csm, mac_str, vid);
+    if (msg)
     {
         mac_info = (struct MACMsg*)msg->buf;
-
-        /*MAC and vid are equal*/
-        if (strcmp(mac_info->mac_str, mac_str) == 0 && mac_info->vid == vid)
-        {
-            mac_exist = 1;
-            break;
-        }
+        mac_exist = 1;
     }
 
     /*handle mac add*/
@@ -1724,6 +2210,9 @@ void do_mac_update_from_syncd(char mac_str[ETHER_ADDR_STR_LEN], uint16_t vid, ch
         /*same MAC exist*/
         if (mac_exist)
         {
+            /*The chip has it, a restored MAC is confirmed*/
+            msg->stale = 0;
+
             /*If the recv mac port is peer-link, that is add from iccpd, no need to handle*/
             if (strcmp(csm->peer_itf_name, mac_msg->ifname) == 0)
             {
@@ -1743,7 +2232,7 @@ void do_mac_update_from_syncd(char mac_str[ETHER_ADDR_STR_LEN], uint16_t vid, ch
             {
                 mac_info->fdb_type = mac_msg->fdb_type;
                 sprintf(mac_info->ifname, "%s", mac_msg->ifname);
-                sprintf(mac_info->origin_ifname, "%s", mac_msg->ifname);
+                mlacp_mac_table_set_origin(csm, msg, mac_msg->ifname);
 
                 /*Remove MAC_AGE_LOCAL flag*/
                 mac_info->age_flag = set_mac_local_age_flag(csm, mac_info, 0);
@@ -1774,30 +2263,16 @@ void do_mac_update_from_syncd(char mac_str[ETHER_ADDR_STR_LEN], uint16_t vid, ch
             mac_msg->age_flag |= MAC_AGE_PEER;
             /*ICCPD_LOG_DEBUG(__FUNCTION__, "Add peer age flag: %s, add %s vlan-id %d, age_flag %d",
                             mac_msg->ifname, mac_msg->mac_str, mac_msg->vid, mac_msg->age_flag);*/
-            mac_msg->op_type = MAC_SYNC_ADD;
-
-            if (MLACP(csm).current_state == MLACP_STATE_EXCHANGE)
-            {
-                struct Msg *msg_send = NULL;
-                if (iccp_csm_init_msg(&msg_send, (char*)mac_msg, msg_len) == 0)
-                {
-                    mac_msg->age_flag &= ~MAC_AGE_PEER;
-                    TAILQ_INSERT_TAIL(&(MLACP(csm).mac_msg_list), msg_send, tail);
-
-                    /*ICCPD_LOG_DEBUG(__FUNCTION__, "MAC-msg-list enqueue: %s, add %s vlan-id %d, age_flag %d",
-                                    mac_msg->ifname, mac_msg->mac_str, mac_msg->vid, mac_msg->age_flag);*/
-                }
-                else
-                {
-                    ICCPD_LOG_WARN(__FUNCTION__, "Failed to enqueue MAC-msg-list: %s, MAC %s vlan-id %d",
-                                    mac_msg->ifname, mac_msg->mac_str, mac_msg->vid);
-                }
-            }
+            if (mlacp_sync_enqueue_or_journal(csm, MLACP_SYNC_TABLE_MAC, mac_msg, MAC_SYNC_ADD) < 0)
+                ICCPD_LOG_WARN(__FUNCTION__, "Failed to enqueue MAC-msg-list: %s, MAC %s vlan-id %d",
+                                mac_msg->ifname, mac_msg->mac_str, mac_msg->vid);
+            else if (MLACP(csm).current_state != MLACP_STATE_INIT)
+                mac_msg->age_flag &= ~MAC_AGE_PEER;
 
             /*enqueue mac to mac-list*/
-            if (iccp_csm_init_msg(&msg, (char*)mac_msg, msg_len) == 0)
+            if (iccp_csm_init_pool_msg(&msg, ICCP_POOL_MAC, (char*)mac_msg, msg_len) == 0)
             {
-                TAILQ_INSERT_TAIL(&(MLACP(csm).mac_list), msg, tail);
+                mlacp_mac_table_add(csm, msg);
 
                 /*ICCPD_LOG_DEBUG(__FUNCTION__, "MAC-list enqueue: %s, add %s vlan-id %d",
                                 mac_msg->ifname, mac_msg->mac_str, mac_msg->vid);*/
@@ -1824,9 +2299,7 @@ void do_mac_update_from_syncd(char mac_str[ETHER_ADDR_STR_LEN], uint16_t vid, ch
                                     mac_info->ifname, mac_info->mac_str, mac_info->vid);
 
                     /*If peer link is down, del the mac*/
-                    TAILQ_REMOVE(&(MLACP(csm).mac_list), msg, tail);
-                    free(msg->buf);
-                    free(msg);
+                    mlacp_mac_table_del(csm, msg);
                 }
                 else if (csm->peer_link_if && csm->peer_link_if->state != PORT_STATE_DOWN)
                 {
@@ -1849,91 +2322,332 @@ void do_mac_update_from_syncd(char mac_str[ETHER_ADDR_STR_LEN], uint16_t vid, ch
                                 mac_info->ifname, mac_info->mac_str, mac_info->vid);
 
                 /*If local and peer both aged, del the mac (local orphan mac is here)*/
-                TAILQ_REMOVE(&(MLACP(csm).mac_list), msg, tail);
-                free(msg->buf);
-                free(msg);
+                mlacp_mac_table_del(csm, msg);
             }
             else
             {
                 ICCPD_LOG_NOTICE(__FUNCTION__, "Recv MAC del msg: %s, del %s vlan-id %d, peer is not age, add back to chip",
                                 mac_info->ifname, mac_info->mac_str, mac_info->vid);
 
-                mac_info->fdb_type = MAC_TYPE_DYNAMIC;
+                mac_info->fdb_type = MAC_TYPE_DYNAMIC;
+
+                if (from_mclag_intf && lif_po && lif_po->state == PORT_STATE_DOWN)
+                {
+                    /*If local if is down, redirect the mac to peer-link*/
+                    if (strlen(csm->peer_itf_name) != 0)
+                    {
+                        memcpy(&mac_info->ifname, csm->peer_itf_name, IFNAMSIZ);
+
+                        if (csm->peer_link_if && csm->peer_link_if->state == PORT_STATE_UP)
+                        {
+                            add_mac_to_chip(mac_info, MAC_TYPE_DYNAMIC);
+                            ICCPD_LOG_NOTICE(__FUNCTION__, "Recv MAC del msg: %s(down), del %s vlan-id %d, redirect to peer-link",
+                                            mac_info->ifname, mac_info->mac_str, mac_info->vid);
+                        }
+                    }
+
+                    return;
+                }
+
+                /*If local is aged but peer is not aged, Send mac add message to mclagsyncd*/
+                /*it is from_mclag_intf and port state is up, local orphan mac can not be here*/
+                /* Find local itf*/
+                if (!(mac_lif = local_if_find_by_name(mac_info->ifname)))
+                    return;
+                if (mac_lif->state == PORT_STATE_UP)
+                    add_mac_to_chip(mac_info, MAC_TYPE_DYNAMIC);
+            }
+        }
+    }
+
+    return;
+}
+
+/* Local MACs of the table are confirmed by the entries added while the
+ * snapshot is received, they get the generation of the snapshot*/
+static void iccp_fdb_snapshot_begin(struct System *sys)
+{
+    sys->fdb_snapshot = 1;
+    sys->fdb_resubscribing = 0;
+    sys->fdb_gen++;
+    sys->fdb_sub_stats.snapshots++;
+
+    return;
+}
+
+/* Local MACs not in the snapshot were deleted while the deltas were lost.
+ * Restored MACs not confirmed yet are left to the checkpoint sweep*/
+static void iccp_fdb_snapshot_end(struct System *sys)
+{
+    struct CSM *csm = LIST_FIRST(&(sys->csm_list));
+    struct Msg *msg = NULL;
+    struct Msg *msg_next = NULL;
+    struct MACMsg mac_info;
+
+    sys->fdb_snapshot = 0;
+    if (!sys->fdb_subscribed)
+        ICCPD_LOG_NOTICE(__FUNCTION__, "FDB changes are pushed by mclagsyncd, stop polling");
+    sys->fdb_subscribed = 1;
+
+    if (csm == NULL)
+        return;
+
+    for (msg = TAILQ_FIRST(&(MLACP(csm).mac_list)); msg; msg = msg_next)
+    {
+        msg_next = TAILQ_NEXT(msg, tail);
+        memcpy(&mac_info, msg->buf, sizeof(struct MACMsg));
+        if (msg->fdb_gen == sys->fdb_gen || msg->stale || (mac_info.age_flag & MAC_AGE_LOCAL))
+            continue;
+
+        sys->fdb_sub_stats.reconciled++;
+        do_mac_update_from_syncd(mac_info.mac_str, mac_info.vid,
+                                 mac_info.origin_ifname[0] ? mac_info.origin_ifname : mac_info.ifname,
+                                 mac_info.fdb_type, MAC_SYNC_DEL);
+    }
+
+    return;
+}
+
+static void iccp_fdb_delta_handler(struct System *sys, struct mclag_fdb_delta_hdr *delta, char *entries)
+{
+    struct CSM *csm = LIST_FIRST(&(sys->csm_list));
+    struct mclag_fdb_info *mac_info;
+    struct Msg *msg = NULL;
+    int i;
+
+    if ((delta->flags & MCLAG_FDB_DELTA_SNAPSHOT) && !sys->fdb_snapshot)
+    {
+        iccp_fdb_snapshot_begin(sys);
+    }
+    else if ((sys->fdb_subscribed || sys->fdb_snapshot) && delta->seq != sys->fdb_seq + 1)
+    {
+        /*Lost msgs, the entries are applied and the snapshot fixes the rest*/
+        sys->fdb_sub_stats.gaps++;
+        ICCPD_LOG_WARN(__FUNCTION__, "FDB delta seq %u after %u, ask a snapshot", delta->seq, sys->fdb_seq);
+        if (!sys->fdb_resubscribing)
+        {
+            sys->fdb_resubscribing = 1;
+            iccp_fdb_subscribe(sys);
+        }
+    }
+
+    sys->fdb_seq = delta->seq;
+    sys->fdb_sub_stats.deltas++;
+    sys->fdb_sub_stats.delta_entries += delta->count;
+    if (delta->flags & MCLAG_FDB_DELTA_SNAPSHOT)
+        sys->fdb_sub_stats.snapshot_entries += delta->count;
+
+    for (i = 0; i < delta->count; i++)
+    {
+        mac_info = (struct mclag_fdb_info *)&entries[i * sizeof(struct mclag_fdb_info)];
+        do_mac_update_from_syncd(mac_info->mac, mac_info->vid, mac_info->port_name, mac_info->type, mac_info->op_type);
+
+        /*MACs of mclagsyncd are kept in the first CSM*/
+        if (sys->fdb_snapshot && csm && mac_info->op_type == MAC_SYNC_ADD
+            && (msg = mlacp_mac_table_find(csm, mac_info->mac, mac_info->vid)) != NULL)
+            msg->fdb_gen = sys->fdb_gen;
+    }
+
+    if (delta->flags & MCLAG_FDB_DELTA_SNAPSHOT_END)
+        iccp_fdb_snapshot_end(sys);
+
+    /*Send the MACs to the peer in this loop, not on the next FSM tick*/
+    if (delta->count > 0)
+        scheduler_fsm_kick();
+
+    return;
+}
+
+/* Dispatch the complete msgs in the receive buffer, return the bytes consumed*/
+static int iccp_syncd_rx_dispatch(struct System *sys)
+{
+    char *msg_buf = sys->syncd_rx_buf;
+    struct IccpSyncdHDr *msg_hdr;
+    struct mclag_fdb_info * mac_info;
+    struct mclag_fdb_delta_hdr *delta;
+    uint32_t pos = 0;
+    int count = 0;
+    int i = 0;
+
+    while (sys->syncd_rx_len - pos >= sizeof(struct IccpSyncdHDr))
+    {
+        msg_hdr = (struct IccpSyncdHDr *)&msg_buf[pos];
+        if (msg_hdr->ver != 1
+            || (msg_hdr->type != MCLAG_SYNCD_MSG_TYPE_FDB_OPERATION && msg_hdr->type != MCLAG_SYNCD_MSG_TYPE_FDB_DELTA)
+            || msg_hdr->len < sizeof(struct IccpSyncdHDr))
+        {
+            ICCPD_LOG_ERR(__FUNCTION__, "msg version %d, type %d or len %d wrong!!!!! ",
+                          msg_hdr->ver, msg_hdr->type, msg_hdr->len);
+            return MCLAG_ERROR;
+        }
+
+        /*Partial msg, wait for the rest*/
+        if (sys->syncd_rx_len - pos < msg_hdr->len)
+            break;
+
+        iccp_capture_write(ICCP_CAPTURE_SYNCD_RX, -1, msg_hdr, msg_hdr->len);
+
+        if (msg_hdr->type == MCLAG_SYNCD_MSG_TYPE_FDB_DELTA)
+        {
+            delta = (struct mclag_fdb_delta_hdr *)&msg_buf[pos + sizeof(struct IccpSyncdHDr)];
+            if (msg_hdr->len < sizeof(struct IccpSyncdHDr) + sizeof(struct mclag_fdb_delta_hdr)
+                || msg_hdr->len < sizeof(struct IccpSyncdHDr) + sizeof(struct mclag_fdb_delta_hdr)
+                   + delta->count * sizeof(struct mclag_fdb_info))
+            {
+                ICCPD_LOG_ERR(__FUNCTION__, "FDB delta msg len %d too short", msg_hdr->len);
+                return MCLAG_ERROR;
+            }
+
+            iccp_fdb_delta_handler(sys, delta, (char *)(delta + 1));
+            pos += msg_hdr->len;
+            continue;
+        }
+
+        count = ( msg_hdr->len - sizeof(struct IccpSyncdHDr )) / sizeof(struct mclag_fdb_info);
+        ICCPD_LOG_DEBUG(__FUNCTION__, "recv msg fdb count %d ", count);
+
+        for (i = 0; i < count; i++)
+        {
+            mac_info = (struct mclag_fdb_info *)&msg_buf[pos + sizeof(struct IccpSyncdHDr ) + i * sizeof(struct mclag_fdb_info)];
+            /*ICCPD_LOG_DEBUG(__FUNCTION__, "recv msg fdb count %d vid %d mac %s port %s  optype  %s ", i, mac_info->vid, mac_info->mac, mac_info->port_name, mac_info->op_type == MAC_SYNC_ADD ? "add" : "del");*/
+            do_mac_update_from_syncd(mac_info->mac, mac_info->vid, mac_info->port_name, mac_info->type, mac_info->op_type);
+        }
+
+        pos += msg_hdr->len;
+    }
+
+    return pos;
+}
+
+/* Make sure the receive buffer can hold the pending msg*/
+static int iccp_syncd_rx_reserve(struct System *sys)
+{
+    struct IccpSyncdHDr *msg_hdr;
+    uint32_t need = SYNCD_RX_BUF_MIN_SIZE;
+    char *buf = NULL;
+
+    if (sys->syncd_rx_len >= sizeof(struct IccpSyncdHDr))
+    {
+        msg_hdr = (struct IccpSyncdHDr *)sys->syncd_rx_buf;
+        if (msg_hdr->len > need)
+            need = msg_hdr->len;
+    }
+
+    if (sys->syncd_rx_buf && sys->syncd_rx_size >= need)
+        return 0;
+
+    buf = (char*)realloc(sys->syncd_rx_buf, need);
+    if (buf == NULL)
+    {
+        ICCPD_LOG_ERR(__FUNCTION__, "Failed to grow mclagsyncd receive buffer to %u", need);
+        return MCLAG_ERROR;
+    }
+
+    sys->syncd_rx_buf = buf;
+    sys->syncd_rx_size = need;
+
+    return 0;
+}
+
+/* Dispatch the complete msgs received, keep the partial one for the next read*/
+static int iccp_syncd_rx_consume(struct System *sys)
+{
+    int pos = 0;
+
+    iccp_latency_begin(ICCP_LAT_CTX_SYNCD, iccp_latency_now_usec());
+    pos = iccp_syncd_rx_dispatch(sys);
+    iccp_latency_end();
+    if (pos < 0)
+    {
+        /*Lost the msg boundary, drop what is buffered*/
+        sys->syncd_rx_len = 0;
+        return MCLAG_ERROR;
+    }
+
+    /*Keep the partial msg at the head of the buffer*/
+    if (pos > 0)
+    {
+        sys->syncd_rx_len -= pos;
+        if (sys->syncd_rx_len > 0)
+            memmove(sys->syncd_rx_buf, sys->syncd_rx_buf + pos, sys->syncd_rx_len);
+    }
+
+    return 0;
+}
+
+/* Handle msgs from a capture file as if read from mclagsyncd*/
+int iccp_syncd_rx_feed(struct System *sys, const char *buf, uint32_t len)
+{
+    uint32_t copy;
 
-                if (from_mclag_intf && lif_po && lif_po->state == PORT_STATE_DOWN)
-                {
-                    /*If local if is down, redirect the mac to peer-link*/
-                    if (strlen(csm->peer_itf_name) != 0)
-                    {
-                        memcpy(&mac_info->ifname, csm->peer_itf_name, IFNAMSIZ);
+    if (sys == NULL)
+        return MCLAG_ERROR;
 
-                        if (csm->peer_link_if && csm->peer_link_if->state == PORT_STATE_UP)
-                        {
-                            add_mac_to_chip(mac_info, MAC_TYPE_DYNAMIC);
-                            ICCPD_LOG_NOTICE(__FUNCTION__, "Recv MAC del msg: %s(down), del %s vlan-id %d, redirect to peer-link",
-                                            mac_info->ifname, mac_info->mac_str, mac_info->vid);
-                        }
-                    }
+    while (len > 0)
+    {
+        if (iccp_syncd_rx_reserve(sys) < 0)
+            return MCLAG_ERROR;
 
-                    return;
-                }
+        copy = sys->syncd_rx_size - sys->syncd_rx_len;
+        if (copy > len)
+            copy = len;
 
-                /*If local is aged but peer is not aged, Send mac add message to mclagsyncd*/
-                /*it is from_mclag_intf and port state is up, local orphan mac can not be here*/
-                /* Find local itf*/
-                if (!(mac_lif = local_if_find_by_name(mac_info->ifname)))
-                    return;
-                if (mac_lif->state == PORT_STATE_UP)
-                    add_mac_to_chip(mac_info, MAC_TYPE_DYNAMIC);
-            }
-        }
+        memcpy(sys->syncd_rx_buf + sys->syncd_rx_len, buf, copy);
+        sys->syncd_rx_len += copy;
+        buf += copy;
+        len -= copy;
+
+        if (iccp_syncd_rx_consume(sys) < 0)
+            return MCLAG_ERROR;
     }
 
-    return;
+    return 0;
 }
 
 int iccp_receive_fdb_handler_from_syncd(struct System *sys)
 {
-    char *msg_buf = g_csm_buf;
-    struct IccpSyncdHDr *msg_hdr;
-    struct mclag_fdb_info * mac_info;
-    size_t pos = 0;
-    int count = 0;
-    int i = 0;
+    int budget = SYNCD_RX_READ_BUDGET;
     int n = 0;
 
     if (sys == NULL)
         return MCLAG_ERROR;
 
-    memset(msg_buf, 0, CSM_BUFFER_SIZE);
-
-    n = read(sys->sync_fd, msg_buf, CSM_BUFFER_SIZE);
-    if (n <= 0)
+    while (budget-- > 0)
     {
-        ICCPD_LOG_ERR(__FUNCTION__, "read msg error!!!" );
-        return MCLAG_ERROR;
-    }
+        if (iccp_syncd_rx_reserve(sys) < 0)
+            return MCLAG_ERROR;
 
-    while (pos < n)
-    {
-        msg_hdr = (struct IccpSyncdHDr *)&msg_buf[pos];
-        if (msg_hdr->ver != 1 || msg_hdr->type != MCLAG_SYNCD_MSG_TYPE_FDB_OPERATION )
+        n = read(sys->sync_fd, sys->syncd_rx_buf + sys->syncd_rx_len,
+                 sys->syncd_rx_size - sys->syncd_rx_len);
+        if (n < 0)
         {
-            ICCPD_LOG_ERR(__FUNCTION__, "msg version or type wrong!!!!! ");
+            if (errno == EINTR)
+                continue;
+
+            if (errno == EAGAIN || errno == EWOULDBLOCK)
+                break;
+
+            ICCPD_LOG_ERR(__FUNCTION__, "read msg error: %s", strerror(errno));
+            syncd_info_close();
             return MCLAG_ERROR;
         }
 
-        count = ( msg_hdr->len - sizeof(struct IccpSyncdHDr )) / sizeof(struct mclag_fdb_info);
-        ICCPD_LOG_DEBUG(__FUNCTION__, "recv msg fdb count %d ", count);
-
-        for (i = 0; i < count; i++)
+        if (n == 0)
         {
-            mac_info = (struct mclag_fdb_info *)&msg_buf[pos + sizeof(struct IccpSyncdHDr ) + i * sizeof(struct mclag_fdb_info)];
-            /*ICCPD_LOG_DEBUG(__FUNCTION__, "recv msg fdb count %d vid %d mac %s port %s  optype  %s ", i, mac_info->vid, mac_info->mac, mac_info->port_name, mac_info->op_type == MAC_SYNC_ADD ? "add" : "del");*/
-            do_mac_update_from_syncd(mac_info->mac, mac_info->vid, mac_info->port_name, mac_info->type, mac_info->op_type);
+            ICCPD_LOG_WARN(__FUNCTION__, "mclagsyncd closed the connection");
+            syncd_info_close();
+            return MCLAG_ERROR;
         }
 
-        pos += msg_hdr->len;
+        sys->syncd_rx_len += n;
+
+        /*The next read may start inside a msg, reconnect for a clean boundary*/
+        if (iccp_syncd_rx_consume(sys) < 0)
+        {
+            ICCPD_LOG_ERR(__FUNCTION__, "mclagsyncd msg framing error, close the connection");
+            syncd_info_close();
+            return MCLAG_ERROR;
+        }
     }
 
     return 0;
@@ -1963,6 +2677,18 @@ char * mclagd_ctl_cmd_str(int req_type)
 
         case INFO_TYPE_CONFIG_LOGLEVEL:
             return "config loglevel";
+
+        case INFO_TYPE_DUMP_COUNTERS:
+            return "dump counters";
+
+        case INFO_TYPE_DUMP_LATENCY:
+            return "dump latency";
+
+        case INFO_TYPE_CLEAR_LATENCY:
+            return "clear latency";
+
+        case INFO_TYPE_DUMP_LOG_RING:
+            return "dump logring";
         default:
             break;
     }
@@ -2133,23 +2859,244 @@ void mclagd_ctl_handle_dump_state(int client_fd, int mclag_id)
     return;
 }
 
-void mclagd_ctl_handle_dump_arp(int client_fd, int mclag_id)
+/* MAC/ARP/ND dumps are streamed, one chunk per event loop round*/
+#define MCLAGD_DUMP_SESSION_MAX 8
+
+struct MclagdDumpSession
+{
+    LIST_ENTRY(MclagdDumpSession) next;
+    int fd;
+    int info_type;
+    int mclag_id;
+    struct mclagdctl_dump_filter filter;
+    struct IccpDumpCursor cursor;
+    /* Unsent part of the current frame*/
+    int tx_off;
+    int tx_len;
+    int done;
+};
+
+static LIST_HEAD(mclagd_dump_session_list, MclagdDumpSession) mclagd_dump_sessions =
+    LIST_HEAD_INITIALIZER(mclagd_dump_sessions);
+static int mclagd_dump_session_num = 0;
+
+static void mclagd_ctl_reply_result(int client_fd, int info_type, int exec_result)
+{
+    char buf[sizeof(struct mclagd_reply_hdr)+sizeof(int)];
+    struct mclagd_reply_hdr *hd = NULL;
+    int len_tmp = 0;
+
+    len_tmp = sizeof(struct mclagd_reply_hdr);
+    memcpy(buf, &len_tmp, sizeof(int));
+    hd = (struct mclagd_reply_hdr *)(buf + sizeof(int));
+    hd->exec_result = exec_result;
+    hd->info_type = info_type;
+    hd->data_len = 0;
+    mclagd_ctl_sock_write(client_fd, buf, MCLAGD_REPLY_INFO_HDR);
+
+    return;
+}
+
+static void mclagd_ctl_dump_close(struct MclagdDumpSession *session)
+{
+    struct System *sys = NULL;
+    struct epoll_event event;
+
+    if ((sys = system_get_instance()) != NULL)
+        epoll_ctl(sys->epoll_fd, EPOLL_CTL_DEL, session->fd, &event);
+
+    close(session->fd);
+    iccp_dump_cursor_finalize(&session->cursor);
+    LIST_REMOVE(session, next);
+    mclagd_dump_session_num--;
+    free(session);
+
+    return;
+}
+
+/* Build the next frame, the last one has EXEC_TYPE_SUCCESS or an error*/
+static void mclagd_ctl_dump_fill(struct MclagdDumpSession *session)
+{
+    struct IccpDumpCursor *cursor = &session->cursor;
+    struct mclagd_reply_hdr *hd = NULL;
+    int entry_size = 0;
+    int len_tmp = 0;
+    int ret = 0;
+
+    ret = iccp_table_dump_chunk(session->info_type, session->mclag_id, &session->filter, cursor);
+
+    hd = (struct mclagd_reply_hdr *)(cursor->buf + sizeof(int));
+    hd->info_type = session->info_type;
+    hd->data_len = 0;
+
+    if (ret < 0)
+    {
+        hd->exec_result = ret;
+        session->done = 1;
+    }
+    else if (session->filter.flags & MCLAGDCTL_FILTER_COUNT_ONLY)
+    {
+        /* Only the final frame carries data, the matched count*/
+        hd->exec_result = ret ? EXEC_TYPE_SUCCESS : EXEC_TYPE_MORE;
+        if (ret)
+        {
+            hd->data_len = sizeof(unsigned int);
+            memcpy(cursor->buf + MCLAGD_REPLY_INFO_HDR, &cursor->matched, sizeof(unsigned int));
+        }
+        session->done = ret;
+    }
+    else
+    {
+        if (session->info_type == INFO_TYPE_DUMP_MAC)
+            entry_size = sizeof(struct mclagd_mac_msg);
+        else if (session->info_type == INFO_TYPE_DUMP_ARP)
+            entry_size = sizeof(struct mclagd_arp_msg);
+        else
+            entry_size = sizeof(struct mclagd_ndisc_msg);
+
+        hd->exec_result = ret ? EXEC_TYPE_SUCCESS : EXEC_TYPE_MORE;
+        hd->data_len = cursor->num * entry_size;
+        session->done = ret;
+    }
+
+    len_tmp = hd->data_len + sizeof(struct mclagd_reply_hdr);
+    memcpy(cursor->buf, &len_tmp, sizeof(int));
+    session->tx_off = 0;
+    session->tx_len = MCLAGD_REPLY_INFO_HDR + hd->data_len;
+
+    return;
+}
+
+/* The client fd is kept by the dump session, return 1 on success*/
+static int mclagd_ctl_dump_start(int client_fd, struct mclagdctl_req_hdr *req)
+{
+    struct System *sys = NULL;
+    struct MclagdDumpSession *session = NULL;
+    struct epoll_event event;
+
+    if ((sys = system_get_instance()) == NULL)
+    {
+        mclagd_ctl_reply_result(client_fd, req->info_type, EXEC_TYPE_NO_EXIST_SYS);
+        return 0;
+    }
+
+    if (mclagd_dump_session_num >= MCLAGD_DUMP_SESSION_MAX)
+    {
+        ICCPD_LOG_WARN(__FUNCTION__, "Too many mclagdctl dumps in progress");
+        mclagd_ctl_reply_result(client_fd, req->info_type, EXEC_TYPE_FAILED);
+        return 0;
+    }
+
+    session = (struct MclagdDumpSession *)calloc(1, sizeof(struct MclagdDumpSession));
+    if (!session || iccp_dump_cursor_init(&session->cursor, req->info_type) < 0)
+    {
+        if (session)
+            free(session);
+        mclagd_ctl_reply_result(client_fd, req->info_type, EXEC_TYPE_FAILED);
+        return 0;
+    }
+
+    session->fd = client_fd;
+    session->info_type = req->info_type;
+    session->mclag_id = req->mclag_id;
+    memcpy(&session->filter, &req->filter, sizeof(struct mclagdctl_dump_filter));
+    session->filter.ifname[MCLAGDCTL_MAX_L_PORT_NANE - 1] = '\0';
+    session->filter.mac_prefix[ETHER_ADDR_STR_LEN - 1] = '\0';
+
+    fcntl(client_fd, F_SETFL, fcntl(client_fd, F_GETFL, 0) | O_NONBLOCK);
+
+    memset(&event, 0, sizeof(event));
+    event.data.fd = client_fd;
+    event.events = EPOLLOUT;
+    if (epoll_ctl(sys->epoll_fd, EPOLL_CTL_ADD, client_fd, &event) < 0)
+    {
+        ICCPD_LOG_WARN(__FUNCTION__, "Failed to add mclagdctl fd %d: %s", client_fd, strerror(errno));
+        iccp_dump_cursor_finalize(&session->cursor);
+        free(session);
+        return 0;
+    }
+
+    LIST_INSERT_HEAD(&mclagd_dump_sessions, session, next);
+    mclagd_dump_session_num++;
+
+    return 1;
+}
+
+/* Send one frame of a dump, return MCLAG_ERROR if fd is not a dump session*/
+int mclagd_ctl_dump_handler(int fd, uint32_t events)
+{
+    struct MclagdDumpSession *session = NULL;
+    int ret = 0;
+
+    LIST_FOREACH(session, &mclagd_dump_sessions, next)
+    {
+        if (session->fd == fd)
+            break;
+    }
+
+    if (!session)
+        return MCLAG_ERROR;
+
+    if (events & (EPOLLERR | EPOLLHUP))
+    {
+        mclagd_ctl_dump_close(session);
+        return 0;
+    }
+
+    if (session->tx_off == session->tx_len)
+    {
+        if (session->done)
+        {
+            mclagd_ctl_dump_close(session);
+            return 0;
+        }
+
+        mclagd_ctl_dump_fill(session);
+    }
+
+    while (session->tx_off < session->tx_len)
+    {
+        ret = write(fd, session->cursor.buf + session->tx_off, session->tx_len - session->tx_off);
+        if (ret < 0)
+        {
+            if (errno == EINTR)
+                continue;
+
+            /* Wait for EPOLLOUT*/
+            if (errno == EAGAIN || errno == EWOULDBLOCK)
+                return 0;
+
+            mclagd_ctl_dump_close(session);
+            return 0;
+        }
+
+        session->tx_off += ret;
+    }
+
+    /* Yield after each frame, the next one goes in the next loop*/
+    if (session->done)
+        mclagd_ctl_dump_close(session);
+
+    return 0;
+}
+
+void mclagd_ctl_handle_dump_local_portlist(int client_fd, int mclag_id)
 {
     char * Pbuf = NULL;
     char buf[512] = { 0 };
-    int arp_num = 0;
+    int lif_num = 0;;
     int ret = 0;
     struct mclagd_reply_hdr *hd = NULL;
     int len_tmp = 0;
 
-    ret = iccp_arp_dump(&Pbuf, &arp_num, mclag_id);
+    ret = iccp_local_if_dump(&Pbuf, &lif_num, mclag_id);
     if (ret != EXEC_TYPE_SUCCESS)
     {
         len_tmp = sizeof(struct mclagd_reply_hdr);
         memcpy(buf, &len_tmp, sizeof(int));
         hd = (struct mclagd_reply_hdr *)(buf + sizeof(int));
         hd->exec_result = ret;
-        hd->info_type = INFO_TYPE_DUMP_ARP;
+        hd->info_type = INFO_TYPE_DUMP_LOCAL_PORTLIST;
         hd->data_len = 0;
         mclagd_ctl_sock_write(client_fd, buf, MCLAGD_REPLY_INFO_HDR);
 
@@ -2161,8 +3108,8 @@ void mclagd_ctl_handle_dump_arp(int client_fd, int mclag_id)
 
     hd = (struct mclagd_reply_hdr *)(Pbuf + sizeof(int));
     hd->exec_result = EXEC_TYPE_SUCCESS;
-    hd->info_type = INFO_TYPE_DUMP_ARP;
-    hd->data_len = arp_num * sizeof(struct mclagd_arp_msg);
+    hd->info_type = INFO_TYPE_DUMP_LOCAL_PORTLIST;
+    hd->data_len = lif_num * sizeof(struct mclagd_local_if);
     len_tmp = (hd->data_len + sizeof(struct mclagd_reply_hdr));
     memcpy(Pbuf, &len_tmp, sizeof(int));
     mclagd_ctl_sock_write(client_fd, Pbuf, MCLAGD_REPLY_INFO_HDR + hd->data_len);
@@ -2173,23 +3120,23 @@ void mclagd_ctl_handle_dump_arp(int client_fd, int mclag_id)
     return;
 }
 
-void mclagd_ctl_handle_dump_ndisc(int client_fd, int mclag_id)
+void mclagd_ctl_handle_dump_peer_portlist(int client_fd, int mclag_id)
 {
-    char *Pbuf = NULL;
+    char * Pbuf = NULL;
     char buf[512] = { 0 };
-    int ndisc_num = 0;
+    int pif_num = 0;
     int ret = 0;
     struct mclagd_reply_hdr *hd = NULL;
     int len_tmp = 0;
 
-    ret = iccp_ndisc_dump(&Pbuf, &ndisc_num, mclag_id);
+    ret = iccp_peer_if_dump(&Pbuf, &pif_num, mclag_id);
     if (ret != EXEC_TYPE_SUCCESS)
     {
         len_tmp = sizeof(struct mclagd_reply_hdr);
         memcpy(buf, &len_tmp, sizeof(int));
         hd = (struct mclagd_reply_hdr *)(buf + sizeof(int));
         hd->exec_result = ret;
-        hd->info_type = INFO_TYPE_DUMP_NDISC;
+        hd->info_type = INFO_TYPE_DUMP_PEER_PORTLIST;
         hd->data_len = 0;
         mclagd_ctl_sock_write(client_fd, buf, MCLAGD_REPLY_INFO_HDR);
 
@@ -2201,8 +3148,8 @@ void mclagd_ctl_handle_dump_ndisc(int client_fd, int mclag_id)
 
     hd = (struct mclagd_reply_hdr *)(Pbuf + sizeof(int));
     hd->exec_result = EXEC_TYPE_SUCCESS;
-    hd->info_type = INFO_TYPE_DUMP_NDISC;
-    hd->data_len = ndisc_num * sizeof(struct mclagd_ndisc_msg);
+    hd->info_type = INFO_TYPE_DUMP_PEER_PORTLIST;
+    hd->data_len = pif_num * sizeof(struct mclagd_peer_if);
     len_tmp = (hd->data_len + sizeof(struct mclagd_reply_hdr));
     memcpy(Pbuf, &len_tmp, sizeof(int));
     mclagd_ctl_sock_write(client_fd, Pbuf, MCLAGD_REPLY_INFO_HDR + hd->data_len);
@@ -2213,23 +3160,23 @@ void mclagd_ctl_handle_dump_ndisc(int client_fd, int mclag_id)
     return;
 }
 
-void mclagd_ctl_handle_dump_mac(int client_fd, int mclag_id)
+void mclagd_ctl_handle_dump_counters(int client_fd, int mclag_id)
 {
     char * Pbuf = NULL;
     char buf[512] = { 0 };
-    int mac_num = 0;
+    int session_num = 0;
     int ret = 0;
     struct mclagd_reply_hdr *hd = NULL;
     int len_tmp = 0;
 
-    ret = iccp_mac_dump(&Pbuf, &mac_num, mclag_id);
+    ret = iccp_counters_dump(&Pbuf, &session_num, mclag_id);
     if (ret != EXEC_TYPE_SUCCESS)
     {
         len_tmp = sizeof(struct mclagd_reply_hdr);
         memcpy(buf, &len_tmp, sizeof(int));
         hd = (struct mclagd_reply_hdr *)(buf + sizeof(int));
         hd->exec_result = ret;
-        hd->info_type = INFO_TYPE_DUMP_MAC;
+        hd->info_type = INFO_TYPE_DUMP_COUNTERS;
         hd->data_len = 0;
         mclagd_ctl_sock_write(client_fd, buf, MCLAGD_REPLY_INFO_HDR);
 
@@ -2241,12 +3188,10 @@ void mclagd_ctl_handle_dump_mac(int client_fd, int mclag_id)
 
     hd = (struct mclagd_reply_hdr *)(Pbuf + sizeof(int));
     hd->exec_result = EXEC_TYPE_SUCCESS;
-    hd->info_type = INFO_TYPE_DUMP_MAC;
-    hd->data_len = mac_num * sizeof(struct mclagd_mac_msg);
-
+    hd->info_type = INFO_TYPE_DUMP_COUNTERS;
+    hd->data_len = sizeof(struct mclagd_counters) + session_num * sizeof(struct mclagd_session_counters);
     len_tmp = (hd->data_len + sizeof(struct mclagd_reply_hdr));
     memcpy(Pbuf, &len_tmp, sizeof(int));
-
     mclagd_ctl_sock_write(client_fd, Pbuf, MCLAGD_REPLY_INFO_HDR + hd->data_len);
 
     if (Pbuf)
@@ -2255,23 +3200,23 @@ void mclagd_ctl_handle_dump_mac(int client_fd, int mclag_id)
     return;
 }
 
-void mclagd_ctl_handle_dump_local_portlist(int client_fd, int mclag_id)
+void mclagd_ctl_handle_dump_latency(int client_fd)
 {
     char * Pbuf = NULL;
     char buf[512] = { 0 };
-    int lif_num = 0;;
+    int tlv_num = 0;
     int ret = 0;
     struct mclagd_reply_hdr *hd = NULL;
     int len_tmp = 0;
 
-    ret = iccp_local_if_dump(&Pbuf, &lif_num, mclag_id);
+    ret = iccp_latency_dump(&Pbuf, &tlv_num);
     if (ret != EXEC_TYPE_SUCCESS)
     {
         len_tmp = sizeof(struct mclagd_reply_hdr);
         memcpy(buf, &len_tmp, sizeof(int));
         hd = (struct mclagd_reply_hdr *)(buf + sizeof(int));
         hd->exec_result = ret;
-        hd->info_type = INFO_TYPE_DUMP_LOCAL_PORTLIST;
+        hd->info_type = INFO_TYPE_DUMP_LATENCY;
         hd->data_len = 0;
         mclagd_ctl_sock_write(client_fd, buf, MCLAGD_REPLY_INFO_HDR);
 
@@ -2283,8 +3228,8 @@ void mclagd_ctl_handle_dump_local_portlist(int client_fd, int mclag_id)
 
     hd = (struct mclagd_reply_hdr *)(Pbuf + sizeof(int));
     hd->exec_result = EXEC_TYPE_SUCCESS;
-    hd->info_type = INFO_TYPE_DUMP_LOCAL_PORTLIST;
-    hd->data_len = lif_num * sizeof(struct mclagd_local_if);
+    hd->info_type = INFO_TYPE_DUMP_LATENCY;
+    hd->data_len = sizeof(struct mclagd_latency) + tlv_num * sizeof(struct mclagd_tlv_counters);
     len_tmp = (hd->data_len + sizeof(struct mclagd_reply_hdr));
     memcpy(Pbuf, &len_tmp, sizeof(int));
     mclagd_ctl_sock_write(client_fd, Pbuf, MCLAGD_REPLY_INFO_HDR + hd->data_len);
@@ -2295,42 +3240,64 @@ void mclagd_ctl_handle_dump_local_portlist(int client_fd, int mclag_id)
     return;
 }
 
-void mclagd_ctl_handle_dump_peer_portlist(int client_fd, int mclag_id)
+void mclagd_ctl_handle_clear_latency(int client_fd)
 {
-    char * Pbuf = NULL;
-    char buf[512] = { 0 };
-    int pif_num = 0;
-    int ret = 0;
+    char buf[sizeof(struct mclagd_reply_hdr)+sizeof(int)];
     struct mclagd_reply_hdr *hd = NULL;
     int len_tmp = 0;
 
-    ret = iccp_peer_if_dump(&Pbuf, &pif_num, mclag_id);
-    if (ret != EXEC_TYPE_SUCCESS)
+    iccp_latency_reset();
+
+    len_tmp = sizeof(struct mclagd_reply_hdr);
+    memcpy(buf, &len_tmp, sizeof(int));
+    hd = (struct mclagd_reply_hdr *)(buf + sizeof(int));
+    hd->exec_result = EXEC_TYPE_SUCCESS;
+    hd->info_type = INFO_TYPE_CLEAR_LATENCY;
+    hd->data_len = 0;
+    mclagd_ctl_sock_write(client_fd, buf, MCLAGD_REPLY_INFO_HDR);
+
+    return;
+}
+
+void mclagd_ctl_handle_dump_log_ring(int client_fd)
+{
+    char buf[sizeof(struct mclagd_reply_hdr) + sizeof(int) + sizeof(struct mclagd_log_ring)];
+    struct mclagd_reply_hdr *hd = NULL;
+    struct mclagd_log_ring *ring = NULL;
+    struct LogStats stats;
+    int len_tmp = 0;
+    int records = 0;
+
+    memset(buf, 0, sizeof(buf));
+    hd = (struct mclagd_reply_hdr *)(buf + sizeof(int));
+    hd->info_type = INFO_TYPE_DUMP_LOG_RING;
+
+    records = log_ring_dump(LOG_RING_FILE);
+    if (records < 0)
     {
+        ICCPD_LOG_WARN(__FUNCTION__, "Failed to dump log ring to %s", LOG_RING_FILE);
         len_tmp = sizeof(struct mclagd_reply_hdr);
         memcpy(buf, &len_tmp, sizeof(int));
-        hd = (struct mclagd_reply_hdr *)(buf + sizeof(int));
-        hd->exec_result = ret;
-        hd->info_type = INFO_TYPE_DUMP_PEER_PORTLIST;
+        hd->exec_result = EXEC_TYPE_FAILED;
         hd->data_len = 0;
         mclagd_ctl_sock_write(client_fd, buf, MCLAGD_REPLY_INFO_HDR);
 
-        if (Pbuf)
-            free(Pbuf);
-
         return;
     }
 
-    hd = (struct mclagd_reply_hdr *)(Pbuf + sizeof(int));
+    log_get_stats(&stats);
+    ring = (struct mclagd_log_ring *)(buf + MCLAGD_REPLY_INFO_HDR);
+    ring->written = stats.written;
+    ring->dropped = stats.dropped;
+    ring->suppressed = stats.suppressed;
+    ring->records = records;
+    snprintf(ring->path, MCLAGDCTL_LOG_RING_PATH_LEN, "%s", LOG_RING_FILE);
+
     hd->exec_result = EXEC_TYPE_SUCCESS;
-    hd->info_type = INFO_TYPE_DUMP_PEER_PORTLIST;
-    hd->data_len = pif_num * sizeof(struct mclagd_peer_if);
+    hd->data_len = sizeof(struct mclagd_log_ring);
     len_tmp = (hd->data_len + sizeof(struct mclagd_reply_hdr));
-    memcpy(Pbuf, &len_tmp, sizeof(int));
-    mclagd_ctl_sock_write(client_fd, Pbuf, MCLAGD_REPLY_INFO_HDR + hd->data_len);
-
-    if (Pbuf)
-        free(Pbuf);
+    memcpy(buf, &len_tmp, sizeof(int));
+    mclagd_ctl_sock_write(client_fd, buf, MCLAGD_REPLY_INFO_HDR + hd->data_len);
 
     return;
 }
@@ -2354,6 +3321,7 @@ void mclagd_ctl_handle_config_loglevel(int client_fd, int log_level)
     return;
 }
 
+/* Return 1 if client_fd is kept for a streamed reply, the caller closes it otherwise*/
 int mclagd_ctl_interactive_process(int client_fd)
 {
     char buf[512] = { 0 };
@@ -2380,16 +3348,9 @@ int mclagd_ctl_interactive_process(int client_fd)
             break;
 
         case INFO_TYPE_DUMP_ARP:
-            mclagd_ctl_handle_dump_arp(client_fd, req->mclag_id);
-            break;
-
         case INFO_TYPE_DUMP_NDISC:
-            mclagd_ctl_handle_dump_ndisc(client_fd, req->mclag_id);
-            break;
-
         case INFO_TYPE_DUMP_MAC:
-            mclagd_ctl_handle_dump_mac(client_fd, req->mclag_id);
-            break;
+            return mclagd_ctl_dump_start(client_fd, req);
 
         case INFO_TYPE_DUMP_LOCAL_PORTLIST:
             mclagd_ctl_handle_dump_local_portlist(client_fd, req->mclag_id);
@@ -2402,6 +3363,22 @@ int mclagd_ctl_interactive_process(int client_fd)
         case INFO_TYPE_CONFIG_LOGLEVEL:
             mclagd_ctl_handle_config_loglevel(client_fd, req->mclag_id);
             break;
+
+        case INFO_TYPE_DUMP_COUNTERS:
+            mclagd_ctl_handle_dump_counters(client_fd, req->mclag_id);
+            break;
+
+        case INFO_TYPE_DUMP_LATENCY:
+            mclagd_ctl_handle_dump_latency(client_fd);
+            break;
+
+        case INFO_TYPE_CLEAR_LATENCY:
+            mclagd_ctl_handle_clear_latency(client_fd);
+            break;
+
+        case INFO_TYPE_DUMP_LOG_RING:
+            mclagd_ctl_handle_dump_log_ring(client_fd);
+            break;
 			
         default:
             return MCLAG_ERROR;
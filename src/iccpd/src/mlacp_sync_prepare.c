@@ -150,7 +150,8 @@ int mlacp_prepare_for_sys_config(struct CSM* csm, char* buf, size_t max_buf_size
     struct System* sys = NULL;
     ICCHdr* icc_hdr = (ICCHdr*)buf;
     mLACPSysConfigTLV* tlv = (mLACPSysConfigTLV*)&buf[sizeof(ICCHdr)];
-    size_t msg_len = sizeof(ICCHdr) + sizeof(mLACPSysConfigTLV);
+    struct mLACPSysConfigCap* cap = NULL;
+    size_t msg_len = sizeof(ICCHdr) + sizeof(mLACPSysConfigTLV) + sizeof(struct mLACPSysConfigCap);
 
     if (csm == NULL)
         return MCLAG_ERROR;
@@ -177,11 +178,16 @@ int mlacp_prepare_for_sys_config(struct CSM* csm, char* buf, size_t max_buf_size
     tlv->icc_parameter.u_bit = 0;
     tlv->icc_parameter.f_bit = 0;
     tlv->icc_parameter.type = htons(TLV_T_MLACP_SYSTEM_CONFIG);
-    tlv->icc_parameter.len = htons(sizeof(mLACPSysConfigTLV) - sizeof(ICCParameter));
+    tlv->icc_parameter.len = htons(sizeof(mLACPSysConfigTLV) + sizeof(struct mLACPSysConfigCap) - sizeof(ICCParameter));
 
     memcpy(tlv->sys_id, MLACP(csm).system_id, ETHER_ADDR_LEN);
     tlv->sys_priority = htons(MLACP(csm).system_priority);
     tlv->node_id = MLACP(csm).node_id;
+
+    /* Capabilities, older peers ignore them*/
+    cap = (struct mLACPSysConfigCap*)&buf[sizeof(ICCHdr) + sizeof(mLACPSysConfigTLV)];
+    cap->capabilities = htonl(MLACP_SYSCONF_CAP_COMPACT_SYNC);
+    cap->max_pdu_size = htons(MLACP_SYNC_PDU_MAX_SIZE);
     return msg_len;
 }
 
@@ -436,6 +442,212 @@ int mlacp_prepare_for_ndisc_info(struct CSM *csm, char *buf, size_t max_buf_size
     return msg_len;
 }
 
+/*****************************************
+* Preprare Sync Interface-ID-Map TLV
+*
+* ***************************************/
+int mlacp_prepare_for_if_id_map(struct CSM* csm, char* buf, size_t max_buf_size, uint16_t if_id, const char* ifname)
+{
+    struct mLACPIfIdMapTLV* tlv = NULL;
+    size_t msg_len = 0;
+    size_t tlv_len = 0;
+    ICCHdr* icc_hdr = NULL;
+
+    if (!csm)
+        return MCLAG_ERROR;
+    if (!buf)
+        return MCLAG_ERROR;
+
+    tlv_len = sizeof(struct mLACPIfIdMapTLV) + sizeof(struct mLACPIfIdData);
+
+    if ((msg_len = sizeof(ICCHdr) + tlv_len) > max_buf_size)
+        return MCLAG_ERROR;
+
+    memset(buf, 0, msg_len);
+
+    /* ICC header */
+    icc_hdr = (ICCHdr*)buf;
+    mlacp_fill_icc_header(csm, icc_hdr, msg_len);
+
+    tlv = (struct mLACPIfIdMapTLV*)&buf[sizeof(ICCHdr)];
+    tlv->icc_parameter.u_bit = 0;
+    tlv->icc_parameter.f_bit = 0;
+    tlv->icc_parameter.type = htons(TLV_T_MLACP_IF_ID_MAP);
+    tlv->icc_parameter.len = htons(tlv_len - sizeof(ICCParameter));
+    tlv->num_of_entry = htons(1);
+
+    tlv->IfIdEntry[0].if_id = htons(if_id);
+    snprintf(tlv->IfIdEntry[0].ifname, MAX_L_PORT_NAME, "%s", ifname);
+
+    ICCPD_LOG_DEBUG(__FUNCTION__, "Send interface id %u for %s to peer", if_id, ifname);
+
+    return msg_len;
+}
+
+/*****************************************
+* Preprare Sync Compact MAC/ARP/ND-Info TLV
+*
+* Entries are appended at count, the return value is the message length
+* with the new entry, or MCLAG_ERROR if it does not fit in max_buf_size
+* ***************************************/
+static size_t mlacp_prepare_for_compact_info(struct CSM* csm, char* buf, size_t max_buf_size,
+                                             uint16_t type, size_t entry_len, int count)
+{
+    ICCParameter* icc_param = NULL;
+    size_t tlv_len = 0;
+    size_t msg_len = 0;
+
+    /* Compact TLVs share the mLACPMACCompactInfoTLV header layout*/
+    tlv_len = sizeof(struct mLACPMACCompactInfoTLV) + entry_len * (count + 1);
+
+    if ((msg_len = sizeof(ICCHdr) + tlv_len) > max_buf_size)
+        return 0;
+
+    /* ICC header is filled once per message, then only grows*/
+    if (count == 0)
+        mlacp_fill_icc_header(csm, (ICCHdr*)buf, msg_len);
+    else
+        ((ICCHdr*)buf)->ldp_hdr.msg_len = htons(msg_len - MSG_L_INCLUD_U_BIT_MSG_T_L_FIELDS);
+
+    icc_param = (ICCParameter*)&buf[sizeof(ICCHdr)];
+    icc_param->len = htons(tlv_len - sizeof(ICCParameter));
+    ((struct mLACPMACCompactInfoTLV*)icc_param)->num_of_entry = htons(count + 1);
+
+    if (count == 0)
+    {
+        icc_param->u_bit = 0;
+        icc_param->f_bit = 0;
+        icc_param->type = htons(type);
+    }
+
+    return msg_len;
+}
+
+int mlacp_prepare_for_mac_info_compact(struct CSM* csm, char* buf, size_t max_buf_size, struct MACMsg* mac_msg, uint16_t if_id, int count)
+{
+    struct mLACPMACCompactInfoTLV* tlv = NULL;
+    struct mLACPMACCompactData* MacData = NULL;
+    unsigned int mac[ETHER_ADDR_LEN];
+    size_t msg_len = 0;
+    int i;
+
+    if (!csm || !buf || !mac_msg)
+        return MCLAG_ERROR;
+
+    msg_len = mlacp_prepare_for_compact_info(csm, buf, max_buf_size, TLV_T_MLACP_MAC_INFO_COMPACT,
+                                             sizeof(struct mLACPMACCompactData), count);
+    if (msg_len == 0)
+        return MCLAG_ERROR;
+
+    tlv = (struct mLACPMACCompactInfoTLV*)&buf[sizeof(ICCHdr)];
+    MacData = &tlv->MacEntry[count];
+    MacData->type = mac_msg->op_type;
+    MacData->vid = htons(mac_msg->vid);
+    MacData->if_id = htons(if_id);
+
+    memset(mac, 0, sizeof(mac));
+    sscanf(mac_msg->mac_str, "%x:%x:%x:%x:%x:%x", &mac[0], &mac[1], &mac[2], &mac[3], &mac[4], &mac[5]);
+    for (i = 0; i < ETHER_ADDR_LEN; i++)
+        MacData->mac_addr[i] = (uint8_t)mac[i];
+
+    ICCPD_LOG_DEBUG(__FUNCTION__, "Send MAC messge to peer, port %s mac = %s, vid = %d, type = %s count %d",
+                    mac_msg->origin_ifname, mac_msg->mac_str, mac_msg->vid, mac_msg->op_type == MAC_SYNC_ADD ? "add" : "del", count);
+
+    return msg_len;
+}
+
+int mlacp_prepare_for_arp_info_compact(struct CSM* csm, char* buf, size_t max_buf_size, struct ARPMsg* arp_msg, uint16_t if_id, int count)
+{
+    struct mLACPARPCompactInfoTLV* tlv = NULL;
+    struct mLACPARPCompactData* ArpData = NULL;
+    size_t msg_len = 0;
+
+    if (!csm || !buf || !arp_msg)
+        return MCLAG_ERROR;
+
+    msg_len = mlacp_prepare_for_compact_info(csm, buf, max_buf_size, TLV_T_MLACP_ARP_INFO_COMPACT,
+                                             sizeof(struct mLACPARPCompactData), count);
+    if (msg_len == 0)
+        return MCLAG_ERROR;
+
+    tlv = (struct mLACPARPCompactInfoTLV*)&buf[sizeof(ICCHdr)];
+    ArpData = &tlv->ArpEntry[count];
+    ArpData->op_type = arp_msg->op_type;
+    ArpData->if_id = htons(if_id);
+    ArpData->ipv4_addr = arp_msg->ipv4_addr;
+    memcpy(ArpData->mac_addr, arp_msg->mac_addr, ETHER_ADDR_LEN);
+
+    ICCPD_LOG_DEBUG(__FUNCTION__, "Send ARP messge to peer, if name %s IP %s count %d",
+                    arp_msg->ifname, show_ip_str(arp_msg->ipv4_addr), count);
+
+    return msg_len;
+}
+
+int mlacp_prepare_for_ndisc_info_compact(struct CSM* csm, char* buf, size_t max_buf_size, struct NDISCMsg* ndisc_msg, uint16_t if_id, int count)
+{
+    struct mLACPNDISCCompactInfoTLV* tlv = NULL;
+    struct mLACPNDISCCompactData* NdiscData = NULL;
+    size_t msg_len = 0;
+
+    if (!csm || !buf || !ndisc_msg)
+        return MCLAG_ERROR;
+
+    msg_len = mlacp_prepare_for_compact_info(csm, buf, max_buf_size, TLV_T_MLACP_NDISC_INFO_COMPACT,
+                                             sizeof(struct mLACPNDISCCompactData), count);
+    if (msg_len == 0)
+        return MCLAG_ERROR;
+
+    tlv = (struct mLACPNDISCCompactInfoTLV*)&buf[sizeof(ICCHdr)];
+    NdiscData = &tlv->NdiscEntry[count];
+    NdiscData->op_type = ndisc_msg->op_type;
+    NdiscData->if_id = htons(if_id);
+    memcpy(NdiscData->ipv6_addr, ndisc_msg->ipv6_addr, sizeof(NdiscData->ipv6_addr));
+    memcpy(NdiscData->mac_addr, ndisc_msg->mac_addr, ETHER_ADDR_LEN);
+
+    ICCPD_LOG_DEBUG(__FUNCTION__, "Send ND messge to peer, if name %s IPv6 %s count %d",
+                    ndisc_msg->ifname, show_ipv6_str((char *)ndisc_msg->ipv6_addr), count);
+
+    return msg_len;
+}
+
+/*****************************************
+* Preprare Sync Sequence TLV
+*
+* ***************************************/
+int mlacp_prepare_for_sync_seq(struct CSM* csm, char* buf, size_t max_buf_size,
+                               uint8_t op, uint8_t flags, uint32_t epoch, const uint32_t* seq)
+{
+    struct mLACPSyncSeqTLV* tlv = NULL;
+    size_t msg_len = sizeof(ICCHdr) + sizeof(struct mLACPSyncSeqTLV);
+    int i;
+
+    if (!csm)
+        return MCLAG_ERROR;
+    if (!buf)
+        return MCLAG_ERROR;
+    if (msg_len > max_buf_size)
+        return MCLAG_ERROR;
+
+    memset(buf, 0, msg_len);
+
+    /* ICC header */
+    mlacp_fill_icc_header(csm, (ICCHdr*)buf, msg_len);
+
+    tlv = (struct mLACPSyncSeqTLV*)&buf[sizeof(ICCHdr)];
+    tlv->icc_parameter.u_bit = 0;
+    tlv->icc_parameter.f_bit = 0;
+    tlv->icc_parameter.type = htons(TLV_T_MLACP_SYNC_SEQ);
+    tlv->icc_parameter.len = htons(sizeof(struct mLACPSyncSeqTLV) - sizeof(ICCParameter));
+
+    tlv->op = op;
+    tlv->flags = flags;
+    tlv->epoch = htonl(epoch);
+    for (i = 0; i < MLACP_SYNC_SEQ_TABLES; i++)
+        tlv->seq[i] = htonl(seq[i]);
+
+    return msg_len;
+}
+
 /*****************************************
 * Prprare Send portchannel info
 *
@@ -465,9 +677,7 @@ int mlacp_prepare_for_port_channel_info(struct CSM* csm, char* buf,
         return MCLAG_ERROR;
 
     /* Calculate VLAN ID Length */
-    LIST_FOREACH(vlan_id, &(port_channel->vlan_list), port_next)
-    if (vlan_id != NULL)
-        num_of_vlan_id++;
+    num_of_vlan_id = vlan_bitmap_count(&port_channel->vlan_bitmap);
 
     tlv_len = sizeof(struct mLACPPortChannelInfoTLV) + sizeof(struct mLACPVLANData) * num_of_vlan_id;
 
@@ -610,6 +820,42 @@ int mlacp_prepare_for_heartbeat(struct CSM* csm, char* buf, size_t max_buf_size)
     return msg_len;
 }
 
+/*****************************************
+* Prepare Send Fast Hello
+*
+* ***************************************/
+int mlacp_prepare_for_fast_hello(struct CSM* csm, char* buf, size_t max_buf_size, uint32_t seq)
+{
+    struct mLACPFastHelloTLV* tlv = NULL;
+    size_t msg_len = sizeof(ICCHdr) + sizeof(struct mLACPFastHelloTLV);
+
+    if (csm == NULL)
+        return MCLAG_ERROR;
+
+    if (buf == NULL)
+        return MCLAG_ERROR;
+
+    if (msg_len > max_buf_size)
+        return MCLAG_ERROR;
+
+    memset(buf, 0, msg_len);
+
+    /* ICC header */
+    mlacp_fill_icc_header(csm, (ICCHdr*)buf, msg_len);
+
+    tlv = (struct mLACPFastHelloTLV*)&buf[sizeof(ICCHdr)];
+    /* 0x1040 does not fit the 14 bit type once swapped, write the whole word*/
+    *(uint16_t *)&tlv->icc_parameter = htons(TLV_T_MLACP_FAST_HELLO);
+    tlv->icc_parameter.len = htons(sizeof(struct mLACPFastHelloTLV) - sizeof(ICCParameter));
+
+    tlv->version = MLACP_FAST_HELLO_VERSION;
+    tlv->multiplier = csm->fast_hello.multiplier;
+    tlv->tx_interval = htonl(csm->fast_hello.tx_interval_msec);
+    tlv->seq = htonl(seq);
+
+    return msg_len;
+}
+
 /*****************************************
 * Prepare Send warm-reboot flag
 *
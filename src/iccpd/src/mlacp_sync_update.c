@@ -30,6 +30,7 @@
 #include "../include/logger.h"
 #include "../include/mlacp_tlv.h"
 #include "../include/iccp_csm.h"
+#include "../include/iccp_pool.h"
 #include "../include/mlacp_link_handler.h"
 #include "../include/iccp_consistency_check.h"
 #include "../include/port.h"
@@ -42,6 +43,8 @@ extern void update_if_ipmac_on_standby(struct LocalInterface* lif_po);
 int mlacp_fsm_update_system_conf(struct CSM* csm, mLACPSysConfigTLV*sysconf)
 {
     struct LocalInterface* lif = NULL;
+    struct mLACPSysConfigCap* cap = NULL;
+    uint16_t pdu_size = 0;
 
     /*NOTE
        a little tricky, we change the NodeID local side if collision happened first time*/
@@ -59,6 +62,25 @@ int mlacp_fsm_update_system_conf(struct CSM* csm, mLACPSysConfigTLV*sysconf)
                     MLACP(csm).remote_system.node_id,
                     MLACP(csm).node_id);
 
+    /* Capabilities follow the fixed part, older peers do not send them*/
+    MLACP(csm).compact_sync = 0;
+    if (ntohs(sysconf->icc_parameter.len) >= sizeof(mLACPSysConfigTLV) + sizeof(struct mLACPSysConfigCap) - sizeof(ICCParameter))
+    {
+        cap = (struct mLACPSysConfigCap*)((char*)sysconf + sizeof(mLACPSysConfigTLV));
+        pdu_size = ntohs(cap->max_pdu_size);
+        if (pdu_size > MLACP_SYNC_PDU_MAX_SIZE)
+            pdu_size = MLACP_SYNC_PDU_MAX_SIZE;
+
+        if ((ntohl(cap->capabilities) & MLACP_SYSCONF_CAP_COMPACT_SYNC) && pdu_size >= MLACP_SYNC_PDU_MIN_SIZE)
+        {
+            MLACP(csm).compact_sync = 1;
+            MLACP(csm).sync_pdu_size = pdu_size;
+        }
+    }
+
+    ICCPD_LOG_INFO(__FUNCTION__, "Peer %s compact sync TLVs, PDU size %u",
+                   MLACP(csm).compact_sync ? "supports" : "does not support", MLACP(csm).sync_pdu_size);
+
     LIST_FOREACH(lif, &(MLACP(csm).lif_list), mlacp_next)
     {
         update_if_ipmac_on_standby(lif);
@@ -182,94 +204,90 @@ int mlacp_fsm_update_mac_entry_from_peer( struct CSM* csm, struct mLACPMACData *
     }
 
     /* update MAC list*/
-    TAILQ_FOREACH(msg, &(MLACP(csm).mac_list), tail)
+    msg = mlacp_mac_table_find(csm, MacData->mac_str, ntohs(MacData->vid));
+    if (msg)
     {
         mac_msg = (struct MACMsg*)msg->buf;
 
         /*Same MAC is exist in local switch, this may be mac move*/
-        if (strcmp(mac_msg->mac_str, MacData->mac_str) == 0 && mac_msg->vid == ntohs(MacData->vid))
+        if (MacData->type == MAC_SYNC_ADD)
         {
-            if (MacData->type == MAC_SYNC_ADD)
+            /*Peer has it, a restored MAC is confirmed*/
+            msg->stale = 0;
+            mac_msg->age_flag &= ~MAC_AGE_PEER;
+            ICCPD_LOG_DEBUG(__FUNCTION__, "Recv ADD, Remove peer age flag:%d ifname %s, MAC %s vlan-id %d",
+                            mac_msg->age_flag, mac_msg->ifname, mac_msg->mac_str, mac_msg->vid);
+
+            /*mac_msg->fdb_type = tlv->fdb_type;*/
+            /*The port ifname is different to the local item*/
+            if (from_mclag_intf == 0 || strcmp(mac_msg->ifname, MacData->ifname) != 0 || strcmp(mac_msg->origin_ifname, MacData->ifname) != 0)
             {
-                mac_msg->age_flag &= ~MAC_AGE_PEER;
-                ICCPD_LOG_DEBUG(__FUNCTION__, "Recv ADD, Remove peer age flag:%d ifname %s, MAC %s vlan-id %d",
-                                mac_msg->age_flag, mac_msg->ifname, mac_msg->mac_str, mac_msg->vid);
+                if (mac_msg->fdb_type != MAC_TYPE_STATIC)
+                {
+                    /*Update local item*/
+                    mlacp_mac_table_set_origin(csm, msg, MacData->ifname);
+                }
 
-                /*mac_msg->fdb_type = tlv->fdb_type;*/
-                /*The port ifname is different to the local item*/
-                if (from_mclag_intf == 0 || strcmp(mac_msg->ifname, MacData->ifname) != 0 || strcmp(mac_msg->origin_ifname, MacData->ifname) != 0)
+                /*If the MAC is learned from orphan port, or from MCLAG port but the local port is down*/
+                if (from_mclag_intf == 0 || (local_if->state == PORT_STATE_DOWN && strcmp(mac_msg->ifname, csm->peer_itf_name) != 0))
                 {
-                    if (mac_msg->fdb_type != MAC_TYPE_STATIC)
-                    {
-                        /*Update local item*/
-                        memcpy(&mac_msg->origin_ifname, MacData->ifname, MAX_L_PORT_NAME);
-                    }
+                    /*Set MAC_AGE_LOCAL flag*/
+                    mac_msg->age_flag = set_mac_local_age_flag(csm, mac_msg, 1);
 
-                    /*If the MAC is learned from orphan port, or from MCLAG port but the local port is down*/
-                    if (from_mclag_intf == 0 || (local_if->state == PORT_STATE_DOWN && strcmp(mac_msg->ifname, csm->peer_itf_name) != 0))
+                    if (strlen(csm->peer_itf_name) != 0)
                     {
-                        /*Set MAC_AGE_LOCAL flag*/
-                        mac_msg->age_flag = set_mac_local_age_flag(csm, mac_msg, 1);
+                        if (strcmp(mac_msg->ifname, csm->peer_itf_name) == 0)
+                        {
+                            /* This MAC is already point to peer-link */
+                            return 0;
+                        }
 
-                        if (strlen(csm->peer_itf_name) != 0)
+                        if (csm->peer_link_if && csm->peer_link_if->state == PORT_STATE_UP)
                         {
-                            if (strcmp(mac_msg->ifname, csm->peer_itf_name) == 0)
-                            {
-                                /* This MAC is already point to peer-link */
-                                return 0;
-                            }
-
-                            if (csm->peer_link_if && csm->peer_link_if->state == PORT_STATE_UP)
-                            {
-                                /*Redirect the mac to peer-link*/
-                                memcpy(&mac_msg->ifname, csm->peer_itf_name, IFNAMSIZ);
-
-                                /*Send mac add message to mclagsyncd*/
-                                add_mac_to_chip(mac_msg, MAC_TYPE_DYNAMIC);
-                            }
-                            else
-                            {
-                                /*must redirect but peerlink is down, del mac from ASIC*/
-                                /*if peerlink change to up, mac will add back to ASIC*/
-                                del_mac_from_chip(mac_msg);
-
-                                /*Redirect the mac to peer-link*/
-                                memcpy(&mac_msg->ifname, csm->peer_itf_name, IFNAMSIZ);
-                            }
+                            /*Redirect the mac to peer-link*/
+                            memcpy(&mac_msg->ifname, csm->peer_itf_name, IFNAMSIZ);
+
+                            /*Send mac add message to mclagsyncd*/
+                            add_mac_to_chip(mac_msg, MAC_TYPE_DYNAMIC);
                         }
                         else
                         {
-                            /*must redirect but no peerlink, del mac from ASIC*/
+                            /*must redirect but peerlink is down, del mac from ASIC*/
+                            /*if peerlink change to up, mac will add back to ASIC*/
                             del_mac_from_chip(mac_msg);
 
-                            /*Update local item*/
-                            memcpy(&mac_msg->ifname, MacData->ifname, MAX_L_PORT_NAME);
-
-                            /*if orphan port mac but no peerlink, don't keep this mac*/
-                            if (from_mclag_intf == 0)
-                            {
-                                TAILQ_REMOVE(&(MLACP(csm).mac_list), msg, tail);
-                                free(msg->buf);
-                                free(msg);
-                                return 0;
-                            }
+                            /*Redirect the mac to peer-link*/
+                            memcpy(&mac_msg->ifname, csm->peer_itf_name, IFNAMSIZ);
                         }
                     }
                     else
                     {
-                        /*Remove MAC_AGE_LOCAL flag*/
-                        mac_msg->age_flag = set_mac_local_age_flag(csm, mac_msg, 0);
+                        /*must redirect but no peerlink, del mac from ASIC*/
+                        del_mac_from_chip(mac_msg);
 
                         /*Update local item*/
                         memcpy(&mac_msg->ifname, MacData->ifname, MAX_L_PORT_NAME);
 
-                        /*from MCLAG port and the local port is up, add mac to ASIC to update port*/
-                        add_mac_to_chip(mac_msg, MAC_TYPE_DYNAMIC);
+                        /*if orphan port mac but no peerlink, don't keep this mac*/
+                        if (from_mclag_intf == 0)
+                        {
+                            mlacp_mac_table_del(csm, msg);
+                            return 0;
+                        }
                     }
                 }
-            }
+                else
+                {
+                    /*Remove MAC_AGE_LOCAL flag*/
+                    mac_msg->age_flag = set_mac_local_age_flag(csm, mac_msg, 0);
 
-            break;
+                    /*Update local item*/
+                    memcpy(&mac_msg->ifname, MacData->ifname, MAX_L_PORT_NAME);
+
+                    /*from MCLAG port and the local port is up, add mac to ASIC to update port*/
+                    add_mac_to_chip(mac_msg, MAC_TYPE_DYNAMIC);
+                }
+            }
         }
     }
 
@@ -286,9 +304,7 @@ int mlacp_fsm_update_mac_entry_from_peer( struct CSM* csm, struct mLACPMACData *
             del_mac_from_chip(mac_msg);
 
             /*If local and peer both aged, del the mac*/
-            TAILQ_REMOVE(&(MLACP(csm).mac_list), msg, tail);
-            free(msg->buf);
-            free(msg);
+            mlacp_mac_table_del(csm, msg);
         }
         else
         {
@@ -335,9 +351,9 @@ int mlacp_fsm_update_mac_entry_from_peer( struct CSM* csm, struct mLACPMACData *
             mac_msg->age_flag = set_mac_local_age_flag(csm, mac_msg, 0);
         }
 
-        if (iccp_csm_init_msg(&msg, (char*)mac_msg, sizeof(struct MACMsg)) == 0)
+        if (iccp_csm_init_pool_msg(&msg, ICCP_POOL_MAC, (char*)mac_msg, sizeof(struct MACMsg)) == 0)
         {
-            TAILQ_INSERT_TAIL(&(MLACP(csm).mac_list), msg, tail);
+            mlacp_mac_table_add(csm, msg);
             /*ICCPD_LOG_INFO(__FUNCTION__, "add mac queue successfully");*/
 
             /*If the mac is from orphan port, or from MCLAG port but the local port is down*/
@@ -385,7 +401,7 @@ void mlacp_enqueue_arp(struct CSM* csm, struct Msg* msg)
     if (!csm)
     {
         if (msg)
-            free(msg);
+            iccp_csm_free_msg(msg);
         return;
     }
     if (!msg)
@@ -394,7 +410,7 @@ void mlacp_enqueue_arp(struct CSM* csm, struct Msg* msg)
     arp_msg = (struct ARPMsg*)msg->buf;
     if (arp_msg->op_type != NEIGH_SYNC_DEL)
     {
-        TAILQ_INSERT_TAIL(&(MLACP(csm).arp_list), msg, tail);
+        mlacp_arp_table_add(csm, msg);
     }
 
     return;
@@ -411,7 +427,7 @@ void mlacp_enqueue_ndisc(struct CSM *csm, struct Msg *msg)
     if (!csm)
     {
         if (msg)
-            free(msg);
+            iccp_csm_free_msg(msg);
         return;
     }
     if (!msg)
@@ -420,7 +436,7 @@ void mlacp_enqueue_ndisc(struct CSM *csm, struct Msg *msg)
     ndisc_msg = (struct NDISCMsg *)msg->buf;
     if (ndisc_msg->op_type != NEIGH_SYNC_DEL)
     {
-        TAILQ_INSERT_TAIL(&(MLACP(csm).ndisc_list), msg, tail);
+        mlacp_ndisc_table_add(csm, msg);
     }
 
     return;
@@ -435,7 +451,8 @@ int mlacp_fsm_update_arp_entry(struct CSM* csm, struct ARPMsg *arp_entry)
     struct ARPMsg *arp_msg = NULL, arp_data;
     struct LocalInterface* local_if;
     struct LocalInterface *peer_link_if = NULL;
-    struct VLAN_ID *vlan_id_list = NULL;
+    struct LocalInterface *vlan_if = NULL;
+    int vid = -1;
     int set_arp_flag = 0;
     char mac_str[18] = "";
 
@@ -453,28 +470,21 @@ int mlacp_fsm_update_arp_entry(struct CSM* csm, struct ARPMsg *arp_entry)
 
     if (strncmp(arp_entry->ifname, "Vlan", 4) == 0)
     {
+        /* Only a L3 vlan itf is matched against the vlan members*/
+        vlan_if = local_if_find_by_name(arp_entry->ifname);
+        if (vlan_if && local_if_is_l3_mode(vlan_if))
+            vid = local_if_vlan_id(vlan_if);
+
         peer_link_if = local_if_find_by_name(csm->peer_itf_name);
 
-        if (peer_link_if && !local_if_is_l3_mode(peer_link_if))
+        /* Is peer-linlk itf belong to a vlan the same as peer?*/
+        if (peer_link_if && !local_if_is_l3_mode(peer_link_if) && local_if_has_vlan(peer_link_if, vid))
         {
-            /* Is peer-linlk itf belong to a vlan the same as peer?*/
-            LIST_FOREACH(vlan_id_list, &(peer_link_if->vlan_list), port_next)
-            {
-                if (!vlan_id_list->vlan_itf)
-                    continue;
-                if (strcmp(vlan_id_list->vlan_itf->name, arp_entry->ifname) != 0)
-                    continue;
-                if (!local_if_is_l3_mode(vlan_id_list->vlan_itf))
-                    continue;
-
-                ICCPD_LOG_DEBUG(__FUNCTION__, "ARP is learnt from intf %s, peer-link %s is the member of this vlan",
-                                vlan_id_list->vlan_itf->name, peer_link_if->name);
+            ICCPD_LOG_DEBUG(__FUNCTION__, "ARP is learnt from intf %s, peer-link %s is the member of this vlan",
+                            vlan_if->name, peer_link_if->name);
 
-                /* Peer-link belong to L3 vlan is alive, set the ARP info*/
-                set_arp_flag = 1;
-
-                break;
-            }
+            /* Peer-link belong to L3 vlan is alive, set the ARP info*/
+            set_arp_flag = 1;
         }
     }
 
@@ -487,21 +497,13 @@ int mlacp_fsm_update_arp_entry(struct CSM* csm, struct ARPMsg *arp_entry)
                 if (!local_if_is_l3_mode(local_if))
                 {
                     /* Is the L2 MLAG itf belong to a vlan the same as peer?*/
-                    LIST_FOREACH(vlan_id_list, &(local_if->vlan_list), port_next)
-                    {
-                        if (!vlan_id_list->vlan_itf)
-                            continue;
-                        if (strcmp(vlan_id_list->vlan_itf->name, arp_entry->ifname) != 0)
-                            continue;
-                        if (!local_if_is_l3_mode(vlan_id_list->vlan_itf))
-                            continue;
-
-                        ICCPD_LOG_DEBUG(__FUNCTION__, "ARP is learnt from intf %s, mclag %s is the member of this vlan",
-                                        vlan_id_list->vlan_itf->name, local_if->name);
-                        break;
-                    }
+                    if (!local_if_has_vlan(local_if, vid))
+                        continue;
 
-                    if (vlan_id_list && local_if->po_active == 1)
+                    ICCPD_LOG_DEBUG(__FUNCTION__, "ARP is learnt from intf %s, mclag %s is the member of this vlan",
+                                    vlan_if->name, local_if->name);
+
+                    if (local_if->po_active == 1)
                     {
                         /* Any po of L3 vlan is alive, set the ARP info*/
                         set_arp_flag = 1;
@@ -562,24 +564,22 @@ int mlacp_fsm_update_arp_entry(struct CSM* csm, struct ARPMsg *arp_entry)
     }
 
     /* update ARP list*/
-    TAILQ_FOREACH(msg, &(MLACP(csm).arp_list), tail)
+    msg = mlacp_arp_table_find(csm, arp_entry->ipv4_addr);
+    if (msg)
     {
         arp_msg = (struct ARPMsg*)msg->buf;
-        if (arp_msg->ipv4_addr == arp_entry->ipv4_addr)
-        {
-            /*arp_msg->op_type = tlv->type;*/
-            sprintf(arp_msg->ifname, "%s", arp_entry->ifname);
-            memcpy(arp_msg->mac_addr, arp_entry->mac_addr, ETHER_ADDR_LEN);
-            break;
-        }
+        /*Peer has it, a restored entry is confirmed*/
+        if (arp_entry->op_type == NEIGH_SYNC_ADD)
+            msg->stale = 0;
+        /*arp_msg->op_type = tlv->type;*/
+        mlacp_arp_table_set_ifname(csm, msg, arp_entry->ifname);
+        memcpy(arp_msg->mac_addr, arp_entry->mac_addr, ETHER_ADDR_LEN);
     }
 
     /* delete/add ARP list*/
     if (msg && arp_entry->op_type == NEIGH_SYNC_DEL)
     {
-        TAILQ_REMOVE(&(MLACP(csm).arp_list), msg, tail);
-        free(msg->buf);
-        free(msg);
+        mlacp_arp_table_del(csm, msg);
         /*ICCPD_LOG_INFO(__FUNCTION__, "Del arp queue successfully");*/
     }
     else if (!msg && arp_entry->op_type == NEIGH_SYNC_ADD)
@@ -589,7 +589,7 @@ int mlacp_fsm_update_arp_entry(struct CSM* csm, struct ARPMsg *arp_entry)
         arp_msg->ipv4_addr = arp_entry->ipv4_addr;
         arp_msg->op_type = arp_entry->op_type;
         memcpy(arp_msg->mac_addr, arp_entry->mac_addr, ETHER_ADDR_LEN);
-        if (iccp_csm_init_msg(&msg, (char*)arp_msg, sizeof(struct ARPMsg)) == 0)
+        if (iccp_csm_init_pool_msg(&msg, ICCP_POOL_ARP, (char*)arp_msg, sizeof(struct ARPMsg)) == 0)
         {
             mlacp_enqueue_arp(csm, msg);
             /*ICCPD_LOG_INFO(__FUNCTION__, "Add arp queue successfully");*/
@@ -608,8 +608,7 @@ int mlacp_fsm_update_arp_entry(struct CSM* csm, struct ARPMsg *arp_entry)
     {
         arp_msg = (struct ARPMsg*)msg->buf;
         TAILQ_REMOVE(&(MLACP(csm).arp_msg_list), msg, tail);
-        free(msg->buf);
-        free(msg);
+        iccp_csm_free_msg(msg);
         TAILQ_FOREACH(msg, &(MLACP(csm).arp_msg_list), tail)
         {
             arp_msg = (struct ARPMsg*)msg->buf;
@@ -646,7 +645,8 @@ int mlacp_fsm_update_ndisc_entry(struct CSM *csm, struct NDISCMsg *ndisc_entry)
     struct NDISCMsg *ndisc_msg = NULL, ndisc_data;
     struct LocalInterface *local_if;
     struct LocalInterface *peer_link_if = NULL;
-    struct VLAN_ID *vlan_id_list = NULL;
+    struct LocalInterface *vlan_if = NULL;
+    int vid = -1;
     int set_ndisc_flag = 0;
     char mac_str[18] = "";
 
@@ -661,29 +661,22 @@ int mlacp_fsm_update_ndisc_entry(struct CSM *csm, struct NDISCMsg *ndisc_entry)
 
     if (strncmp(ndisc_entry->ifname, "Vlan", 4) == 0)
     {
+        /* Only a L3 vlan itf is matched against the vlan members */
+        vlan_if = local_if_find_by_name(ndisc_entry->ifname);
+        if (vlan_if && local_if_is_l3_mode(vlan_if))
+            vid = local_if_vlan_id(vlan_if);
+
         peer_link_if = local_if_find_by_name(csm->peer_itf_name);
 
-        if (peer_link_if && !local_if_is_l3_mode(peer_link_if))
+        /* Is peer-linlk itf belong to a vlan the same as peer? */
+        if (peer_link_if && !local_if_is_l3_mode(peer_link_if) && local_if_has_vlan(peer_link_if, vid))
         {
-            /* Is peer-linlk itf belong to a vlan the same as peer? */
-            LIST_FOREACH(vlan_id_list, &(peer_link_if->vlan_list), port_next)
-            {
-                if (!vlan_id_list->vlan_itf)
-                    continue;
-                if (strcmp(vlan_id_list->vlan_itf->name, ndisc_entry->ifname) != 0)
-                    continue;
-                if (!local_if_is_l3_mode(vlan_id_list->vlan_itf))
-                    continue;
-
-                ICCPD_LOG_DEBUG(__FUNCTION__,
-                                "ND is learnt from intf %s, peer-link %s is the member of this vlan",
-                                vlan_id_list->vlan_itf->name, peer_link_if->name);
+            ICCPD_LOG_DEBUG(__FUNCTION__,
+                            "ND is learnt from intf %s, peer-link %s is the member of this vlan",
+                            vlan_if->name, peer_link_if->name);
 
-                /* Peer-link belong to L3 vlan is alive, set the NDISC info */
-                set_ndisc_flag = 1;
-
-                break;
-            }
+            /* Peer-link belong to L3 vlan is alive, set the NDISC info */
+            set_ndisc_flag = 1;
         }
     }
 
@@ -696,21 +689,13 @@ int mlacp_fsm_update_ndisc_entry(struct CSM *csm, struct NDISCMsg *ndisc_entry)
                 if (!local_if_is_l3_mode(local_if))
                 {
                     /* Is the L2 MLAG itf belong to a vlan the same as peer? */
-                    LIST_FOREACH(vlan_id_list, &(local_if->vlan_list), port_next)
-                    {
-                        if (!vlan_id_list->vlan_itf)
-                            continue;
-                        if (strcmp(vlan_id_list->vlan_itf->name, ndisc_entry->ifname) != 0)
-                            continue;
-                        if (!local_if_is_l3_mode(vlan_id_list->vlan_itf))
-                            continue;
-
-                        ICCPD_LOG_DEBUG(__FUNCTION__,
-                                        "ND is learnt from intf %s, %s is the member of this vlan", vlan_id_list->vlan_itf->name, local_if->name);
-                        break;
-                    }
+                    if (!local_if_has_vlan(local_if, vid))
+                        continue;
+
+                    ICCPD_LOG_DEBUG(__FUNCTION__,
+                                    "ND is learnt from intf %s, %s is the member of this vlan", vlan_if->name, local_if->name);
 
-                    if (vlan_id_list && local_if->po_active == 1)
+                    if (local_if->po_active == 1)
                     {
                         /* Any po of L3 vlan is alive, set the NDISC info */
                         set_ndisc_flag = 1;
@@ -772,24 +757,22 @@ int mlacp_fsm_update_ndisc_entry(struct CSM *csm, struct NDISCMsg *ndisc_entry)
     }
 
     /* update NDISC list */
-    TAILQ_FOREACH(msg, &(MLACP(csm).ndisc_list), tail)
+    msg = mlacp_ndisc_table_find(csm, ndisc_entry->ipv6_addr);
+    if (msg)
     {
         ndisc_msg = (struct NDISCMsg *)msg->buf;
-        if (memcmp((char *)ndisc_msg->ipv6_addr, (char *)ndisc_entry->ipv6_addr, 16) == 0)
-        {
-            /* ndisc_msg->op_type = tlv->type; */
-            sprintf(ndisc_msg->ifname, "%s", ndisc_entry->ifname);
-            memcpy(ndisc_msg->mac_addr, ndisc_entry->mac_addr, ETHER_ADDR_LEN);
-            break;
-        }
+        /* Peer has it, a restored entry is confirmed */
+        if (ndisc_entry->op_type == NEIGH_SYNC_ADD)
+            msg->stale = 0;
+        /* ndisc_msg->op_type = tlv->type; */
+        mlacp_ndisc_table_set_ifname(csm, msg, ndisc_entry->ifname);
+        memcpy(ndisc_msg->mac_addr, ndisc_entry->mac_addr, ETHER_ADDR_LEN);
     }
 
     /* delete/add NDISC list */
     if (msg && ndisc_entry->op_type == NEIGH_SYNC_DEL)
     {
-        TAILQ_REMOVE(&(MLACP(csm).ndisc_list), msg, tail);
-        free(msg->buf);
-        free(msg);
+        mlacp_ndisc_table_del(csm, msg);
         /* ICCPD_LOG_INFO(__FUNCTION__, "Del ndisc queue successfully"); */
     }
     else if (!msg && ndisc_entry->op_type == NEIGH_SYNC_ADD)
@@ -799,7 +782,7 @@ int mlacp_fsm_update_ndisc_entry(struct CSM *csm, struct NDISCMsg *ndisc_entry)
         memcpy((char *)ndisc_msg->ipv6_addr, (char *)ndisc_entry->ipv6_addr, 16);
         ndisc_msg->op_type = ndisc_entry->op_type;
         memcpy(ndisc_msg->mac_addr, ndisc_entry->mac_addr, ETHER_ADDR_LEN);
-        if (iccp_csm_init_msg(&msg, (char *)ndisc_msg, sizeof(struct NDISCMsg)) == 0)
+        if (iccp_csm_init_pool_msg(&msg, ICCP_POOL_NDISC, (char *)ndisc_msg, sizeof(struct NDISCMsg)) == 0)
         {
             mlacp_enqueue_ndisc(csm, msg);
             /* ICCPD_LOG_INFO(__FUNCTION__, "Add ndisc queue successfully"); */
@@ -818,8 +801,7 @@ int mlacp_fsm_update_ndisc_entry(struct CSM *csm, struct NDISCMsg *ndisc_entry)
     {
         ndisc_msg = (struct NDISCMsg *)msg->buf;
         TAILQ_REMOVE(&(MLACP(csm).ndisc_msg_list), msg, tail);
-        free(msg->buf);
-        free(msg);
+        iccp_csm_free_msg(msg);
         TAILQ_FOREACH(msg, &(MLACP(csm).ndisc_msg_list), tail)
         {
             ndisc_msg = (struct NDISCMsg *)msg->buf;
@@ -847,6 +829,174 @@ int mlacp_fsm_update_ndisc_info(struct CSM *csm, struct mLACPNDISCInfoTLV *tlv)
     }
 }
 
+/*****************************************
+* Interface-ID-Map Update
+* ***************************************/
+int mlacp_fsm_update_if_id_map(struct CSM* csm, struct mLACPIfIdMapTLV* tlv)
+{
+    struct mLACPIfIdData* entry = NULL;
+    char ifname[MAX_L_PORT_NAME];
+    int count = 0;
+    int i;
+
+    if (!csm || !tlv)
+        return MCLAG_ERROR;
+
+    count = ntohs(tlv->num_of_entry);
+    if (sizeof(struct mLACPIfIdMapTLV) - sizeof(ICCParameter) + count * sizeof(struct mLACPIfIdData)
+        > ntohs(tlv->icc_parameter.len))
+    {
+        ICCPD_LOG_WARN(__FUNCTION__, "Interface id map count %d exceeds TLV length %d", count, ntohs(tlv->icc_parameter.len));
+        return MCLAG_ERROR;
+    }
+
+    for (i = 0; i < count; i++)
+    {
+        entry = &tlv->IfIdEntry[i];
+        snprintf(ifname, MAX_L_PORT_NAME, "%.*s", MAX_L_PORT_NAME - 1, entry->ifname);
+        if (mlacp_if_id_set(&MLACP(csm).rx_if_id, ntohs(entry->if_id), ifname) < 0)
+            ICCPD_LOG_WARN(__FUNCTION__, "Failed to bind interface id %d to %s", ntohs(entry->if_id), ifname);
+        else
+            ICCPD_LOG_DEBUG(__FUNCTION__, "Peer interface id %d is %s", ntohs(entry->if_id), ifname);
+    }
+
+    return 0;
+}
+
+/* Interface name of a peer interface id, NULL if it was never advertised*/
+static const char* mlacp_fsm_peer_if_name(struct CSM* csm, uint16_t if_id)
+{
+    const char* ifname = mlacp_if_id_name(&MLACP(csm).rx_if_id, if_id);
+
+    if (ifname == NULL)
+        ICCPD_LOG_WARN(__FUNCTION__, "Unknown peer interface id %d, drop the entry", if_id);
+
+    return ifname;
+}
+
+/*****************************************
+* Compact MAC/ARP/ND-Info Update
+*
+* Entries are expanded to the legacy format and take the same path
+* ***************************************/
+int mlacp_fsm_update_mac_info_compact(struct CSM* csm, struct mLACPMACCompactInfoTLV* tlv)
+{
+    struct mLACPMACCompactData* entry = NULL;
+    struct mLACPMACData mac_data;
+    const char* ifname = NULL;
+    int count = 0;
+    int i;
+
+    if (!csm || !tlv)
+        return MCLAG_ERROR;
+
+    count = ntohs(tlv->num_of_entry);
+    if (sizeof(struct mLACPMACCompactInfoTLV) - sizeof(ICCParameter) + count * sizeof(struct mLACPMACCompactData)
+        > ntohs(tlv->icc_parameter.len))
+    {
+        ICCPD_LOG_WARN(__FUNCTION__, "MAC count %d exceeds TLV length %d", count, ntohs(tlv->icc_parameter.len));
+        return MCLAG_ERROR;
+    }
+
+    ICCPD_LOG_INFO(__FUNCTION__, "Received compact MAC Info count %d", count);
+
+    for (i = 0; i < count; i++)
+    {
+        entry = &tlv->MacEntry[i];
+        if ((ifname = mlacp_fsm_peer_if_name(csm, ntohs(entry->if_id))) == NULL)
+            continue;
+
+        memset(&mac_data, 0, sizeof(struct mLACPMACData));
+        mac_data.type = entry->type;
+        mac_data.vid = entry->vid;
+        sprintf(mac_data.mac_str, "%02x:%02x:%02x:%02x:%02x:%02x", entry->mac_addr[0], entry->mac_addr[1],
+                entry->mac_addr[2], entry->mac_addr[3], entry->mac_addr[4], entry->mac_addr[5]);
+        snprintf(mac_data.ifname, MAX_L_PORT_NAME, "%s", ifname);
+
+        mlacp_fsm_update_mac_entry_from_peer(csm, &mac_data);
+    }
+
+    return 0;
+}
+
+int mlacp_fsm_update_arp_info_compact(struct CSM* csm, struct mLACPARPCompactInfoTLV* tlv)
+{
+    struct mLACPARPCompactData* entry = NULL;
+    struct ARPMsg arp_data;
+    const char* ifname = NULL;
+    int count = 0;
+    int i;
+
+    if (!csm || !tlv)
+        return MCLAG_ERROR;
+
+    count = ntohs(tlv->num_of_entry);
+    if (sizeof(struct mLACPARPCompactInfoTLV) - sizeof(ICCParameter) + count * sizeof(struct mLACPARPCompactData)
+        > ntohs(tlv->icc_parameter.len))
+    {
+        ICCPD_LOG_WARN(__FUNCTION__, "ARP count %d exceeds TLV length %d", count, ntohs(tlv->icc_parameter.len));
+        return MCLAG_ERROR;
+    }
+
+    ICCPD_LOG_INFO(__FUNCTION__, "Received compact ARP Info count %d", count);
+
+    for (i = 0; i < count; i++)
+    {
+        entry = &tlv->ArpEntry[i];
+        if ((ifname = mlacp_fsm_peer_if_name(csm, ntohs(entry->if_id))) == NULL)
+            continue;
+
+        memset(&arp_data, 0, sizeof(struct ARPMsg));
+        arp_data.op_type = entry->op_type;
+        arp_data.ipv4_addr = entry->ipv4_addr;
+        memcpy(arp_data.mac_addr, entry->mac_addr, ETHER_ADDR_LEN);
+        snprintf(arp_data.ifname, MAX_L_PORT_NAME, "%s", ifname);
+
+        mlacp_fsm_update_arp_entry(csm, &arp_data);
+    }
+
+    return 0;
+}
+
+int mlacp_fsm_update_ndisc_info_compact(struct CSM* csm, struct mLACPNDISCCompactInfoTLV* tlv)
+{
+    struct mLACPNDISCCompactData* entry = NULL;
+    struct NDISCMsg ndisc_data;
+    const char* ifname = NULL;
+    int count = 0;
+    int i;
+
+    if (!csm || !tlv)
+        return MCLAG_ERROR;
+
+    count = ntohs(tlv->num_of_entry);
+    if (sizeof(struct mLACPNDISCCompactInfoTLV) - sizeof(ICCParameter) + count * sizeof(struct mLACPNDISCCompactData)
+        > ntohs(tlv->icc_parameter.len))
+    {
+        ICCPD_LOG_WARN(__FUNCTION__, "ND count %d exceeds TLV length %d", count, ntohs(tlv->icc_parameter.len));
+        return MCLAG_ERROR;
+    }
+
+    ICCPD_LOG_INFO(__FUNCTION__, "Received compact NDISC Info count %d", count);
+
+    for (i = 0; i < count; i++)
+    {
+        entry = &tlv->NdiscEntry[i];
+        if ((ifname = mlacp_fsm_peer_if_name(csm, ntohs(entry->if_id))) == NULL)
+            continue;
+
+        memset(&ndisc_data, 0, sizeof(struct NDISCMsg));
+        ndisc_data.op_type = entry->op_type;
+        memcpy(ndisc_data.ipv6_addr, entry->ipv6_addr, sizeof(ndisc_data.ipv6_addr));
+        memcpy(ndisc_data.mac_addr, entry->mac_addr, ETHER_ADDR_LEN);
+        snprintf(ndisc_data.ifname, MAX_L_PORT_NAME, "%s", ifname);
+
+        mlacp_fsm_update_ndisc_entry(csm, &ndisc_data);
+    }
+
+    return 0;
+}
+
 /*****************************************
 * Port-Channel-Info Update
 * ***************************************/
@@ -0,0 +1,504 @@
+/*
+ *  mlacp_table.c
+ *  Hash index of mLACP MAC, ARP and ND tables.
+ *
+ * Copyright(c) 2016-2019 Nephos/Estinet.
+ *
+ * This program is free software; you can redistribute it and/or modify it
+ * under the terms and conditions of the GNU General Public License,
+ * version 2, as published by the Free Software Foundation.
+ *
+ * This program is distributed in the hope it will be useful, but WITHOUT
+ * ANY WARRANTY; without even the implied warranty of MERCHANTABILITY or
+ * FITNESS FOR A PARTICULAR PURPOSE.  See the GNU General Public License for
+ * more details.
+ *
+ * You should have received a copy of the GNU General Public License along with
+ * this program; if not, see <http://www.gnu.org/licenses/>.
+ *
+ * The full GNU General Public License is included in this distribution in
+ * the file called "COPYING".
+ *
+ *  Maintainer: jianjun, grace Li from nephos
+ */
+
+#include <stdio.h>
+#include <stdlib.h>
+#include <string.h>
+#include <sys/queue.h>
+
+#include "../include/system.h"
+#include "../include/iccp_csm.h"
+#include "../include/mlacp_tlv.h"
+#include "../include/mlacp_table.h"
+#include "../include/iccp_latency.h"
+
+#define MLACP_HASH_GOLDEN_RATIO     0x9E3779B97F4A7C15ULL
+
+/*****************************************
+* Hash key
+*
+* ***************************************/
+
+/* Pack MAC string "xx:xx:xx:xx:xx:xx" to 48 bits and append 12 bits vid*/
+uint64_t mlacp_mac_key(const char* mac_str, uint16_t vid)
+{
+    uint64_t mac = 0;
+    const char* p = NULL;
+    char c;
+
+    for (p = mac_str; *p; p++)
+    {
+        c = *p;
+        if (c >= '0' && c <= '9')
+            mac = (mac << 4) | (c - '0');
+        else if (c >= 'a' && c <= 'f')
+            mac = (mac << 4) | (c - 'a' + 10);
+        else if (c >= 'A' && c <= 'F')
+            mac = (mac << 4) | (c - 'A' + 10);
+    }
+
+    return ((mac & 0xFFFFFFFFFFFFULL) << 12) | (vid & 0xFFF);
+}
+
+static unsigned int mlacp_mac_hash(const char* mac_str, uint16_t vid)
+{
+    uint64_t key = mlacp_mac_key(mac_str, vid);
+
+    return (unsigned int)((key * MLACP_HASH_GOLDEN_RATIO) >> 50) & (MLACP_MAC_HASH_SIZE - 1);
+}
+
+static unsigned int mlacp_arp_hash(uint32_t ipv4_addr)
+{
+    return (unsigned int)(((uint64_t)ipv4_addr * MLACP_HASH_GOLDEN_RATIO) >> 50) & (MLACP_NEIGH_HASH_SIZE - 1);
+}
+
+static unsigned int mlacp_ndisc_hash(const uint32_t* ipv6_addr)
+{
+    uint64_t key = 0;
+
+    key = ((uint64_t)(ipv6_addr[0] ^ ipv6_addr[1]) << 32) | (ipv6_addr[2] ^ ipv6_addr[3]);
+
+    return (unsigned int)((key * MLACP_HASH_GOLDEN_RATIO) >> 50) & (MLACP_NEIGH_HASH_SIZE - 1);
+}
+
+unsigned int mlacp_if_hash(const char* ifname)
+{
+    unsigned int hash = 5381;
+    const char* p = NULL;
+
+    for (p = ifname; *p; p++)
+        hash = ((hash << 5) + hash) + (unsigned char)*p;
+
+    return hash & (MLACP_IF_HASH_SIZE - 1);
+}
+
+/*****************************************
+* MAC table
+*
+* ***************************************/
+struct Msg* mlacp_mac_table_find(struct CSM* csm, const char* mac_str, uint16_t vid)
+{
+    struct Msg* msg = NULL;
+    struct MACMsg* mac_msg = NULL;
+
+    if (!csm || !mac_str)
+        return NULL;
+
+    LIST_FOREACH(msg, &MLACP(csm).mac_hash[mlacp_mac_hash(mac_str, vid)], hash_next)
+    {
+        mac_msg = (struct MACMsg*)msg->buf;
+
+        if (mac_msg->vid == vid && strcmp(mac_msg->mac_str, mac_str) == 0)
+            return msg;
+    }
+
+    return NULL;
+}
+
+/* Insert MAC to mac_list and hash index, msg->buf is a MACMsg*/
+void mlacp_mac_table_add(struct CSM* csm, struct Msg* msg)
+{
+    struct MACMsg* mac_msg = NULL;
+
+    if (!csm || !msg)
+        return;
+
+    mac_msg = (struct MACMsg*)msg->buf;
+
+    TAILQ_INSERT_TAIL(&(MLACP(csm).mac_list), msg, tail);
+    LIST_INSERT_HEAD(&MLACP(csm).mac_hash[mlacp_mac_hash(mac_msg->mac_str, mac_msg->vid)], msg, hash_next);
+    LIST_INSERT_HEAD(MLACP_MAC_IF_BUCKET(csm, mac_msg->origin_ifname), msg, if_next);
+    MLACP(csm).mac_num++;
+    iccp_latency_mark(ICCP_LAT_POINT_TABLE);
+
+    return;
+}
+
+/* Remove MAC from mac_list and hash index, then free it*/
+void mlacp_mac_table_del(struct CSM* csm, struct Msg* msg)
+{
+    if (!csm || !msg)
+        return;
+
+    TAILQ_REMOVE(&(MLACP(csm).mac_list), msg, tail);
+    LIST_REMOVE(msg, hash_next);
+    LIST_REMOVE(msg, if_next);
+    MLACP(csm).mac_num--;
+
+    iccp_csm_free_msg(msg);
+
+    return;
+}
+
+/* Change origin_ifname and move the MAC to the new interface bucket*/
+void mlacp_mac_table_set_origin(struct CSM* csm, struct Msg* msg, const char* ifname)
+{
+    struct MACMsg* mac_msg = NULL;
+
+    if (!csm || !msg || !ifname)
+        return;
+
+    mac_msg = (struct MACMsg*)msg->buf;
+
+    LIST_REMOVE(msg, if_next);
+    snprintf(mac_msg->origin_ifname, MAX_L_PORT_NAME, "%s", ifname);
+    LIST_INSERT_HEAD(MLACP_MAC_IF_BUCKET(csm, mac_msg->origin_ifname), msg, if_next);
+
+    return;
+}
+
+void mlacp_mac_table_flush(struct CSM* csm)
+{
+    struct Msg* msg = NULL;
+    int i;
+
+    if (!csm)
+        return;
+
+    while (!TAILQ_EMPTY(&(MLACP(csm).mac_list)))
+    {
+        msg = TAILQ_FIRST(&(MLACP(csm).mac_list));
+        TAILQ_REMOVE(&(MLACP(csm).mac_list), msg, tail);
+        iccp_csm_free_msg(msg);
+    }
+    TAILQ_INIT(&(MLACP(csm).mac_list));
+
+    for (i = 0; i < MLACP_MAC_HASH_SIZE; i++)
+        LIST_INIT(&MLACP(csm).mac_hash[i]);
+
+    for (i = 0; i < MLACP_IF_HASH_SIZE; i++)
+        LIST_INIT(&MLACP(csm).mac_if_hash[i]);
+
+    MLACP(csm).mac_num = 0;
+
+    return;
+}
+
+/*****************************************
+* ARP table
+*
+* ***************************************/
+struct Msg* mlacp_arp_table_find(struct CSM* csm, uint32_t ipv4_addr)
+{
+    struct Msg* msg = NULL;
+    struct ARPMsg* arp_msg = NULL;
+
+    if (!csm)
+        return NULL;
+
+    LIST_FOREACH(msg, &MLACP(csm).arp_hash[mlacp_arp_hash(ipv4_addr)], hash_next)
+    {
+        arp_msg = (struct ARPMsg*)msg->buf;
+
+        if (arp_msg->ipv4_addr == ipv4_addr)
+            return msg;
+    }
+
+    return NULL;
+}
+
+/* Insert ARP to arp_list and hash index, msg->buf is a ARPMsg*/
+void mlacp_arp_table_add(struct CSM* csm, struct Msg* msg)
+{
+    struct ARPMsg* arp_msg = NULL;
+
+    if (!csm || !msg)
+        return;
+
+    arp_msg = (struct ARPMsg*)msg->buf;
+
+    TAILQ_INSERT_TAIL(&(MLACP(csm).arp_list), msg, tail);
+    LIST_INSERT_HEAD(&MLACP(csm).arp_hash[mlacp_arp_hash(arp_msg->ipv4_addr)], msg, hash_next);
+    LIST_INSERT_HEAD(MLACP_ARP_IF_BUCKET(csm, arp_msg->ifname), msg, if_next);
+    MLACP(csm).arp_num++;
+    iccp_latency_mark(ICCP_LAT_POINT_TABLE);
+
+    return;
+}
+
+/* Remove ARP from arp_list and hash index, then free it*/
+void mlacp_arp_table_del(struct CSM* csm, struct Msg* msg)
+{
+    if (!csm || !msg)
+        return;
+
+    TAILQ_REMOVE(&(MLACP(csm).arp_list), msg, tail);
+    LIST_REMOVE(msg, hash_next);
+    LIST_REMOVE(msg, if_next);
+    MLACP(csm).arp_num--;
+
+    iccp_csm_free_msg(msg);
+
+    return;
+}
+
+/* Change ifname and move the ARP to the new interface bucket*/
+void mlacp_arp_table_set_ifname(struct CSM* csm, struct Msg* msg, const char* ifname)
+{
+    struct ARPMsg* arp_msg = NULL;
+
+    if (!csm || !msg || !ifname)
+        return;
+
+    arp_msg = (struct ARPMsg*)msg->buf;
+
+    LIST_REMOVE(msg, if_next);
+    snprintf(arp_msg->ifname, MAX_L_PORT_NAME, "%s", ifname);
+    LIST_INSERT_HEAD(MLACP_ARP_IF_BUCKET(csm, arp_msg->ifname), msg, if_next);
+
+    return;
+}
+
+void mlacp_arp_table_flush(struct CSM* csm)
+{
+    struct Msg* msg = NULL;
+    int i;
+
+    if (!csm)
+        return;
+
+    while (!TAILQ_EMPTY(&(MLACP(csm).arp_list)))
+    {
+        msg = TAILQ_FIRST(&(MLACP(csm).arp_list));
+        TAILQ_REMOVE(&(MLACP(csm).arp_list), msg, tail);
+        iccp_csm_free_msg(msg);
+    }
+    TAILQ_INIT(&(MLACP(csm).arp_list));
+
+    for (i = 0; i < MLACP_NEIGH_HASH_SIZE; i++)
+        LIST_INIT(&MLACP(csm).arp_hash[i]);
+
+    for (i = 0; i < MLACP_IF_HASH_SIZE; i++)
+        LIST_INIT(&MLACP(csm).arp_if_hash[i]);
+
+    MLACP(csm).arp_num = 0;
+
+    return;
+}
+
+/*****************************************
+* ND table
+*
+* ***************************************/
+struct Msg* mlacp_ndisc_table_find(struct CSM* csm, const uint32_t* ipv6_addr)
+{
+    struct Msg* msg = NULL;
+    struct NDISCMsg* ndisc_msg = NULL;
+
+    if (!csm || !ipv6_addr)
+        return NULL;
+
+    LIST_FOREACH(msg, &MLACP(csm).ndisc_hash[mlacp_ndisc_hash(ipv6_addr)], hash_next)
+    {
+        ndisc_msg = (struct NDISCMsg*)msg->buf;
+
+        if (memcmp(ndisc_msg->ipv6_addr, ipv6_addr, 16) == 0)
+            return msg;
+    }
+
+    return NULL;
+}
+
+/* Insert ND to ndisc_list and hash index, msg->buf is a NDISCMsg*/
+void mlacp_ndisc_table_add(struct CSM* csm, struct Msg* msg)
+{
+    struct NDISCMsg* ndisc_msg = NULL;
+
+    if (!csm || !msg)
+        return;
+
+    ndisc_msg = (struct NDISCMsg*)msg->buf;
+
+    TAILQ_INSERT_TAIL(&(MLACP(csm).ndisc_list), msg, tail);
+    LIST_INSERT_HEAD(&MLACP(csm).ndisc_hash[mlacp_ndisc_hash(ndisc_msg->ipv6_addr)], msg, hash_next);
+    LIST_INSERT_HEAD(MLACP_NDISC_IF_BUCKET(csm, ndisc_msg->ifname), msg, if_next);
+    MLACP(csm).ndisc_num++;
+    iccp_latency_mark(ICCP_LAT_POINT_TABLE);
+
+    return;
+}
+
+/* Remove ND from ndisc_list and hash index, then free it*/
+void mlacp_ndisc_table_del(struct CSM* csm, struct Msg* msg)
+{
+    if (!csm || !msg)
+        return;
+
+    TAILQ_REMOVE(&(MLACP(csm).ndisc_list), msg, tail);
+    LIST_REMOVE(msg, hash_next);
+    LIST_REMOVE(msg, if_next);
+    MLACP(csm).ndisc_num--;
+
+    iccp_csm_free_msg(msg);
+
+    return;
+}
+
+/* Change ifname and move the ND to the new interface bucket*/
+void mlacp_ndisc_table_set_ifname(struct CSM* csm, struct Msg* msg, const char* ifname)
+{
+    struct NDISCMsg* ndisc_msg = NULL;
+
+    if (!csm || !msg || !ifname)
+        return;
+
+    ndisc_msg = (struct NDISCMsg*)msg->buf;
+
+    LIST_REMOVE(msg, if_next);
+    snprintf(ndisc_msg->ifname, MAX_L_PORT_NAME, "%s", ifname);
+    LIST_INSERT_HEAD(MLACP_NDISC_IF_BUCKET(csm, ndisc_msg->ifname), msg, if_next);
+
+    return;
+}
+
+void mlacp_ndisc_table_flush(struct CSM* csm)
+{
+    struct Msg* msg = NULL;
+    int i;
+
+    if (!csm)
+        return;
+
+    while (!TAILQ_EMPTY(&(MLACP(csm).ndisc_list)))
+    {
+        msg = TAILQ_FIRST(&(MLACP(csm).ndisc_list));
+        TAILQ_REMOVE(&(MLACP(csm).ndisc_list), msg, tail);
+        iccp_csm_free_msg(msg);
+    }
+    TAILQ_INIT(&(MLACP(csm).ndisc_list));
+
+    for (i = 0; i < MLACP_NEIGH_HASH_SIZE; i++)
+        LIST_INIT(&MLACP(csm).ndisc_hash[i]);
+
+    for (i = 0; i < MLACP_IF_HASH_SIZE; i++)
+        LIST_INIT(&MLACP(csm).ndisc_if_hash[i]);
+
+    MLACP(csm).ndisc_num = 0;
+
+    return;
+}
+
+/*****************************************
+* Interface id table
+*
+* ***************************************/
+void mlacp_if_id_init(struct mlacp_if_id_table* table)
+{
+    memset(table, 0, sizeof(struct mlacp_if_id_table));
+    memset(table->bucket, 0xFF, sizeof(table->bucket));
+
+    return;
+}
+
+static int mlacp_if_id_grow(struct mlacp_if_id_table* table, uint32_t min_size)
+{
+    char (*name)[MAX_L_PORT_NAME] = NULL;
+    uint16_t* next = NULL;
+    uint32_t size = table->size ? table->size : 64;
+
+    while (size < min_size)
+        size <<= 1;
+    if (size > MLACP_IF_ID_NONE)
+        size = MLACP_IF_ID_NONE;
+    if (size < min_size)
+        return MCLAG_ERROR;
+
+    name = realloc(table->name, size * MAX_L_PORT_NAME);
+    if (name == NULL)
+        return MCLAG_ERROR;
+    table->name = name;
+
+    next = (uint16_t*)realloc(table->next, size * sizeof(uint16_t));
+    if (next == NULL)
+        return MCLAG_ERROR;
+    table->next = next;
+
+    memset(table->name[table->size], 0, (size - table->size) * MAX_L_PORT_NAME);
+    memset(&table->next[table->size], 0xFF, (size - table->size) * sizeof(uint16_t));
+    table->size = size;
+
+    return 0;
+}
+
+/* Sender side, return the id of ifname and allocate one for a new name*/
+int mlacp_if_id_get(struct mlacp_if_id_table* table, const char* ifname, int* is_new)
+{
+    unsigned int hash = mlacp_if_hash(ifname);
+    uint16_t id;
+
+    *is_new = 0;
+
+    for (id = table->bucket[hash]; id != MLACP_IF_ID_NONE; id = table->next[id])
+    {
+        if (strcmp(table->name[id], ifname) == 0)
+            return id;
+    }
+
+    if (table->num >= table->size && mlacp_if_id_grow(table, table->num + 1) < 0)
+        return MCLAG_ERROR;
+
+    id = table->num++;
+    snprintf(table->name[id], MAX_L_PORT_NAME, "%s", ifname);
+    table->next[id] = table->bucket[hash];
+    table->bucket[hash] = id;
+    *is_new = 1;
+
+    return id;
+}
+
+/* Receiver side, bind the id advertised by the peer*/
+int mlacp_if_id_set(struct mlacp_if_id_table* table, uint16_t id, const char* ifname)
+{
+    if (id == MLACP_IF_ID_NONE)
+        return MCLAG_ERROR;
+
+    if (id >= table->size && mlacp_if_id_grow(table, id + 1) < 0)
+        return MCLAG_ERROR;
+
+    snprintf(table->name[id], MAX_L_PORT_NAME, "%s", ifname);
+    if (id >= table->num)
+        table->num = id + 1;
+
+    return 0;
+}
+
+const char* mlacp_if_id_name(struct mlacp_if_id_table* table, uint16_t id)
+{
+    if (id >= table->num || table->name[id][0] == '\0')
+        return NULL;
+
+    return table->name[id];
+}
+
+void mlacp_if_id_flush(struct mlacp_if_id_table* table)
+{
+    if (table->name)
+        free(table->name);
+    if (table->next)
+        free(table->next);
+
+    mlacp_if_id_init(table);
+
+    return;
+}
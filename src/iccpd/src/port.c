@@ -30,6 +30,7 @@
 #include "../include/iccp_csm.h"
 #include "../include/iccp_netlink.h"
 #include "../include/scheduler.h"
+#include "../include/iccp_capture.h"
 
 void local_if_init(struct LocalInterface* local_if)
 {
@@ -51,10 +52,72 @@ void local_if_init(struct LocalInterface* local_if)
     local_if->csm = NULL;
     local_if->isolate_to_peer_link = 0;
     LIST_INIT(&local_if->vlan_list);
+    vlan_bitmap_clear_all(&local_if->vlan_bitmap);
 
     return;
 }
 
+void vlan_bitmap_clear_all(struct VlanBitmap* bm)
+{
+    memset(bm->bits, 0, sizeof(bm->bits));
+
+    return;
+}
+
+void vlan_bitmap_set(struct VlanBitmap* bm, int vid)
+{
+    if (vid < 0 || vid >= VLAN_ID_MAX)
+        return;
+
+    bm->bits[vid / 64] |= 1ULL << (vid % 64);
+
+    return;
+}
+
+void vlan_bitmap_clear(struct VlanBitmap* bm, int vid)
+{
+    if (vid < 0 || vid >= VLAN_ID_MAX)
+        return;
+
+    bm->bits[vid / 64] &= ~(1ULL << (vid % 64));
+
+    return;
+}
+
+int vlan_bitmap_test(const struct VlanBitmap* bm, int vid)
+{
+    if (vid < 0 || vid >= VLAN_ID_MAX)
+        return 0;
+
+    return (bm->bits[vid / 64] >> (vid % 64)) & 1;
+}
+
+int vlan_bitmap_count(const struct VlanBitmap* bm)
+{
+    int count = 0;
+    int i;
+
+    for (i = 0; i < VLAN_BITMAP_WORDS; i++)
+        count += __builtin_popcountll(bm->bits[i]);
+
+    return count;
+}
+
+int vlan_bitmap_first_diff(const struct VlanBitmap* a, const struct VlanBitmap* b)
+{
+    uint64_t diff;
+    int i;
+
+    for (i = 0; i < VLAN_BITMAP_WORDS; i++)
+    {
+        diff = a->bits[i] & ~b->bits[i];
+        if (diff)
+            return i * 64 + __builtin_ctzll(diff);
+    }
+
+    return -1;
+}
+
 void vlan_info_init(struct VLAN_ID* vlan)
 {
     vlan->vid = -1;
@@ -64,6 +127,93 @@ void vlan_info_init(struct VLAN_ID* vlan)
     return;
 }
 
+static unsigned int local_if_name_hash(const char* ifname)
+{
+    unsigned int hash = 5381;
+    const char* p = NULL;
+
+    for (p = ifname; *p; p++)
+        hash = ((hash << 5) + hash) + (unsigned char)*p;
+
+    return hash & (LOCAL_IF_HASH_SIZE - 1);
+}
+
+#define LOCAL_IF_NUM_HASH(num) ((unsigned int)(num) & (LOCAL_IF_HASH_SIZE - 1))
+
+/* Port-channel id is the number in the name, -1 if no number*/
+static int local_if_parse_po_id(const char* ifname)
+{
+    int i;
+    int len;
+
+    len = strlen(ifname);
+
+    for (i = 0; i < len; ++i)
+        if (ifname[i] >= '0' && ifname[i] <= '9')
+            break;
+
+    if (i >= len)
+        return -1;
+
+    return atoi(&ifname[i]);
+}
+
+/* Add local interface to sys->lif_list and hash index*/
+static void local_if_link(struct System* sys, struct LocalInterface* local_if)
+{
+    LIST_INSERT_HEAD(&(sys->lif_list), local_if, system_next);
+    LIST_INSERT_HEAD(&(sys->lif_name_hash[local_if_name_hash(local_if->name)]), local_if, name_hash_next);
+    LIST_INSERT_HEAD(&(sys->lif_ifindex_hash[LOCAL_IF_NUM_HASH(local_if->ifindex)]), local_if, ifindex_hash_next);
+    if (local_if->type == IF_T_PORT_CHANNEL)
+        LIST_INSERT_HEAD(&(sys->lif_po_id_hash[LOCAL_IF_NUM_HASH(local_if->po_id)]), local_if, po_id_hash_next);
+
+    return;
+}
+
+/* Remove local interface from sys->lif_list and hash index*/
+void local_if_unlink(struct LocalInterface* local_if)
+{
+    LIST_REMOVE(local_if, system_next);
+    LIST_REMOVE(local_if, name_hash_next);
+    LIST_REMOVE(local_if, ifindex_hash_next);
+    if (local_if->type == IF_T_PORT_CHANNEL)
+        LIST_REMOVE(local_if, po_id_hash_next);
+
+    return;
+}
+
+void local_if_rename(struct LocalInterface* local_if, const char* ifname)
+{
+    struct System* sys = NULL;
+    int po_id;
+
+    if (!local_if || !ifname)
+        return;
+
+    if (!(sys = system_get_instance()))
+        return;
+
+    ICCPD_LOG_NOTICE(__FUNCTION__, "Rename local_if %s to %s, ifindex = %d",
+                     local_if->name, ifname, local_if->ifindex);
+
+    LIST_REMOVE(local_if, name_hash_next);
+    snprintf(local_if->name, MAX_L_PORT_NAME, "%s", ifname);
+    LIST_INSERT_HEAD(&(sys->lif_name_hash[local_if_name_hash(local_if->name)]), local_if, name_hash_next);
+
+    if (local_if->type == IF_T_PORT_CHANNEL)
+    {
+        po_id = local_if_parse_po_id(ifname);
+        if (po_id >= 0 && po_id != local_if->po_id)
+        {
+            LIST_REMOVE(local_if, po_id_hash_next);
+            local_if->po_id = po_id;
+            LIST_INSERT_HEAD(&(sys->lif_po_id_hash[LOCAL_IF_NUM_HASH(local_if->po_id)]), local_if, po_id_hash_next);
+        }
+    }
+
+    return;
+}
+
 struct LocalInterface* local_if_create(int ifindex, char* ifname, int type)
 {
     struct System* sys = NULL;
@@ -95,18 +245,13 @@ struct LocalInterface* local_if_create(int ifindex, char* ifname, int type)
 
     if (local_if->type == IF_T_PORT_CHANNEL)
     {
-        int i;
-        int len;
-        len = strlen(ifname);
-
-        for (i = 0; i < len; ++i)
-            if (ifname[i] >= '0' && ifname[i] <= '9')
-                break;
+        local_if->po_id = local_if_parse_po_id(ifname);
 
-        if (i >= len)
+        if (local_if->po_id < 0)
+        {
+            free(local_if);
             return NULL;
-
-        local_if->po_id =  atoi(&ifname[i]);
+        }
     }
 
     if (ifname)
@@ -140,7 +285,7 @@ struct LocalInterface* local_if_create(int ifindex, char* ifname, int type)
                    ifname, local_if->ifindex, local_if->mac_addr[0], local_if->mac_addr[1], local_if->mac_addr[2],
                    local_if->mac_addr[3], local_if->mac_addr[4], local_if->mac_addr[5], local_if->state ? "down" : "up");
 
-    LIST_INSERT_HEAD(&(sys->lif_list), local_if, system_next);
+    local_if_link(sys, local_if);
 
     /*Check the intf is peer-link? Only support PortChannel and Ethernet currently*/
     /*When set peer-link, the local-if is probably not created*/
@@ -174,7 +319,7 @@ struct LocalInterface* local_if_find_by_name(const char* ifname)
     if (!(sys = system_get_instance()))
         return NULL;
 
-    LIST_FOREACH(local_if, &(sys->lif_list), system_next)
+    LIST_FOREACH(local_if, &(sys->lif_name_hash[local_if_name_hash(ifname)]), name_hash_next)
     {
         if (strcmp(local_if->name, ifname) == 0)
             return local_if;
@@ -191,7 +336,7 @@ struct LocalInterface* local_if_find_by_ifindex(int ifindex)
     if ((sys = system_get_instance()) == NULL)
         return NULL;
 
-    LIST_FOREACH(local_if, &(sys->lif_list), system_next)
+    LIST_FOREACH(local_if, &(sys->lif_ifindex_hash[LOCAL_IF_NUM_HASH(ifindex)]), ifindex_hash_next)
     {
         if (local_if->ifindex == ifindex)
             return local_if;
@@ -208,7 +353,7 @@ struct LocalInterface* local_if_find_by_po_id(int po_id)
     if ((sys = system_get_instance()) == NULL)
         return NULL;
 
-    LIST_FOREACH(local_if, &(sys->lif_list), system_next)
+    LIST_FOREACH(local_if, &(sys->lif_po_id_hash[LOCAL_IF_NUM_HASH(po_id)]), po_id_hash_next)
     {
         if (local_if->type == IF_T_PORT_CHANNEL && local_if->po_id == po_id)
             return local_if;
@@ -313,7 +458,7 @@ void local_if_destroy(char *ifname)
 
  to_sys_purge:
     /* sys purge */
-    LIST_REMOVE(lif, system_next);
+    local_if_unlink(lif);
     if (lif->csm)
         LIST_REMOVE(lif, mlacp_next);
     LIST_INSERT_HEAD(&(sys->lif_purge_list), lif, system_purge_next);
@@ -321,7 +466,7 @@ void local_if_destroy(char *ifname)
 
  to_mlacp_purge:
     /* sys & mlacp purge */
-    LIST_REMOVE(lif, system_next);
+    local_if_unlink(lif);
     LIST_REMOVE(lif, mlacp_next);
     LIST_INSERT_HEAD(&(sys->lif_purge_list), lif, system_purge_next);
     LIST_INSERT_HEAD(&(MLACP(csm).lif_purge_list), lif, mlacp_purge_next);
@@ -480,6 +625,7 @@ void peer_if_del_all_vlan(struct PeerInterface* pif)
         LIST_REMOVE(pvlan, port_next);
         free(pvlan);
     }
+    vlan_bitmap_clear_all(&pif->vlan_bitmap);
 
     return;
 }
@@ -502,13 +648,19 @@ int local_if_add_vlan(struct LocalInterface* local_if, uint16_t vid)
     struct VLAN_ID *vlan = NULL;
     char vlan_name[16] = "";
 
+    if (vid >= VLAN_ID_MAX)
+        return MCLAG_ERROR;
+
     sprintf(vlan_name, "Vlan%d", vid);
 
-    /* traverse 1 time */
-    LIST_FOREACH(vlan, &(local_if->vlan_list), port_next)
+    /* Only an existing member has a node to refresh*/
+    if (vlan_bitmap_test(&local_if->vlan_bitmap, vid))
     {
-        if (vlan->vid == vid)
-            break;
+        LIST_FOREACH(vlan, &(local_if->vlan_list), port_next)
+        {
+            if (vlan->vid == vid)
+                break;
+        }
     }
 
     if (!vlan)
@@ -520,6 +672,7 @@ int local_if_add_vlan(struct LocalInterface* local_if, uint16_t vid)
         ICCPD_LOG_DEBUG(__FUNCTION__, "Add %s to VLAN %d", local_if->name, vid);
         local_if->port_config_sync = 1;
         LIST_INSERT_HEAD(&(local_if->vlan_list), vlan, port_next);
+        vlan_bitmap_set(&local_if->vlan_bitmap, vid);
     }
 
     vlan_info_init(vlan);
@@ -536,6 +689,9 @@ void local_if_del_vlan(struct LocalInterface* local_if, uint16_t vid)
 {
     struct VLAN_ID *vlan = NULL;
 
+    if (!vlan_bitmap_test(&local_if->vlan_bitmap, vid))
+        return;
+
     /* traverse 1 time */
     LIST_FOREACH(vlan, &(local_if->vlan_list), port_next)
     {
@@ -549,6 +705,7 @@ void local_if_del_vlan(struct LocalInterface* local_if, uint16_t vid)
         free(vlan);
         local_if->port_config_sync = 1;
     }
+    vlan_bitmap_clear(&local_if->vlan_bitmap, vid);
 
     ICCPD_LOG_DEBUG(__FUNCTION__, "Remove %s from VLAN %d", local_if->name, vid);
 
@@ -566,25 +723,133 @@ void local_if_del_all_vlan(struct LocalInterface* lif)
         LIST_REMOVE(vlan, port_next);
         free(vlan);
     }
+    vlan_bitmap_clear_all(&lif->vlan_bitmap);
 
     return;
 }
 
+/* Replace the VLANs of local_if in one pass, used for netlink bridge updates*/
+int local_if_set_vlans(struct LocalInterface* local_if, const struct VlanBitmap* vlans)
+{
+    struct VLAN_ID *vlan = NULL;
+    struct VLAN_ID *vlan_next = NULL;
+    struct VlanBitmap added;
+    char vlan_name[16] = "";
+    uint64_t word;
+    int changed = 0;
+    int ret = 0;
+    int vid;
+    int i;
+
+    /* Drop the removed VLANs and refresh the VLAN itf of the others*/
+    vlan = LIST_FIRST(&(local_if->vlan_list));
+    while (vlan)
+    {
+        vlan_next = LIST_NEXT(vlan, port_next);
+
+        if (!vlan_bitmap_test(vlans, vlan->vid))
+        {
+            ICCPD_LOG_DEBUG(__FUNCTION__, "Remove %s from VLAN %d", local_if->name, vlan->vid);
+            LIST_REMOVE(vlan, port_next);
+            free(vlan);
+            changed = 1;
+        }
+        else
+        {
+            sprintf(vlan_name, "Vlan%d", vlan->vid);
+            vlan->vlan_removed = 0;
+            vlan->vlan_itf = local_if_find_by_name(vlan_name);
+        }
+
+        vlan = vlan_next;
+    }
+
+    for (i = 0; i < VLAN_BITMAP_WORDS; i++)
+        added.bits[i] = vlans->bits[i] & ~local_if->vlan_bitmap.bits[i];
+
+    local_if->vlan_bitmap = *vlans;
+
+    for (i = 0; i < VLAN_BITMAP_WORDS; i++)
+    {
+        for (word = added.bits[i]; word; word &= word - 1)
+        {
+            vid = i * 64 + __builtin_ctzll(word);
+
+            vlan = (struct VLAN_ID*)malloc(sizeof(struct VLAN_ID));
+            if (!vlan)
+            {
+                vlan_bitmap_clear(&local_if->vlan_bitmap, vid);
+                ret = MCLAG_ERROR;
+                continue;
+            }
+
+            ICCPD_LOG_DEBUG(__FUNCTION__, "Add %s to VLAN %d", local_if->name, vid);
+            sprintf(vlan_name, "Vlan%d", vid);
+            vlan_info_init(vlan);
+            vlan->vid = vid;
+            vlan->vlan_itf = local_if_find_by_name(vlan_name);
+            LIST_INSERT_HEAD(&(local_if->vlan_list), vlan, port_next);
+            changed = 1;
+        }
+    }
+
+    if (changed)
+        local_if->port_config_sync = 1;
+
+    update_if_ipmac_on_standby(local_if);
+
+    return ret;
+}
+
+int local_if_has_vlan(const struct LocalInterface* local_if, int vid)
+{
+    return vlan_bitmap_test(&local_if->vlan_bitmap, vid);
+}
+
+/* VLAN ID of a VLAN interface, -1 for other interfaces*/
+int local_if_vlan_id(const struct LocalInterface* lif_vlan)
+{
+    int vid;
+
+    if (lif_vlan->type != IF_T_VLAN)
+        return -1;
+
+    if (strncmp(lif_vlan->name, VLAN_PREFIX, strlen(VLAN_PREFIX)) != 0)
+        return -1;
+
+    vid = atoi(&lif_vlan->name[strlen(VLAN_PREFIX)]);
+    if (vid <= 0 || vid >= VLAN_ID_MAX)
+        return -1;
+
+    return vid;
+}
+
+int peer_if_has_vlan(const struct PeerInterface* peer_if, int vid)
+{
+    return vlan_bitmap_test(&peer_if->vlan_bitmap, vid);
+}
+
 /* Add VLAN from peer-link*/
 int peer_if_add_vlan(struct PeerInterface* peer_if, uint16_t vlan_id)
 {
     struct VLAN_ID *peer_vlan = NULL;
     char vlan_name[16] = "";
 
+    if (vlan_id >= VLAN_ID_MAX)
+        return MCLAG_ERROR;
+
     sprintf(vlan_name, "Vlan%d", vlan_id);
 
-    /* traverse 1 time */
-    LIST_FOREACH(peer_vlan, &(peer_if->vlan_list), port_next)
+    /* Only an existing member has a node to refresh*/
+    if (vlan_bitmap_test(&peer_if->vlan_bitmap, vlan_id))
     {
-        if (peer_vlan->vid == vlan_id)
+        LIST_FOREACH(peer_vlan, &(peer_if->vlan_list), port_next)
         {
-            ICCPD_LOG_DEBUG(__FUNCTION__, "Update VLAN ID %d for peer intf %s", peer_vlan->vid, peer_if->name);
-            break;
+            if (peer_vlan->vid == vlan_id)
+            {
+                ICCPD_LOG_DEBUG(__FUNCTION__, "Update VLAN ID %d for peer intf %s", peer_vlan->vid, peer_if->name);
+                break;
+            }
         }
     }
 
@@ -596,6 +861,7 @@ int peer_if_add_vlan(struct PeerInterface* peer_if, uint16_t vlan_id)
 
         ICCPD_LOG_DEBUG(__FUNCTION__, "Add peer intf %s to VLAN %d", peer_if->name, vlan_id);
         LIST_INSERT_HEAD(&(peer_if->vlan_list), peer_vlan, port_next);
+        vlan_bitmap_set(&peer_if->vlan_bitmap, vlan_id);
     }
 
     vlan_info_init(peer_vlan);
@@ -617,6 +883,7 @@ int peer_if_clean_unused_vlan(struct PeerInterface* peer_if)
         if (peer_vlan != NULL)
         {
             ICCPD_LOG_DEBUG(__FUNCTION__, "Remove peer intf %s from VLAN %d", peer_if->name, peer_vlan->vid);
+            vlan_bitmap_clear(&peer_if->vlan_bitmap, peer_vlan->vid);
             LIST_REMOVE(peer_vlan, port_next);
             free(peer_vlan);
             peer_vlan = NULL;
@@ -629,6 +896,7 @@ int peer_if_clean_unused_vlan(struct PeerInterface* peer_if)
     if (peer_vlan != NULL)
     {
         ICCPD_LOG_DEBUG(__FUNCTION__, "Remove peer intf %s from VLAN %d", peer_if->name, peer_vlan->vid);
+        vlan_bitmap_clear(&peer_if->vlan_bitmap, peer_vlan->vid);
         LIST_REMOVE(peer_vlan, port_next);
         free(peer_vlan);
     }
@@ -644,6 +912,9 @@ int set_sys_arp_accept_flag(char* ifname, int flag)
     char buf[2];
     int result = MCLAG_ERROR;
 
+    if (iccp_replaying())
+        return 0;
+
     memset(arp_file, 0, 64);
     snprintf(arp_file, 63, "/proc/sys/net/ipv4/conf/%s/arp_accept", ifname);
     if (!(file_ptr = fopen(arp_file, "r")))
@@ -32,6 +32,7 @@
 #include <netinet/in.h>
 #include <arpa/inet.h>
 #include <sys/epoll.h>
+#include <fcntl.h>
 
 #include "../include/logger.h"
 #include "../include/system.h"
@@ -41,6 +42,12 @@
 #include "../include/iccp_cmd.h"
 #include "../include/mlacp_link_handler.h"
 #include "../include/iccp_netlink.h"
+#include "../include/iccp_timer.h"
+#include "../include/mlacp_fast_hello.h"
+#include "../include/iccp_ingest.h"
+#include "../include/iccp_latency.h"
+#include "../include/iccp_checkpoint.h"
+#include "../include/iccp_capture.h"
 
 /******************************************************
 *
@@ -91,27 +98,98 @@ static void heartbeat_update(struct CSM *csm)
     return;
 }
 
+static struct iccp_timer scheduler_fsm_timer;
+static struct iccp_timer scheduler_fdb_timer;
+static struct iccp_timer scheduler_log_timer;
+
+/* Run the FSMs in this loop*/
+void scheduler_fsm_kick()
+{
+    struct System* sys = NULL;
+
+    if ((sys = system_get_instance()) == NULL)
+        return;
+
+    sys->fsm_kick = 1;
+
+    return;
+}
+
+/* Time based FSM checks, heartbeat, connect retry, etc.*/
+static void scheduler_fsm_timer_handler(void* arg)
+{
+    scheduler_fsm_kick();
+    iccp_timer_start(&scheduler_fsm_timer, TRANSIT_INTERVAL_SEC * 1000);
+
+    return;
+}
+
+/* Pull the FDB changes from mclagsyncd every FDB_PULL_INTERVAL_SEC*/
+static void scheduler_fdb_timer_handler(void* arg)
+{
+    struct CSM* csm = NULL;
+    struct System* sys = NULL;
+    time_t elapsed = 0;
+
+    if ((sys = system_get_instance()) == NULL)
+        return;
+
+    elapsed = time(NULL) - sys->csm_trans_time;
+    if (elapsed >= FDB_PULL_INTERVAL_SEC)
+    {
+        LIST_FOREACH(csm, &(sys->csm_list), next)
+        {
+            if (MLACP(csm).current_state == MLACP_STATE_EXCHANGE)
+            {
+                iccp_get_fdb_change_from_syncd();
+                sys->csm_trans_time = time(NULL);
+                break;
+            }
+        }
+        elapsed = 0;
+    }
+
+    /* the peer connect handler may have restarted the interval*/
+    iccp_timer_start(&scheduler_fdb_timer, (FDB_PULL_INTERVAL_SEC - elapsed) * 1000);
+
+    return;
+}
+
+/* Report the log records suppressed in a window that closed quietly*/
+static void scheduler_log_timer_handler(void* arg)
+{
+    log_rate_flush();
+    iccp_timer_start(&scheduler_log_timer, LOG_RATE_WINDOW_MSEC);
+
+    return;
+}
+
 /* Transit FSM of all connections */
 static int scheduler_transit_fsm()
 {
     struct CSM* csm = NULL;
     struct System* sys = NULL;
+    int iccp_state, app_state, mlacp_state;
 
     if ((sys = system_get_instance()) == NULL)
         return MCLAG_ERROR;
 
     LIST_FOREACH(csm, &(sys->csm_list), next)
     {
+        iccp_state = csm->current_state;
+        app_state = csm->app_csm.current_state;
+        mlacp_state = MLACP(csm).current_state;
+
         heartbeat_update(csm);
         iccp_csm_transit(csm);
         app_csm_transit(csm);
         mlacp_fsm_transit(csm);
+        scheduler_csm_write_callback(csm);
 
-        if (MLACP(csm).current_state == MLACP_STATE_EXCHANGE && (time(NULL) - sys->csm_trans_time) >= 60)
-        {
-            iccp_get_fdb_change_from_syncd();
-            sys->csm_trans_time = time(NULL);
-        }
+        /* State changed or msg left, go on in the next loop without waiting*/
+        if (iccp_state != csm->current_state || app_state != csm->app_csm.current_state
+            || mlacp_state != MLACP(csm).current_state || !TAILQ_EMPTY(&(csm->msg_list)))
+            sys->fsm_kick = 1;
     }
 
     local_if_change_flag_clear();
@@ -120,51 +198,77 @@ static int scheduler_transit_fsm()
     return 1;
 }
 
-/* Receive packets call back function */
-int scheduler_csm_read_callback(struct CSM* csm)
+/* Parse the complete msgs in the csm rx block, they are queued as slices of it*/
+static int scheduler_csm_parse_msg(struct CSM* csm)
 {
+    struct CSMRxBlock* block = csm->rx_block;
     struct Msg* msg = NULL;
-    /*peer message*/
-    char *peer_msg = g_csm_buf;
-    LDPHdr* ldp_hdr = (LDPHdr*)peer_msg;
-    char* data = &peer_msg[sizeof(LDPHdr)];
-    size_t data_len = 0;
-    size_t pos = 0;
-    int recv_len = 0, len = 0, retval;
-
-    if (csm->sock_fd <= 0)
-        return MCLAG_ERROR;
-
-    memset(peer_msg, 0, CSM_BUFFER_SIZE);
+    LDPHdr* ldp_hdr = NULL;
+    uint32_t msg_len = 0;
+    uint64_t rx_usec = iccp_latency_now_usec();
 
-    recv_len = 0;
-
-    while (recv_len != sizeof(LDPHdr))
+    while (block->len - csm->rx_head >= sizeof(LDPHdr))
     {
-        len = recv(csm->sock_fd, peer_msg + recv_len, sizeof(LDPHdr) - recv_len, 0);
-        if (len == -1)
+        ldp_hdr = (LDPHdr*)&block->data[csm->rx_head];
+        msg_len = ntohs(ldp_hdr->msg_len) + MSG_L_INCLUD_U_BIT_MSG_T_L_FIELDS;
+        if (msg_len < sizeof(LDPHdr))
         {
-            perror("recv(). Error");
-            goto recv_err;
+            ICCPD_LOG_WARN(__FUNCTION__, "Peer msg len %u is illegal", msg_len);
+            return MCLAG_ERROR;
         }
-        else if (len == 0)
+
+        /*Partial msg, wait for the rest*/
+        if (block->len - csm->rx_head < msg_len)
+            break;
+
+        iccp_latency_count_msg(ICCP_LAT_RX, &block->data[csm->rx_head], msg_len);
+        iccp_capture_write(ICCP_CAPTURE_PEER_RX, csm->mlag_id, &block->data[csm->rx_head], msg_len);
+
+        msg = iccp_csm_slice_msg(csm, csm->rx_head, msg_len);
+        if (msg)
         {
-            ICCPD_LOG_WARN(__FUNCTION__, "Peer disconnect for receive error");
-            goto recv_err;
+            msg->trace_usec = rx_usec;
+            iccp_csm_enqueue_msg(csm, msg);
+            ++csm->icc_msg_in_count;
         }
-        recv_len += len;
-        /*usleep(100);*/
+        else
+            ++csm->i_msg_in_count;
+
+        ++csm->io_stats.rx_msgs;
+        csm->rx_head += msg_len;
     }
 
-    data_len = ntohs(ldp_hdr->msg_len) - MSG_L_INCLUD_U_BIT_MSG_T_L_FIELDS;
-    pos = 0;
+    return 0;
+}
+
+/* Receive packets call back function */
+int scheduler_csm_read_callback(struct CSM* csm)
+{
+    int budget = CSM_RX_READ_BUDGET;
+    int recv_len = 0;
+    int rx_total = 0;
+    uint32_t space = 0;
+    char* buf = NULL;
 
-    while (data_len > 0)
+    if (csm->sock_fd <= 0)
+        return MCLAG_ERROR;
+
+    while (budget-- > 0)
     {
-        recv_len = recv(csm->sock_fd, &data[pos], data_len, 0);
+        buf = iccp_csm_rx_space(csm, &space);
+        if (buf == NULL)
+            return MCLAG_ERROR;
+
+        recv_len = recv(csm->sock_fd, buf, space, 0);
         if (recv_len == -1)
         {
-            perror("continue recv(). Error");
+            if (errno == EINTR)
+                continue;
+
+            if (errno == EAGAIN || errno == EWOULDBLOCK)
+                break;
+
+            ICCPD_LOG_WARN(__FUNCTION__, "Peer disconnect for receive error: %s", strerror(errno));
             goto recv_err;
         }
         else if (recv_len == 0)
@@ -172,19 +276,17 @@ int scheduler_csm_read_callback(struct CSM* csm)
             ICCPD_LOG_WARN(__FUNCTION__, "Peer disconnect for read error");
             goto recv_err;
         }
-        data_len -= recv_len;
-        pos += recv_len;
-        /*usleep(100);*/
-    }
 
-    retval = iccp_csm_init_msg(&msg, peer_msg, ntohs(ldp_hdr->msg_len) + MSG_L_INCLUD_U_BIT_MSG_T_L_FIELDS);
-    if (retval == 0)
-    {
-        iccp_csm_enqueue_msg(csm, msg);
-        ++csm->icc_msg_in_count;
+        csm->rx_block->len += recv_len;
+        csm->io_stats.rx_bytes += recv_len;
+        rx_total += recv_len;
+
+        if (scheduler_csm_parse_msg(csm) < 0)
+            goto recv_err;
     }
-    else
-        ++csm->i_msg_in_count;
+
+    if (rx_total > 0)
+        mlacp_fast_hello_rx_activity(csm);
 
     return 1;
 
@@ -193,6 +295,15 @@ int scheduler_csm_read_callback(struct CSM* csm)
     return MCLAG_ERROR;
 }
 
+/* Send queue call back function, on EPOLLOUT and at the end of each loop*/
+int scheduler_csm_write_callback(struct CSM* csm)
+{
+    if (csm->sock_fd <= 0)
+        return MCLAG_ERROR;
+
+    return iccp_csm_flush(csm);
+}
+
 /* Handle server accept client */
 int scheduler_server_accept()
 {
@@ -218,6 +329,11 @@ int scheduler_server_accept()
     {
         goto reject_client;
     }
+    else if (sys->replay_file_path != NULL)
+    {
+        /* Sessions come from the replay file*/
+        goto reject_client;
+    }
     else
     {
         csm = system_get_csm_by_peer_ip(inet_ntoa(client_addr.sin_addr));
@@ -267,9 +383,11 @@ int scheduler_server_accept()
     }
 
     csm->sock_fd = new_fd;
+    fcntl(new_fd, F_SETFL, fcntl(new_fd, F_GETFL, 0) | O_NONBLOCK);
     csm->current_state = ICCP_NONEXISTENT;
     FD_SET(new_fd, &(sys->readfd));
     sys->readfd_count++;
+    iccp_capture_session(csm, 1, 1);
     session_conn_thread_unlock(&csm->conn_mutex);
     return 0;
 }
@@ -300,19 +418,36 @@ void iccp_get_start_type(struct System* sys)
 void scheduler_init()
 {
     struct System* sys = NULL;
+    uint8_t start_type;
 
     if (!(sys = system_get_instance()))
         return;
 
+    /*A replay takes the boot type, config, kernel state and checkpoint
+       from the file, and has no mclagsyncd or mclagdctl*/
+    if (sys->replay_file_path != NULL)
+    {
+        if (iccp_replay_start(sys) < 0)
+            ICCPD_LOG_WARN(__FUNCTION__, "Replay file %s can't be used", sys->replay_file_path);
+        return;
+    }
+
+    iccp_capture_start(sys);
     iccp_get_start_type(sys);
+    start_type = (sys->warmboot_start == WARM_REBOOT);
+    iccp_capture_write(ICCP_CAPTURE_START, -1, &start_type, sizeof(start_type));
     /*Get kernel interface and port */
     iccp_sys_local_if_list_get_init();
     iccp_sys_local_if_list_get_addr();
     /*Interfaces must be created before this func called*/
     iccp_config_from_file(sys->config_file_path);
 
-    /*Get kernel ARP info */
-    iccp_neigh_get_init();
+    /*Tables of the last run, each entry is stale until confirmed*/
+    iccp_checkpoint_restore(sys);
+
+    /*Get kernel ARP info, restored ARP/ND not in kernel any more are dropped*/
+    if (iccp_neigh_get_init() >= 0)
+        iccp_checkpoint_sweep(sys, ICCP_CHECKPOINT_ARP | ICCP_CHECKPOINT_NDISC);
 
     if (iccp_connect_syncd() < 0)
     {
@@ -391,18 +526,38 @@ void scheduler_loop()
 
     while (1)
     {
-        if (sys->sync_fd <= 0)
+        if (sys->replay_file_path != NULL)
+        {
+            iccp_replay_feed(sys);
+        }
+        else if (sys->sync_fd <= 0)
         {
             iccp_connect_syncd();
         }
 
-        /*handle socket slelect event ,If no message received, it will block 0.1s*/
-        iccp_handle_events(sys);
+        /*handle socket and timer events, block until one comes unless the FSMs have work left*/
+        iccp_handle_events(sys, sys->fsm_kick ? 0 : -1);
         /*csm, app state machine transit */
-        scheduler_transit_fsm();
+        if (sys->fsm_kick)
+        {
+            sys->fsm_kick = 0;
+            scheduler_transit_fsm();
+        }
+        /*push out the messages queued to mclagsyncd in this loop*/
+        iccp_syncd_flush(sys);
+        /*and the ARP/ND requests to kernel*/
+        iccp_netlink_neigh_flush(sys);
+
+        if (iccp_replay_done(sys))
+        {
+            iccp_capture_stop();
+            return;
+        }
 
         if (sys->warmboot_exit == WARM_REBOOT)
         {
+            iccp_checkpoint_save(sys, 1);
+            iccp_capture_stop();
             ICCPD_LOG_DEBUG(__FUNCTION__, "Warm reboot exit ......");
             return;
         }
@@ -452,8 +607,24 @@ int mlacp_sync_with_kernel_callback()
 /* Scheduler start while loop */
 void scheduler_start()
 {
+    struct System* sys = NULL;
+
     /*mlacp_sync_with_kernel_callback();*/
 
+    iccp_timer_init(&scheduler_fsm_timer, scheduler_fsm_timer_handler, NULL);
+    iccp_timer_init(&scheduler_fdb_timer, scheduler_fdb_timer_handler, NULL);
+    iccp_timer_start(&scheduler_fsm_timer, 0);
+    iccp_timer_init(&scheduler_log_timer, scheduler_log_timer_handler, NULL);
+    iccp_timer_start(&scheduler_fdb_timer, FDB_PULL_INTERVAL_SEC * 1000);
+    iccp_timer_start(&scheduler_log_timer, LOG_RATE_WINDOW_MSEC);
+    scheduler_fsm_kick();
+
+    if ((sys = system_get_instance()) != NULL && sys->replay_file_path == NULL)
+    {
+        iccp_ingest_start(sys);
+        iccp_checkpoint_start(sys);
+    }
+
     scheduler_loop();
 
     return;
@@ -548,9 +719,11 @@ void session_client_conn_handler(struct CSM *csm)
         if (err)
             goto conn_fail;
         csm->sock_fd = connFd;
+        fcntl(connFd, F_SETFL, fcntl(connFd, F_GETFL, 0) | O_NONBLOCK);
         FD_SET(connFd, &(sys->readfd));
         sys->readfd_count++;
         ICCPD_LOG_INFO(__FUNCTION__, "Connect to server %s sucess .", csm->peer_ip);
+        iccp_capture_session(csm, 1, 0);
         goto conn_ok;
     }
 
@@ -591,6 +764,10 @@ int scheduler_prepare_session(struct CSM* csm)
         goto time_update;
     }
 
+    /* Sessions come from the replay file*/
+    if (system_get_instance()->replay_file_path != NULL)
+        goto time_update;
+
     if ((ret = scheduler_check_csm_config(csm)) < 0)
         goto time_update;
 
@@ -755,6 +932,7 @@ void scheduler_session_disconnect_handler(struct CSM* csm)
     scheduler_unregister_sock_read_event_callback(csm);
     if (csm->sock_fd > 0)
     {
+        iccp_capture_session(csm, 0, 0);
         event.data.fd = csm->sock_fd;
         event.events = EPOLLIN;
         epoll_ctl(sys->epoll_fd, EPOLL_CTL_DEL, csm->sock_fd, &event);
@@ -763,6 +941,8 @@ void scheduler_session_disconnect_handler(struct CSM* csm)
         csm->sock_fd = -1;
     }
 
+    iccp_csm_io_reset(csm);
+    mlacp_fast_hello_reset(csm);
     mlacp_peer_disconn_handler(csm);
     MLACP(csm).current_state = MLACP_STATE_INIT;
     iccp_csm_status_reset(csm, 0);
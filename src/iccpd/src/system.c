@@ -27,6 +27,10 @@
 #include "../include/logger.h"
 #include "../include/iccp_netlink.h"
 #include "../include/scheduler.h"
+#include "../include/iccp_timer.h"
+#include "../include/iccp_ingest.h"
+#include "../include/iccp_latency.h"
+#include "../include/iccp_checkpoint.h"
 
 /* Singleton */
 struct System* system_get_instance()
@@ -50,6 +54,8 @@ struct System* system_get_instance()
 /* System instance initialization */
 void system_init(struct System* sys)
 {
+    int i;
+
     if (sys == NULL )
         return;
 
@@ -65,21 +71,83 @@ void system_init(struct System* sys)
     LIST_INIT(&(sys->csm_list));
     LIST_INIT(&(sys->lif_list));
     LIST_INIT(&(sys->lif_purge_list));
+    for (i = 0; i < LOCAL_IF_HASH_SIZE; i++)
+    {
+        LIST_INIT(&(sys->lif_name_hash[i]));
+        LIST_INIT(&(sys->lif_ifindex_hash[i]));
+        LIST_INIT(&(sys->lif_po_id_hash[i]));
+    }
+
+    TAILQ_INIT(&(sys->syncd_tx_list));
+    sys->syncd_tx_fdb_frame = NULL;
+    sys->syncd_tx_offset = 0;
+    sys->syncd_tx_bytes = 0;
+    sys->syncd_tx_pollout = 0;
+    sys->syncd_tx_stalled = 0;
+    TAILQ_INIT(&(sys->syncd_defer_list));
+    for (i = 0; i < SYNCD_TX_DEFER_HASH_SIZE; i++)
+        LIST_INIT(&(sys->syncd_defer_hash[i]));
+    sys->syncd_defer_num = 0;
+    memset(&(sys->syncd_tx_stats), 0, sizeof(struct SyncdTxStats));
+    sys->fdb_subscribed = 0;
+    sys->fdb_snapshot = 0;
+    sys->fdb_resubscribing = 0;
+    sys->fdb_seq = 0;
+    sys->fdb_gen = 0;
+    memset(&(sys->fdb_sub_stats), 0, sizeof(struct FdbSubscribeStats));
+    sys->syncd_rx_buf = NULL;
+    sys->syncd_rx_size = 0;
+    sys->syncd_rx_len = 0;
+    sys->genric_sock = NULL;
+    sys->genric_event_sock = NULL;
+    sys->route_sock = NULL;
+    sys->route_event_sock = NULL;
+    sys->neigh_sock = NULL;
+    TAILQ_INIT(&(sys->neigh_tx_list));
+    sys->neigh_tx_msgs = 0;
+    sys->neigh_tx_pollout = 0;
+    sys->neigh_seq = 0;
+    sys->neigh_batch_id = 0;
+    sys->neigh_pending_num = 0;
+    sys->neigh_pending = NULL;
+    memset(sys->neigh_batch, 0, sizeof(sys->neigh_batch));
+    memset(&(sys->neigh_stats), 0, sizeof(struct NeighBatchStats));
+    sys->neigh_dump_sock = NULL;
 
     sys->log_file_path = strdup("/var/log/iccpd.log");
     sys->cmd_file_path = strdup("/var/run/iccpd/iccpd.vty");
     sys->config_file_path = strdup("/etc/iccpd/iccpd.conf");
     sys->mclagdctl_file_path = strdup("/var/run/iccpd/mclagdctl.sock");
+    sys->checkpoint_file_path = strdup(ICCP_CHECKPOINT_FILE);
+    sys->capture_file_path = NULL;
+    sys->replay_file_path = NULL;
+    sys->replay_speed = 0;
     sys->pid_file_fd = 0;
     sys->telnet_port = 2015;
     FD_ZERO(&(sys->readfd));
     sys->readfd_count = 0;
     sys->csm_trans_time = 0;
-    sys->need_sync_team_again = 0;
-    sys->need_sync_netlink_again = 0;
-    scheduler_server_sock_init();
-    iccp_system_init_netlink_socket();
-    iccp_init_netlink_event_fd(sys);
+    sys->fsm_kick = 0;
+    sys->netlink_resync_dirty = 0;
+    memset(&(sys->netlink_resync_stats), 0, sizeof(struct NetlinkResyncStats));
+    iccp_latency_reset();
+    iccp_timer_wheel_init(ICCP_TIMER_TICK_MSEC);
+}
+
+/* Once the options are known, a replay has no peer or kernel sockets*/
+int system_init_sockets(struct System* sys)
+{
+    if (sys == NULL )
+        return MCLAG_ERROR;
+
+    if (sys->replay_file_path == NULL)
+    {
+        scheduler_server_sock_init();
+        iccp_system_init_netlink_socket();
+        iccp_ingest_init(sys);
+    }
+
+    return iccp_init_netlink_event_fd(sys);
 }
 
 /* System instance tear down */
@@ -104,7 +172,7 @@ void system_finalize()
     while (!LIST_EMPTY(&(sys->lif_list)))
     {
         local_if = LIST_FIRST(&(sys->lif_list));
-        LIST_REMOVE(local_if, system_next);
+        local_if_unlink(local_if);
         local_if_finalize(local_if);
     }
 
@@ -115,7 +183,9 @@ void system_finalize()
         local_if_finalize(local_if);
     }
 
+    iccp_ingest_finalize(sys);
     iccp_system_dinit_netlink_socket();
+    iccp_timer_wheel_finalize();
 
     if (sys->log_file_path != NULL )
         free(sys->log_file_path);
@@ -123,12 +193,20 @@ void system_finalize()
         free(sys->cmd_file_path);
     if (sys->config_file_path != NULL )
         free(sys->config_file_path);
+    if (sys->checkpoint_file_path != NULL )
+        free(sys->checkpoint_file_path);
+    if (sys->capture_file_path != NULL )
+        free(sys->capture_file_path);
+    if (sys->replay_file_path != NULL )
+        free(sys->replay_file_path);
     if (sys->pid_file_fd > 0)
         close(sys->pid_file_fd);
     if (sys->server_fd > 0)
         close(sys->server_fd);
     if (sys->sync_fd > 0)
         close(sys->sync_fd);
+    if (sys->syncd_rx_buf != NULL)
+        free(sys->syncd_rx_buf);
     if (sys->sync_ctrl_fd > 0)
         close(sys->sync_ctrl_fd);
     if (sys->arp_receive_fd > 0)
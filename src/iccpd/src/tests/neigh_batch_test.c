@@ -0,0 +1,361 @@
+/*
+ *  neigh_batch_test.c
+ *  Kernel neighbor programming test, batches of ARP/ND requests in a netns.
+ *
+ * Copyright(c) 2016-2019 Nephos/Estinet.
+ *
+ * This program is free software; you can redistribute it and/or modify it
+ * under the terms and conditions of the GNU General Public License,
+ * version 2, as published by the Free Software Foundation.
+ *
+ * This program is distributed in the hope it will be useful, but WITHOUT
+ * ANY WARRANTY; without even the implied warranty of MERCHANTABILITY or
+ * FITNESS FOR A PARTICULAR PURPOSE.  See the GNU General Public License for
+ * more details.
+ *
+ * You should have received a copy of the GNU General Public License along with
+ * this program; if not, see <http://www.gnu.org/licenses/>.
+ *
+ * The full GNU General Public License is included in this distribution in
+ * the file called "COPYING".
+ *
+ *  Maintainer: jianjun, grace Li from nephos
+ */
+
+/*
+ * Runs in its own network namespace, created from a user namespace when
+ * not started by root:
+ *
+ *   nbt0 <---- veth ----> nbt1
+ *
+ * Adds then deletes a few batches of ARP/ND entries on nbt0 through
+ * iccp_netlink_neighbor_request(). Some requests are meant to fail: adds
+ * on a port whose ifindex the kernel does not have (ENODEV) and deletes
+ * of entries that are not there (ENOENT). Each request is checked by its
+ * sequence number, the ack must carry the result of that very request.
+ *
+ * Needs the veth driver and the ip command, the exit status is 77 if the
+ * namespace or the ports can't be set up.
+ */
+
+#define _GNU_SOURCE
+
+#include <stdio.h>
+#include <stdlib.h>
+#include <stdarg.h>
+#include <stdint.h>
+#include <string.h>
+#include <unistd.h>
+#include <errno.h>
+#include <fcntl.h>
+#include <sched.h>
+#include <time.h>
+#include <net/if.h>
+#include <arpa/inet.h>
+
+#include "../../include/system.h"
+#include "../../include/port.h"
+#include "../../include/iccp_netlink.h"
+
+#define NBT_PORT            "nbt0"
+#define NBT_PEER            "nbt1"
+#define NBT_GONE            "nbtgone"   /* local port the kernel does not have*/
+#define NBT_GONE_IFINDEX    0x7ffffff0
+#define NBT_ENTRIES         600         /* a few batches, below the ARP gc_thresh2*/
+#define NBT_GONE_EVERY      7
+#define NBT_MISSING_EVERY   5
+#define NBT_WAIT_MSEC       5000
+#define NBT_SKIP            77
+
+struct nbt_request
+{
+    uint32_t seq;
+    int expect;
+    int family;
+    int add;
+    int index;
+};
+
+static struct nbt_request nbt_requests[2 * NBT_ENTRIES];
+static int nbt_request_num;
+static int nbt_expect_failures;
+
+static uint64_t nbt_now_msec()
+{
+    struct timespec now;
+
+    clock_gettime(CLOCK_MONOTONIC, &now);
+
+    return (uint64_t)now.tv_sec * 1000 + now.tv_nsec / 1000000;
+}
+
+static int nbt_write_file(const char* path, const char* fmt, ...)
+{
+    va_list ap;
+    FILE* fp = NULL;
+    int ret;
+
+    if ((fp = fopen(path, "w")) == NULL)
+        return -1;
+
+    va_start(ap, fmt);
+    ret = vfprintf(fp, fmt, ap);
+    va_end(ap);
+
+    if (fclose(fp) != 0)
+        ret = -1;
+
+    return ret < 0 ? -1 : 0;
+}
+
+static int nbt_run(const char* fmt, ...)
+{
+    char cmd[256];
+    va_list ap;
+
+    va_start(ap, fmt);
+    vsnprintf(cmd, sizeof(cmd), fmt, ap);
+    va_end(ap);
+
+    return system(cmd) == 0 ? 0 : -1;
+}
+
+static int nbt_enter_netns()
+{
+    uid_t uid = getuid();
+    gid_t gid = getgid();
+    int flags = CLONE_NEWNET;
+
+    if (uid != 0)
+        flags |= CLONE_NEWUSER;
+
+    if (unshare(flags) < 0)
+    {
+        fprintf(stderr, "Failed to create namespaces: %s\n", strerror(errno));
+        return -1;
+    }
+
+    if (uid != 0)
+    {
+        if (nbt_write_file("/proc/self/setgroups", "deny") < 0
+            || nbt_write_file("/proc/self/uid_map", "0 %u 1", uid) < 0
+            || nbt_write_file("/proc/self/gid_map", "0 %u 1", gid) < 0)
+        {
+            fprintf(stderr, "Failed to map uid %u in the user namespace\n", uid);
+            return -1;
+        }
+    }
+
+    if (nbt_run("ip link set lo up") < 0
+        || nbt_run("ip link add " NBT_PORT " type veth peer name " NBT_PEER) < 0
+        || nbt_run("ip link set " NBT_PORT " up") < 0
+        || nbt_run("ip link set " NBT_PEER " up") < 0)
+    {
+        fprintf(stderr, "Failed to create the veth ports\n");
+        return -1;
+    }
+
+    return 0;
+}
+
+/* Entry i, 10.1.x.x / fd00:1::x, or one that is never added*/
+static void nbt_addr(int family, int index, int missing, uint8_t* addr)
+{
+    char buf[INET6_ADDRSTRLEN];
+
+    memset(addr, 0, 16);
+    if (family == AF_INET)
+        snprintf(buf, sizeof(buf), "10.%d.%d.%d", missing ? 2 : 1, (index >> 8) & 0xff, index & 0xff);
+    else
+        snprintf(buf, sizeof(buf), "fd00:%d::%x", missing ? 2 : 1, index);
+
+    inet_pton(family, buf, addr);
+}
+
+static int nbt_request(struct System* sys, int family, int index, int missing, int add, char* port, int expect)
+{
+    struct nbt_request* req = NULL;
+    uint8_t addr[16];
+    uint8_t mac[ETHER_ADDR_LEN] = { 0x02, 0x00, 0x5e, 0x00, 0x00, 0x00 };
+
+    nbt_addr(family, index, missing, addr);
+    mac[4] = (index >> 8) & 0xff;
+    mac[5] = index & 0xff;
+
+    if (iccp_netlink_neighbor_request(family, addr, add, mac, port) < 0)
+    {
+        fprintf(stderr, "Request %d (%s) was not queued\n", index, add ? "add" : "del");
+        return -1;
+    }
+
+    req = &nbt_requests[nbt_request_num++];
+    req->seq = sys->neigh_seq;
+    req->expect = expect;
+    req->family = family;
+    req->add = add;
+    req->index = index;
+    if (expect)
+        nbt_expect_failures++;
+
+    return 0;
+}
+
+/* Send the queued batches and take the acks*/
+static int nbt_wait_acks(struct System* sys)
+{
+    uint64_t start = nbt_now_msec();
+
+    iccp_netlink_neigh_flush(sys);
+    while (sys->neigh_pending_num > 0 || !TAILQ_EMPTY(&(sys->neigh_tx_list)))
+    {
+        if (nbt_now_msec() - start > NBT_WAIT_MSEC)
+        {
+            fprintf(stderr, "%u requests not acked in %d ms\n", sys->neigh_pending_num, NBT_WAIT_MSEC);
+            return -1;
+        }
+
+        iccp_handle_events(sys, 100);
+    }
+
+    return 0;
+}
+
+/* The ack kept in the slot of each sequence must be the one expected*/
+static int nbt_check_acks(struct System* sys)
+{
+    struct NeighPending* pending = NULL;
+    struct nbt_request* req = NULL;
+    int errors = 0;
+    int i;
+
+    for (i = 0; i < nbt_request_num; i++)
+    {
+        req = &nbt_requests[i];
+        pending = &sys->neigh_pending[req->seq & (NEIGH_PENDING_MAX - 1)];
+
+        if (pending->seq == req->seq && !pending->in_use && pending->error == req->expect)
+            continue;
+
+        if (errors++ < 10)
+            fprintf(stderr, "seq %u: %s %s entry %d, ack %d, expected %d%s\n",
+                    req->seq, req->add ? "add" : "del", (req->family == AF_INET) ? "ARP" : "ND",
+                    req->index, pending->error, req->expect,
+                    (pending->seq != req->seq) ? ", slot reused" : (pending->in_use ? ", not acked" : ""));
+    }
+
+    if (sys->neigh_stats.failures != nbt_expect_failures)
+    {
+        fprintf(stderr, "%llu failures acked, expected %d\n",
+                (unsigned long long)sys->neigh_stats.failures, nbt_expect_failures);
+        errors++;
+    }
+
+    if (sys->neigh_stats.acks != sys->neigh_stats.requests
+        || sys->neigh_stats.lost_acks || sys->neigh_stats.dropped)
+    {
+        fprintf(stderr, "%llu requests, %llu acks, %llu lost, %llu dropped\n",
+                (unsigned long long)sys->neigh_stats.requests, (unsigned long long)sys->neigh_stats.acks,
+                (unsigned long long)sys->neigh_stats.lost_acks, (unsigned long long)sys->neigh_stats.dropped);
+        errors++;
+    }
+
+    return errors ? -1 : 0;
+}
+
+static int nbt_kernel_entries(int family)
+{
+    char cmd[64];
+    FILE* fp = NULL;
+    int num = -1;
+
+    snprintf(cmd, sizeof(cmd), "ip -%d neigh show dev " NBT_PORT " | wc -l", (family == AF_INET) ? 4 : 6);
+    if ((fp = popen(cmd, "r")) == NULL)
+        return -1;
+    if (fscanf(fp, "%d", &num) != 1)
+        num = -1;
+    pclose(fp);
+
+    return num;
+}
+
+static int nbt_phase(struct System* sys, const char* name, int add)
+{
+    int expect[2] = { 0, 0 };
+    int kernel[2];
+    int family, gone;
+    int i;
+
+    nbt_request_num = 0;
+    nbt_expect_failures = 0;
+    memset(&sys->neigh_stats, 0, sizeof(sys->neigh_stats));
+
+    for (i = 0; i < NBT_ENTRIES; i++)
+    {
+        family = (i % 4 == 3) ? AF_INET6 : AF_INET;
+        gone = (i % NBT_GONE_EVERY == NBT_GONE_EVERY - 1);
+
+        /* Adds on the gone port fail, so do the deletes of what they did not add*/
+        if (add)
+        {
+            if (nbt_request(sys, family, i, 0, 1, gone ? NBT_GONE : NBT_PORT, gone ? -ENODEV : 0) < 0)
+                return -1;
+            if (!gone)
+                expect[family == AF_INET6]++;
+        }
+        else
+        {
+            if (nbt_request(sys, family, i, 0, 0, NBT_PORT, gone ? -ENOENT : 0) < 0)
+                return -1;
+            if (i % NBT_MISSING_EVERY == 0
+                && nbt_request(sys, family, i, 1, 0, NBT_PORT, -ENOENT) < 0)
+                return -1;
+        }
+    }
+
+    if (nbt_wait_acks(sys) < 0 || nbt_check_acks(sys) < 0)
+    {
+        printf("FAIL: %s\n", name);
+        return -1;
+    }
+
+    kernel[0] = nbt_kernel_entries(AF_INET);
+    kernel[1] = nbt_kernel_entries(AF_INET6);
+    if (kernel[0] != expect[0] || kernel[1] != expect[1])
+    {
+        fprintf(stderr, "Kernel has %d ARP and %d ND entries, expected %d and %d\n",
+                kernel[0], kernel[1], expect[0], expect[1]);
+        printf("FAIL: %s\n", name);
+        return -1;
+    }
+
+    printf("PASS: %s, %d requests in %llu batches, %d failures matched by seq\n",
+           name, nbt_request_num, (unsigned long long)sys->neigh_stats.batches, nbt_expect_failures);
+
+    return 0;
+}
+
+int main(int argc, char* argv[])
+{
+    struct System* sys = NULL;
+
+    if (nbt_enter_netns() < 0)
+        return NBT_SKIP;
+
+    if ((sys = system_get_instance()) == NULL)
+        return EXIT_FAILURE;
+
+    if (iccp_system_init_netlink_socket() < 0 || iccp_init_netlink_event_fd(sys) < 0)
+    {
+        fprintf(stderr, "Failed to open the netlink sockets\n");
+        return NBT_SKIP;
+    }
+
+    if (local_if_create(if_nametoindex(NBT_PORT), NBT_PORT, IF_T_PORT) == NULL
+        || local_if_create(NBT_GONE_IFINDEX, NBT_GONE, IF_T_PORT) == NULL)
+        return EXIT_FAILURE;
+
+    if (nbt_phase(sys, "add", 1) < 0 || nbt_phase(sys, "delete", 0) < 0)
+        return EXIT_FAILURE;
+
+    return EXIT_SUCCESS;
+}